@@ -15,31 +15,20 @@
 
 namespace ArUcoMarkerTracker
 {
-    struct DetectedMarker
+    namespace
     {
-        int32_t markerId;
+        const uint64_t c_markerTrackingTaskKey = 0;
 
-        Eigen::Vector3f point;
-        Eigen::Vector3f dir;
-
-        // Image position
-        int x;
-        int y;
-    };
+        const uint64_t c_statisticsReportInterval = 300;
+    }
 
-    std::map<int32_t, DetectedMarker> DetectArUcoMarkers(
-        HoloLensForCV::SensorFrame^ frame)
+    void DetectArUcoMarkers(
+        HoloLensForCV::SensorFrame^ frame,
+        const int32_t viewIndex,
+        ArUcoMarkerDetector& markerDetector,
+        std::vector<MarkerCornerObservation>& observations)
     {
-        std::map<int32_t, DetectedMarker> detectedMarkers;
-
-        cv::Ptr<cv::aruco::DetectorParameters> arucoDetectorParameters =
-            cv::aruco::DetectorParameters::create();
-
-        cv::Ptr<cv::aruco::Dictionary> arucoDictionary =
-            cv::aruco::getPredefinedDictionary(
-                cv::aruco::DICT_6X6_1000);
-
-        std::vector<std::vector<cv::Point2f>> arucoMarkers, arucoRejectedCandidates;
+        std::vector<std::vector<cv::Point2f>> arucoMarkers;
         std::vector<int32_t> arucoMarkerIds;
 
         cv::Mat wrappedImage;
@@ -48,37 +37,21 @@ namespace ArUcoMarkerTracker
             frame,
             wrappedImage);
 
-        cv::aruco::detectMarkers(
+        markerDetector.Detect(
             wrappedImage,
-            arucoDictionary,
-            arucoMarkers,
             arucoMarkerIds,
-            arucoDetectorParameters,
-            arucoRejectedCandidates);
- 
+            arucoMarkers);
+
         if (!arucoMarkerIds.empty())
         {
             Windows::Foundation::Numerics::float4x4 camToRef;
 
             if (!Windows::Foundation::Numerics::invert(frame->CameraViewTransform, &camToRef))
             {
-                return detectedMarkers;
+                return;
             }
 
             Windows::Foundation::Numerics::float4x4 camToOrigin = camToRef * frame->FrameToOrigin;
-            Eigen::Vector3f camPinhole(camToOrigin.m41, camToOrigin.m42, camToOrigin.m43);
-
-            Eigen::Matrix3f camToOriginR;
-
-            camToOriginR(0, 0) = camToOrigin.m11;
-            camToOriginR(0, 1) = camToOrigin.m12;
-            camToOriginR(0, 2) = camToOrigin.m13;
-            camToOriginR(1, 0) = camToOrigin.m21;
-            camToOriginR(1, 1) = camToOrigin.m22;
-            camToOriginR(1, 2) = camToOrigin.m23;
-            camToOriginR(2, 0) = camToOrigin.m31;
-            camToOriginR(2, 1) = camToOrigin.m32;
-            camToOriginR(2, 2) = camToOrigin.m33;
 
             for (size_t i = 0; i < arucoMarkerIds.size(); ++i)
             {
@@ -96,15 +69,6 @@ namespace ArUcoMarkerTracker
 
                 for (size_t j = 0; j < markerCorners.size(); ++j)
                 {
-                    DetectedMarker detectedMarker;
-
-                    detectedMarker.markerId =
-                        arucoMarkerIds[i] * 4 + j;
-
-                    detectedMarker.x = static_cast<int>(markerCorners[j].x);
-                    detectedMarker.y = static_cast<int>(markerCorners[j].y);
-                    detectedMarker.point = camPinhole;
-
                     Windows::Foundation::Point uv;
 
                     uv.X = static_cast<float>(markerCorners[j].x);
@@ -117,78 +81,58 @@ namespace ArUcoMarkerTracker
                         continue;
                     }
 
-                    Eigen::Vector3f dirCam;
-
-                    dirCam[0] = xy.X;
-                    dirCam[1] = xy.Y;
-                    dirCam[2] = 1.0f;
-
-                    detectedMarker.dir =
-                        camToOriginR.transpose() * dirCam;
-
-                    detectedMarkers[detectedMarker.markerId] =
-                        detectedMarker;
+                    observations.push_back(
+                        CreateMarkerCornerObservation(
+                            arucoMarkerIds[i] * 4 + static_cast<int32_t>(j),
+                            viewIndex,
+                            camToOrigin,
+                            xy));
                 }
             }
         }
-
-        return detectedMarkers;
     }
 
-    struct TrackedMarker
+    std::vector<TriangulatedMarkerCorner> TrackArUcoMarkers(
+        const std::vector<HoloLensForCV::SensorFrame^>& frames,
+        std::array<ArUcoMarkerDetector, c_numberOfMarkerTrackingCameras>& markerDetectors,
+        MarkerTriangulator& markerTriangulator)
     {
-        int32_t markerId;
-        Eigen::Vector3f point;
-    };
+        std::vector<std::vector<MarkerCornerObservation>> observationsPerView(
+            frames.size());
 
-    std::map<int32_t, TrackedMarker> TrackArUcoMarkers(
-        HoloLensForCV::SensorFrame^ leftFrame,
-        HoloLensForCV::SensorFrame^ rightFrame)
-    {
-        std::map<int32_t, TrackedMarker> trackedMarkers;
+        //
+        // The cameras are independent, so detect in all of the images concurrently.
+        //
+        concurrency::parallel_for(
+            size_t(0),
+            frames.size(),
+            [&](size_t viewIndex)
+            {
+                if (nullptr != frames[viewIndex])
+                {
+                    DetectArUcoMarkers(
+                        frames[viewIndex],
+                        static_cast<int32_t>(viewIndex),
+                        markerDetectors[viewIndex],
+                        observationsPerView[viewIndex]);
+                }
+            });
 
-        Windows::Foundation::Numerics::float4x4 leftCamToRef;
+        std::vector<MarkerCornerObservation> observations;
 
-        if (!Windows::Foundation::Numerics::invert(leftFrame->CameraViewTransform, &leftCamToRef))
+        for (const auto& viewObservations : observationsPerView)
         {
-            return trackedMarkers;
+            observations.insert(
+                observations.end(),
+                viewObservations.begin(),
+                viewObservations.end());
         }
 
-        auto leftCamToOrigin = leftCamToRef * leftFrame->FrameToOrigin;
-
-        auto leftDetections = DetectArUcoMarkers(leftFrame);
-        auto rightDetections = DetectArUcoMarkers(rightFrame);
-
-        for (auto leftDetectionIterator : leftDetections)
-        {
-            auto leftDetection = leftDetectionIterator.second;
-
-            if (rightDetections.count(leftDetection.markerId))
-            {
-                auto rightDetection = rightDetections[leftDetection.markerId];
-
-                auto a = leftDetection.point;
-                auto b = leftDetection.dir;
-                auto c = rightDetection.point;
-                auto d = rightDetection.dir;
-
-                Eigen::Matrix<float, 3, 2> A;
-
-                A.col(0) = b;
-                A.col(1) = -d;
-
-                Eigen::Vector3f y = (c - a);
+        std::vector<TriangulatedMarkerCorner> trackedMarkers;
 
-                Eigen::Vector2f x = (A.transpose() * A).inverse() * (A.transpose() * y);
-
-                TrackedMarker triangulatedMarkerCorner;
-
-                triangulatedMarkerCorner.markerId = leftDetection.markerId;
-                triangulatedMarkerCorner.point = (a + b * x[0] + c + d * x[1]) * 0.5f;
-
-                trackedMarkers[triangulatedMarkerCorner.markerId] = triangulatedMarkerCorner;
-            }
-        }
+        markerTriangulator.Triangulate(
+            observations,
+            trackedMarkers);
 
         return trackedMarkers;
     }
@@ -200,6 +144,17 @@ namespace ArUcoMarkerTracker
             HoloLensForCV::MediaFrameSourceGroupType::HoloLensResearchModeSensors)
         , _holoLensMediaFrameSourceGroupStarted(false)
     {
+#if defined(_DEBUG)
+        //
+        // Catches mistakes in the camera conventions before they show up as markers
+        // that are never tracked.
+        //
+        ValidateMarkerTriangulator();
+#endif
+
+#if MARKER_TRIANGULATOR_BENCHMARK
+        BenchmarkMarkerTriangulator();
+#endif
     }
 
     void AppMain::OnHolographicSpaceChanged(
@@ -286,9 +241,7 @@ namespace ArUcoMarkerTracker
             return;
         }
 
-        static long long s_previousTimestamp = 0;
-
-        if (leftFrame->Timestamp.UniversalTime == s_previousTimestamp)
+        if (leftFrame->Timestamp.UniversalTime == _previousMarkerTrackingTimestamp)
         {
 #if 0
             dbg::trace(L"AppMain::OnUpdateFor3DTracking: timestamp did not change");
@@ -297,20 +250,44 @@ namespace ArUcoMarkerTracker
             return;
         }
 
-        if (InterlockedIncrement(&_markerUpdatesInProgress) > 1)
-        {
-            InterlockedDecrement(&_markerUpdatesInProgress);
+        _previousMarkerTrackingTimestamp = leftFrame->Timestamp.UniversalTime;
 
-            return;
-        }
+        //
+        // The side facing cameras are used when they have a frame close enough to the
+        // front facing pair; the triangulation works with any subset of two or more views.
+        //
+        std::vector<HoloLensForCV::SensorFrame^> frames(
+            c_numberOfMarkerTrackingCameras);
 
-        s_previousTimestamp = leftFrame->Timestamp.UniversalTime;
+        frames[0] = leftFrame;
+        frames[1] = rightFrame;
 
-        concurrency::create_task([this, leftFrame, rightFrame]()
+        for (size_t viewIndex = 2; viewIndex < frames.size(); ++viewIndex)
+        {
+            frames[viewIndex] = _multiFrameBuffer->GetFrameForTime(
+                c_markerTrackingSensorTypes[viewIndex],
+                commonTime,
+                c_timestampTolerance);
+        }
+
+        //
+        // Frames that arrive while markers are being tracked replace the frames waiting for
+        // the tracker, so it always picks up the newest frames once it is done.
+        //
+        _taskExecutor.SubmitLatest(
+            Io::TaskLane::Compute,
+            c_markerTrackingTaskKey,
+            [this, leftFrame, frames]()
         {
             auto trackedMarkers = TrackArUcoMarkers(
-                leftFrame,
-                rightFrame);
+                frames,
+                _markerDetectors,
+                _markerTriangulator);
+
+#if ARUCO_MARKER_DETECTOR_REPLAY_BENCHMARK
+            _markerDetectorBenchmark.AddFrame(
+                leftFrame);
+#endif /* ARUCO_MARKER_DETECTOR_REPLAY_BENCHMARK */
 
             {
                 std::lock_guard<std::mutex> guard(_markerRenderersMutex);
@@ -318,11 +295,8 @@ namespace ArUcoMarkerTracker
                 Windows::Foundation::Numerics::float3 focusPoint(0.0f, 0.0f, 0.0f);
                 int32_t numberOfMarkersDetected = 0;
 
-                for (auto& triangulatedMarkerCornerIterator : trackedMarkers)
+                for (auto& triangulatedMarkerCorner : trackedMarkers)
                 {
-                    auto& triangulatedMarkerCorner =
-                        triangulatedMarkerCornerIterator.second;
-
                     Windows::Foundation::Numerics::float3 p(
                         triangulatedMarkerCorner.point.x(),
                         triangulatedMarkerCorner.point.y(),
@@ -333,29 +307,29 @@ namespace ArUcoMarkerTracker
                         continue;
                     }
 
-                    if (_markerRenderers.find(triangulatedMarkerCorner.markerId) == _markerRenderers.end())
+                    if (_markerRenderers.find(triangulatedMarkerCorner.cornerId) == _markerRenderers.end())
                     {
 #if 0
-                        dbg::trace(L"AppMain::OnUpdateFor3DTracking: adding marker renderer for marker id %i", triangulatedMarkerCorner.markerId);
+                        dbg::trace(L"AppMain::OnUpdateFor3DTracking: adding marker renderer for marker id %i", triangulatedMarkerCorner.cornerId);
 #endif
 
-                        _markerRenderers[triangulatedMarkerCorner.markerId] =
+                        _markerRenderers[triangulatedMarkerCorner.cornerId] =
                             std::make_shared<Rendering::MarkerRenderer>(
                                 _deviceResources,
                                 0.0035f /* markerSize */);
                     }
 
 #if 0
-                    dbg::trace(L"AppMain::OnUpdateFor3DTracking: moving marker id %i to [%f, %f, %f]", triangulatedMarkerCorner.markerId, p.x, p.y, p.z);
+                    dbg::trace(L"AppMain::OnUpdateFor3DTracking: moving marker id %i to [%f, %f, %f]", triangulatedMarkerCorner.cornerId, p.x, p.y, p.z);
 #endif
 
-                    _markerRenderers[triangulatedMarkerCorner.markerId]->SetIsEnabled(true);
-                    _markerRenderers[triangulatedMarkerCorner.markerId]->SetPosition(p);
+                    _markerRenderers[triangulatedMarkerCorner.cornerId]->SetIsEnabled(true);
+                    _markerRenderers[triangulatedMarkerCorner.cornerId]->SetPosition(p);
 
                     focusPoint += p;
                     ++numberOfMarkersDetected;
 
-                    _lastObservedMarkerTimestamp[triangulatedMarkerCorner.markerId] =
+                    _lastObservedMarkerTimestamp[triangulatedMarkerCorner.cornerId] =
                         leftFrame->Timestamp.UniversalTime;
                 }
 
@@ -378,7 +352,18 @@ namespace ArUcoMarkerTracker
                 }
             }
 
-            InterlockedDecrement(&_markerUpdatesInProgress);
+            const Io::TaskLaneStatistics statistics =
+                _taskExecutor.GetStatistics(
+                    Io::TaskLane::Compute);
+
+            if (0 == statistics.numberOfTasksExecuted % c_statisticsReportInterval)
+            {
+                dbg::trace(
+                    L"AppMain::OnUpdateForMarkerTracker: %llu frames tracked, %llu replaced, %.02fms average queue latency",
+                    statistics.numberOfTasksExecuted,
+                    statistics.numberOfTasksReplaced,
+                    statistics.totalQueueLatencyInMicroseconds * 1e-3 / std::max<uint64_t>(1, statistics.numberOfTasksExecuted));
+            }
         });
     }
 
@@ -435,11 +420,11 @@ namespace ArUcoMarkerTracker
     {
         std::vector<HoloLensForCV::SensorType> enabledSensorTypes;
 
-        enabledSensorTypes.emplace_back(
-            HoloLensForCV::SensorType::VisibleLightLeftFront);
-
-        enabledSensorTypes.emplace_back(
-            HoloLensForCV::SensorType::VisibleLightRightFront);
+        for (const auto markerTrackingSensorType : c_markerTrackingSensorTypes)
+        {
+            enabledSensorTypes.emplace_back(
+                markerTrackingSensorType);
+        }
 
         _multiFrameBuffer =
             ref new HoloLensForCV::MultiFrameBuffer();
@@ -11,8 +11,27 @@
 
 #pragma once
 
+#include "ArUcoMarkerDetector.h"
+#include "ArUcoMarkerDetectorBenchmark.h"
+#include "MarkerTriangulator.h"
+#include "MarkerTriangulatorValidation.h"
+
 namespace ArUcoMarkerTracker
 {
+    //
+    // Cameras used for marker tracking. The front facing pair comes first: their
+    // frames are required, while the side facing cameras are used when available.
+    //
+    const size_t c_numberOfMarkerTrackingCameras = 4;
+
+    const HoloLensForCV::SensorType c_markerTrackingSensorTypes[c_numberOfMarkerTrackingCameras] =
+    {
+        HoloLensForCV::SensorType::VisibleLightLeftFront,
+        HoloLensForCV::SensorType::VisibleLightRightFront,
+        HoloLensForCV::SensorType::VisibleLightLeftLeft,
+        HoloLensForCV::SensorType::VisibleLightRightRight
+    };
+
     class AppMain : public Holographic::AppMainBase
     {
     public:
@@ -49,7 +68,15 @@ namespace ArUcoMarkerTracker
         std::map<int32_t, std::shared_ptr<Rendering::MarkerRenderer>> _markerRenderers;
         std::map<int32_t, long long> _lastObservedMarkerTimestamp;
         std::mutex _markerRenderersMutex;
-        volatile long _markerUpdatesInProgress{ 0 };
+        long long _previousMarkerTrackingTimestamp{ 0 };
+
+        // Only used by the marker tracking task, which never runs more than once at a time
+        std::array<ArUcoMarkerDetector, c_numberOfMarkerTrackingCameras> _markerDetectors;
+        MarkerTriangulator _markerTriangulator;
+
+#if ARUCO_MARKER_DETECTOR_REPLAY_BENCHMARK
+        ArUcoMarkerDetectorBenchmark _markerDetectorBenchmark;
+#endif /* ARUCO_MARKER_DETECTOR_REPLAY_BENCHMARK */
 
         // Selected HoloLens media frame source group
         HoloLensForCV::MediaFrameSourceGroupType _selectedHoloLensMediaFrameSourceGroupType;
@@ -57,5 +84,9 @@ namespace ArUcoMarkerTracker
         bool _holoLensMediaFrameSourceGroupStarted;
 
         HoloLensForCV::MultiFrameBuffer^ _multiFrameBuffer;
+
+        // Declared last, so that its destructor waits for the marker tracking task before
+        // anything the task uses is destroyed
+        Io::TaskExecutor _taskExecutor;
     };
 }
@@ -0,0 +1,326 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "ArUcoMarkerDetector.h"
+
+namespace ArUcoMarkerTracker
+{
+    namespace
+    {
+        //
+        // Run full-frame detection at least this often, so that markers entering the
+        // field of view are picked up while others are being tracked.
+        //
+        const int32_t c_fullFrameDetectionInterval = 15;
+
+        //
+        // Regions of interest extend past the previous marker outline by half of its
+        // size plus this many pixels, which covers typical head motion at 30fps.
+        //
+        const int32_t c_regionOfInterestMargin = 16;
+
+        const uint64_t c_statisticsReportInterval = 300;
+    }
+
+    ArUcoMarkerDetector::ArUcoMarkerDetector()
+        : _detectorParameters(cv::aruco::DetectorParameters::create())
+        , _dictionary(cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_1000))
+    {
+        Reset();
+    }
+
+    void ArUcoMarkerDetector::Reset()
+    {
+        _previousMarkers.clear();
+        _framesSinceFullFrameDetection = 0;
+
+        _numberOfFrames = 0;
+        _numberOfFullFrameDetections = 0;
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+        _numberOfValidationMarkers = 0;
+        _numberOfValidationMarkersFound = 0;
+
+        _numberOfRegionOfInterestSearches = 0;
+        _numberOfRegionOfInterestValidationMarkers = 0;
+        _numberOfRegionOfInterestValidationMarkersFound = 0;
+
+        _detectionMilliseconds = 0.0;
+        _fullFrameDetectionMilliseconds = 0.0;
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+    }
+
+    void ArUcoMarkerDetector::Detect(
+        _In_ const cv::Mat& image,
+        _Out_ std::vector<int32_t>& markerIds,
+        _Out_ std::vector<std::vector<cv::Point2f>>& markerCorners)
+    {
+        dbg::TimerGuard timerGuard(
+            L"ArUcoMarkerDetector::Detect",
+            20.0 /* minimum_time_elapsed_in_milliseconds */);
+
+        std::map<int32_t, std::vector<cv::Point2f>> detectedMarkers;
+
+        ++_numberOfFrames;
+
+        bool runFullFrameDetection =
+            _previousMarkers.empty() ||
+            ++_framesSinceFullFrameDetection >= c_fullFrameDetectionInterval;
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+        const bool runRegionOfInterestSearch =
+            !runFullFrameDetection;
+
+        std::map<int32_t, std::vector<cv::Point2f>> regionOfInterestMarkers;
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+
+        if (!runFullFrameDetection)
+        {
+            std::vector<cv::Rect> regionsOfInterest;
+
+            PredictRegionsOfInterest(
+                image.size(),
+                regionsOfInterest);
+
+            for (const auto& regionOfInterest : regionsOfInterest)
+            {
+                DetectInRegion(
+                    image,
+                    regionOfInterest,
+                    detectedMarkers);
+            }
+
+            //
+            // Fall back to searching the whole frame as soon as a tracked marker is lost.
+            //
+            for (const auto& previousMarker : _previousMarkers)
+            {
+                if (0 == detectedMarkers.count(previousMarker.first))
+                {
+                    runFullFrameDetection = true;
+                    break;
+                }
+            }
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+            regionOfInterestMarkers =
+                detectedMarkers;
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+        }
+
+        if (runFullFrameDetection)
+        {
+            DetectInRegion(
+                image,
+                cv::Rect(0, 0, image.cols, image.rows),
+                detectedMarkers);
+
+            _framesSinceFullFrameDetection = 0;
+            ++_numberOfFullFrameDetections;
+        }
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+        Validate(
+            image,
+            detectedMarkers,
+            runRegionOfInterestSearch ? &regionOfInterestMarkers : nullptr,
+            timerGuard.GetTimer().GetMillisecondsFromStart());
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+
+        markerIds.clear();
+        markerCorners.clear();
+
+        for (const auto& detectedMarker : detectedMarkers)
+        {
+            markerIds.push_back(detectedMarker.first);
+            markerCorners.push_back(detectedMarker.second);
+        }
+
+        _previousMarkers =
+            std::move(detectedMarkers);
+
+        if (0 == _numberOfFrames % c_statisticsReportInterval)
+        {
+            dbg::trace(
+                L"ArUcoMarkerDetector::Detect: %llu frames, %llu full-frame detections",
+                _numberOfFrames,
+                _numberOfFullFrameDetections);
+        }
+    }
+
+    void ArUcoMarkerDetector::DetectInRegion(
+        _In_ const cv::Mat& image,
+        _In_ const cv::Rect& region,
+        _Inout_ std::map<int32_t, std::vector<cv::Point2f>>& detectedMarkers)
+    {
+        std::vector<std::vector<cv::Point2f>> arucoMarkers, arucoRejectedCandidates;
+        std::vector<int32_t> arucoMarkerIds;
+
+        //
+        // Detection runs on a view of the region; no pixels are copied.
+        //
+        cv::aruco::detectMarkers(
+            image(region),
+            _dictionary,
+            arucoMarkers,
+            arucoMarkerIds,
+            _detectorParameters,
+            arucoRejectedCandidates);
+
+        for (size_t i = 0; i < arucoMarkerIds.size(); ++i)
+        {
+            auto& markerCorners = arucoMarkers[i];
+
+            if (markerCorners.size() != 4)
+            {
+                continue;
+            }
+
+            for (auto& markerCorner : markerCorners)
+            {
+                markerCorner.x += static_cast<float>(region.x);
+                markerCorner.y += static_cast<float>(region.y);
+            }
+
+            detectedMarkers[arucoMarkerIds[i]] =
+                std::move(markerCorners);
+        }
+    }
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+    void ArUcoMarkerDetector::Validate(
+        _In_ const cv::Mat& image,
+        _In_ const std::map<int32_t, std::vector<cv::Point2f>>& detectedMarkers,
+        _In_opt_ const std::map<int32_t, std::vector<cv::Point2f>>* regionOfInterestMarkers,
+        _In_ const double detectionMilliseconds)
+    {
+        dbg::Timer timer;
+
+        std::map<int32_t, std::vector<cv::Point2f>> validationMarkers;
+
+        DetectInRegion(
+            image,
+            cv::Rect(0, 0, image.cols, image.rows),
+            validationMarkers);
+
+        _fullFrameDetectionMilliseconds += timer.GetMillisecondsFromStart();
+        _detectionMilliseconds += detectionMilliseconds;
+
+        if (nullptr != regionOfInterestMarkers)
+        {
+            ++_numberOfRegionOfInterestSearches;
+        }
+
+        //
+        // Every frame counts, including those that fell back to full-frame detection
+        // because the region of interest search lost a marker: their misses count
+        // against the region of interest search.
+        //
+        for (const auto& validationMarker : validationMarkers)
+        {
+            ++_numberOfValidationMarkers;
+
+            if (0 != detectedMarkers.count(validationMarker.first))
+            {
+                ++_numberOfValidationMarkersFound;
+            }
+
+            if (nullptr != regionOfInterestMarkers)
+            {
+                ++_numberOfRegionOfInterestValidationMarkers;
+
+                if (0 != regionOfInterestMarkers->count(validationMarker.first))
+                {
+                    ++_numberOfRegionOfInterestValidationMarkersFound;
+                }
+            }
+        }
+
+        if (0 == _numberOfFrames % c_statisticsReportInterval)
+        {
+            dbg::trace(
+                L"ArUcoMarkerDetector::Validate: %llu frames, detection %.02fms/frame, full frame %.02fms/frame, recall %.03f, region of interest search recall %.03f over %llu frames",
+                _numberOfFrames,
+                _detectionMilliseconds / _numberOfFrames,
+                _fullFrameDetectionMilliseconds / _numberOfFrames,
+                _numberOfValidationMarkers > 0
+                    ? static_cast<double>(_numberOfValidationMarkersFound) / _numberOfValidationMarkers
+                    : 1.0,
+                _numberOfRegionOfInterestValidationMarkers > 0
+                    ? static_cast<double>(_numberOfRegionOfInterestValidationMarkersFound) / _numberOfRegionOfInterestValidationMarkers
+                    : 1.0,
+                _numberOfRegionOfInterestSearches);
+        }
+    }
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+
+    void ArUcoMarkerDetector::PredictRegionsOfInterest(
+        _In_ const cv::Size& imageSize,
+        _Out_ std::vector<cv::Rect>& regionsOfInterest) const
+    {
+        regionsOfInterest.clear();
+
+        const cv::Rect imageBounds(
+            cv::Point(0, 0),
+            imageSize);
+
+        for (const auto& previousMarker : _previousMarkers)
+        {
+            cv::Rect regionOfInterest =
+                cv::boundingRect(previousMarker.second);
+
+            const int32_t margin =
+                std::max(regionOfInterest.width, regionOfInterest.height) / 2 +
+                c_regionOfInterestMargin;
+
+            regionOfInterest.x -= margin;
+            regionOfInterest.y -= margin;
+            regionOfInterest.width += 2 * margin;
+            regionOfInterest.height += 2 * margin;
+
+            regionOfInterest &= imageBounds;
+
+            if (regionOfInterest.area() > 0)
+            {
+                regionsOfInterest.push_back(
+                    regionOfInterest);
+            }
+        }
+
+        //
+        // Merge overlapping regions, so that no marker is detected (or cut in half) by
+        // two regions at once.
+        //
+        bool merged = true;
+
+        while (merged)
+        {
+            merged = false;
+
+            for (size_t i = 0; i < regionsOfInterest.size() && !merged; ++i)
+            {
+                for (size_t j = i + 1; j < regionsOfInterest.size(); ++j)
+                {
+                    if ((regionsOfInterest[i] & regionsOfInterest[j]).area() > 0)
+                    {
+                        regionsOfInterest[i] |= regionsOfInterest[j];
+                        regionsOfInterest.erase(regionsOfInterest.begin() + j);
+
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
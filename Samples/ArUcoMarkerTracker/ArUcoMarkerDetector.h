@@ -0,0 +1,87 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, every frame is also run through full-frame detection as the reference.
+// The recall of the detector's results, and of the region of interest search alone on
+// the frames it ran on, are traced along with the detection latencies.
+//
+#define ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST 0
+
+namespace ArUcoMarkerTracker
+{
+    //
+    // Detects ArUco markers in the frames of a single camera. The dictionary and the
+    // detector parameters are created once, and markers found in the previous frame are
+    // searched for in predicted regions of interest around their last corners first.
+    // Full-frame detection only runs when a tracked marker was lost, when nothing is
+    // being tracked, or periodically to pick up markers entering the field of view.
+    //
+    // Instances are not thread-safe: use one detector per camera.
+    //
+    class ArUcoMarkerDetector
+    {
+    public:
+        ArUcoMarkerDetector();
+
+        void Reset();
+
+        void Detect(
+            _In_ const cv::Mat& image,
+            _Out_ std::vector<int32_t>& markerIds,
+            _Out_ std::vector<std::vector<cv::Point2f>>& markerCorners);
+
+    private:
+        void DetectInRegion(
+            _In_ const cv::Mat& image,
+            _In_ const cv::Rect& region,
+            _Inout_ std::map<int32_t, std::vector<cv::Point2f>>& detectedMarkers);
+
+        void PredictRegionsOfInterest(
+            _In_ const cv::Size& imageSize,
+            _Out_ std::vector<cv::Rect>& regionsOfInterest) const;
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+        //
+        // Compares the markers detected in the frame, and those found by the region of
+        // interest search if it ran, to full-frame detection.
+        //
+        void Validate(
+            _In_ const cv::Mat& image,
+            _In_ const std::map<int32_t, std::vector<cv::Point2f>>& detectedMarkers,
+            _In_opt_ const std::map<int32_t, std::vector<cv::Point2f>>* regionOfInterestMarkers,
+            _In_ const double detectionMilliseconds);
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+
+        cv::Ptr<cv::aruco::DetectorParameters> _detectorParameters;
+        cv::Ptr<cv::aruco::Dictionary> _dictionary;
+
+        std::map<int32_t, std::vector<cv::Point2f>> _previousMarkers;
+        int32_t _framesSinceFullFrameDetection;
+
+        uint64_t _numberOfFrames;
+        uint64_t _numberOfFullFrameDetections;
+
+#if ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST
+        uint64_t _numberOfValidationMarkers;
+        uint64_t _numberOfValidationMarkersFound;
+
+        uint64_t _numberOfRegionOfInterestSearches;
+        uint64_t _numberOfRegionOfInterestValidationMarkers;
+        uint64_t _numberOfRegionOfInterestValidationMarkersFound;
+
+        double _detectionMilliseconds;
+        double _fullFrameDetectionMilliseconds;
+#endif /* ARUCO_MARKER_DETECTOR_VALIDATE_REGIONS_OF_INTEREST */
+    };
+}
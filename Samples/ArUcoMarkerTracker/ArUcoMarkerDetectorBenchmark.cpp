@@ -0,0 +1,176 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "ArUcoMarkerDetector.h"
+#include "ArUcoMarkerDetectorBenchmark.h"
+
+namespace ArUcoMarkerTracker
+{
+    namespace
+    {
+        //
+        // Ten seconds at 30fps, enough for several full-frame detection intervals.
+        //
+        const size_t c_numberOfBenchmarkFrames = 300;
+
+        //
+        // The detector before ArUcoMarkerDetector: the parameters and the dictionary are
+        // created for every frame, and every frame is searched in full.
+        //
+        void DetectWithPerFrameDetector(
+            _In_ const cv::Mat& image,
+            _Out_ std::set<int32_t>& markerIds)
+        {
+            cv::Ptr<cv::aruco::DetectorParameters> arucoDetectorParameters =
+                cv::aruco::DetectorParameters::create();
+
+            cv::Ptr<cv::aruco::Dictionary> arucoDictionary =
+                cv::aruco::getPredefinedDictionary(
+                    cv::aruco::DICT_6X6_1000);
+
+            std::vector<std::vector<cv::Point2f>> arucoMarkers, arucoRejectedCandidates;
+            std::vector<int32_t> arucoMarkerIds;
+
+            cv::aruco::detectMarkers(
+                image,
+                arucoDictionary,
+                arucoMarkers,
+                arucoMarkerIds,
+                arucoDetectorParameters,
+                arucoRejectedCandidates);
+
+            markerIds.clear();
+
+            for (size_t i = 0; i < arucoMarkerIds.size(); ++i)
+            {
+                if (arucoMarkers[i].size() == 4)
+                {
+                    markerIds.insert(arucoMarkerIds[i]);
+                }
+            }
+        }
+    }
+
+    ArUcoMarkerDetectorBenchmark::ArUcoMarkerDetectorBenchmark()
+        : _isReplayed(false)
+    {
+        _frames.reserve(
+            c_numberOfBenchmarkFrames);
+    }
+
+    void ArUcoMarkerDetectorBenchmark::AddFrame(
+        _In_ HoloLensForCV::SensorFrame^ frame)
+    {
+        if (_isReplayed || nullptr == frame)
+        {
+            return;
+        }
+
+        cv::Mat wrappedImage;
+
+        rmcv::WrapHoloLensVisibleLightCameraFrameWithCvMat(
+            frame,
+            wrappedImage);
+
+        //
+        // The wrapped image points into the sensor frame's buffer, which is recycled.
+        //
+        _frames.push_back(
+            wrappedImage.clone());
+
+        if (_frames.size() == c_numberOfBenchmarkFrames)
+        {
+            Replay();
+
+            _frames.clear();
+            _frames.shrink_to_fit();
+
+            _isReplayed = true;
+        }
+    }
+
+    void ArUcoMarkerDetectorBenchmark::Replay()
+    {
+        double perFrameDetectorMilliseconds = 0.0, perFrameDetectorMaximumMilliseconds = 0.0;
+        double markerDetectorMilliseconds = 0.0, markerDetectorMaximumMilliseconds = 0.0;
+
+        uint64_t numberOfReferenceMarkers = 0, numberOfReferenceMarkersFound = 0;
+        uint64_t numberOfAdditionalMarkers = 0;
+
+        //
+        // A fresh detector, so that the replay starts with a full-frame detection like
+        // the tracker does.
+        //
+        ArUcoMarkerDetector markerDetector;
+
+        std::set<int32_t> referenceMarkerIds;
+        std::vector<int32_t> markerIds;
+        std::vector<std::vector<cv::Point2f>> markerCorners;
+
+        for (const cv::Mat& image : _frames)
+        {
+            dbg::Timer timer;
+
+            DetectWithPerFrameDetector(
+                image,
+                referenceMarkerIds);
+
+            const double perFrameDetectorFrameMilliseconds =
+                timer.GetMillisecondsFromLastEvent();
+
+            timer.MarkEvent();
+
+            markerDetector.Detect(
+                image,
+                markerIds,
+                markerCorners);
+
+            const double markerDetectorFrameMilliseconds =
+                timer.GetMillisecondsFromLastEvent();
+
+            perFrameDetectorMilliseconds += perFrameDetectorFrameMilliseconds;
+            perFrameDetectorMaximumMilliseconds =
+                std::max(perFrameDetectorMaximumMilliseconds, perFrameDetectorFrameMilliseconds);
+
+            markerDetectorMilliseconds += markerDetectorFrameMilliseconds;
+            markerDetectorMaximumMilliseconds =
+                std::max(markerDetectorMaximumMilliseconds, markerDetectorFrameMilliseconds);
+
+            numberOfReferenceMarkers += referenceMarkerIds.size();
+
+            for (const int32_t markerId : markerIds)
+            {
+                if (0 != referenceMarkerIds.count(markerId))
+                {
+                    ++numberOfReferenceMarkersFound;
+                }
+                else
+                {
+                    ++numberOfAdditionalMarkers;
+                }
+            }
+        }
+
+        dbg::trace(
+            L"ArUcoMarkerDetectorBenchmark::Replay: %llu frames, per-frame detector %.02fms/frame (max %.02fms), ArUcoMarkerDetector %.02fms/frame (max %.02fms), recall %.03f, %llu markers not found by the per-frame detector",
+            static_cast<uint64_t>(_frames.size()),
+            perFrameDetectorMilliseconds / _frames.size(),
+            perFrameDetectorMaximumMilliseconds,
+            markerDetectorMilliseconds / _frames.size(),
+            markerDetectorMaximumMilliseconds,
+            numberOfReferenceMarkers > 0
+                ? static_cast<double>(numberOfReferenceMarkersFound) / numberOfReferenceMarkers
+                : 1.0,
+            numberOfAdditionalMarkers);
+    }
+}
@@ -0,0 +1,43 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, the first frames of the left front camera are recorded and replayed
+// through the detector as it was before ArUcoMarkerDetector, and through a fresh
+// ArUcoMarkerDetector, and their latencies and results are traced. The replay runs on
+// the marker tracking task, which stalls for a few seconds while it does.
+//
+#define ARUCO_MARKER_DETECTOR_REPLAY_BENCHMARK 0
+
+namespace ArUcoMarkerTracker
+{
+    class ArUcoMarkerDetectorBenchmark
+    {
+    public:
+        ArUcoMarkerDetectorBenchmark();
+
+        //
+        // Records a copy of the frame until enough frames are recorded, then replays
+        // them once.
+        //
+        void AddFrame(
+            _In_ HoloLensForCV::SensorFrame^ frame);
+
+    private:
+        void Replay();
+
+    private:
+        std::vector<cv::Mat> _frames;
+        bool _isReplayed;
+    };
+}
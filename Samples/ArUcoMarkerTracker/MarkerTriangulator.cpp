@@ -0,0 +1,449 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "MarkerTriangulator.h"
+
+namespace ArUcoMarkerTracker
+{
+    namespace
+    {
+        //
+        // Lower bound on the camera-to-corner distance used to weight the rays, so that
+        // a corner triangulated (wrongly) right next to a camera does not dominate.
+        //
+        const float c_minimumRangeInMeters = 0.05f;
+
+        //
+        // Rays closer to parallel than this are rejected, see MarkerTriangulator::SolveCorner.
+        //
+        const double c_minimumNormalizedDeterminant = 1e-9;
+
+        const float c_pi = 3.14159265f;
+    }
+
+    MarkerCornerObservation CreateMarkerCornerObservation(
+        _In_ const int32_t cornerId,
+        _In_ const int32_t viewIndex,
+        _In_ const Windows::Foundation::Numerics::float4x4& cameraToOrigin,
+        _In_ const Windows::Foundation::Point& unitPlanePoint)
+    {
+        //
+        // Windows::Foundation::Numerics transforms row vectors, so the rotation of column
+        // vectors is the transpose of the upper left 3x3 block.
+        //
+        Eigen::Matrix3f cameraToOriginRotation;
+
+        cameraToOriginRotation <<
+            cameraToOrigin.m11, cameraToOrigin.m21, cameraToOrigin.m31,
+            cameraToOrigin.m12, cameraToOrigin.m22, cameraToOrigin.m32,
+            cameraToOrigin.m13, cameraToOrigin.m23, cameraToOrigin.m33;
+
+        const Eigen::Vector3f directionInCamera(
+            -unitPlanePoint.X,
+            -unitPlanePoint.Y,
+            -1.0f);
+
+        MarkerCornerObservation observation;
+
+        observation.cornerId = cornerId;
+        observation.viewIndex = viewIndex;
+
+        observation.cameraCenter = Eigen::Vector3f(
+            cameraToOrigin.m41,
+            cameraToOrigin.m42,
+            cameraToOrigin.m43);
+
+        observation.direction =
+            cameraToOriginRotation * directionInCamera;
+
+        return observation;
+    }
+
+    MarkerTriangulator::MarkerTriangulator(
+        _In_ const float angularNoiseInRadians,
+        _In_ const float maximumAngularErrorInRadians)
+        : _angularNoiseInRadians(angularNoiseInRadians)
+        , _maximumAngularErrorInRadians(maximumAngularErrorInRadians)
+    {
+    }
+
+    void MarkerTriangulator::Triangulate(
+        _In_ const std::vector<MarkerCornerObservation>& observations,
+        _Out_ std::vector<TriangulatedMarkerCorner>& triangulatedCorners)
+    {
+        triangulatedCorners.clear();
+
+        LoadObservations(
+            observations);
+
+        const size_t numberOfCorners =
+            _cornerIds.size();
+
+        _pointX.assign(numberOfCorners, 0.0f);
+        _pointY.assign(numberOfCorners, 0.0f);
+        _pointZ.assign(numberOfCorners, 0.0f);
+        _uncertainties.assign(numberOfCorners, 0.0f);
+        _solved.assign(numberOfCorners, 0);
+
+        for (size_t i = 0; i < numberOfCorners; ++i)
+        {
+            SelectInliers(i);
+
+            _solved[i] = SolveCorner(i, false /* weighted */);
+        }
+
+        //
+        // Weight every ray by its inverse variance, assuming constant angular noise.
+        //
+        for (size_t i = 0; i < numberOfCorners; ++i)
+        {
+            for (size_t k = _cornerOffsets[i]; k < _cornerOffsets[i + 1]; ++k)
+            {
+                const float dx = _pointX[i] - _centerX[k];
+                const float dy = _pointY[i] - _centerY[k];
+                const float dz = _pointZ[i] - _centerZ[k];
+
+                const float sigma =
+                    _angularNoiseInRadians *
+                    std::max(c_minimumRangeInMeters, std::sqrt(dx * dx + dy * dy + dz * dz));
+
+                _weights[k] = 1.0f / (sigma * sigma);
+            }
+        }
+
+        for (size_t i = 0; i < numberOfCorners; ++i)
+        {
+            if (_solved[i])
+            {
+                _solved[i] = SolveCorner(i, true /* weighted */);
+            }
+        }
+
+        for (size_t i = 0; i < numberOfCorners; ++i)
+        {
+            float worstAngularError = 0.0f;
+            int32_t numberOfInliers = 0;
+
+            while (_solved[i])
+            {
+                size_t worstObservation = _cornerOffsets[i];
+
+                worstAngularError = 0.0f;
+                numberOfInliers = 0;
+
+                for (size_t k = _cornerOffsets[i]; k < _cornerOffsets[i + 1]; ++k)
+                {
+                    if (!_inliers[k])
+                    {
+                        continue;
+                    }
+
+                    const float angularError =
+                        GetAngularError(Eigen::Vector3f(_pointX[i], _pointY[i], _pointZ[i]), k);
+
+                    if (angularError >= worstAngularError)
+                    {
+                        worstAngularError = angularError;
+                        worstObservation = k;
+                    }
+
+                    ++numberOfInliers;
+                }
+
+                if (worstAngularError <= _maximumAngularErrorInRadians)
+                {
+                    break;
+                }
+
+                if (numberOfInliers <= 2)
+                {
+                    _solved[i] = false;
+                    break;
+                }
+
+                _inliers[worstObservation] = 0;
+
+                _solved[i] = SolveCorner(i, true /* weighted */);
+            }
+
+            if (!_solved[i])
+            {
+                continue;
+            }
+
+            TriangulatedMarkerCorner triangulatedCorner;
+
+            triangulatedCorner.cornerId = _cornerIds[i];
+            triangulatedCorner.point = Eigen::Vector3f(_pointX[i], _pointY[i], _pointZ[i]);
+            triangulatedCorner.uncertainty = _uncertainties[i];
+            triangulatedCorner.maximumAngularError = worstAngularError;
+            triangulatedCorner.numberOfViews = numberOfInliers;
+
+            triangulatedCorners.push_back(
+                triangulatedCorner);
+        }
+    }
+
+    void MarkerTriangulator::LoadObservations(
+        _In_ const std::vector<MarkerCornerObservation>& observations)
+    {
+        _sortedObservations.resize(
+            observations.size());
+
+        for (size_t k = 0; k < observations.size(); ++k)
+        {
+            _sortedObservations[k] = k;
+        }
+
+        std::stable_sort(
+            _sortedObservations.begin(),
+            _sortedObservations.end(),
+            [&observations](const size_t a, const size_t b)
+        {
+            return observations[a].cornerId < observations[b].cornerId;
+        });
+
+        _centerX.resize(observations.size());
+        _centerY.resize(observations.size());
+        _centerZ.resize(observations.size());
+        _directionX.resize(observations.size());
+        _directionY.resize(observations.size());
+        _directionZ.resize(observations.size());
+        _weights.assign(observations.size(), 1.0f);
+        _inliers.assign(observations.size(), 1);
+
+        _cornerIds.clear();
+        _cornerOffsets.clear();
+
+        for (size_t k = 0; k < _sortedObservations.size(); ++k)
+        {
+            const MarkerCornerObservation& observation =
+                observations[_sortedObservations[k]];
+
+            if (_cornerIds.empty() || _cornerIds.back() != observation.cornerId)
+            {
+                _cornerIds.push_back(observation.cornerId);
+                _cornerOffsets.push_back(k);
+            }
+
+            const Eigen::Vector3f direction =
+                observation.direction.normalized();
+
+            _centerX[k] = observation.cameraCenter.x();
+            _centerY[k] = observation.cameraCenter.y();
+            _centerZ[k] = observation.cameraCenter.z();
+            _directionX[k] = direction.x();
+            _directionY[k] = direction.y();
+            _directionZ[k] = direction.z();
+        }
+
+        _cornerOffsets.push_back(
+            _sortedObservations.size());
+    }
+
+    void MarkerTriangulator::SelectInliers(
+        _In_ const size_t cornerIndex)
+    {
+        const size_t begin = _cornerOffsets[cornerIndex];
+        const size_t end = _cornerOffsets[cornerIndex + 1];
+
+        //
+        // A single bad ray drags the least squares solution far enough to make the good
+        // rays look like outliers. With only a handful of cameras, trying the two-ray
+        // intersection of every pair and keeping the one most rays agree with is cheap.
+        //
+        if (end - begin < 3)
+        {
+            return;
+        }
+
+        int32_t bestNumberOfInliers = 0;
+        Eigen::Vector3f bestPoint;
+
+        for (size_t p = begin; p < end; ++p)
+        {
+            for (size_t q = p + 1; q < end; ++q)
+            {
+                const Eigen::Vector3f c1(_centerX[p], _centerY[p], _centerZ[p]);
+                const Eigen::Vector3f d1(_directionX[p], _directionY[p], _directionZ[p]);
+                const Eigen::Vector3f c2(_centerX[q], _centerY[q], _centerZ[q]);
+                const Eigen::Vector3f d2(_directionX[q], _directionY[q], _directionZ[q]);
+
+                const Eigen::Vector3f w = c1 - c2;
+
+                const float b = d1.dot(d2);
+                const float d = d1.dot(w);
+                const float e = d2.dot(w);
+
+                const float denominator = 1.0f - b * b;
+
+                if (denominator < std::numeric_limits<float>::epsilon())
+                {
+                    continue;
+                }
+
+                const float s = (b * e - d) / denominator;
+                const float t = (e - b * d) / denominator;
+
+                //
+                // The rays point from the cameras towards the corner (see
+                // CreateMarkerCornerObservation), which must be in front of both.
+                //
+                if (s <= 0.0f || t <= 0.0f)
+                {
+                    continue;
+                }
+
+                const Eigen::Vector3f point =
+                    0.5f * (c1 + s * d1 + c2 + t * d2);
+
+                int32_t numberOfInliers = 0;
+
+                for (size_t k = begin; k < end; ++k)
+                {
+                    if (GetAngularError(point, k) <= _maximumAngularErrorInRadians)
+                    {
+                        ++numberOfInliers;
+                    }
+                }
+
+                if (numberOfInliers > bestNumberOfInliers)
+                {
+                    bestNumberOfInliers = numberOfInliers;
+                    bestPoint = point;
+                }
+            }
+        }
+
+        if (bestNumberOfInliers < 2)
+        {
+            return;
+        }
+
+        for (size_t k = begin; k < end; ++k)
+        {
+            _inliers[k] =
+                GetAngularError(bestPoint, k) <= _maximumAngularErrorInRadians ? 1 : 0;
+        }
+    }
+
+    bool MarkerTriangulator::SolveCorner(
+        _In_ const size_t cornerIndex,
+        _In_ const bool weighted)
+    {
+        //
+        // Accumulate sum(w * (I - d * d^T)) and sum(w * (I - d * d^T) * c); the minimizer
+        // of the weighted squared distances to all rays solves A * x = b.
+        //
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+
+        int32_t numberOfRays = 0;
+
+        for (size_t k = _cornerOffsets[cornerIndex]; k < _cornerOffsets[cornerIndex + 1]; ++k)
+        {
+            if (!_inliers[k])
+            {
+                continue;
+            }
+
+            const float w = weighted ? _weights[k] : 1.0f;
+
+            const float dx = _directionX[k];
+            const float dy = _directionY[k];
+            const float dz = _directionZ[k];
+
+            const float m00 = w * (1.0f - dx * dx);
+            const float m01 = -w * dx * dy;
+            const float m02 = -w * dx * dz;
+            const float m11 = w * (1.0f - dy * dy);
+            const float m12 = -w * dy * dz;
+            const float m22 = w * (1.0f - dz * dz);
+
+            a00 += m00; a01 += m01; a02 += m02;
+            a11 += m11; a12 += m12;
+            a22 += m22;
+
+            b0 += m00 * _centerX[k] + m01 * _centerY[k] + m02 * _centerZ[k];
+            b1 += m01 * _centerX[k] + m11 * _centerY[k] + m12 * _centerZ[k];
+            b2 += m02 * _centerX[k] + m12 * _centerY[k] + m22 * _centerZ[k];
+
+            ++numberOfRays;
+        }
+
+        if (numberOfRays < 2)
+        {
+            return false;
+        }
+
+        Eigen::Matrix3d A;
+
+        A <<
+            a00, a01, a02,
+            a01, a11, a12,
+            a02, a12, a22;
+
+        //
+        // Nearly parallel rays leave the depth along them unconstrained.
+        //
+        const double scale = A.trace() / 3.0;
+
+        if (A.determinant() < c_minimumNormalizedDeterminant * scale * scale * scale)
+        {
+            return false;
+        }
+
+        const Eigen::Matrix3d inverse = A.inverse();
+        const Eigen::Vector3d x = inverse * Eigen::Vector3d(b0, b1, b2);
+
+        _pointX[cornerIndex] = static_cast<float>(x.x());
+        _pointY[cornerIndex] = static_cast<float>(x.y());
+        _pointZ[cornerIndex] = static_cast<float>(x.z());
+
+        //
+        // With inverse variance weights, the inverse of A is the covariance of the corner.
+        //
+        _uncertainties[cornerIndex] =
+            weighted ? static_cast<float>(std::sqrt(inverse.trace())) : 0.0f;
+
+        return true;
+    }
+
+    float MarkerTriangulator::GetAngularError(
+        _In_ const Eigen::Vector3f& point,
+        _In_ const size_t observationIndex) const
+    {
+        const Eigen::Vector3f toPoint(
+            point.x() - _centerX[observationIndex],
+            point.y() - _centerY[observationIndex],
+            point.z() - _centerZ[observationIndex]);
+
+        const Eigen::Vector3f direction(
+            _directionX[observationIndex],
+            _directionY[observationIndex],
+            _directionZ[observationIndex]);
+
+        const float cosine =
+            direction.dot(toPoint.normalized());
+
+        //
+        // Points behind the camera are as wrong as they get.
+        //
+        if (!(cosine > 0.0f))
+        {
+            return c_pi;
+        }
+
+        return std::acos(std::min(1.0f, cosine));
+    }
+}
@@ -0,0 +1,122 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace ArUcoMarkerTracker
+{
+    //
+    // A marker corner seen by one camera: the ray from the camera center through the
+    // detected corner, in the world coordinate system.
+    //
+    struct MarkerCornerObservation
+    {
+        int32_t cornerId;
+        int32_t viewIndex;
+
+        Eigen::Vector3f cameraCenter;
+        Eigen::Vector3f direction;
+    };
+
+    //
+    // Creates the observation of a marker corner seen at a point of the camera unit
+    // plane, given the camera-to-origin transform. The camera looks down its negative
+    // Z axis, so the ray through the point (x, y) has the direction -(x, y, 1) in the
+    // camera's coordinate system; the triangulator only keeps corners in front of the
+    // cameras.
+    //
+    MarkerCornerObservation CreateMarkerCornerObservation(
+        _In_ const int32_t cornerId,
+        _In_ const int32_t viewIndex,
+        _In_ const Windows::Foundation::Numerics::float4x4& cameraToOrigin,
+        _In_ const Windows::Foundation::Point& unitPlanePoint);
+
+    struct TriangulatedMarkerCorner
+    {
+        int32_t cornerId;
+        Eigen::Vector3f point;
+
+        // Standard deviation of the position in meters, propagated from the ray noise
+        float uncertainty;
+
+        // Largest angle between an inlier ray and the triangulated point, in radians
+        float maximumAngularError;
+
+        int32_t numberOfViews;
+    };
+
+    //
+    // Triangulates marker corners observed by any number of synchronized cameras. Each
+    // corner is the point closest, in the least squares sense, to all of its rays (the
+    // multi-view midpoint method). Observations are stored as a structure of arrays
+    // grouped by corner, so that all corners of a frame are solved in one pass over
+    // contiguous memory:
+    //
+    //  0. Corners seen by three or more cameras start from the two-ray intersection
+    //     that most rays agree with; the other rays are set aside as outliers.
+    //  1. An unweighted pass provides the distance from each camera to the corner.
+    //  2. A weighted pass models the ray noise as constant in angle, i.e. growing with
+    //     distance, and yields the covariance of the corner position.
+    //  3. Rays whose angular error exceeds the threshold are dropped one at a time,
+    //     worst first, and their corners re-solved; corners left with fewer than two
+    //     rays are rejected.
+    //
+    class MarkerTriangulator
+    {
+    public:
+        MarkerTriangulator(
+            _In_ const float angularNoiseInRadians = 0.002f,
+            _In_ const float maximumAngularErrorInRadians = 0.01f);
+
+        void Triangulate(
+            _In_ const std::vector<MarkerCornerObservation>& observations,
+            _Out_ std::vector<TriangulatedMarkerCorner>& triangulatedCorners);
+
+    private:
+        void LoadObservations(
+            _In_ const std::vector<MarkerCornerObservation>& observations);
+
+        void SelectInliers(
+            _In_ const size_t cornerIndex);
+
+        bool SolveCorner(
+            _In_ const size_t cornerIndex,
+            _In_ const bool weighted);
+
+        float GetAngularError(
+            _In_ const Eigen::Vector3f& point,
+            _In_ const size_t observationIndex) const;
+
+        const float _angularNoiseInRadians;
+        const float _maximumAngularErrorInRadians;
+
+        //
+        // Observations, sorted by corner. The observations of corner i are stored at
+        // [_cornerOffsets[i], _cornerOffsets[i + 1]).
+        //
+        std::vector<float> _centerX, _centerY, _centerZ;
+        std::vector<float> _directionX, _directionY, _directionZ;
+        std::vector<float> _weights;
+        std::vector<uint8_t> _inliers;
+
+        std::vector<int32_t> _cornerIds;
+        std::vector<size_t> _cornerOffsets;
+
+        //
+        // Per corner results.
+        //
+        std::vector<float> _pointX, _pointY, _pointZ;
+        std::vector<float> _uncertainties;
+        std::vector<uint8_t> _solved;
+
+        std::vector<size_t> _sortedObservations;
+    };
+}
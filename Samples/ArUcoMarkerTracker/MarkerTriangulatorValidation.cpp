@@ -0,0 +1,364 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "MarkerTriangulator.h"
+#include "MarkerTriangulatorValidation.h"
+
+namespace ArUcoMarkerTracker
+{
+    namespace
+    {
+        const float c_degreesToRadians = 0.0174532925f;
+
+        const int32_t c_numberOfCameras = 4;
+
+        //
+        // Camera positions in the headset's coordinate system, and the angles they are
+        // turned by around the headset's vertical axis (positive turns to the left).
+        //
+        const Windows::Foundation::Numerics::float3 c_cameraPositions[c_numberOfCameras] =
+        {
+            { -0.05f, 0.0f, 0.0f },
+            { 0.05f, 0.0f, 0.0f },
+            { -0.07f, 0.0f, 0.02f },
+            { 0.07f, 0.0f, 0.02f }
+        };
+
+        const float c_cameraYawsInDegrees[c_numberOfCameras] =
+        {
+            10.0f,
+            -10.0f,
+            45.0f,
+            -45.0f
+        };
+
+        //
+        // Points of the unit plane beyond this are outside of the cameras' field of view.
+        //
+        const float c_maximumUnitPlaneCoordinate = 1.3f;
+
+        //
+        // Marker corners in the headset's coordinate system: one marker straight ahead
+        // that all four cameras see, and one to the left that only the left cameras see.
+        //
+        const Windows::Foundation::Numerics::float3 c_cornerPositions[] =
+        {
+            { -0.05f, 0.05f, -1.2f },
+            { 0.05f, 0.05f, -1.2f },
+            { 0.05f, -0.05f, -1.2f },
+            { -0.05f, -0.05f, -1.2f },
+            { -0.7f, 0.05f, -0.6f },
+            { -0.7f, 0.05f, -0.5f },
+            { -0.7f, -0.05f, -0.5f },
+            { -0.7f, -0.05f, -0.6f }
+        };
+
+        //
+        // The ray of the first camera to the second corner, which all four cameras see,
+        // is moved this far on the unit plane, i.e. by several degrees, and must be
+        // rejected as an outlier.
+        //
+        const float c_outlierOffset = 0.1f;
+
+        const float c_maximumPositionErrorInMeters = 0.001f;
+
+        //
+        // The benchmark triangulates a wall of markers 1.5m ahead, ten by ten markers
+        // of 5cm every 10cm, i.e. 400 corners, repeatedly. Its observations are
+        // perturbed by Gaussian noise of about a milliradian, and every tenth corner
+        // has an outlier ray.
+        //
+        const int32_t c_numberOfBenchmarkMarkersPerRow = 10;
+        const float c_benchmarkMarkerSpacingInMeters = 0.1f;
+        const float c_benchmarkMarkerSizeInMeters = 0.05f;
+        const float c_benchmarkMarkerDistanceInMeters = 1.5f;
+        const float c_benchmarkUnitPlaneNoise = 0.001f;
+        const int32_t c_benchmarkOutlierCornerInterval = 10;
+        const int32_t c_numberOfBenchmarkFrames = 100;
+
+        //
+        // The headset is away from the origin and turned, so that mixing up the
+        // coordinate systems does not go unnoticed.
+        //
+        Windows::Foundation::Numerics::float4x4 GetHeadsetToOrigin()
+        {
+            return
+                Windows::Foundation::Numerics::make_rotation_y(25.0f * c_degreesToRadians) *
+                Windows::Foundation::Numerics::make_rotation_x(-10.0f * c_degreesToRadians) *
+                Windows::Foundation::Numerics::make_translation(0.3f, 1.6f, -0.2f);
+        }
+
+        //
+        // Projects the corners, given in the headset's coordinate system, onto the unit
+        // planes of the cameras that see them, adds Gaussian noise of the given standard
+        // deviation to the unit plane points, and turns them into observations. The
+        // first camera's ray to every outlierCornerInterval-th corner, starting with the
+        // second one, is moved by c_outlierOffset and not counted in the expected number
+        // of views.
+        //
+        void ObserveCorners(
+            _In_ const Windows::Foundation::Numerics::float3* cornerPositions,
+            _In_ const int32_t numberOfCorners,
+            _In_ const Windows::Foundation::Numerics::float4x4& headsetToOrigin,
+            _In_ const float unitPlaneNoise,
+            _In_ const int32_t outlierCornerInterval,
+            _Inout_ std::mt19937& randomEngine,
+            _Out_ std::vector<MarkerCornerObservation>& observations,
+            _Out_ std::vector<int32_t>& expectedNumberOfViews)
+        {
+            std::normal_distribution<float> noiseDistribution(
+                0.0f,
+                1.0f);
+
+            observations.clear();
+            expectedNumberOfViews.assign(numberOfCorners, 0);
+
+            for (int32_t viewIndex = 0; viewIndex < c_numberOfCameras; ++viewIndex)
+            {
+                const Windows::Foundation::Numerics::float4x4 cameraToOrigin =
+                    Windows::Foundation::Numerics::make_rotation_y(c_cameraYawsInDegrees[viewIndex] * c_degreesToRadians) *
+                    Windows::Foundation::Numerics::make_translation(c_cameraPositions[viewIndex]) *
+                    headsetToOrigin;
+
+                Windows::Foundation::Numerics::float4x4 originToCamera;
+
+                ASSERT(Windows::Foundation::Numerics::invert(cameraToOrigin, &originToCamera));
+
+                for (int32_t cornerId = 0; cornerId < numberOfCorners; ++cornerId)
+                {
+                    const Windows::Foundation::Numerics::float3 cornerInCamera =
+                        Windows::Foundation::Numerics::transform(
+                            Windows::Foundation::Numerics::transform(
+                                cornerPositions[cornerId],
+                                headsetToOrigin),
+                            originToCamera);
+
+                    //
+                    // The camera looks down its negative Z axis: the ray -(x, y, 1) reaches
+                    // the corner at the distance -z along the axis.
+                    //
+                    if (cornerInCamera.z >= 0.0f)
+                    {
+                        continue;
+                    }
+
+                    Windows::Foundation::Point unitPlanePoint(
+                        cornerInCamera.x / cornerInCamera.z,
+                        cornerInCamera.y / cornerInCamera.z);
+
+                    if (std::abs(unitPlanePoint.X) > c_maximumUnitPlaneCoordinate ||
+                        std::abs(unitPlanePoint.Y) > c_maximumUnitPlaneCoordinate)
+                    {
+                        continue;
+                    }
+
+                    unitPlanePoint.X += unitPlaneNoise * noiseDistribution(randomEngine);
+                    unitPlanePoint.Y += unitPlaneNoise * noiseDistribution(randomEngine);
+
+                    if (0 == viewIndex && 1 == cornerId % outlierCornerInterval)
+                    {
+                        unitPlanePoint.X += c_outlierOffset;
+                    }
+                    else
+                    {
+                        ++expectedNumberOfViews[cornerId];
+                    }
+
+                    observations.push_back(
+                        CreateMarkerCornerObservation(
+                            cornerId,
+                            viewIndex,
+                            cameraToOrigin,
+                            unitPlanePoint));
+                }
+            }
+        }
+    }
+
+    bool ValidateMarkerTriangulator()
+    {
+        const int32_t numberOfCorners =
+            static_cast<int32_t>(_countof(c_cornerPositions));
+
+        const Windows::Foundation::Numerics::float4x4 headsetToOrigin =
+            GetHeadsetToOrigin();
+
+        //
+        // Without noise, only the one corrupted ray is off.
+        //
+        std::mt19937 randomEngine;
+
+        std::vector<MarkerCornerObservation> observations;
+        std::vector<int32_t> expectedNumberOfViews;
+
+        ObserveCorners(
+            c_cornerPositions,
+            numberOfCorners,
+            headsetToOrigin,
+            0.0f /* unitPlaneNoise */,
+            numberOfCorners /* outlierCornerInterval */,
+            randomEngine,
+            observations,
+            expectedNumberOfViews);
+
+        MarkerTriangulator markerTriangulator;
+        std::vector<TriangulatedMarkerCorner> triangulatedCorners;
+
+        markerTriangulator.Triangulate(
+            observations,
+            triangulatedCorners);
+
+        bool passed =
+            static_cast<int32_t>(triangulatedCorners.size()) == numberOfCorners;
+
+        float maximumPositionErrorInMeters = 0.0f;
+
+        for (const TriangulatedMarkerCorner& triangulatedCorner : triangulatedCorners)
+        {
+            const Windows::Foundation::Numerics::float3 expectedPosition =
+                Windows::Foundation::Numerics::transform(
+                    c_cornerPositions[triangulatedCorner.cornerId],
+                    headsetToOrigin);
+
+            const float positionError =
+                (triangulatedCorner.point - Eigen::Vector3f(expectedPosition.x, expectedPosition.y, expectedPosition.z)).norm();
+
+            maximumPositionErrorInMeters =
+                std::max(maximumPositionErrorInMeters, positionError);
+
+            passed =
+                passed &&
+                positionError <= c_maximumPositionErrorInMeters &&
+                triangulatedCorner.numberOfViews == expectedNumberOfViews[triangulatedCorner.cornerId];
+        }
+
+        dbg::trace(
+            L"ValidateMarkerTriangulator: %s, %i of %i corners triangulated from %i observations, position error up to %.02fmm",
+            passed ? L"passed" : L"FAILED",
+            static_cast<int32_t>(triangulatedCorners.size()),
+            numberOfCorners,
+            static_cast<int32_t>(observations.size()),
+            maximumPositionErrorInMeters * 1000.0f);
+
+        return passed;
+    }
+
+    void BenchmarkMarkerTriangulator()
+    {
+        std::vector<Windows::Foundation::Numerics::float3> cornerPositions;
+
+        const float firstMarkerOffset =
+            -0.5f * (c_numberOfBenchmarkMarkersPerRow - 1) * c_benchmarkMarkerSpacingInMeters;
+
+        for (int32_t row = 0; row < c_numberOfBenchmarkMarkersPerRow; ++row)
+        {
+            for (int32_t column = 0; column < c_numberOfBenchmarkMarkersPerRow; ++column)
+            {
+                const float x = firstMarkerOffset + column * c_benchmarkMarkerSpacingInMeters;
+                const float y = firstMarkerOffset + row * c_benchmarkMarkerSpacingInMeters;
+                const float halfSize = 0.5f * c_benchmarkMarkerSizeInMeters;
+
+                cornerPositions.emplace_back(x - halfSize, y + halfSize, -c_benchmarkMarkerDistanceInMeters);
+                cornerPositions.emplace_back(x + halfSize, y + halfSize, -c_benchmarkMarkerDistanceInMeters);
+                cornerPositions.emplace_back(x + halfSize, y - halfSize, -c_benchmarkMarkerDistanceInMeters);
+                cornerPositions.emplace_back(x - halfSize, y - halfSize, -c_benchmarkMarkerDistanceInMeters);
+            }
+        }
+
+        const int32_t numberOfCorners =
+            static_cast<int32_t>(cornerPositions.size());
+
+        const Windows::Foundation::Numerics::float4x4 headsetToOrigin =
+            GetHeadsetToOrigin();
+
+        //
+        // A fixed seed, so that every run triangulates the same observations.
+        //
+        std::mt19937 randomEngine(
+            42 /* seed */);
+
+        std::vector<std::vector<MarkerCornerObservation>> frames(
+            c_numberOfBenchmarkFrames);
+
+        std::vector<int32_t> expectedNumberOfViews;
+
+        for (std::vector<MarkerCornerObservation>& observations : frames)
+        {
+            ObserveCorners(
+                cornerPositions.data(),
+                numberOfCorners,
+                headsetToOrigin,
+                c_benchmarkUnitPlaneNoise,
+                c_benchmarkOutlierCornerInterval,
+                randomEngine,
+                observations,
+                expectedNumberOfViews);
+        }
+
+        //
+        // The triangulator is reused across frames like the tracker does, so that its
+        // buffers are only allocated for the first one.
+        //
+        MarkerTriangulator markerTriangulator;
+        std::vector<TriangulatedMarkerCorner> triangulatedCorners;
+
+        double totalMilliseconds = 0.0, maximumMilliseconds = 0.0;
+        uint64_t numberOfTriangulatedCorners = 0;
+        double sumOfPositionErrorsInMeters = 0.0;
+        float maximumPositionErrorInMeters = 0.0f;
+
+        for (const std::vector<MarkerCornerObservation>& observations : frames)
+        {
+            dbg::Timer timer;
+
+            markerTriangulator.Triangulate(
+                observations,
+                triangulatedCorners);
+
+            const double frameMilliseconds =
+                timer.GetMillisecondsFromStart();
+
+            totalMilliseconds += frameMilliseconds;
+            maximumMilliseconds = std::max(maximumMilliseconds, frameMilliseconds);
+
+            numberOfTriangulatedCorners += triangulatedCorners.size();
+
+            for (const TriangulatedMarkerCorner& triangulatedCorner : triangulatedCorners)
+            {
+                const Windows::Foundation::Numerics::float3 expectedPosition =
+                    Windows::Foundation::Numerics::transform(
+                        cornerPositions[triangulatedCorner.cornerId],
+                        headsetToOrigin);
+
+                const float positionError =
+                    (triangulatedCorner.point - Eigen::Vector3f(expectedPosition.x, expectedPosition.y, expectedPosition.z)).norm();
+
+                sumOfPositionErrorsInMeters += positionError;
+                maximumPositionErrorInMeters = std::max(maximumPositionErrorInMeters, positionError);
+            }
+        }
+
+        dbg::trace(
+            L"BenchmarkMarkerTriangulator: %i frames of %i corners from %i observations, %.03fms/frame (max %.03fms), %.01f corners triangulated per frame, position error %.02fmm on average (max %.02fmm)",
+            c_numberOfBenchmarkFrames,
+            numberOfCorners,
+            static_cast<int32_t>(frames.front().size()),
+            totalMilliseconds / c_numberOfBenchmarkFrames,
+            maximumMilliseconds,
+            static_cast<double>(numberOfTriangulatedCorners) / c_numberOfBenchmarkFrames,
+            numberOfTriangulatedCorners > 0
+                ? 1000.0 * sumOfPositionErrorsInMeters / numberOfTriangulatedCorners
+                : 0.0,
+            maximumPositionErrorInMeters * 1000.0f);
+    }
+}
@@ -0,0 +1,39 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, BenchmarkMarkerTriangulator runs at startup and traces how long the
+// triangulation of a frame with hundreds of corners takes.
+//
+#define MARKER_TRIANGULATOR_BENCHMARK 0
+
+namespace ArUcoMarkerTracker
+{
+    //
+    // Checks the marker corner observations and MarkerTriangulator against a synthetic
+    // rig of four cameras laid out like the HoloLens visible light cameras: two front
+    // facing cameras turned slightly outwards and two side facing ones. Known corners
+    // are projected onto the cameras' unit planes, turned into observations with
+    // CreateMarkerCornerObservation like the detected corners are, and triangulated.
+    // One ray is corrupted to exercise the outlier rejection. Returns true if every
+    // corner is recovered within a millimeter from the expected number of views.
+    //
+    bool ValidateMarkerTriangulator();
+
+    //
+    // Triangulates 100 frames of a wall of 100 markers, 400 corners, seen by the same
+    // synthetic rig, with noisy rays and an outlier ray for every tenth corner. Traces
+    // the time per frame and the position error.
+    //
+    void BenchmarkMarkerTriangulator();
+}
@@ -22,9 +22,12 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <random>
 #include <shared_mutex>
 #include <wincodec.h>
 #include <WindowsNumerics.h>
+#include <ppl.h>
 #include <ppltasks.h>
 #include <stddef.h>
 #include <unordered_set>
@@ -44,6 +47,7 @@
 #include <DirectXHelpers.h>
 
 #include <Debugging/All.h>
+#include <Io/All.h>
 #include <Graphics/All.h>
 #include <Rendering/All.h>
 #include <Holographic/All.h>
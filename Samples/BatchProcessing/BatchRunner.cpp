@@ -0,0 +1,206 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace BatchProcessing
+{
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        uint64_t GetMicrosecondsSince(
+            _In_ const Clock::time_point& startTime)
+        {
+            return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - startTime).count());
+        }
+    }
+
+    HoloLensBatchRunner::HoloLensBatchRunner(
+        _In_ size_t numberOfWorkers,
+        _In_ size_t maximumNumberOfItemsInFlight)
+        : _maximumNumberOfItemsInFlight(maximumNumberOfItemsInFlight)
+        , _isCanceled(false)
+        , _executor(numberOfWorkers)
+    {
+        REQUIRES(_maximumNumberOfItemsInFlight > 0);
+    }
+
+    HoloLensBatchStatistics HoloLensBatchRunner::Run(
+        _In_ const std::vector<bool>& isItemDone,
+        _In_ const LoadFunction& loadFunction,
+        _In_ const ProcessFunction& processFunction,
+        _In_ const WriteFunction& writeFunction)
+    {
+        const Clock::time_point startTime =
+            Clock::now();
+
+        HoloLensBatchStatistics statistics = {};
+
+        statistics.NumberOfItems = isItemDone.size();
+
+        std::mutex mutex;
+        std::condition_variable itemDoneCondition;
+        size_t numberOfItemsInFlight = 0;
+
+        std::mutex writeMutex;
+
+        std::atomic<uint64_t> loadMicroseconds(0);
+        std::atomic<uint64_t> processMicroseconds(0);
+
+        for (size_t itemIndex = 0; itemIndex < isItemDone.size(); ++itemIndex)
+        {
+            if (isItemDone[itemIndex])
+            {
+                ++statistics.NumberOfItemsSkipped;
+
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                itemDoneCondition.wait(
+                    lock,
+                    [&]() { return _isCanceled || numberOfItemsInFlight < _maximumNumberOfItemsInFlight; });
+
+                if (_isCanceled)
+                {
+                    break;
+                }
+
+                ++numberOfItemsInFlight;
+
+                statistics.MaximumNumberOfItemsInFlight =
+                    std::max(
+                        statistics.MaximumNumberOfItemsInFlight,
+                        numberOfItemsInFlight);
+            }
+
+            _executor.Submit(
+                Io::TaskLane::Io,
+                [&, itemIndex]()
+            {
+                const Clock::time_point loadStartTime =
+                    Clock::now();
+
+                auto images =
+                    std::make_shared<std::vector<cv::Mat>>();
+
+                loadFunction(
+                    itemIndex,
+                    *images);
+
+                loadMicroseconds +=
+                    GetMicrosecondsSince(
+                        loadStartTime);
+
+                _executor.Submit(
+                    Io::TaskLane::Compute,
+                    [&, itemIndex, images]()
+                {
+                    const Clock::time_point processStartTime =
+                        Clock::now();
+
+                    const std::string result =
+                        processFunction(
+                            itemIndex,
+                            *images);
+
+                    processMicroseconds +=
+                        GetMicrosecondsSince(
+                            processStartTime);
+
+                    // The images are no longer needed once the item is processed.
+                    images->clear();
+
+                    {
+                        std::lock_guard<std::mutex> writeLock(writeMutex);
+
+                        writeFunction(
+                            itemIndex,
+                            result);
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+
+                        --numberOfItemsInFlight;
+                        ++statistics.NumberOfItemsProcessed;
+                    }
+
+                    itemDoneCondition.notify_all();
+                });
+            });
+        }
+
+        _executor.WaitForIdle();
+
+        statistics.LoadMicroseconds = loadMicroseconds;
+        statistics.ProcessMicroseconds = processMicroseconds;
+        statistics.ElapsedMicroseconds = GetMicrosecondsSince(startTime);
+
+        return statistics;
+    }
+
+    void HoloLensBatchRunner::Cancel()
+    {
+        _isCanceled = true;
+    }
+
+    size_t HoloLensBatchRunner::GetNumberOfWorkers() const
+    {
+        return _executor.GetNumberOfWorkers();
+    }
+
+    size_t ReadBatchResultKeys(
+        _In_reads_bytes_(size) const char* data,
+        _In_ size_t size,
+        _Inout_ std::unordered_set<std::string>& keys)
+    {
+        size_t lineStart = 0;
+
+        while (lineStart < size)
+        {
+            const char* lineEnd =
+                static_cast<const char*>(
+                    memchr(
+                        data + lineStart,
+                        '\n',
+                        size - lineStart));
+
+            if (nullptr == lineEnd)
+            {
+                break;
+            }
+
+            const size_t lineSize =
+                static_cast<size_t>(lineEnd - (data + lineStart));
+
+            const char* keyEnd =
+                static_cast<const char*>(
+                    memchr(
+                        data + lineStart,
+                        ',',
+                        lineSize));
+
+            keys.emplace(
+                data + lineStart,
+                nullptr != keyEnd ? static_cast<size_t>(keyEnd - (data + lineStart)) : lineSize);
+
+            lineStart += lineSize + 1;
+        }
+
+        return lineStart;
+    }
+}
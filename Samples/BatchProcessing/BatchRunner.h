@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace BatchProcessing
+{
+    struct HoloLensBatchStatistics
+    {
+        uint64_t NumberOfItems;
+
+        // Items done by an earlier run, according to its results
+        uint64_t NumberOfItemsSkipped;
+
+        uint64_t NumberOfItemsProcessed;
+
+        size_t MaximumNumberOfItemsInFlight;
+
+        // Summed over all workers
+        uint64_t LoadMicroseconds;
+        uint64_t ProcessMicroseconds;
+
+        uint64_t ElapsedMicroseconds;
+    };
+
+    //
+    // Runs a function over the items of a batch, single frames or synchronized sets of
+    // frames (see RecordingBatch.h), on a pool of worker threads. Each item is loaded on
+    // the executor's I/O lane and processed on its compute lane, which the workers
+    // prefer: the next items load while others are processed, and loaded items are
+    // processed before more are loaded. At most maximumNumberOfItemsInFlight items are
+    // loaded or being processed at any time, which bounds the memory their images hold.
+    //
+    // The result of each item is handed to the write function as soon as it is done, in
+    // the order the items finish, one item at a time.
+    //
+    // Uses only the standard library, OpenCV and Io::TaskExecutor, so that it can be
+    // built and measured outside of the app. The functions must not throw.
+    //
+    class HoloLensBatchRunner
+    {
+    public:
+        typedef std::function<void(size_t itemIndex, std::vector<cv::Mat>& images)> LoadFunction;
+        typedef std::function<std::string(size_t itemIndex, const std::vector<cv::Mat>& images)> ProcessFunction;
+        typedef std::function<void(size_t itemIndex, const std::string& result)> WriteFunction;
+
+        //
+        // Zero workers stands for one per hardware thread.
+        //
+        HoloLensBatchRunner(
+            _In_ size_t numberOfWorkers,
+            _In_ size_t maximumNumberOfItemsInFlight);
+
+        //
+        // Runs the batch over the items that are not done yet, and returns once all of
+        // them have been written or, after Cancel, once the items in flight have been.
+        //
+        HoloLensBatchStatistics Run(
+            _In_ const std::vector<bool>& isItemDone,
+            _In_ const LoadFunction& loadFunction,
+            _In_ const ProcessFunction& processFunction,
+            _In_ const WriteFunction& writeFunction);
+
+        //
+        // Makes Run stop starting items. May be called from any thread.
+        //
+        void Cancel();
+
+        size_t GetNumberOfWorkers() const;
+
+    private:
+        size_t _maximumNumberOfItemsInFlight;
+
+        std::atomic<bool> _isCanceled;
+
+        Io::TaskExecutor _executor;
+    };
+
+    //
+    // Finds the keys of the results of earlier runs: the first field of each complete
+    // line of "<key>,<result>" lines. Returns the size of the complete lines, after
+    // which a run that was interrupted while writing may have left part of a line.
+    //
+    size_t ReadBatchResultKeys(
+        _In_reads_bytes_(size) const char* data,
+        _In_ size_t size,
+        _Inout_ std::unordered_set<std::string>& keys);
+}
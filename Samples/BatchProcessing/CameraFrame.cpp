@@ -13,24 +13,372 @@
 
 namespace BatchProcessing
 {
-    void HoloLensCameraFrame::Load()
+    namespace
     {
-        std::vector<byte> imageBuffer =
-            Io::ReadDataSync(
+        //
+        // Enough for "P5\n<width> <height>\n65535\n", the header of the recorded PGM files.
+        //
+        const size_t kMaximumNetpbmHeaderSize = 32;
+
+        //
+        // Lists the segments of a segmented recording, see RecordingSegmentManifest.
+        //
+        const wchar_t* const kSegmentManifestFileName = L"segments.csv";
+
+        const size_t kNumberOfSegmentManifestColumns = 8;
+
+        bool FileExists(
+            _In_ Windows::Storage::StorageFolder^ folder,
+            _In_ const std::wstring& fileName)
+        {
+            Microsoft::WRL::ComPtr<IStorageFolderHandleAccess> folderHandleAccess =
+                Io::GetStorageFolderHandleAccess(
+                    folder);
+
+            HANDLE file = nullptr;
+
+            if (FAILED(folderHandleAccess->Create(
+                fileName.c_str() /* fileName */,
+                HCO_OPEN_EXISTING /* creationOptions */,
+                HAO_READ /* accessOptions */,
+                HSO_SHARE_READ /* sharingOptions */,
+                HO_NONE /* options */,
+                nullptr /* oplockBreakingHandler */,
+                &file)))
+            {
+                return false;
+            }
+
+            CloseHandle(
+                file);
+
+            return true;
+        }
+
+        void ReadAt(
+            _In_ HANDLE file,
+            _In_ uint64_t offset,
+            _In_ size_t size,
+            _Out_writes_bytes_(size) void* data)
+        {
+            OVERLAPPED overlapped = {};
+
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD numberOfBytesRead = 0;
+
+            ASSERT(!!ReadFile(
+                file,
+                data,
+                static_cast<DWORD>(size),
+                &numberOfBytesRead,
+                &overlapped));
+
+            ASSERT(size == numberOfBytesRead);
+        }
+
+        //
+        // Parses the header of a PGM/PPM bitmap, returning false if the data is not one.
+        //
+        bool ParseNetpbmHeader(
+            _In_ const char* header,
+            _Out_ int32_t& width,
+            _Out_ int32_t& height,
+            _Out_ int32_t& type,
+            _Out_ size_t& headerSize)
+        {
+            char magic = 0;
+            int32_t maximumValue = 0;
+            int32_t numberOfCharacters = 0;
+
+            if (4 != sscanf_s(
+                header,
+                "P%c %d %d %d%n",
+                &magic,
+                1 /* magic size */,
+                &width,
+                &height,
+                &maximumValue,
+                &numberOfCharacters) ||
+                ('5' != magic && '6' != magic))
+            {
+                return false;
+            }
+
+            type =
+                '6' == magic ? CV_8UC3 :
+                maximumValue > 255 ? CV_16UC1 : CV_8UC1;
+
+            // A single whitespace character separates the header from the pixels.
+            headerSize =
+                static_cast<size_t>(numberOfCharacters) + 1;
+
+            return true;
+        }
+
+        HANDLE OpenFile(
+            _In_ Windows::Storage::StorageFolder^ folder,
+            _In_ const std::wstring& fileName)
+        {
+            Microsoft::WRL::ComPtr<IStorageFolderHandleAccess> folderHandleAccess =
+                Io::GetStorageFolderHandleAccess(
+                    folder);
+
+            HANDLE file = nullptr;
+
+            ASSERT_SUCCEEDED(folderHandleAccess->Create(
+                fileName.c_str() /* fileName */,
+                HCO_OPEN_EXISTING /* creationOptions */,
+                HAO_READ /* accessOptions */,
+                HSO_SHARE_READ /* sharingOptions */,
+                HO_NONE /* options */,
+                nullptr /* oplockBreakingHandler */,
+                &file));
+
+            return file;
+        }
+
+        //
+        // Decodes a JPEG or PNG bitmap to BGRA (CV_8UC4) or Gray16 (CV_16UC1) pixels,
+        // copied straight into the image.
+        //
+        void DecodeBitmap(
+            _In_ Windows::Storage::StorageFolder^ folder,
+            _In_ const std::wstring& fileName,
+            _In_ int32_t type,
+            _Inout_ cv::Mat& image)
+        {
+            REQUIRES(CV_8UC4 == type || CV_16UC1 == type);
+
+            Windows::Storage::StorageFile^ file =
+                concurrency::create_task(
+                    folder->GetFileAsync(
+                        ref new Platform::String(
+                            fileName.c_str()))).get();
+
+            Windows::Storage::Streams::IRandomAccessStreamWithContentType^ stream =
+                concurrency::create_task(
+                    file->OpenReadAsync()).get();
+
+            Windows::Graphics::Imaging::BitmapDecoder^ decoder =
+                concurrency::create_task(
+                    Windows::Graphics::Imaging::BitmapDecoder::CreateAsync(
+                        stream)).get();
+
+            Windows::Graphics::Imaging::SoftwareBitmap^ bitmap =
+                concurrency::create_task(
+                    decoder->GetSoftwareBitmapAsync(
+                        CV_8UC4 == type
+                            ? Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8
+                            : Windows::Graphics::Imaging::BitmapPixelFormat::Gray16,
+                        Windows::Graphics::Imaging::BitmapAlphaMode::Ignore)).get();
+
+            image.create(
+                bitmap->PixelHeight /* rows */,
+                bitmap->PixelWidth /* cols */,
+                type);
+
+            auto bitmapBuffer =
+                bitmap->LockBuffer(
+                    Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+            const Windows::Graphics::Imaging::BitmapPlaneDescription planeDescription =
+                bitmapBuffer->GetPlaneDescription(
+                    0 /* index */);
+
+            auto bitmapBufferReference =
+                bitmapBuffer->CreateReference();
+
+            uint32_t bitmapBufferDataLength = 0;
+
+            const uint8_t* bitmapBufferData =
+                Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                    bitmapBufferReference,
+                    bitmapBufferDataLength);
+
+            for (int32_t row = 0; row < image.rows; ++row)
+            {
+                memcpy(
+                    image.ptr(row),
+                    bitmapBufferData + planeDescription.StartIndex + row * planeDescription.Stride,
+                    image.cols * image.elemSize());
+            }
+        }
+    }
+
+    void HoloLensCameraFrame::Load(
+        _Inout_ cv::Mat& image) const
+    {
+        HANDLE input =
+            OpenFile(
                 RecordingFolder,
                 FileName);
 
-        Image = cv::Mat(
-            Height /* _rows */,
-            Width /* _cols */,
-            PixelFormat,
-            imageBuffer.data(),
-            cv::Mat::AUTO_STEP).clone();
+        LARGE_INTEGER fileSize = {};
+
+        ASSERT(!!GetFileSizeEx(
+            input,
+            &fileSize));
+
+        char header[kMaximumNetpbmHeaderSize + 1] = {};
+
+        ReadAt(
+            input,
+            0 /* offset */,
+            std::min<size_t>(kMaximumNetpbmHeaderSize, static_cast<size_t>(fileSize.QuadPart)),
+            header);
+
+        int32_t bitmapWidth = 0;
+        int32_t bitmapHeight = 0;
+        int32_t bitmapType = 0;
+        size_t headerSize = 0;
+
+        if (ParseNetpbmHeader(
+            header,
+            bitmapWidth,
+            bitmapHeight,
+            bitmapType,
+            headerSize))
+        {
+            //
+            // The pixels are read into a buffer kept by the thread, which is reused for
+            // every frame it loads, and converted to BGRA into the image.
+            //
+            static thread_local cv::Mat bitmap;
+
+            bitmap.create(
+                bitmapHeight /* rows */,
+                bitmapWidth /* cols */,
+                bitmapType);
+
+            ReadAt(
+                input,
+                headerSize,
+                bitmap.total() * bitmap.elemSize(),
+                bitmap.data);
+
+            if (CV_8UC3 == bitmapType)
+            {
+                cv::cvtColor(
+                    bitmap,
+                    image,
+                    cv::COLOR_RGB2BGRA);
+            }
+            else if (CV_8UC1 == bitmapType)
+            {
+                cv::cvtColor(
+                    bitmap,
+                    image,
+                    cv::COLOR_GRAY2BGRA);
+            }
+            else
+            {
+                static thread_local cv::Mat bitmap8;
+
+                bitmap.convertTo(
+                    bitmap8,
+                    CV_8U,
+                    1.0 / 256.0 /* alpha */);
+
+                cv::cvtColor(
+                    bitmap8,
+                    image,
+                    cv::COLOR_GRAY2BGRA);
+            }
+        }
+        else if (static_cast<size_t>(fileSize.QuadPart) ==
+            static_cast<size_t>(Width) * Height * CV_ELEM_SIZE(PixelFormat))
+        {
+            //
+            // Raw pixels as described by the manifest are read straight into the image.
+            //
+            image.create(
+                Height /* rows */,
+                Width /* cols */,
+                PixelFormat);
+
+            ReadAt(
+                input,
+                0 /* offset */,
+                static_cast<size_t>(fileSize.QuadPart),
+                image.data);
+        }
+        else
+        {
+            DecodeBitmap(
+                RecordingFolder,
+                FileName,
+                CV_8UC4,
+                image);
+        }
+
+        CloseHandle(
+            input);
     }
 
-    void HoloLensCameraFrame::Unload()
+    void HoloLensCameraFrame::LoadDepth(
+        _Inout_ cv::Mat& depthImage) const
     {
-        Image.release();
+        HANDLE input =
+            OpenFile(
+                RecordingFolder,
+                FileName);
+
+        LARGE_INTEGER fileSize = {};
+
+        ASSERT(!!GetFileSizeEx(
+            input,
+            &fileSize));
+
+        char header[kMaximumNetpbmHeaderSize + 1] = {};
+
+        ReadAt(
+            input,
+            0 /* offset */,
+            std::min<size_t>(kMaximumNetpbmHeaderSize, static_cast<size_t>(fileSize.QuadPart)),
+            header);
+
+        int32_t bitmapWidth = 0;
+        int32_t bitmapHeight = 0;
+        int32_t bitmapType = 0;
+        size_t headerSize = 0;
+
+        if (ParseNetpbmHeader(
+            header,
+            bitmapWidth,
+            bitmapHeight,
+            bitmapType,
+            headerSize))
+        {
+            //
+            // The recorder writes the 16-bit pixels of PGM files in little endian byte
+            // order, see RecordingImageEncoder, so they are read as they are.
+            //
+            ASSERT(CV_16UC1 == bitmapType);
+
+            depthImage.create(
+                bitmapHeight /* rows */,
+                bitmapWidth /* cols */,
+                CV_16UC1);
+
+            ReadAt(
+                input,
+                headerSize,
+                depthImage.total() * depthImage.elemSize(),
+                depthImage.data);
+        }
+        else
+        {
+            DecodeBitmap(
+                RecordingFolder,
+                FileName,
+                CV_16UC1,
+                depthImage);
+        }
+
+        CloseHandle(
+            input);
     }
 
     std::vector<HoloLensCameraFrame> DiscoverCameraFrames(
@@ -75,12 +423,15 @@ namespace BatchProcessing
                 tokens,
                 lineBuffer);
 
+            //
+            // Recordings of version 0.3 and later end with the ImageCodec column.
+            //
             ASSERT(
                 1 /* Timestamp */ +
                 1 /* ImageFileName */ +
                 16 /* FrameToOrigin.m(1..4)(1..4) */ +
                 16 /* CameraViewTransform.m(1..4)(1..4) */ +
-                16 /* CameraProjectionTransform.m(1..4)(1..4) */ == tokens.size());
+                16 /* CameraProjectionTransform.m(1..4)(1..4) */ <= tokens.size());
 
             //
             // Skip the CSV file header
@@ -150,7 +501,7 @@ namespace BatchProcessing
                     cameraFrame.CameraViewTransform.at<float>(j, i) =
                         static_cast<float>(
                             std::atof(
-                                tokens[j * 4 + i + 2].c_str()));
+                                tokens[j * 4 + i + 18].c_str()));
                 }
             }
 
@@ -161,7 +512,7 @@ namespace BatchProcessing
                     cameraFrame.CameraProjectionTransform.at<float>(j, i) =
                         static_cast<float>(
                             std::atof(
-                                tokens[j * 4 + i + 2].c_str()));
+                                tokens[j * 4 + i + 34].c_str()));
                 }
             }
 
@@ -178,4 +529,107 @@ namespace BatchProcessing
         return std::move(
             cameraFrames);
     }
+
+    std::vector<HoloLensCameraFrame> DiscoverSensorCameraFrames(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName)
+    {
+        if (!FileExists(recordingFolder, kSegmentManifestFileName))
+        {
+            const std::wstring manifestFileName =
+                sensorName + L".csv";
+
+            if (!FileExists(recordingFolder, manifestFileName))
+            {
+                dbg::trace(
+                    L"DiscoverSensorCameraFrames: no manifest for sensor '%s'",
+                    sensorName.c_str());
+
+                return std::vector<HoloLensCameraFrame>();
+            }
+
+            return DiscoverCameraFrames(
+                recordingFolder,
+                manifestFileName);
+        }
+
+        std::vector<byte> segmentsBuffer =
+            Io::ReadDataSync(
+                recordingFolder,
+                kSegmentManifestFileName);
+
+        std::istringstream segmentsStream(
+            std::string(
+                reinterpret_cast<char*>(segmentsBuffer.data()),
+                segmentsBuffer.size()));
+
+        const std::string sensorNameUtf8 =
+            Utf16ToUtf8(
+                sensorName);
+
+        std::string line;
+        std::vector<std::string> tokens;
+        std::vector<char> lineBuffer;
+
+        std::vector<std::pair<int32_t, std::wstring>> segments;
+
+        while (std::getline(segmentsStream, line))
+        {
+            line.erase(
+                line.find_last_not_of(
+                    " \t\r\n") + 1);
+
+            if (line.empty())
+            {
+                continue;
+            }
+
+            Io::TokenizeString(
+                line,
+                "," /* delimiter */,
+                tokens,
+                lineBuffer);
+
+            //
+            // Skips the header, the segments of other sensors and the line of a segment
+            // that is still being appended by the recorder.
+            //
+            if (kNumberOfSegmentManifestColumns != tokens.size() ||
+                sensorNameUtf8 != tokens[0])
+            {
+                continue;
+            }
+
+            segments.emplace_back(
+                std::atoi(tokens[1].c_str()) /* SegmentIndex */,
+                Utf8ToUtf16(tokens[3]) /* CsvFileName */);
+        }
+
+        std::sort(
+            segments.begin(),
+            segments.end());
+
+        std::vector<HoloLensCameraFrame> cameraFrames;
+
+        for (const auto& segment : segments)
+        {
+            std::vector<HoloLensCameraFrame> segmentFrames =
+                DiscoverCameraFrames(
+                    recordingFolder,
+                    segment.second);
+
+            cameraFrames.insert(
+                cameraFrames.end(),
+                std::make_move_iterator(segmentFrames.begin()),
+                std::make_move_iterator(segmentFrames.end()));
+        }
+
+        dbg::trace(
+            L"DiscoverSensorCameraFrames: %zu frames in %zu segments for sensor '%s'",
+            cameraFrames.size(),
+            segments.size(),
+            sensorName.c_str());
+
+        return cameraFrames;
+    }
 }
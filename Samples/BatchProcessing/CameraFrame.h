@@ -27,10 +27,23 @@ namespace BatchProcessing
         int32_t Width;
         int32_t Height;
         int32_t PixelFormat;
-        cv::Mat Image;
 
-        void Load();
-        void Unload();
+        //
+        // Loads the BGRA image of the frame. PGM/PPM bitmaps are read straight into
+        // the image, or into a scratch buffer of the calling thread when they need
+        // converting; JPEG and PNG bitmaps are decoded, which blocks on asynchronous
+        // operations and therefore must not happen on the UI thread. The image is only
+        // reallocated if it does not have the size and type of the frame yet.
+        //
+        void Load(
+            _Inout_ cv::Mat& image) const;
+
+        //
+        // Loads the 16-bit (CV_16UC1) image of a depth camera frame, the distance along
+        // each pixel's ray in millimeters. Like Load, blocks when decoding PNG bitmaps.
+        //
+        void LoadDepth(
+            _Inout_ cv::Mat& depthImage) const;
     };
 
     //
@@ -41,4 +54,13 @@ namespace BatchProcessing
     std::vector<HoloLensCameraFrame> DiscoverCameraFrames(
         _In_ Windows::Storage::StorageFolder^ recordingFolder,
         _In_ const std::wstring& manifestFileName);
+
+    //
+    // Returns the camera frames of a sensor in recording order: those of every segment
+    // listed for it in the recording's "segments.csv", or those of "<sensor>.csv" if
+    // the recording is not segmented. Returns no frames if the recording has neither.
+    //
+    std::vector<HoloLensCameraFrame> DiscoverSensorCameraFrames(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName);
 }
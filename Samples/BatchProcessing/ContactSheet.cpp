@@ -0,0 +1,238 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace BatchProcessing
+{
+    namespace
+    {
+        //
+        // Magic, version, number of frames, number of levels, channels and bytes per
+        // channel, followed by the scale, width, height and offset of each level.
+        //
+        const char kContactSheetMagic[4] = { 'H', 'L', 'C', 'S' };
+        const uint32_t kContactSheetVersion = 1;
+        const size_t kContactSheetHeaderSize = 4 + 5 * sizeof(uint32_t);
+        const size_t kContactSheetLevelSize = 3 * sizeof(uint32_t) + sizeof(uint64_t);
+    }
+
+    HoloLensContactSheet::HoloLensContactSheet(
+        _In_ HANDLE file)
+        : _file(file)
+        , _imageType(0)
+        , _bytesPerPixel(0)
+    {
+    }
+
+    HoloLensContactSheet::~HoloLensContactSheet()
+    {
+        CloseHandle(
+            _file);
+    }
+
+    std::unique_ptr<HoloLensContactSheet> HoloLensContactSheet::Open(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName)
+    {
+        Microsoft::WRL::ComPtr<IStorageFolderHandleAccess> folderHandleAccess =
+            Io::GetStorageFolderHandleAccess(
+                recordingFolder);
+
+        const std::wstring fileName =
+            sensorName + L"_previews.bin";
+
+        HANDLE file = nullptr;
+
+        if (FAILED(folderHandleAccess->Create(
+            fileName.c_str() /* fileName */,
+            HCO_OPEN_EXISTING /* creationOptions */,
+            HAO_READ /* accessOptions */,
+            HSO_SHARE_READ /* sharingOptions */,
+            HO_NONE /* options */,
+            nullptr /* oplockBreakingHandler */,
+            &file)))
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<HoloLensContactSheet> contactSheet(
+            new HoloLensContactSheet(
+                file));
+
+        uint8_t header[kContactSheetHeaderSize] = {};
+
+        contactSheet->Read(
+            0 /* offset */,
+            sizeof(header),
+            header);
+
+        uint32_t fields[5] = {};
+
+        memcpy(
+            fields,
+            header + sizeof(kContactSheetMagic),
+            sizeof(fields));
+
+        const uint32_t version = fields[0];
+        const uint32_t numberOfFrames = fields[1];
+        const uint32_t numberOfLevels = fields[2];
+        const uint32_t channels = fields[3];
+        const uint32_t bytesPerChannel = fields[4];
+
+        if (0 != memcmp(header, kContactSheetMagic, sizeof(kContactSheetMagic)) ||
+            kContactSheetVersion != version)
+        {
+            dbg::trace(
+                L"HoloLensContactSheet::Open: %s is not a contact sheet of a supported version",
+                fileName.c_str());
+
+            return nullptr;
+        }
+
+        ASSERT(1 == channels || 4 == channels);
+        ASSERT(1 == bytesPerChannel || 2 == bytesPerChannel);
+
+        contactSheet->_imageType =
+            CV_MAKETYPE(
+                2 == bytesPerChannel ? CV_16U : CV_8U,
+                channels);
+
+        contactSheet->_bytesPerPixel =
+            channels * bytesPerChannel;
+
+        //
+        // The level descriptions and the timestamps follow the header.
+        //
+        std::vector<uint8_t> index(
+            numberOfLevels * kContactSheetLevelSize +
+            numberOfFrames * sizeof(uint64_t));
+
+        contactSheet->Read(
+            kContactSheetHeaderSize,
+            index.size(),
+            index.data());
+
+        for (uint32_t i = 0; i < numberOfLevels; ++i)
+        {
+            const uint8_t* levelData =
+                index.data() + i * kContactSheetLevelSize;
+
+            uint32_t levelFields[3] = {};
+
+            memcpy(
+                levelFields,
+                levelData,
+                sizeof(levelFields));
+
+            HoloLensContactSheetLevel level;
+
+            level.Scale = static_cast<int32_t>(levelFields[0]);
+            level.Width = static_cast<int32_t>(levelFields[1]);
+            level.Height = static_cast<int32_t>(levelFields[2]);
+
+            memcpy(
+                &level.Offset,
+                levelData + sizeof(levelFields),
+                sizeof(level.Offset));
+
+            contactSheet->_levels.push_back(
+                level);
+        }
+
+        contactSheet->_timestamps.resize(
+            numberOfFrames);
+
+        memcpy(
+            contactSheet->_timestamps.data(),
+            index.data() + numberOfLevels * kContactSheetLevelSize,
+            numberOfFrames * sizeof(uint64_t));
+
+        return contactSheet;
+    }
+
+    size_t HoloLensContactSheet::GetNumberOfFrames() const
+    {
+        return _timestamps.size();
+    }
+
+    const std::vector<HoloLensContactSheetLevel>& HoloLensContactSheet::GetLevels() const
+    {
+        return _levels;
+    }
+
+    bool HoloLensContactSheet::FindFrame(
+        _In_ uint64_t timestamp,
+        _Out_ size_t& frameIndex) const
+    {
+        const auto frame =
+            std::lower_bound(
+                _timestamps.begin(),
+                _timestamps.end(),
+                timestamp);
+
+        frameIndex =
+            static_cast<size_t>(frame - _timestamps.begin());
+
+        return frame != _timestamps.end() && *frame == timestamp;
+    }
+
+    void HoloLensContactSheet::ReadPreview(
+        _In_ size_t frameIndex,
+        _In_ size_t level,
+        _Inout_ cv::Mat& preview) const
+    {
+        REQUIRES(frameIndex < _timestamps.size() && level < _levels.size());
+
+        const HoloLensContactSheetLevel& contactSheetLevel =
+            _levels[level];
+
+        const size_t previewSize =
+            contactSheetLevel.Width * contactSheetLevel.Height * _bytesPerPixel;
+
+        preview.create(
+            contactSheetLevel.Height /* rows */,
+            contactSheetLevel.Width /* cols */,
+            _imageType);
+
+        ASSERT(preview.isContinuous());
+
+        Read(
+            contactSheetLevel.Offset + frameIndex * previewSize,
+            previewSize,
+            preview.data);
+    }
+
+    void HoloLensContactSheet::Read(
+        _In_ uint64_t offset,
+        _In_ size_t size,
+        _Out_writes_bytes_(size) void* data) const
+    {
+        //
+        // Positioned reads, so that previews can be read from several threads.
+        //
+        OVERLAPPED overlapped = {};
+
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD numberOfBytesRead = 0;
+
+        ASSERT(!!ReadFile(
+            _file,
+            data,
+            static_cast<DWORD>(size),
+            &numberOfBytesRead,
+            &overlapped));
+
+        ASSERT(size == numberOfBytesRead);
+    }
+}
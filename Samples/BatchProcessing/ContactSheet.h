@@ -0,0 +1,83 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace BatchProcessing
+{
+    //
+    // One level of a preview pyramid: the previews of all frames, each of them
+    // Width x Height pixels, back to back starting at Offset in the file.
+    //
+    struct HoloLensContactSheetLevel
+    {
+        int32_t Scale;
+        int32_t Width;
+        int32_t Height;
+        uint64_t Offset;
+    };
+
+    //
+    // The preview pyramid of the frames of one sensor, as written to
+    // "<sensor>_previews.bin" by Samples/py/recording_previews.py (see there for the
+    // file format). Opening a contact sheet reads its header and frame timestamps
+    // only; each preview is read from the file when it is requested.
+    //
+    class HoloLensContactSheet
+    {
+    public:
+        //
+        // Returns nullptr if the recording has no contact sheet for the sensor.
+        //
+        static std::unique_ptr<HoloLensContactSheet> Open(
+            _In_ Windows::Storage::StorageFolder^ recordingFolder,
+            _In_ const std::wstring& sensorName);
+
+        ~HoloLensContactSheet();
+
+        size_t GetNumberOfFrames() const;
+
+        const std::vector<HoloLensContactSheetLevel>& GetLevels() const;
+
+        //
+        // Finds the frame with the timestamp, returning false if there is none.
+        //
+        bool FindFrame(
+            _In_ uint64_t timestamp,
+            _Out_ size_t& frameIndex) const;
+
+        //
+        // Reads the preview straight into the image, which is only reallocated if it
+        // does not have the size and type of the preview yet. Color previews are BGRA.
+        //
+        void ReadPreview(
+            _In_ size_t frameIndex,
+            _In_ size_t level,
+            _Inout_ cv::Mat& preview) const;
+
+    private:
+        HoloLensContactSheet(
+            _In_ HANDLE file);
+
+        void Read(
+            _In_ uint64_t offset,
+            _In_ size_t size,
+            _Out_writes_bytes_(size) void* data) const;
+
+        HANDLE _file;
+
+        int32_t _imageType;
+        size_t _bytesPerPixel;
+
+        std::vector<HoloLensContactSheetLevel> _levels;
+        std::vector<uint64_t> _timestamps;
+    };
+}
@@ -0,0 +1,481 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace BatchProcessing
+{
+    namespace
+    {
+        //
+        // Trace the running statistics every so many frames.
+        //
+        const uint64_t kStatisticsInterval = 100;
+
+        //
+        // The synthetic scene is processed this many times, and at most this many
+        // recorded frames, to measure the latency of the plane extraction.
+        //
+        const int32_t kNumberOfSyntheticPlaneRepetitions = 20;
+        const size_t kNumberOfRecordedPlaneFrames = 100;
+
+        //
+        // Length of the synthetic camera path that the drift reduction is measured on.
+        //
+        const int32_t kNumberOfSyntheticTrackingFrames = 100;
+
+        const float kMinimumDepthInMeters = 0.2f;
+        const float kMaximumDepthInMeters = 4.0f;
+
+        //
+        // Composes the camera-to-world transform of a frame from the poses in its
+        // manifest, like rmcv::GetCameraToWorldTransform does for sensor frames. The
+        // manifest's transforms use the row vector convention, hence the transpose.
+        //
+        cv::Matx44f GetCameraToWorldTransform(
+            _In_ const HoloLensCameraFrame& frame)
+        {
+            const cv::Matx44f frameToOrigin =
+                frame.FrameToOrigin;
+
+            const cv::Matx44f cameraViewTransform =
+                frame.CameraViewTransform;
+
+            return (cameraViewTransform.inv() * frameToOrigin).t();
+        }
+
+        //
+        // The headset reports no pose for frames taken while it was not tracking; their
+        // FrameToOrigin is not a rigid transform (see read_sensor_poses in Samples/py).
+        //
+        bool HasPose(
+            _In_ const HoloLensCameraFrame& frame)
+        {
+            const cv::Matx33f rotation =
+                cv::Matx44f(frame.FrameToOrigin).get_minor<3, 3>(0, 0);
+
+            return std::abs(cv::determinant(rotation) - 1.0) < 0.01;
+        }
+
+        //
+        // Reads the camera unit plane coordinates of every pixel, which the recorder
+        // writes column by column (see SensorFrameRecorderSink::WriteCameraCalibration).
+        //
+        cv::Mat ReadCameraUnitPlane(
+            _In_ Windows::Storage::StorageFolder^ recordingFolder,
+            _In_ const std::wstring& sensorName,
+            _In_ const cv::Size& imageSize)
+        {
+            std::vector<byte> projection =
+                Io::ReadDataSync(
+                    recordingFolder,
+                    sensorName + L"_camera_space_projection.bin");
+
+            REQUIRES(projection.size() == static_cast<size_t>(imageSize.area()) * sizeof(cv::Vec2f));
+
+            const cv::Mat columns(
+                imageSize.width /* rows */,
+                imageSize.height /* cols */,
+                CV_32FC2,
+                projection.data());
+
+            return columns.t();
+        }
+
+        void WriteManifestHeader(
+            _Inout_ std::ostringstream& manifest)
+        {
+            manifest << "Timestamp,ImageFileName";
+
+            for (const char* transformName : { "FrameToOrigin", "CameraViewTransform", "CameraProjectionTransform" })
+            {
+                for (int32_t j = 1; j <= 4; ++j)
+                {
+                    for (int32_t i = 1; i <= 4; ++i)
+                    {
+                        manifest << "," << transformName << ".m" << j << i;
+                    }
+                }
+            }
+
+            manifest << "\n";
+        }
+
+        void WriteManifestLine(
+            _In_ const HoloLensCameraFrame& frame,
+            _In_ const cv::Mat& frameToOrigin,
+            _Inout_ std::ostringstream& manifest)
+        {
+            manifest << frame.Timestamp << "," << Utf16ToUtf8(frame.FileName);
+
+            for (const cv::Mat* transform : { &frameToOrigin, &frame.CameraViewTransform, &frame.CameraProjectionTransform })
+            {
+                for (int32_t j = 0; j < 4; ++j)
+                {
+                    for (int32_t i = 0; i < 4; ++i)
+                    {
+                        manifest << "," << transform->at<float>(j, i);
+                    }
+                }
+            }
+
+            manifest << "\n";
+        }
+
+        void WriteManifest(
+            _In_ Windows::Storage::StorageFolder^ recordingFolder,
+            _In_ const std::wstring& manifestFileName,
+            _In_ const std::string& manifest)
+        {
+            Microsoft::WRL::ComPtr<IStorageFolderHandleAccess> folderHandleAccess =
+                Io::GetStorageFolderHandleAccess(
+                    recordingFolder);
+
+            HANDLE output = nullptr;
+
+            ASSERT_SUCCEEDED(folderHandleAccess->Create(
+                manifestFileName.c_str() /* fileName */,
+                HCO_CREATE_ALWAYS /* creationOptions */,
+                HAO_WRITE /* accessOptions */,
+                HSO_SHARE_NONE /* sharingOptions */,
+                HO_NONE /* options */,
+                nullptr /* oplockBreakingHandler */,
+                &output));
+
+            DWORD numberOfBytesWritten = 0;
+
+            ASSERT(!!WriteFile(
+                output,
+                manifest.data(),
+                static_cast<DWORD>(manifest.size()),
+                &numberOfBytesWritten,
+                nullptr /* lpOverlapped */));
+
+            ASSERT(manifest.size() == numberOfBytesWritten);
+
+            CloseHandle(
+                output);
+        }
+
+        void TraceStatistics(
+            _In_ const wchar_t* label,
+            _In_ const std::wstring& sensorName,
+            _In_ const HoloLensDepthTrackingStatistics& statistics)
+        {
+            dbg::trace(
+                L"RunDepthTracking: %s '%s': %llu frames, %llu refined, %llu key frames, %.02f ms/frame (at most %.02f ms), drift %.04fm / %.02fdeg (at most %.04fm / %.02fdeg)",
+                label,
+                sensorName.c_str(),
+                statistics.NumberOfFrames,
+                statistics.NumberOfFramesRefined,
+                statistics.NumberOfKeyFrames,
+                statistics.TotalMilliseconds / std::max<uint64_t>(1, statistics.NumberOfFrames),
+                statistics.MaximumMilliseconds,
+                statistics.FinalDriftInMeters,
+                statistics.FinalDriftInDegrees,
+                statistics.MaximumDriftInMeters,
+                statistics.MaximumDriftInDegrees);
+        }
+    }
+
+    HoloLensDepthTrackingStatistics::HoloLensDepthTrackingStatistics()
+        : NumberOfFrames(0)
+        , NumberOfFramesRefined(0)
+        , NumberOfKeyFrames(0)
+        , TotalMilliseconds(0.0)
+        , MaximumMilliseconds(0.0)
+        , FinalDriftInMeters(0.0f)
+        , FinalDriftInDegrees(0.0f)
+        , MaximumDriftInMeters(0.0f)
+        , MaximumDriftInDegrees(0.0f)
+    {
+    }
+
+    HoloLensDepthTrackingStatistics RunDepthTracking(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName,
+        _In_ const std::wstring& outputManifestFileName)
+    {
+        std::vector<HoloLensCameraFrame> frames =
+            DiscoverSensorCameraFrames(
+                recordingFolder,
+                sensorName);
+
+        std::sort(
+            frames.begin(),
+            frames.end(),
+            [](const HoloLensCameraFrame& a, const HoloLensCameraFrame& b)
+        {
+            return a.Timestamp < b.Timestamp;
+        });
+
+        HoloLensDepthTrackingStatistics statistics;
+
+        if (frames.empty())
+        {
+            return statistics;
+        }
+
+        std::ostringstream manifest;
+
+        WriteManifestHeader(
+            manifest);
+
+        std::unique_ptr<rmcv::DepthIcp> depthIcp;
+        cv::Mat depthImage;
+
+        for (const HoloLensCameraFrame& frame : frames)
+        {
+            if (!HasPose(frame))
+            {
+                //
+                // Keep the frame, but do not register a frame without an initial guess:
+                // the next frame with a pose starts over from the headset's trajectory.
+                //
+                WriteManifestLine(
+                    frame,
+                    frame.FrameToOrigin,
+                    manifest);
+
+                if (nullptr != depthIcp)
+                {
+                    depthIcp->Reset();
+                }
+
+                continue;
+            }
+
+            frame.LoadDepth(
+                depthImage);
+
+            if (nullptr == depthIcp)
+            {
+                depthIcp.reset(
+                    new rmcv::DepthIcp(
+                        ReadCameraUnitPlane(
+                            recordingFolder,
+                            sensorName,
+                            depthImage.size()),
+                        rmcv::DepthIcpSettings()));
+            }
+
+            const cv::Matx44f headsetCameraToWorld =
+                GetCameraToWorldTransform(
+                    frame);
+
+            cv::Matx44f refinedCameraToWorld;
+
+            const bool refined =
+                depthIcp->Refine(
+                    depthImage,
+                    headsetCameraToWorld,
+                    refinedCameraToWorld);
+
+            const rmcv::DepthIcpStatistics& frameStatistics =
+                depthIcp->GetStatistics();
+
+            ++statistics.NumberOfFrames;
+            statistics.NumberOfFramesRefined += refined ? 1 : 0;
+            statistics.NumberOfKeyFrames += frameStatistics.KeyFrameUpdated ? 1 : 0;
+            statistics.TotalMilliseconds += frameStatistics.ElapsedTimeInMilliseconds;
+            statistics.MaximumMilliseconds = std::max(statistics.MaximumMilliseconds, frameStatistics.ElapsedTimeInMilliseconds);
+
+            statistics.FinalDriftInMeters = frameStatistics.CorrectionTranslationInMeters;
+            statistics.FinalDriftInDegrees = frameStatistics.CorrectionRotationInDegrees;
+            statistics.MaximumDriftInMeters = std::max(statistics.MaximumDriftInMeters, frameStatistics.CorrectionTranslationInMeters);
+            statistics.MaximumDriftInDegrees = std::max(statistics.MaximumDriftInDegrees, frameStatistics.CorrectionRotationInDegrees);
+
+            dbg::trace(
+                L"RunDepthTracking: %llu: %s in %.02f ms, %i -> %i inliers, truncated rms residual %.04fm -> %.04fm, drift %.04fm / %.02fdeg",
+                frame.Timestamp,
+                refined ? L"refined" : L"kept",
+                frameStatistics.ElapsedTimeInMilliseconds,
+                frameStatistics.InitialNumberOfInliers,
+                frameStatistics.FinalNumberOfInliers,
+                frameStatistics.InitialTruncatedRmsResidualInMeters,
+                frameStatistics.FinalTruncatedRmsResidualInMeters,
+                frameStatistics.CorrectionTranslationInMeters,
+                frameStatistics.CorrectionRotationInDegrees);
+
+            if (0 == statistics.NumberOfFrames % kStatisticsInterval)
+            {
+                TraceStatistics(
+                    L"running",
+                    sensorName,
+                    statistics);
+            }
+
+            //
+            // The inverse of GetCameraToWorldTransform, see rmcv::GetFrameToOriginTransform.
+            //
+            const cv::Matx44f cameraViewTransform =
+                frame.CameraViewTransform;
+
+            const cv::Matx44f refinedFrameToOrigin =
+                cameraViewTransform * refinedCameraToWorld.t();
+
+            WriteManifestLine(
+                frame,
+                cv::Mat(refinedFrameToOrigin),
+                manifest);
+        }
+
+        WriteManifest(
+            recordingFolder,
+            outputManifestFileName,
+            manifest.str());
+
+        TraceStatistics(
+            L"done with",
+            sensorName,
+            statistics);
+
+        return statistics;
+    }
+
+    bool BenchmarkDepthTracking(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName)
+    {
+        const std::vector<HoloLensCameraFrame> frames =
+            DiscoverSensorCameraFrames(
+                recordingFolder,
+                sensorName);
+
+        if (frames.empty())
+        {
+            return false;
+        }
+
+        cv::Mat depthImage;
+
+        frames[0].LoadDepth(
+            depthImage);
+
+        const rmcv::DepthIcpDriftBenchmarkResult result =
+            rmcv::BenchmarkDepthIcpDrift(
+                ReadCameraUnitPlane(
+                    recordingFolder,
+                    sensorName,
+                    depthImage.size()),
+                kNumberOfSyntheticTrackingFrames);
+
+        dbg::trace(
+            L"BenchmarkDepthTracking: '%s': synthetic path %s, drift reduced from %.04fm / %.02fdeg to %.04fm / %.02fdeg, %.02f ms per frame",
+            sensorName.c_str(),
+            result.Passed ? L"passed" : L"FAILED",
+            result.HeadsetDriftInMeters,
+            result.HeadsetDriftInDegrees,
+            result.RefinedDriftInMeters,
+            result.RefinedDriftInDegrees,
+            result.MeanMilliseconds);
+
+        return result.Passed;
+    }
+
+    bool ValidateDepthPlanes(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName)
+    {
+        const std::vector<HoloLensCameraFrame> frames =
+            DiscoverSensorCameraFrames(
+                recordingFolder,
+                sensorName);
+
+        if (frames.empty())
+        {
+            return false;
+        }
+
+        cv::Mat depthImage;
+
+        frames[0].LoadDepth(
+            depthImage);
+
+        const cv::Mat cameraUnitPlane =
+            ReadCameraUnitPlane(
+                recordingFolder,
+                sensorName,
+                depthImage.size());
+
+        const rmcv::DepthPlaneValidationResult result =
+            rmcv::ValidateDepthPlaneExtraction(
+                cameraUnitPlane,
+                kNumberOfSyntheticPlaneRepetitions);
+
+        const rmcv::DepthPlaneExtractorSettings planeExtractorSettings;
+
+        rmcv::DepthNormalEstimator normalEstimator;
+        rmcv::DepthPlaneExtractor planeExtractor(
+            planeExtractorSettings);
+
+        cv::Mat vertices, normals, labels;
+        std::vector<rmcv::DepthPlane> planes;
+
+        const size_t numberOfFrames =
+            std::min(kNumberOfRecordedPlaneFrames, frames.size());
+
+        double normalEstimationMilliseconds = 0.0;
+        double planeExtractionMilliseconds = 0.0;
+        double maximumMilliseconds = 0.0;
+        size_t numberOfPlanes = 0;
+
+        for (size_t i = 0; i < numberOfFrames; ++i)
+        {
+            frames[i].LoadDepth(
+                depthImage);
+
+            rmcv::BackprojectDepthImage(
+                depthImage,
+                cameraUnitPlane,
+                kMinimumDepthInMeters,
+                kMaximumDepthInMeters,
+                vertices);
+
+            dbg::Timer timer;
+
+            normalEstimator.Compute(
+                vertices,
+                normals);
+
+            const double normalMilliseconds =
+                timer.GetMillisecondsFromLastEvent();
+
+            timer.MarkEvent();
+
+            planeExtractor.Extract(
+                vertices,
+                normals,
+                planes,
+                labels);
+
+            const double planeMilliseconds =
+                timer.GetMillisecondsFromLastEvent();
+
+            normalEstimationMilliseconds += normalMilliseconds;
+            planeExtractionMilliseconds += planeMilliseconds;
+            maximumMilliseconds = std::max(maximumMilliseconds, normalMilliseconds + planeMilliseconds);
+            numberOfPlanes += planes.size();
+        }
+
+        dbg::trace(
+            L"ValidateDepthPlanes: '%s': synthetic scene %s, %zu recorded frames: %.02f ms normals, %.02f ms planes (at most %.02f ms together), %.1f planes per frame",
+            sensorName.c_str(),
+            result.Passed ? L"passed" : L"FAILED",
+            numberOfFrames,
+            normalEstimationMilliseconds / numberOfFrames,
+            planeExtractionMilliseconds / numberOfFrames,
+            maximumMilliseconds,
+            static_cast<double>(numberOfPlanes) / numberOfFrames);
+
+        return result.Passed;
+    }
+}
@@ -0,0 +1,79 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace BatchProcessing
+{
+    struct HoloLensDepthTrackingStatistics
+    {
+        HoloLensDepthTrackingStatistics();
+
+        uint64_t NumberOfFrames;
+
+        //
+        // Frames whose refined pose was accepted, and frames that became key frames.
+        //
+        uint64_t NumberOfFramesRefined;
+        uint64_t NumberOfKeyFrames;
+
+        double TotalMilliseconds;
+        double MaximumMilliseconds;
+
+        //
+        // Difference between the refined and the headset's camera pose, i.e. how far the
+        // headset's trajectory drifted from the depth data, at the last frame and at most.
+        //
+        float FinalDriftInMeters;
+        float FinalDriftInDegrees;
+        float MaximumDriftInMeters;
+        float MaximumDriftInDegrees;
+    };
+
+    //
+    // Refines the camera poses of a depth sensor's frames with rmcv::DepthIcp, starting
+    // from the poses the headset recorded, and writes them to a frame manifest in the
+    // recording's CSV format: the same frames with the refined FrameToOrigin, which
+    // DiscoverCameraFrames and Samples/py read like the recorded manifest. Traces the
+    // registration time, the residuals and the drift of every frame.
+    //
+    // The frames are registered one after another and their depth images are decoded
+    // on the calling thread, which must therefore not be the UI thread.
+    //
+    HoloLensDepthTrackingStatistics RunDepthTracking(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName,
+        _In_ const std::wstring& outputManifestFileName);
+
+    //
+    // Measures the drift reduction of rmcv::DepthIcp on a synthetic scene seen through
+    // the depth sensor's lens along a known camera path (see rmcv::BenchmarkDepthIcpDrift).
+    // Unlike the drift traced by RunDepthTracking, which is measured against the
+    // headset's own poses, this compares both trajectories with the ground truth and
+    // gives the same results on every run. Returns false if the refined trajectory did
+    // not drift less than the headset's, or the recording has no frames of the sensor.
+    // Blocks like RunDepthTracking.
+    //
+    bool BenchmarkDepthTracking(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName);
+
+    //
+    // Checks the normal estimation and plane extraction of rmcv on a synthetic scene seen
+    // through the depth sensor's lens (see rmcv::ValidateDepthPlaneExtraction), then
+    // traces their latency on the first of the sensor's recorded frames. Returns false
+    // if the check fails or the recording has no frames of the sensor. Blocks like
+    // RunDepthTracking.
+    //
+    bool ValidateDepthPlanes(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& sensorName);
+}
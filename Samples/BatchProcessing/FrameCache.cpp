@@ -0,0 +1,372 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace BatchProcessing
+{
+    HoloLensFrameCache::HoloLensFrameCache(
+        _In_ size_t numberOfFrames,
+        _In_ size_t maximumSize,
+        _In_ size_t prefetchDistance,
+        _In_ LoadFunction loadFunction)
+        : _numberOfFrames(numberOfFrames)
+        , _maximumSize(maximumSize)
+        , _prefetchDistance(prefetchDistance)
+        , _loadFunction(std::move(loadFunction))
+        , _hasCursor(false)
+        , _cursor(0)
+        , _statistics()
+        , _stopping(false)
+    {
+        REQUIRES(!!_loadFunction);
+
+        _prefetchThread = std::thread(
+            &HoloLensFrameCache::PrefetchThread,
+            this);
+    }
+
+    HoloLensFrameCache::~HoloLensFrameCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _stopping = true;
+        }
+
+        _prefetchCondition.notify_all();
+
+        _prefetchThread.join();
+    }
+
+    void HoloLensFrameCache::MoveCursor(
+        _In_ size_t frameIndex)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            REQUIRES(frameIndex < _numberOfFrames);
+
+            //
+            // The browser wraps around at the ends of the recording, so the step is
+            // taken the short way around.
+            //
+            const int64_t numberOfFrames =
+                static_cast<int64_t>(_numberOfFrames);
+
+            int64_t step = 1;
+
+            if (_hasCursor && frameIndex != _cursor)
+            {
+                step = static_cast<int64_t>(frameIndex) - static_cast<int64_t>(_cursor);
+
+                if (step > numberOfFrames / 2)
+                {
+                    step -= numberOfFrames;
+                }
+                else if (step < -numberOfFrames / 2)
+                {
+                    step += numberOfFrames;
+                }
+            }
+
+            _cursor = frameIndex;
+            _hasCursor = true;
+
+            const auto getFrameAhead = [&](int64_t offset)
+            {
+                return static_cast<size_t>(
+                    ((static_cast<int64_t>(frameIndex) + offset) % numberOfFrames + numberOfFrames) % numberOfFrames);
+            };
+
+            _prefetchQueue.clear();
+
+            for (size_t i = 1; i <= _prefetchDistance; ++i)
+            {
+                _prefetchQueue.push_back(
+                    getFrameAhead(step * static_cast<int64_t>(i)));
+
+                //
+                // After a page, the next frame is as likely to be viewed as the next page.
+                //
+                if (1 == i && (step > 1 || step < -1))
+                {
+                    _prefetchQueue.push_back(
+                        getFrameAhead(step > 0 ? 1 : -1));
+                }
+            }
+        }
+
+        _prefetchCondition.notify_one();
+    }
+
+    cv::Mat HoloLensFrameCache::Get(
+        _In_ size_t frameIndex)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        REQUIRES(frameIndex < _numberOfFrames);
+
+        ++_statistics.NumberOfRequests;
+
+        if (_loading.count(frameIndex))
+        {
+            ++_statistics.NumberOfPrefetchWaits;
+
+            _loadedCondition.wait(
+                lock,
+                [&]() { return 0 == _loading.count(frameIndex); });
+        }
+        else if (!_entries.count(frameIndex))
+        {
+            ++_statistics.NumberOfMisses;
+        }
+        else
+        {
+            ++_statistics.NumberOfHits;
+        }
+
+        auto entry =
+            _entries.find(frameIndex);
+
+        if (entry != _entries.end())
+        {
+            Touch(
+                entry->second);
+
+            return entry->second.Image;
+        }
+
+        //
+        // Not cached, or evicted again right after it was prefetched: load it here.
+        //
+        _loading.insert(
+            frameIndex);
+
+        lock.unlock();
+
+        cv::Mat image;
+
+        try
+        {
+            _loadFunction(
+                frameIndex,
+                image);
+        }
+        catch (...)
+        {
+            lock.lock();
+
+            _loading.erase(
+                frameIndex);
+
+            ++_statistics.NumberOfLoadFailures;
+
+            lock.unlock();
+
+            _loadedCondition.notify_all();
+
+            throw;
+        }
+
+        lock.lock();
+
+        _loading.erase(
+            frameIndex);
+
+        Insert(
+            frameIndex,
+            image);
+
+        lock.unlock();
+
+        _loadedCondition.notify_all();
+
+        return image;
+    }
+
+    bool HoloLensFrameCache::TryGet(
+        _In_ size_t frameIndex,
+        _Out_ cv::Mat& image)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto entry =
+            _entries.find(frameIndex);
+
+        if (entry == _entries.end())
+        {
+            return false;
+        }
+
+        ++_statistics.NumberOfRequests;
+        ++_statistics.NumberOfHits;
+
+        Touch(
+            entry->second);
+
+        image = entry->second.Image;
+
+        return true;
+    }
+
+    HoloLensFrameCacheStatistics HoloLensFrameCache::GetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        HoloLensFrameCacheStatistics statistics = _statistics;
+
+        statistics.NumberOfFrames = _entries.size();
+
+        return statistics;
+    }
+
+    void HoloLensFrameCache::Touch(
+        _Inout_ Entry& entry)
+    {
+        _lru.splice(
+            _lru.begin(),
+            _lru,
+            entry.LruPosition);
+    }
+
+    void HoloLensFrameCache::Insert(
+        _In_ size_t frameIndex,
+        _In_ const cv::Mat& image)
+    {
+        if (_entries.count(frameIndex))
+        {
+            return;
+        }
+
+        Entry entry;
+
+        entry.Image = image;
+        entry.Size = image.total() * image.elemSize();
+        entry.LruPosition = _lru.insert(_lru.begin(), frameIndex);
+
+        _statistics.NumberOfBytes += entry.Size;
+
+        _entries.emplace(
+            frameIndex,
+            std::move(entry));
+
+        //
+        // Neither the frame just inserted nor the cursor's frame is evicted, even if
+        // they alone exceed the budget.
+        //
+        auto victim = _lru.end();
+
+        while (_statistics.NumberOfBytes > _maximumSize && victim != _lru.begin())
+        {
+            --victim;
+
+            if (*victim == frameIndex || (_hasCursor && *victim == _cursor))
+            {
+                continue;
+            }
+
+            auto victimEntry =
+                _entries.find(*victim);
+
+            _statistics.NumberOfBytes -= victimEntry->second.Size;
+            ++_statistics.NumberOfEvictions;
+
+            _entries.erase(
+                victimEntry);
+
+            victim = _lru.erase(
+                victim);
+        }
+    }
+
+    void HoloLensFrameCache::PrefetchThread()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while (true)
+        {
+            _prefetchCondition.wait(
+                lock,
+                [this]() { return _stopping || !_prefetchQueue.empty(); });
+
+            if (_stopping)
+            {
+                break;
+            }
+
+            const size_t frameIndex =
+                _prefetchQueue.front();
+
+            _prefetchQueue.pop_front();
+
+            auto entry =
+                _entries.find(frameIndex);
+
+            if (entry != _entries.end())
+            {
+                // Keep the frames ahead of the cursor from being evicted next.
+                Touch(
+                    entry->second);
+
+                continue;
+            }
+
+            if (_loading.count(frameIndex))
+            {
+                continue;
+            }
+
+            _loading.insert(
+                frameIndex);
+
+            lock.unlock();
+
+            cv::Mat image;
+            bool loaded = true;
+
+            try
+            {
+                _loadFunction(
+                    frameIndex,
+                    image);
+            }
+            catch (...)
+            {
+                //
+                // Leave the frame uncached: a Get waiting for it loads it again and
+                // passes the failure on to its caller.
+                //
+                loaded = false;
+            }
+
+            lock.lock();
+
+            _loading.erase(
+                frameIndex);
+
+            if (loaded)
+            {
+                ++_statistics.NumberOfPrefetches;
+
+                Insert(
+                    frameIndex,
+                    image);
+            }
+            else
+            {
+                ++_statistics.NumberOfLoadFailures;
+            }
+
+            _loadedCondition.notify_all();
+        }
+    }
+}
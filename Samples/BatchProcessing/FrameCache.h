@@ -0,0 +1,134 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace BatchProcessing
+{
+    struct HoloLensFrameCacheStatistics
+    {
+        // Get calls: served from the cache, by waiting for a prefetch in flight, or
+        // by loading the frame on the calling thread
+        uint64_t NumberOfRequests;
+        uint64_t NumberOfHits;
+        uint64_t NumberOfPrefetchWaits;
+        uint64_t NumberOfMisses;
+
+        // Frames loaded ahead of the cursor, and frames evicted to stay in budget
+        uint64_t NumberOfPrefetches;
+        uint64_t NumberOfEvictions;
+
+        // Loads that threw, on the prefetch thread or in Get
+        uint64_t NumberOfLoadFailures;
+
+        size_t NumberOfFrames;
+        size_t NumberOfBytes;
+    };
+
+    //
+    // Keeps the images of recently viewed frames of a recording, by frame index, within
+    // a memory budget, evicting the least recently used ones. A background thread loads
+    // the frames the cursor is heading for: the next few in the direction it last moved,
+    // with the same stride, so that paging by ten frames prefetches the pages ahead, and
+    // the neighbor of the frame paged to. The images are loaded straight into the cached
+    // matrices by the load function, which is called on the prefetch thread or on the
+    // thread calling Get, never on the UI thread unless Get is called from it.
+    //
+    // Uses only the standard library and OpenCV, so that it can be built and measured
+    // outside of the app.
+    //
+    class HoloLensFrameCache
+    {
+    public:
+        typedef std::function<void(size_t frameIndex, cv::Mat& image)> LoadFunction;
+
+        HoloLensFrameCache(
+            _In_ size_t numberOfFrames,
+            _In_ size_t maximumSize,
+            _In_ size_t prefetchDistance,
+            _In_ LoadFunction loadFunction);
+
+        ~HoloLensFrameCache();
+
+        //
+        // Moves the cursor to the frame, which the cache then keeps, and replaces the
+        // frames waiting to be prefetched with those ahead of it. Does not block.
+        //
+        void MoveCursor(
+            _In_ size_t frameIndex);
+
+        //
+        // Returns the image of the frame, waiting for it if it is being prefetched and
+        // loading it if it is not cached. Exceptions of the load function are passed on
+        // to the caller; a frame whose prefetch failed is loaded again, so that the
+        // caller gets the failure.
+        //
+        cv::Mat Get(
+            _In_ size_t frameIndex);
+
+        //
+        // Returns the image of the frame if it is cached, without blocking.
+        //
+        bool TryGet(
+            _In_ size_t frameIndex,
+            _Out_ cv::Mat& image);
+
+        HoloLensFrameCacheStatistics GetStatistics();
+
+    private:
+        struct Entry
+        {
+            cv::Mat Image;
+            size_t Size;
+            std::list<size_t>::iterator LruPosition;
+        };
+
+        void Touch(
+            _Inout_ Entry& entry);
+
+        //
+        // Caches the image as the most recently used and evicts the least recently
+        // used frames but the cursor's until the cache fits its budget again.
+        //
+        void Insert(
+            _In_ size_t frameIndex,
+            _In_ const cv::Mat& image);
+
+        void PrefetchThread();
+
+        size_t _numberOfFrames;
+        size_t _maximumSize;
+        size_t _prefetchDistance;
+        LoadFunction _loadFunction;
+
+        std::mutex _mutex;
+
+        std::unordered_map<size_t, Entry> _entries;
+
+        // Frame indices, the most recently used first
+        std::list<size_t> _lru;
+
+        // Frames being loaded, by the prefetch thread or by Get
+        std::unordered_set<size_t> _loading;
+        std::condition_variable _loadedCondition;
+
+        std::deque<size_t> _prefetchQueue;
+        std::condition_variable _prefetchCondition;
+
+        bool _hasCursor;
+        size_t _cursor;
+
+        HoloLensFrameCacheStatistics _statistics;
+
+        bool _stopping;
+        std::thread _prefetchThread;
+    };
+}
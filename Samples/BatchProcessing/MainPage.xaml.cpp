@@ -25,6 +25,34 @@ using namespace Windows::UI::Xaml::Navigation;
 
 namespace BatchProcessing
 {
+    namespace
+    {
+        //
+        // About 70 PV camera frames, and the frames prefetched ahead of the cursor.
+        //
+        const size_t kPvFrameCacheSize = 256 * 1024 * 1024;
+        const size_t kPvFramePrefetchDistance = 4;
+
+        //
+        // Trace the cache's hit rate every so many requests.
+        //
+        const uint64_t kPvFrameCacheStatisticsInterval = 100;
+
+        //
+        // The sample batch processes each PV camera frame with the frames of the front
+        // visible light cameras taken within a frame time of it, at 30 frames per second
+        // in units of 100ns, keeping two items in flight per worker.
+        //
+        const uint64_t kSampleBatchMaximumTimeDifference = 10000000 / 30;
+        const size_t kSampleBatchItemsInFlightPerWorker = 2;
+
+        //
+        // The refined poses of a depth camera are written next to its frame manifest.
+        //
+        const wchar_t* const kDepthCameraSensorNames[] = { L"long_throw_depth", L"short_throw_depth" };
+        const wchar_t* const kRefinedPosesManifestSuffix = L"_refined_poses.csv";
+    }
+
     MainPage::MainPage()
     {
         InitializeComponent();
@@ -49,6 +77,9 @@ namespace BatchProcessing
             folderPicker->PickSingleFolderAsync()).
             then([this](Windows::Storage::StorageFolder^ folder)
         {
+            _recordingFolder =
+                folder;
+
             _cameraCalibrations =
                 ReadCameraCalibrations(
                     folder);
@@ -69,10 +100,16 @@ namespace BatchProcessing
                     cameraCalibration.TangentialDistortionY);
             }
 
+            //
+            // The previous recording's cache may still be prefetching, and loads still
+            // in flight hold on to it until they are done.
+            //
+            _pvFrameCache.reset();
+
             _pvCameraFrames =
-                DiscoverCameraFrames(
+                DiscoverSensorCameraFrames(
                     folder,
-                    L"pv.csv");
+                    L"pv");
 
             dbg::trace(
                 L" *** found %i PV camera frames",
@@ -86,6 +123,37 @@ namespace BatchProcessing
                     cameraFrame.FileName.c_str());
             }
 
+            //
+            // With a contact sheet, written by Samples/py/recording_previews.py, the
+            // preview of a frame is shown right away and the frame once it is loaded.
+            //
+            _pvContactSheet =
+                HoloLensContactSheet::Open(
+                    folder,
+                    L"pv");
+
+            dbg::trace(
+                L" *** found %i PV camera frame previews",
+                nullptr != _pvContactSheet ? _pvContactSheet->GetNumberOfFrames() : 0);
+
+            if (!_pvCameraFrames.empty())
+            {
+                auto pvCameraFrames =
+                    std::make_shared<const std::vector<HoloLensCameraFrame>>(
+                        _pvCameraFrames);
+
+                _pvFrameCache =
+                    std::make_shared<HoloLensFrameCache>(
+                        pvCameraFrames->size() /* numberOfFrames */,
+                        kPvFrameCacheSize /* maximumSize */,
+                        kPvFramePrefetchDistance /* prefetchDistance */,
+                        [pvCameraFrames](size_t frameIndex, cv::Mat& image)
+                {
+                    (*pvCameraFrames)[frameIndex].Load(
+                        image);
+                });
+            }
+
             _currentPvCameraFrame = -1;
 
             MoveRecordingCursor(
@@ -109,46 +177,46 @@ namespace BatchProcessing
             +1 /* howMuch */);
     }
 
-    void MainPage::UpdatePreview()
+    void MainPage::UpdatePreview(
+        int32_t pvCameraFrame,
+        cv::Mat image,
+        bool isPreview)
     {
-        if (_currentPvCameraFrame < 0)
-        {
-            return;
-        }
-
         _pvCameraImage->Dispatcher->RunAsync(
             Windows::UI::Core::CoreDispatcherPriority::Normal,
             ref new Windows::UI::Core::DispatchedHandler(
-                [this]()
+                [this, pvCameraFrame, image, isPreview]()
         {
-            const auto& pvCameraFrame =
-                _pvCameraFrames[
-                    _currentPvCameraFrame];
+            if (pvCameraFrame != _currentPvCameraFrame)
+            {
+                return;
+            }
 
             {
                 wchar_t caption[MAX_PATH] = {};
 
                 swprintf_s(
                     caption,
-                    L"PV Camera Image: frame %i / %i",
-                    _currentPvCameraFrame + 1,
-                    static_cast<uint32_t>(_pvCameraFrames.size()));
+                    L"PV Camera Image: frame %i / %i%s",
+                    pvCameraFrame + 1,
+                    static_cast<uint32_t>(_pvCameraFrames.size()),
+                    isPreview ? L" (preview)" : L"");
 
                 _pvCameraImageCaption->Text =
                     ref new Platform::String(
                         caption);
             }
 
-            auto image =
+            auto bitmap =
                 ref new Windows::Graphics::Imaging::SoftwareBitmap(
                     Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8,
-                    pvCameraFrame.Width,
-                    pvCameraFrame.Height,
+                    image.cols,
+                    image.rows,
                     Windows::Graphics::Imaging::BitmapAlphaMode::Ignore);
 
             {
                 auto imageBuffer =
-                    image->LockBuffer(
+                    bitmap->LockBuffer(
                         Windows::Graphics::Imaging::BitmapBufferAccessMode::Write);
 
                 auto imageBufferReference =
@@ -161,13 +229,13 @@ namespace BatchProcessing
                         imageBufferReference,
                         imageBufferDataLength);
 
-                ASSERT((int32_t)imageBufferDataLength == pvCameraFrame.Width * pvCameraFrame.Height * 4);
+                ASSERT((int32_t)imageBufferDataLength == image.cols * image.rows * 4);
 
                 ASSERT(0 == memcpy_s(
                     imageBufferData,
                     imageBufferDataLength,
-                    pvCameraFrame.Image.data,
-                    pvCameraFrame.Width * pvCameraFrame.Height * 4));
+                    image.data,
+                    image.cols * image.rows * 4));
             }
 
             auto imageSource =
@@ -175,7 +243,7 @@ namespace BatchProcessing
 
             concurrency::create_task(
                 imageSource->SetBitmapAsync(
-                    image)).then(
+                    bitmap)).then(
                         [this, imageSource]()
             {
                 _pvCameraImage->Source =
@@ -208,6 +276,154 @@ namespace BatchProcessing
             MoveRecordingCursor(
                 +10 /* howMuch */);
         }
+        else if (e->Key == Windows::System::VirtualKey::B)
+        {
+            RunSampleBatch();
+        }
+        else if (e->Key == Windows::System::VirtualKey::D)
+        {
+            TrackDepthCameras();
+        }
+        else if (e->Key == Windows::System::VirtualKey::P)
+        {
+            ValidateDepthCameraPlanes();
+        }
+        else if (e->Key == Windows::System::VirtualKey::Escape)
+        {
+            std::lock_guard<std::mutex> lock(_batchRunnerMutex);
+
+            if (nullptr != _batchRunner)
+            {
+                _batchRunner->Cancel();
+            }
+        }
+    }
+
+    void MainPage::RunSampleBatch()
+    {
+        Windows::Storage::StorageFolder^ recordingFolder =
+            _recordingFolder;
+
+        if (nullptr == recordingFolder)
+        {
+            return;
+        }
+
+        std::shared_ptr<HoloLensBatchRunner> batchRunner;
+
+        {
+            std::lock_guard<std::mutex> lock(_batchRunnerMutex);
+
+            if (nullptr != _batchRunner)
+            {
+                return;
+            }
+
+            const size_t numberOfWorkers =
+                std::max<size_t>(1, std::thread::hardware_concurrency());
+
+            _batchRunner =
+                std::make_shared<HoloLensBatchRunner>(
+                    numberOfWorkers,
+                    numberOfWorkers * kSampleBatchItemsInFlightPerWorker /* maximumNumberOfItemsInFlight */);
+
+            batchRunner =
+                _batchRunner;
+        }
+
+        concurrency::create_task(
+            [this, recordingFolder, batchRunner]()
+        {
+            const std::vector<HoloLensBatchItem> items =
+                DiscoverSynchronizedBatchItems(
+                    recordingFolder,
+                    L"pv" /* referenceSensorName */,
+                    { L"vlc_lf", L"vlc_rf" } /* sensorNames */,
+                    kSampleBatchMaximumTimeDifference);
+
+            //
+            // The mean intensity of each of the item's images.
+            //
+            RunBatch(
+                recordingFolder,
+                L"sample_batch_results.csv" /* resultsFileName */,
+                items,
+                [](const HoloLensBatchItem& item, const std::vector<cv::Mat>& images)
+            {
+                std::ostringstream result;
+
+                for (size_t i = 0; i < images.size(); ++i)
+                {
+                    const cv::Scalar mean =
+                        cv::mean(
+                            images[i]);
+
+                    result << (i > 0 ? "," : "") << (mean[0] + mean[1] + mean[2]) / 3.0;
+                }
+
+                return result.str();
+            },
+                *batchRunner);
+
+            std::lock_guard<std::mutex> lock(_batchRunnerMutex);
+
+            _batchRunner.reset();
+        });
+    }
+
+    void MainPage::TrackDepthCameras()
+    {
+        Windows::Storage::StorageFolder^ recordingFolder =
+            _recordingFolder;
+
+        if (nullptr == recordingFolder ||
+            _isTrackingDepthCameras.exchange(true))
+        {
+            return;
+        }
+
+        concurrency::create_task(
+            [this, recordingFolder]()
+        {
+            for (const wchar_t* sensorName : kDepthCameraSensorNames)
+            {
+                BenchmarkDepthTracking(
+                    recordingFolder,
+                    sensorName);
+
+                RunDepthTracking(
+                    recordingFolder,
+                    sensorName,
+                    sensorName + std::wstring(kRefinedPosesManifestSuffix));
+            }
+
+            _isTrackingDepthCameras = false;
+        });
+    }
+
+    void MainPage::ValidateDepthCameraPlanes()
+    {
+        Windows::Storage::StorageFolder^ recordingFolder =
+            _recordingFolder;
+
+        if (nullptr == recordingFolder ||
+            _isValidatingDepthCameraPlanes.exchange(true))
+        {
+            return;
+        }
+
+        concurrency::create_task(
+            [this, recordingFolder]()
+        {
+            for (const wchar_t* sensorName : kDepthCameraSensorNames)
+            {
+                ValidateDepthPlanes(
+                    recordingFolder,
+                    sensorName);
+            }
+
+            _isValidatingDepthCameraPlanes = false;
+        });
     }
 
     void MainPage::MoveRecordingCursor(
@@ -223,12 +439,121 @@ namespace BatchProcessing
                 howMuch = -((-howMuch) % numberOfFrames);
             }
 
-            _currentPvCameraFrame =
+            const int32_t currentPvCameraFrame =
                 (_currentPvCameraFrame + numberOfFrames + howMuch) % numberOfFrames;
 
-            _pvCameraFrames[_currentPvCameraFrame].Load();
+            _currentPvCameraFrame =
+                currentPvCameraFrame;
+
+            _pvFrameCache->MoveCursor(
+                currentPvCameraFrame);
+
+            {
+                const HoloLensFrameCacheStatistics statistics =
+                    _pvFrameCache->GetStatistics();
+
+                if (statistics.NumberOfRequests > 0 &&
+                    0 == statistics.NumberOfRequests % kPvFrameCacheStatisticsInterval)
+                {
+                    dbg::trace(
+                        L" *** PV frame cache: %llu requests, %.1f%% hits, %llu prefetch waits, %llu misses, %llu prefetches, %llu evictions, %llu load failures, %zu frames (%zu MB)",
+                        statistics.NumberOfRequests,
+                        100.0 * statistics.NumberOfHits / statistics.NumberOfRequests,
+                        statistics.NumberOfPrefetchWaits,
+                        statistics.NumberOfMisses,
+                        statistics.NumberOfPrefetches,
+                        statistics.NumberOfEvictions,
+                        statistics.NumberOfLoadFailures,
+                        statistics.NumberOfFrames,
+                        statistics.NumberOfBytes / (1024 * 1024));
+                }
+            }
+
+            cv::Mat image;
+
+            if (_pvFrameCache->TryGet(
+                currentPvCameraFrame,
+                image))
+            {
+                UpdatePreview(
+                    currentPvCameraFrame,
+                    image,
+                    false /* isPreview */);
+
+                return;
+            }
+
+            //
+            // Show the preview first: reading it takes a fraction of a millisecond.
+            //
+            size_t previewIndex = 0;
+
+            if (nullptr != _pvContactSheet &&
+                _pvContactSheet->FindFrame(
+                    _pvCameraFrames[currentPvCameraFrame].Timestamp,
+                    previewIndex))
+            {
+                cv::Mat preview;
+
+                _pvContactSheet->ReadPreview(
+                    previewIndex,
+                    0 /* level */,
+                    preview);
+
+                UpdatePreview(
+                    currentPvCameraFrame,
+                    preview,
+                    true /* isPreview */);
+            }
 
-            UpdatePreview();
+            //
+            // Get the frame off the UI thread, unless the cursor moved on before its
+            // turn came. It is likely being prefetched already.
+            //
+            std::shared_ptr<HoloLensFrameCache> pvFrameCache =
+                _pvFrameCache;
+
+            const std::wstring fileName =
+                _pvCameraFrames[currentPvCameraFrame].FileName;
+
+            concurrency::create_task(
+                [this, currentPvCameraFrame, pvFrameCache]()
+            {
+                if (currentPvCameraFrame != _currentPvCameraFrame)
+                {
+                    return;
+                }
+
+                UpdatePreview(
+                    currentPvCameraFrame,
+                    pvFrameCache->Get(
+                        currentPvCameraFrame),
+                    false /* isPreview */);
+            }).then([fileName](concurrency::task<void> getTask)
+            {
+                //
+                // Observe the failure, so that it does not surface as an unobserved task
+                // exception; the preview, if any, stays up.
+                //
+                try
+                {
+                    getTask.get();
+                }
+                catch (const std::exception& exception)
+                {
+                    dbg::trace(
+                        L" *** failed to load PV camera frame %s: %S",
+                        fileName.c_str(),
+                        exception.what());
+                }
+                catch (Platform::Exception^ exception)
+                {
+                    dbg::trace(
+                        L" *** failed to load PV camera frame %s: %s",
+                        fileName.c_str(),
+                        exception->Message->Data());
+                }
+            });
         }
     }
 }
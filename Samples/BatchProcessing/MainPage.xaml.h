@@ -40,11 +40,46 @@ namespace BatchProcessing
         void MoveRecordingCursor(
             int32_t howMuch);
 
-        void UpdatePreview();
+        //
+        // Runs a sample batch over the recording in the background, resuming an earlier
+        // run of it, unless one is running already.
+        //
+        void RunSampleBatch();
+
+        //
+        // Benchmarks the pose refinement on a synthetic scene and refines the poses of
+        // the depth cameras' frames in the background, unless that is running already,
+        // see BenchmarkDepthTracking and RunDepthTracking.
+        //
+        void TrackDepthCameras();
+
+        //
+        // Validates and times the plane extraction for the depth cameras in the
+        // background, see ValidateDepthPlanes.
+        //
+        void ValidateDepthCameraPlanes();
+
+        //
+        // Shows the image of the frame, unless the cursor moved on in the meantime.
+        // The image is BGRA, either the frame or its preview.
+        //
+        void UpdatePreview(
+            int32_t pvCameraFrame,
+            cv::Mat image,
+            bool isPreview);
 
     private:
+        Windows::Storage::StorageFolder^ _recordingFolder;
         std::vector<HoloLensCameraCalibration> _cameraCalibrations;
         std::vector<HoloLensCameraFrame> _pvCameraFrames;
-        int32_t _currentPvCameraFrame = -1;
+        std::unique_ptr<HoloLensContactSheet> _pvContactSheet;
+        std::shared_ptr<HoloLensFrameCache> _pvFrameCache;
+        std::atomic<int32_t> _currentPvCameraFrame{ -1 };
+
+        std::mutex _batchRunnerMutex;
+        std::shared_ptr<HoloLensBatchRunner> _batchRunner;
+
+        std::atomic<bool> _isTrackingDepthCameras{ false };
+        std::atomic<bool> _isValidatingDepthCameraPlanes{ false };
     };
 }
@@ -0,0 +1,301 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace BatchProcessing
+{
+    namespace
+    {
+        //
+        // Results are flushed to the disk every so many items, so that a crash of the
+        // device loses at most that many.
+        //
+        const uint64_t kResultsFlushInterval = 64;
+    }
+
+    std::vector<HoloLensBatchItem> DiscoverFrameBatchItems(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::vector<std::wstring>& sensorNames)
+    {
+        std::vector<HoloLensBatchItem> items;
+
+        for (const std::wstring& sensorName : sensorNames)
+        {
+            for (HoloLensCameraFrame& frame : DiscoverSensorCameraFrames(recordingFolder, sensorName))
+            {
+                HoloLensBatchItem item;
+
+                item.SensorNames.push_back(
+                    sensorName);
+
+                item.Frames.emplace_back(
+                    std::move(
+                        frame));
+
+                items.emplace_back(
+                    std::move(
+                        item));
+            }
+        }
+
+        return items;
+    }
+
+    std::vector<HoloLensBatchItem> DiscoverSynchronizedBatchItems(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& referenceSensorName,
+        _In_ const std::vector<std::wstring>& sensorNames,
+        _In_ uint64_t maximumTimeDifference)
+    {
+        std::vector<std::vector<HoloLensCameraFrame>> sensorFrames;
+
+        for (const std::wstring& sensorName : sensorNames)
+        {
+            sensorFrames.emplace_back(
+                DiscoverSensorCameraFrames(
+                    recordingFolder,
+                    sensorName));
+
+            std::sort(
+                sensorFrames.back().begin(),
+                sensorFrames.back().end(),
+                [](const HoloLensCameraFrame& a, const HoloLensCameraFrame& b)
+            {
+                return a.Timestamp < b.Timestamp;
+            });
+        }
+
+        std::vector<HoloLensBatchItem> items;
+
+        for (const HoloLensCameraFrame& referenceFrame : DiscoverSensorCameraFrames(recordingFolder, referenceSensorName))
+        {
+            HoloLensBatchItem item;
+
+            item.SensorNames.push_back(
+                referenceSensorName);
+
+            item.Frames.push_back(
+                referenceFrame);
+
+            for (size_t i = 0; i < sensorNames.size(); ++i)
+            {
+                const std::vector<HoloLensCameraFrame>& frames =
+                    sensorFrames[i];
+
+                //
+                // The closest frame is the first one taken at or after the reference
+                // frame, or the one before it.
+                //
+                auto next =
+                    std::lower_bound(
+                        frames.begin(),
+                        frames.end(),
+                        referenceFrame.Timestamp,
+                        [](const HoloLensCameraFrame& frame, uint64_t timestamp)
+                {
+                    return frame.Timestamp < timestamp;
+                });
+
+                auto closest = frames.end();
+                uint64_t closestTimeDifference = maximumTimeDifference;
+
+                if (next != frames.end() &&
+                    next->Timestamp - referenceFrame.Timestamp <= closestTimeDifference)
+                {
+                    closest = next;
+                    closestTimeDifference = next->Timestamp - referenceFrame.Timestamp;
+                }
+
+                if (next != frames.begin() &&
+                    referenceFrame.Timestamp - std::prev(next)->Timestamp <= closestTimeDifference &&
+                    (closest == frames.end() || referenceFrame.Timestamp - std::prev(next)->Timestamp < closestTimeDifference))
+                {
+                    closest = std::prev(next);
+                }
+
+                if (closest == frames.end())
+                {
+                    break;
+                }
+
+                item.SensorNames.push_back(
+                    sensorNames[i]);
+
+                item.Frames.push_back(
+                    *closest);
+            }
+
+            if (item.Frames.size() == sensorNames.size() + 1)
+            {
+                items.emplace_back(
+                    std::move(
+                        item));
+            }
+        }
+
+        return items;
+    }
+
+    HoloLensBatchStatistics RunBatch(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& resultsFileName,
+        _In_ const std::vector<HoloLensBatchItem>& items,
+        _In_ HoloLensBatchFunction function,
+        _Inout_ HoloLensBatchRunner& runner)
+    {
+        Microsoft::WRL::ComPtr<IStorageFolderHandleAccess> folderHandleAccess =
+            Io::GetStorageFolderHandleAccess(
+                recordingFolder);
+
+        HANDLE results = nullptr;
+
+        ASSERT_SUCCEEDED(folderHandleAccess->Create(
+            resultsFileName.c_str() /* fileName */,
+            HCO_OPEN_ALWAYS /* creationOptions */,
+            static_cast<HANDLE_ACCESS_OPTIONS>(HAO_READ | HAO_WRITE) /* accessOptions */,
+            HSO_SHARE_READ /* sharingOptions */,
+            HO_NONE /* options */,
+            nullptr /* oplockBreakingHandler */,
+            &results));
+
+        //
+        // The results of earlier runs are the checkpoint: their items are done.
+        //
+        LARGE_INTEGER resultsSize = {};
+
+        ASSERT(!!GetFileSizeEx(
+            results,
+            &resultsSize));
+
+        std::vector<char> earlierResults(
+            static_cast<size_t>(resultsSize.QuadPart));
+
+        if (!earlierResults.empty())
+        {
+            DWORD numberOfBytesRead = 0;
+
+            ASSERT(!!ReadFile(
+                results,
+                earlierResults.data(),
+                static_cast<DWORD>(earlierResults.size()),
+                &numberOfBytesRead,
+                nullptr /* lpOverlapped */));
+
+            ASSERT(earlierResults.size() == numberOfBytesRead);
+        }
+
+        std::unordered_set<std::string> doneKeys;
+
+        LARGE_INTEGER completeResultsSize = {};
+
+        completeResultsSize.QuadPart =
+            ReadBatchResultKeys(
+                earlierResults.data(),
+                earlierResults.size(),
+                doneKeys);
+
+        //
+        // Drop the part of a line an interrupted run may have left, and append.
+        //
+        ASSERT(!!SetFilePointerEx(
+            results,
+            completeResultsSize,
+            nullptr /* lpNewFilePointer */,
+            FILE_BEGIN));
+
+        ASSERT(!!SetEndOfFile(
+            results));
+
+        std::vector<std::string> keys;
+        std::vector<bool> isItemDone;
+
+        for (const HoloLensBatchItem& item : items)
+        {
+            REQUIRES(!item.Frames.empty());
+
+            keys.push_back(
+                Utf16ToUtf8(
+                    item.Frames[0].FileName));
+
+            isItemDone.push_back(
+                0 != doneKeys.count(keys.back()));
+        }
+
+        uint64_t numberOfResultsWritten = 0;
+
+        const HoloLensBatchStatistics statistics =
+            runner.Run(
+                isItemDone,
+                [&items](size_t itemIndex, std::vector<cv::Mat>& images)
+        {
+            const HoloLensBatchItem& item =
+                items[itemIndex];
+
+            images.resize(
+                item.Frames.size());
+
+            for (size_t i = 0; i < item.Frames.size(); ++i)
+            {
+                item.Frames[i].Load(
+                    images[i]);
+            }
+        },
+                [&items, &function](size_t itemIndex, const std::vector<cv::Mat>& images)
+        {
+            return function(
+                items[itemIndex],
+                images);
+        },
+                [&](size_t itemIndex, const std::string& result)
+        {
+            const std::string line =
+                keys[itemIndex] + "," + result + "\n";
+
+            DWORD numberOfBytesWritten = 0;
+
+            ASSERT(!!WriteFile(
+                results,
+                line.data(),
+                static_cast<DWORD>(line.size()),
+                &numberOfBytesWritten,
+                nullptr /* lpOverlapped */));
+
+            ASSERT(line.size() == numberOfBytesWritten);
+
+            if (0 == ++numberOfResultsWritten % kResultsFlushInterval)
+            {
+                FlushFileBuffers(
+                    results);
+            }
+        });
+
+        FlushFileBuffers(
+            results);
+
+        CloseHandle(
+            results);
+
+        dbg::trace(
+            L"RunBatch: %llu of %llu items processed (%llu done before) by %zu workers in %.1f seconds, %.1f items/s, load %.1f ms/item, process %.1f ms/item, at most %zu items in flight",
+            statistics.NumberOfItemsProcessed,
+            statistics.NumberOfItems,
+            statistics.NumberOfItemsSkipped,
+            runner.GetNumberOfWorkers(),
+            statistics.ElapsedMicroseconds / 1e6,
+            statistics.NumberOfItemsProcessed * 1e6 / std::max<uint64_t>(1, statistics.ElapsedMicroseconds),
+            statistics.LoadMicroseconds / 1e3 / std::max<uint64_t>(1, statistics.NumberOfItemsProcessed),
+            statistics.ProcessMicroseconds / 1e3 / std::max<uint64_t>(1, statistics.NumberOfItemsProcessed),
+            statistics.MaximumNumberOfItemsInFlight);
+
+        return statistics;
+    }
+}
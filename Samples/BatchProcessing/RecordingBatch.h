@@ -0,0 +1,65 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace BatchProcessing
+{
+    //
+    // The frames processed together: a single frame, or a frame of the reference
+    // sensor followed by the frame of each other sensor closest to it in time.
+    //
+    struct HoloLensBatchItem
+    {
+        std::vector<std::wstring> SensorNames;
+        std::vector<HoloLensCameraFrame> Frames;
+    };
+
+    //
+    // Returns the result of the item, written to the results file as one line after
+    // its key, so it must not contain line breaks. The images are the BGRA images of
+    // the item's frames, in the same order.
+    //
+    typedef std::function<std::string(const HoloLensBatchItem& item, const std::vector<cv::Mat>& images)> HoloLensBatchFunction;
+
+    //
+    // One item per frame of each of the sensors that the recording has frames of, from
+    // all of their segments (see DiscoverSensorCameraFrames).
+    //
+    std::vector<HoloLensBatchItem> DiscoverFrameBatchItems(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::vector<std::wstring>& sensorNames);
+
+    //
+    // One item per frame of the reference sensor, with the frames of the other sensors
+    // taken closest to it. Frames for which a sensor has no frame within the maximum
+    // time difference, in units of 100ns, are left out.
+    //
+    std::vector<HoloLensBatchItem> DiscoverSynchronizedBatchItems(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& referenceSensorName,
+        _In_ const std::vector<std::wstring>& sensorNames,
+        _In_ uint64_t maximumTimeDifference);
+
+    //
+    // Runs the function over the items on all cores, writing the result of each item to
+    // the results file in the recording folder as it is done, as "<key>,<result>" lines
+    // where the key is the image file name of the item's first frame. Results already
+    // in the file, from a run that was interrupted or canceled, are kept and their
+    // items skipped, so running the batch again resumes where it stopped.
+    //
+    HoloLensBatchStatistics RunBatch(
+        _In_ Windows::Storage::StorageFolder^ recordingFolder,
+        _In_ const std::wstring& resultsFileName,
+        _In_ const std::vector<HoloLensBatchItem>& items,
+        _In_ HoloLensBatchFunction function,
+        _Inout_ HoloLensBatchRunner& runner);
+}
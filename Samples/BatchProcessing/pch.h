@@ -11,19 +11,44 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include <collection.h>
 #include <ppltasks.h>
 
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include <Debugging/All.h>
 #include <Io/All.h>
 
+#include <OpenCVHelpers/DepthImage.h>
+#include <OpenCVHelpers/DepthIcp.h>
+#include <OpenCVHelpers/DepthIcpValidation.h>
+#include <OpenCVHelpers/DepthNormalEstimator.h>
+#include <OpenCVHelpers/DepthPlaneExtractor.h>
+#include <OpenCVHelpers/DepthPlaneValidation.h>
+
 #include "CameraCalibration.h"
 #include "CameraFrame.h"
+#include "ContactSheet.h"
+#include "FrameCache.h"
+#include "BatchRunner.h"
+#include "RecordingBatch.h"
+#include "DepthTracking.h"
 
 #include "App.xaml.h"
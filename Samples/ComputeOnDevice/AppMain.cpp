@@ -13,6 +13,10 @@
 
 #include "AppMain.h"
 
+// Uncomment to compare, on the first PV camera frame, three consumers deriving their
+// own images from the frame against sharing them through an rmcv::DerivedImageCache.
+//#define COMPUTE_ON_DEVICE_BENCHMARK_DERIVED_IMAGE_CACHE
+
 namespace ComputeOnDevice
 {
     AppMain::AppMain(
@@ -21,9 +25,17 @@ namespace ComputeOnDevice
         , _selectedHoloLensMediaFrameSourceGroupType(
             HoloLensForCV::MediaFrameSourceGroupType::PhotoVideoCamera)
         , _holoLensMediaFrameSourceGroupStarted(false)
-        , _undistortMapsInitialized(false)
+        , _pvCameraFrameSubscriptionToken(0)
+        , _edgeOverlayPVCameraImageUpdated(false)
         , _isActiveRenderer(false)
     {
+#if defined(_DEBUG)
+        //
+        // Catches the single pass undistortion and downscaling drifting away from the
+        // full resolution sequence it replaced.
+        //
+        rmcv::ValidateEdgeOverlayPipeline();
+#endif
     }
 
     void AppMain::OnHolographicSpaceChanged(
@@ -90,41 +102,55 @@ namespace ComputeOnDevice
         
         
         //
-        // Process sensor data received through the HoloLensForCV component.
+        // Display the latest edge overlay computed by ProcessPVCameraFrame.
         //
-        if (!_holoLensMediaFrameSourceGroupStarted)
         {
-            return;
-        }
+            std::lock_guard<std::mutex> lock(_edgeOverlayMutex);
 
-        HoloLensForCV::SensorFrame^ latestFrame;
-
-        latestFrame =
-            _holoLensMediaFrameSourceGroup->GetLatestSensorFrame(
-                HoloLensForCV::SensorType::PhotoVideo);
+            if (!_edgeOverlayPVCameraImageUpdated)
+            {
+                return;
+            }
 
-        if (nullptr == latestFrame)
-        {
-            return;
-        }
+            std::swap(
+                _edgeOverlayPVCameraImage,
+                _edgeOverlayRenderImage);
 
-        if (_latestSelectedCameraTimestamp.UniversalTime == latestFrame->Timestamp.UniversalTime)
-        {
-            return;
+            _edgeOverlayPVCameraImageUpdated = false;
         }
 
-        _latestSelectedCameraTimestamp = latestFrame->Timestamp;
+        OpenCVHelpers::CreateOrUpdateTexture2D(
+            _deviceResources,
+            _edgeOverlayRenderImage,
+            _currentVisualizationTexture);
+    }
 
+    void AppMain::ProcessPVCameraFrame(
+        _In_ HoloLensForCV::SensorFrame^ sensorFrame)
+    {
         cv::Mat wrappedImage;
 
         rmcv::WrapHoloLensSensorFrameWithCvMat(
-            latestFrame,
+            sensorFrame,
             wrappedImage);
 
-        if (!_undistortMapsInitialized)
+#ifdef COMPUTE_ON_DEVICE_BENCHMARK_DERIVED_IMAGE_CACHE
+        static bool s_derivedImageCacheBenchmarkDone = false;
+
+        if (!s_derivedImageCacheBenchmarkDone)
+        {
+            rmcv::BenchmarkDerivedImageCache(
+                wrappedImage,
+                100 /* numberOfFrames */);
+
+            s_derivedImageCacheBenchmarkDone = true;
+        }
+#endif
+
+        if (!_edgeOverlayPipeline.HasCameraIntrinsics())
         {
             Windows::Media::Devices::Core::CameraIntrinsics^ cameraIntrinsics =
-                latestFrame->CoreCameraIntrinsics;
+                sensorFrame->CoreCameraIntrinsics;
 
             if (nullptr != cameraIntrinsics)
             {
@@ -145,74 +171,36 @@ namespace ComputeOnDevice
                 distCoeffs.at<double>(3, 0) = cameraIntrinsics->TangentialDistortion.y;
                 distCoeffs.at<double>(4, 0) = cameraIntrinsics->RadialDistortion.z;
 
-                cv::initUndistortRectifyMap(
+                _edgeOverlayPipeline.SetCameraIntrinsics(
                     cameraMatrix,
                     distCoeffs,
-                    cv::Mat_<double>::eye(3, 3) /* R */,
-                    cameraMatrix,
-                    cv::Size(wrappedImage.cols, wrappedImage.rows),
-                    CV_32FC1 /* type */,
-                    _undistortMap1,
-                    _undistortMap2);
-
-                _undistortMapsInitialized = true;
+                    cv::Size(wrappedImage.cols, wrappedImage.rows));
             }
         }
 
-        if (_undistortMapsInitialized)
-        {
-            cv::remap(
-                wrappedImage,
-                _undistortedPVCameraImage,
-                _undistortMap1,
-                _undistortMap2,
-                cv::INTER_LINEAR);
-
-            cv::resize(
-                _undistortedPVCameraImage,
-                _resizedPVCameraImage,
-                cv::Size(),
-                0.5 /* fx */,
-                0.5 /* fy */,
-                cv::INTER_AREA);
-        }
-        else
-        {
-            cv::resize(
-                wrappedImage,
-                _resizedPVCameraImage,
-                cv::Size(),
-                0.5 /* fx */,
-                0.5 /* fy */,
-                cv::INTER_AREA);
-        }
-
-        cv::medianBlur(
-            _resizedPVCameraImage,
-            _blurredPVCameraImage,
-            3 /* ksize */);
+        //
+        // Undistortion and downscaling happen in a single remap pass; frames are only
+        // downscaled until the camera intrinsics become available. The undistorted and
+        // blurred frames are taken from the derived image cache.
+        //
+        _edgeOverlayPipeline.Process(
+            wrappedImage,
+            sensorFrame->Timestamp.UniversalTime,
+            static_cast<int32_t>(HoloLensForCV::SensorType::PhotoVideo),
+            _derivedImageCache,
+            _edgeOverlayWorkerImage);
 
-        cv::Canny(
-            _blurredPVCameraImage,
-            _cannyPVCameraImage,
-            50.0,
-            200.0);
+        //
+        // The worker, the pending and the rendered overlay images rotate by swapping, so
+        // that neither side copies, reallocates or waits for the other per frame.
+        //
+        std::lock_guard<std::mutex> lock(_edgeOverlayMutex);
 
-        for (int32_t y = 0; y < _blurredPVCameraImage.rows; ++y)
-        {
-            for (int32_t x = 0; x < _blurredPVCameraImage.cols; ++x)
-            {
-                if (_cannyPVCameraImage.at<uint8_t>(y, x) > 64)
-                {
-                    *(_blurredPVCameraImage.ptr<uint32_t>(y, x)) = 0xFFFF00FF;
-                }
-            }
-        }
+        std::swap(
+            _edgeOverlayWorkerImage,
+            _edgeOverlayPVCameraImage);
 
-        OpenCVHelpers::CreateOrUpdateTexture2D(
-            _deviceResources,
-            _blurredPVCameraImage,
-            _currentVisualizationTexture);
+        _edgeOverlayPVCameraImageUpdated = true;
     }
 
     void AppMain::OnPreRender()
@@ -246,6 +234,14 @@ namespace ComputeOnDevice
             r->ReleaseDeviceDependentResources();
         }
 
+        if (nullptr != _pvCameraFrameMailbox)
+        {
+            _pvCameraFrameMailbox->Unsubscribe(
+                _pvCameraFrameSubscriptionToken);
+
+            _pvCameraFrameMailbox = nullptr;
+        }
+
         _holoLensMediaFrameSourceGroup = nullptr;
         _holoLensMediaFrameSourceGroupStarted = false;
 
@@ -284,6 +280,23 @@ namespace ComputeOnDevice
         _holoLensMediaFrameSourceGroup->Enable(
             HoloLensForCV::SensorType::PhotoVideo);
 
+        //
+        // Process frames as they arrive rather than polling for them from OnUpdate, so
+        // that the processing runs at the camera rate, off the render thread.
+        //
+        _pvCameraFrameMailbox =
+            _holoLensMediaFrameSourceGroup->GetSensorFrameMailbox(
+                HoloLensForCV::SensorType::PhotoVideo);
+
+        _pvCameraFrameSubscriptionToken =
+            _pvCameraFrameMailbox->Subscribe(
+                ref new HoloLensForCV::SensorFrameArrivedHandler(
+                    [this](HoloLensForCV::SensorFrame^ sensorFrame)
+        {
+            ProcessPVCameraFrame(
+                sensorFrame);
+        }));
+
         concurrency::create_task(_holoLensMediaFrameSourceGroup->StartAsync()).then(
             [&]()
         {
@@ -43,6 +43,10 @@ namespace ComputeOnDevice
         // Initializes access to HoloLens sensors.
         void StartHoloLensMediaFrameSourceGroup();
 
+        // Computes the edge overlay for a new PV camera frame. Called on a worker thread.
+        void ProcessPVCameraFrame(
+            _In_ HoloLensForCV::SensorFrame^ sensorFrame);
+
     private:
         std::vector<std::shared_ptr<Rendering::SlateRenderer> >_slateRendererList;
         std::shared_ptr<Rendering::SlateRenderer> _currentSlateRenderer;
@@ -55,16 +59,23 @@ namespace ComputeOnDevice
         // HoloLens media frame server manager
         HoloLensForCV::SensorFrameStreamer^ _sensorFrameStreamer;
 
-        Windows::Foundation::DateTime _latestSelectedCameraTimestamp;
+        // Subscription to the PV camera frame mailbox, see ProcessPVCameraFrame.
+        HoloLensForCV::SensorFrameMailbox^ _pvCameraFrameMailbox;
+        int64_t _pvCameraFrameSubscriptionToken;
+
+        // Images derived from the PV camera frames, shared by their consumers.
+        rmcv::DerivedImageCache _derivedImageCache;
+
+        rmcv::EdgeOverlayPipeline _edgeOverlayPipeline;
+        cv::Mat _edgeOverlayWorkerImage;
 
-        cv::Mat _undistortMap1;
-        cv::Mat _undistortMap2;
-        bool _undistortMapsInitialized;
+        // The latest edge overlay, handed from the worker thread to OnUpdate.
+        std::mutex _edgeOverlayMutex;
+        cv::Mat _edgeOverlayPVCameraImage;
+        bool _edgeOverlayPVCameraImageUpdated;
 
-        cv::Mat _undistortedPVCameraImage;
-        cv::Mat _resizedPVCameraImage;
-        cv::Mat _blurredPVCameraImage;
-        cv::Mat _cannyPVCameraImage;
+        // Only accessed by OnUpdate.
+        cv::Mat _edgeOverlayRenderImage;
 
         std::vector<Rendering::Texture2DPtr> _visualizationTextureList;
         Rendering::Texture2DPtr _currentVisualizationTexture;
@@ -11,6 +11,7 @@
 
 #include "pch.h"
 #include <cmath>
+#include <mutex>
 #include <MemoryBuffer.h>
 #include "FrameRenderer.h"
 
@@ -124,8 +125,84 @@ static ColorBGRA InfraredColor(float value)
     return infraredLookupTable.GetValue(value);
 }
 
+typedef DirectLookupTable<UINT16, ColorBGRA> ColorLookupTable16;
+typedef DirectLookupTable<byte, ColorBGRA> ColorLookupTable8;
+
+// Maps a 16 bit depth value to a pseudo-color pixel.
+static ColorBGRA DepthColor(UINT16 value, float depthScale, float minReliableDepth, float maxReliableDepth)
+{
+    // Map invalid depth values to transparent pixels.
+    // This happens when depth information cannot be calculated, e.g. when objects are too close.
+    if (value == 0 || value > 4000)
+    {
+        return { 0xFF, 0x00, 0x00, 0x7F };
+    }
+
+    const float rangeReciprocal = 1.0f / (maxReliableDepth - minReliableDepth);
+    const float depth = static_cast<float>(value) * depthScale;
+    const float alpha = (depth - minReliableDepth) * rangeReciprocal;
+    return PseudoColor(alpha);
+}
+
+// Maps a 16 bit infrared value to a pseudo-color pixel.
+static ColorBGRA InfraredColorFor16Bit(UINT16 value)
+{
+    if (value == 0)
+    {
+        return { 0xFF, 0x00, 0x00, 0x7F };
+    }
+
+    const float rangeReciprocal = 1.0f / static_cast<float>(UINT16_MAX);
+    return InfraredColor(value * rangeReciprocal);
+}
+
+// Maps a 8 bit infrared value to a pseudo-color pixel.
+static ColorBGRA InfraredColorFor8Bit(byte value)
+{
+    if (value == 0)
+    {
+        return { 0xFF, 0x00, 0x00, 0x7F };
+    }
+
+    const float rangeReciprocal = 1.0f / static_cast<float>(UINT8_MAX);
+    return InfraredColor(value * rangeReciprocal);
+}
+
 // Maps each pixel in a scanline from a 16 bit depth value to a pseudo-color pixel.
-static void PseudoColorForDepth(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes, float depthScale, float minReliableDepth, float maxReliableDepth)
+static void PseudoColorForDepth(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes, const ColorLookupTable16* depthLookupTable)
+{
+    depthLookupTable->TransformScanline(
+        pixelWidth,
+        reinterpret_cast<UINT16*>(inputRowBytes),
+        reinterpret_cast<ColorBGRA*>(outputRowBytes));
+}
+
+// Maps each pixel in a scanline from a 16 bit infrared value to a pseudo-color pixel.
+static void PseudoColorFor16BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
+{
+    static const ColorLookupTable16 infraredLookupTable16(InfraredColorFor16Bit);
+
+    infraredLookupTable16.TransformScanline(
+        pixelWidth,
+        reinterpret_cast<UINT16*>(inputRowBytes),
+        reinterpret_cast<ColorBGRA*>(outputRowBytes));
+}
+
+// Maps each pixel in a scanline from a 8 bit infrared value to a pseudo-color pixel.
+static void PseudoColorFor8BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
+{
+    static const ColorLookupTable8 infraredLookupTable8(InfraredColorFor8Bit);
+
+    infraredLookupTable8.TransformScanline(
+        pixelWidth,
+        inputRowBytes,
+        reinterpret_cast<ColorBGRA*>(outputRowBytes));
+}
+
+#pragma region Per-pixel reference colorization
+
+// Maps each pixel in a scanline from a 16 bit depth value to a pseudo-color pixel.
+static void ReferencePseudoColorForDepth(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes, float depthScale, float minReliableDepth, float maxReliableDepth)
 {
     // Visualize space in front of your desktop, in meters.
     const float rangeReciprocal = 1.0f / (maxReliableDepth - minReliableDepth);
@@ -150,7 +227,7 @@ static void PseudoColorForDepth(int pixelWidth, byte* inputRowBytes, byte* outpu
 }
 
 // Maps each pixel in a scanline from a 16 bit infrared value to a pseudo-color pixel.
-static void PseudoColorFor16BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
+static void ReferencePseudoColorFor16BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
 {
     UINT16* inputRow = reinterpret_cast<UINT16*>(inputRowBytes);
     ColorBGRA* outputRow = reinterpret_cast<ColorBGRA*>(outputRowBytes);
@@ -169,7 +246,7 @@ static void PseudoColorFor16BitInfrared(int pixelWidth, byte* inputRowBytes, byt
 }
 
 // Maps each pixel in a scanline from a 8 bit infrared value to a pseudo-color pixel.
-static void PseudoColorFor8BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
+static void ReferencePseudoColorFor8BitInfrared(int pixelWidth, byte* inputRowBytes, byte* outputRowBytes)
 {
     ColorBGRA* outputRow = reinterpret_cast<ColorBGRA*>(outputRowBytes);
     const float rangeReciprocal = 1.0f / static_cast<float>(UINT8_MAX);
@@ -186,8 +263,284 @@ static void PseudoColorFor8BitInfrared(int pixelWidth, byte* inputRowBytes, byte
     }
 }
 
+enum class ColorizationKind
+{
+    Depth,
+    Infrared16Bit,
+    Infrared8Bit
+};
+
+struct ColorizationCase
+{
+    const wchar_t* Name;
+    ColorizationKind Kind;
+    float MinReliableDepth;
+    float MaxReliableDepth;
+};
+
+static const ColorizationCase colorizationCases[] =
+{
+    { L"long throw depth", ColorizationKind::Depth, 0.5f, 4.0f },
+    { L"short throw depth", ColorizationKind::Depth, 0.2f, 1.0f },
+    { L"16 bit infrared", ColorizationKind::Infrared16Bit, 0.0f, 0.0f },
+    { L"8 bit infrared", ColorizationKind::Infrared8Bit, 0.0f, 0.0f }
+};
+
+struct ColorizationResolution
+{
+    int Width;
+    int Height;
+};
+
+// The depth camera and the PV camera resolutions, and an odd size that ends every
+// scanline within the unrolled loop of DirectLookupTable::TransformScanline.
+static const ColorizationResolution colorizationResolutions[] =
+{
+    { 448, 450 },
+    { 1280, 720 },
+    { 101, 7 }
+};
+
+static int GetColorizationBytesPerPixel(const ColorizationCase& colorizationCase)
+{
+    return colorizationCase.Kind == ColorizationKind::Infrared8Bit ? 1 : 2;
+}
+
+// Depth frames are colorized with a lookup table for the reliable depth range of the case.
+static std::unique_ptr<ColorLookupTable16> CreateDepthLookupTable(const ColorizationCase& colorizationCase)
+{
+    if (colorizationCase.Kind != ColorizationKind::Depth)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<ColorLookupTable16>(
+        std::bind(&DepthColor, std::placeholders::_1, 1.0f / 1000.0f, colorizationCase.MinReliableDepth, colorizationCase.MaxReliableDepth));
+}
+
+// Fills a synthetic frame with pseudo-random pixels. Depth frames cover the valid range
+// as well as the invalid values above it.
+static void GenerateColorizationInput(const ColorizationCase& colorizationCase, std::vector<byte>& input)
+{
+    const size_t numberOfPixels = input.size() / GetColorizationBytesPerPixel(colorizationCase);
+
+    UINT32 seed = 0x5EED;
+    for (size_t i = 0; i < numberOfPixels; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        const UINT16 value = static_cast<UINT16>(seed >> 16);
+
+        switch (colorizationCase.Kind)
+        {
+        case ColorizationKind::Depth:
+            reinterpret_cast<UINT16*>(input.data())[i] = static_cast<UINT16>(value % 4500);
+            break;
+
+        case ColorizationKind::Infrared16Bit:
+            reinterpret_cast<UINT16*>(input.data())[i] = value;
+            break;
+
+        case ColorizationKind::Infrared8Bit:
+            input[i] = static_cast<byte>(value >> 8);
+            break;
+        }
+    }
+}
+
+// Colorizes a frame scanline by scanline, as TransformBitmap does, with either the
+// per-pixel reference or the lookup tables.
+static void ColorizeFrame(
+    const ColorizationCase& colorizationCase,
+    const ColorLookupTable16* depthLookupTable,
+    bool useReference,
+    int width,
+    int height,
+    std::vector<byte>& input,
+    std::vector<ColorBGRA>& output)
+{
+    const int inputStride = width * GetColorizationBytesPerPixel(colorizationCase);
+
+    for (int y = 0; y < height; y++)
+    {
+        byte* inputRowBytes = input.data() + y * inputStride;
+        byte* outputRowBytes = reinterpret_cast<byte*>(output.data() + y * width);
+
+        switch (colorizationCase.Kind)
+        {
+        case ColorizationKind::Depth:
+            if (useReference)
+            {
+                ReferencePseudoColorForDepth(width, inputRowBytes, outputRowBytes, 1.0f / 1000.0f, colorizationCase.MinReliableDepth, colorizationCase.MaxReliableDepth);
+            }
+            else
+            {
+                PseudoColorForDepth(width, inputRowBytes, outputRowBytes, depthLookupTable);
+            }
+            break;
+
+        case ColorizationKind::Infrared16Bit:
+            if (useReference)
+            {
+                ReferencePseudoColorFor16BitInfrared(width, inputRowBytes, outputRowBytes);
+            }
+            else
+            {
+                PseudoColorFor16BitInfrared(width, inputRowBytes, outputRowBytes);
+            }
+            break;
+
+        case ColorizationKind::Infrared8Bit:
+            if (useReference)
+            {
+                ReferencePseudoColorFor8BitInfrared(width, inputRowBytes, outputRowBytes);
+            }
+            else
+            {
+                PseudoColorFor8BitInfrared(width, inputRowBytes, outputRowBytes);
+            }
+            break;
+        }
+    }
+}
+
+static int CountMismatches(const std::vector<ColorBGRA>& output, const std::vector<ColorBGRA>& referenceOutput)
+{
+    int numberOfMismatches = 0;
+    for (size_t i = 0; i < output.size(); i++)
+    {
+        if (memcmp(&output[i], &referenceOutput[i], sizeof(ColorBGRA)) != 0)
+        {
+            numberOfMismatches++;
+        }
+    }
+
+    return numberOfMismatches;
+}
+
+// Checks that the lookup tables colorize synthetic frames of every kind, at every
+// resolution, exactly like the per-pixel reference, and traces the result of each case.
+// Returns true if all of them match.
+static bool ValidateColorization()
+{
+    bool passed = true;
+
+    for (const auto& resolution : colorizationResolutions)
+    {
+        for (const auto& colorizationCase : colorizationCases)
+        {
+            const std::unique_ptr<ColorLookupTable16> depthLookupTable =
+                CreateDepthLookupTable(colorizationCase);
+
+            const int numberOfPixels = resolution.Width * resolution.Height;
+
+            std::vector<byte> input(numberOfPixels * GetColorizationBytesPerPixel(colorizationCase));
+            std::vector<ColorBGRA> referenceOutput(numberOfPixels);
+            std::vector<ColorBGRA> output(numberOfPixels);
+
+            GenerateColorizationInput(colorizationCase, input);
+
+            ColorizeFrame(colorizationCase, depthLookupTable.get(), true /* useReference */, resolution.Width, resolution.Height, input, referenceOutput);
+            ColorizeFrame(colorizationCase, depthLookupTable.get(), false /* useReference */, resolution.Width, resolution.Height, input, output);
+
+            const int numberOfMismatches = CountMismatches(output, referenceOutput);
+
+            passed = passed && 0 == numberOfMismatches;
+
+            wchar_t message[256];
+            swprintf_s(
+                message,
+                L"FrameRenderer::ValidateColorization: %s %ix%i: %s, %i mismatches\n",
+                colorizationCase.Name,
+                resolution.Width,
+                resolution.Height,
+                0 == numberOfMismatches ? L"passed" : L"FAILED",
+                numberOfMismatches);
+            OutputDebugStringW(message);
+        }
+    }
+
+    return passed;
+}
+
+#pragma endregion
+
+#if FRAME_RENDERER_BENCHMARK_COLORIZATION
+static double GetMillisecondsFromCounter(const LARGE_INTEGER& start)
+{
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return static_cast<double>(now.QuadPart - start.QuadPart) * 1000.0 / static_cast<double>(frequency.QuadPart);
+}
+
+// Colorizes synthetic frames of every kind, at every resolution, with both the per-pixel
+// reference and the lookup tables, and reports the timings and any mismatching pixels.
+static void BenchmarkColorization()
+{
+    const int numberOfFrames = 100;
+
+    for (const auto& resolution : colorizationResolutions)
+    {
+        for (const auto& colorizationCase : colorizationCases)
+        {
+            const std::unique_ptr<ColorLookupTable16> depthLookupTable =
+                CreateDepthLookupTable(colorizationCase);
+
+            const int numberOfPixels = resolution.Width * resolution.Height;
+
+            std::vector<byte> input(numberOfPixels * GetColorizationBytesPerPixel(colorizationCase));
+            std::vector<ColorBGRA> referenceOutput(numberOfPixels);
+            std::vector<ColorBGRA> output(numberOfPixels);
+
+            GenerateColorizationInput(colorizationCase, input);
+
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+
+            for (int frame = 0; frame < numberOfFrames; frame++)
+            {
+                ColorizeFrame(colorizationCase, depthLookupTable.get(), true /* useReference */, resolution.Width, resolution.Height, input, referenceOutput);
+            }
+
+            const double referenceMilliseconds = GetMillisecondsFromCounter(start) / numberOfFrames;
+
+            QueryPerformanceCounter(&start);
+
+            for (int frame = 0; frame < numberOfFrames; frame++)
+            {
+                ColorizeFrame(colorizationCase, depthLookupTable.get(), false /* useReference */, resolution.Width, resolution.Height, input, output);
+            }
+
+            const double lookupTableMilliseconds = GetMillisecondsFromCounter(start) / numberOfFrames;
+
+            wchar_t message[256];
+            swprintf_s(
+                message,
+                L"FrameRenderer::BenchmarkColorization: %s %ix%i: per-pixel %.03fms, lookup table %.03fms, %i mismatches\n",
+                colorizationCase.Name,
+                resolution.Width,
+                resolution.Height,
+                referenceMilliseconds,
+                lookupTableMilliseconds,
+                CountMismatches(output, referenceOutput));
+            OutputDebugStringW(message);
+        }
+    }
+}
+#endif /* FRAME_RENDERER_BENCHMARK_COLORIZATION */
+
 FrameRenderer::FrameRenderer(Image^ imageElement)
 {
+#if _DEBUG
+    static std::once_flag validationFlag;
+    std::call_once(validationFlag, ValidateColorization);
+#endif /* _DEBUG */
+
+#if FRAME_RENDERER_BENCHMARK_COLORIZATION
+    static std::once_flag benchmarkFlag;
+    std::call_once(benchmarkFlag, BenchmarkColorization);
+#endif /* FRAME_RENDERER_BENCHMARK_COLORIZATION */
+
     m_imageElement = imageElement;
     m_imageElement->Source = ref new SoftwareBitmapSource();
 }
@@ -336,23 +689,28 @@ SoftwareBitmap^ FrameRenderer::ConvertToDisplayableImage(VideoMediaFrame^ inputF
 
                 // Use a special pseudo color to render 16 bits depth frame.
                 // Since we must scale the output appropriately we use std::bind to
-                // create a function that takes the depth scale as input but also matches
-                // the required signature.
+                // create a function that takes the lookup table for the depth range as
+                // input but also matches the required signature.
+                // The lookup tables for each reliable depth range are built on first use.
                 const float depthScale = 1.0f / 1000.0f;
-                float minReliableDepth, maxReliableDepth;
+                const ColorLookupTable16* depthLookupTable;
 
                 if (m_sensorName == L"Long Throw ToF Depth")
                 {
-                    minReliableDepth = 0.5f;
-                    maxReliableDepth = 4.0f;
+                    static const ColorLookupTable16 longThrowDepthLookupTable(
+                        std::bind(&DepthColor, _1, depthScale, 0.5f, 4.0f));
+
+                    depthLookupTable = &longThrowDepthLookupTable;
                 }
                 else
                 {
-                    minReliableDepth = 0.2f;
-                    maxReliableDepth = 1.0f;
+                    static const ColorLookupTable16 shortThrowDepthLookupTable(
+                        std::bind(&DepthColor, _1, depthScale, 0.2f, 1.0f));
+
+                    depthLookupTable = &shortThrowDepthLookupTable;
                 }
 
-                return TransformBitmap(inputBitmap, std::bind(&PseudoColorForDepth, _1, _2, _3, depthScale, minReliableDepth, maxReliableDepth));
+                return TransformBitmap(inputBitmap, std::bind(&PseudoColorForDepth, _1, _2, _3, depthLookupTable));
             }
             else
             {
@@ -391,11 +749,26 @@ SoftwareBitmap^ FrameRenderer::ConvertToDisplayableImage(VideoMediaFrame^ inputF
 
 SoftwareBitmap^ FrameRenderer::TransformVlcBitmap(SoftwareBitmap^ inputBitmap)
 {
+    // Visible light camera frames are packed 8-bit gray pixels delivered in a Bgra8 bitmap
+    // a quarter of the actual width. Downsample them 2x2 and rotate them upright.
+    const int32_t inputWidth = inputBitmap->PixelWidth * 4;
+    const int32_t inputHeight = inputBitmap->PixelHeight;
+    const int32_t downsampleFactor = 2;
+
+    int32_t outputWidth, outputHeight;
+    Io::GetTransformedGray8ImageSize(
+        inputWidth,
+        inputHeight,
+        downsampleFactor,
+        Io::ImageOrientation::Rotate90Clockwise,
+        outputWidth,
+        outputHeight);
+
     // XAML Image control only supports premultiplied Bgra8 format.
     SoftwareBitmap^ outputBitmap = ref new SoftwareBitmap(
         BitmapPixelFormat::Bgra8,
-        480 / 2,
-        640 / 2,
+        outputWidth,
+        outputHeight,
         BitmapAlphaMode::Premultiplied);
 
     BitmapBuffer^ input = inputBitmap->LockBuffer(BitmapBufferAccessMode::Read);
@@ -416,30 +789,16 @@ SoftwareBitmap^ FrameRenderer::TransformVlcBitmap(SoftwareBitmap^ inputBitmap)
     UINT32 outputCapacity;
     AsComPtr<IMemoryBufferByteAccess>(outputReference)->GetBuffer(&outputBytes, &outputCapacity);
 
-    for (int y = 0; y < 480; y += 2)
-    {
-        byte* inputRowBytes = inputBytes + y * 640;
-        uint8_t* inputRow = reinterpret_cast<uint8_t*>(inputRowBytes);
-
-        for (int x = 0; x < 640; x += 2)
-        {
-            const byte input =
-                static_cast<byte>(
-                    (static_cast<uint32_t>(inputRow[x]) +
-                     static_cast<uint32_t>(inputRow[x + 1]) +
-                     static_cast<uint32_t>(inputRow[x + 640]) +
-                     static_cast<uint32_t>(inputRow[x + 641])) >> 2);
-
-            byte* outputRowBytes = outputBytes + (x * outputStride >> 1);
-            ColorBGRA* outputRow = reinterpret_cast<ColorBGRA*>(outputRowBytes);
-            auto& output = outputRow[(480 / 2 - 1) - (y >> 1)];
-
-            output.B = input;
-            output.G = input;
-            output.R = input;
-            output.A = 255;
-        }
-    }
+    Io::TransformGray8Image(
+        inputBytes,
+        inputWidth,
+        inputHeight,
+        inputStride,
+        downsampleFactor,
+        Io::ImageOrientation::Rotate90Clockwise,
+        Io::ImageKernelOutputFormat::Bgra8,
+        outputBytes,
+        outputStride);
 
     // Close objects that need closing.
     delete outputReference;
@@ -533,14 +892,22 @@ SoftwareBitmap^ FrameRenderer::TransformBitmap(SoftwareBitmap^ inputBitmap, Tran
     UINT32 outputCapacity;
     AsComPtr<IMemoryBufferByteAccess>(outputReference)->GetBuffer(&outputBytes, &outputCapacity);
 
-    // Iterate over all pixels, and store the converted value.
-    for (int y = 0; y < pixelHeight; y++)
+    // Iterate over all pixels, and store the converted value. Scanline transformations
+    // are stateless, so bands of rows are converted in parallel.
+    const int numberOfBands = (pixelHeight + c_rowsPerBand - 1) / c_rowsPerBand;
+
+    parallel_for(0, numberOfBands, [&](int band)
     {
-        byte* inputRowBytes = inputBytes + y * inputStride;
-        byte* outputRowBytes = outputBytes + y * outputStride;
+        const int endRow = min(pixelHeight, (band + 1) * c_rowsPerBand);
 
-        pixelTransformation(pixelWidth, inputRowBytes, outputRowBytes);
-    }
+        for (int y = band * c_rowsPerBand; y < endRow; y++)
+        {
+            byte* inputRowBytes = inputBytes + y * inputStride;
+            byte* outputRowBytes = outputBytes + y * outputStride;
+
+            pixelTransformation(pixelWidth, inputRowBytes, outputRowBytes);
+        }
+    });
 
     // Close objects that need closing.
     delete outputReference;
@@ -13,6 +13,14 @@
 
 #include "LookupTable.h"
 
+//
+// When enabled, the first frame renderer colorizes synthetic depth and infrared frames,
+// at the depth and PV camera resolutions, with both the per-pixel float conversion and
+// the lookup tables, and reports timings. Debug builds always check that both produce
+// the same pixels.
+//
+#define FRAME_RENDERER_BENCHMARK_COLORIZATION 0
+
 namespace SensorStreaming
 {
     // Function type used to map a scanline of pixels to an alternate pixel format.
@@ -67,6 +75,9 @@ namespace SensorStreaming
         Windows::UI::Xaml::Controls::Image^ m_imageElement;
         Platform::String^ m_sensorName;
 
+        // Number of rows converted by each parallel task in TransformBitmap.
+        static const int c_rowsPerBand{ 32 };
+
         static const int32_t c_maxNumberOfTasksScheduled{ 1 };
         static const int32_t c_maxNumberOfTasksRunning{ 1 };
 
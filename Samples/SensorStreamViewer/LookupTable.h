@@ -43,4 +43,68 @@ namespace SensorStreaming
     private:
         T m_lookuptable[LookupTableSize];
     };
+
+    /// <summary>
+    /// Lookup table indexed directly by every possible value of an 8 or 16 bit pixel, so
+    /// that converting a pixel takes a single load. Any special handling of out-of-range
+    /// values is done by the generator once, rather than for every pixel.
+    /// </summary>
+    template<typename TInput, typename TOutput>
+    class DirectLookupTable
+    {
+        static_assert(sizeof(TInput) <= 2, "DirectLookupTable is limited to 8 and 16 bit inputs");
+
+    public:
+
+        // Function type for lookup table generation.
+        typedef std::function<TOutput(TInput)> LookupTableGenerator;
+
+        static constexpr UINT32 LookupTableSize = 1u << (8 * sizeof(TInput));
+
+        DirectLookupTable(LookupTableGenerator Generator)
+            : m_lookuptable(LookupTableSize)
+        {
+            for (UINT32 i = 0; i < LookupTableSize; i++)
+            {
+                m_lookuptable[i] = Generator(static_cast<TInput>(i));
+            }
+        }
+
+        TOutput GetValue(TInput value) const
+        {
+            return m_lookuptable[value];
+        }
+
+        /// <summary>
+        /// Converts a scanline. Neither SSE on x86 nor NEON on ARM has a gather, and NEON's
+        /// table lookup only indexes 64 bytes, far less than the 1 KB and 256 KB tables.
+        /// The loop is unrolled instead to keep several independent loads in flight.
+        /// </summary>
+        void TransformScanline(int pixelWidth, const TInput* inputRow, TOutput* outputRow) const
+        {
+            const TOutput* lookuptable = m_lookuptable.data();
+
+            int x = 0;
+            for (; x + 4 <= pixelWidth; x += 4)
+            {
+                const TOutput output0 = lookuptable[inputRow[x]];
+                const TOutput output1 = lookuptable[inputRow[x + 1]];
+                const TOutput output2 = lookuptable[inputRow[x + 2]];
+                const TOutput output3 = lookuptable[inputRow[x + 3]];
+
+                outputRow[x] = output0;
+                outputRow[x + 1] = output1;
+                outputRow[x + 2] = output2;
+                outputRow[x + 3] = output3;
+            }
+
+            for (; x < pixelWidth; x++)
+            {
+                outputRow[x] = lookuptable[inputRow[x]];
+            }
+        }
+
+    private:
+        std::vector<TOutput> m_lookuptable;
+    };
 }
\ No newline at end of file
@@ -16,5 +16,7 @@
 #include <rpcndr.h>
 #include <concrt.h>
 
+#include <Io/ImageKernels.h>
+
 #include "MFPropertyGuids.h"
 #include "App.xaml.h"
\ No newline at end of file
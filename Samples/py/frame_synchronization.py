@@ -0,0 +1,211 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Synchronizes the frames of the VLC cameras and stages them for reconstruction """
+# pylint: disable=C0103
+
+import argparse
+import os
+import shutil
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+# Ways to stage the synchronized images in the reconstruction folder. Hard links
+# need the recording and the reconstruction on the same volume and symbolic links
+# need the privilege to create them on Windows; both fall back to copies.
+STAGING_MODES = ("hardlink", "symlink", "copy")
+
+# Frames per second the VLC cameras record at, and of the sampled reference frames
+VLC_FRAME_RATE = 30.0
+BENCHMARK_SAMPLED_FRAME_RATE = 5.0
+
+# Size of a 640x480 PGM image written by the Recorder
+BENCHMARK_IMAGE_SIZE = 640 * 480 + 15
+
+
+def match_time_stamps(ref_time_stamps, time_stamps, max_time_diff):
+    """Returns, for each time stamp, the index of the nearest reference time stamp,
+    or -1 if that is max_time_diff or farther away. Each time stamp is located by
+    binary search in the sorted references instead of a scan of all of them; ties
+    go to the earlier reference, as with np.argmin."""
+    ref_time_stamps = np.asarray(ref_time_stamps, dtype=np.int64)
+    time_stamps = np.asarray(time_stamps, dtype=np.int64)
+    if len(ref_time_stamps) == 0:
+        return np.full(len(time_stamps), -1, dtype=np.int64)
+
+    if np.any(np.diff(ref_time_stamps) < 0):
+        order = np.argsort(ref_time_stamps, kind='stable')
+        indices = match_time_stamps(ref_time_stamps[order], time_stamps, max_time_diff)
+        return np.where(indices >= 0, order[indices], -1)
+
+    next_indices = np.searchsorted(ref_time_stamps, time_stamps)
+    prev_indices = np.maximum(next_indices - 1, 0)
+    next_indices = np.minimum(next_indices, len(ref_time_stamps) - 1)
+    prev_time_diffs = np.abs(time_stamps - ref_time_stamps[prev_indices])
+    next_time_diffs = np.abs(time_stamps - ref_time_stamps[next_indices])
+
+    nearest_indices = np.where(prev_time_diffs <= next_time_diffs,
+                               prev_indices, next_indices)
+    nearest_time_diffs = np.minimum(prev_time_diffs, next_time_diffs)
+    return np.where(nearest_time_diffs < max_time_diff, nearest_indices, -1)
+
+
+def match_time_stamps_exhaustive(ref_time_stamps, time_stamps, max_time_diff):
+    """match_time_stamps as synchronize_sensor_frames used to do it, scanning all
+    reference time stamps for each time stamp."""
+    ref_time_stamps = np.asarray(ref_time_stamps, dtype=np.int64)
+    indices = []
+    for time_stamp in time_stamps:
+        time_diffs = np.abs(time_stamp - ref_time_stamps)
+        min_time_diff_idx = np.argmin(time_diffs)
+        if time_diffs[min_time_diff_idx] < max_time_diff:
+            indices.append(min_time_diff_idx)
+        else:
+            indices.append(-1)
+    return np.array(indices, dtype=np.int64)
+
+
+def stage_image(source_path, target_path, mode="hardlink"):
+    """Makes the image available at target_path without copying it, if the mode
+    and the file system allow; returns the mode used."""
+    if os.path.lexists(target_path):
+        return mode
+    if mode == "hardlink":
+        try:
+            os.link(source_path, target_path)
+            return mode
+        except OSError:
+            pass
+    elif mode == "symlink":
+        try:
+            os.symlink(os.path.abspath(source_path), target_path)
+            return mode
+        except OSError:
+            pass
+    shutil.copyfile(source_path, target_path)
+    return "copy"
+
+
+def get_allocated_size(path):
+    """Returns the bytes a staged image adds to the disk usage."""
+    if os.path.islink(path):
+        return 0
+    stat = os.stat(path)
+    if stat.st_nlink > 1:
+        return 0
+    return stat.st_size
+
+
+def create_synthetic_time_stamps(num_minutes, num_cameras, seed=0):
+    """Returns the sorted time stamps, in 100ns units, of cameras recording at 30 Hz
+    with jitter and the occasional dropped frame."""
+    random = np.random.RandomState(seed)
+    num_frames = int(num_minutes * 60 * VLC_FRAME_RATE)
+    time_per_frame = 10**7 / VLC_FRAME_RATE
+    streams = []
+    for _ in range(num_cameras):
+        time_stamps = np.arange(num_frames) * time_per_frame
+        time_stamps += random.normal(0, time_per_frame / 50, num_frames)
+        time_stamps = time_stamps[random.rand(num_frames) > 0.01]
+        streams.append(np.sort(time_stamps.astype(np.int64) + 10**9))
+    return streams
+
+
+def benchmark_matching(num_minutes, num_exhaustive_minutes):
+    time_per_frame = 10**7 / VLC_FRAME_RATE
+    ref_stream, *streams = create_synthetic_time_stamps(num_minutes, 4)
+    sampled = ref_stream[::int(VLC_FRAME_RATE / BENCHMARK_SAMPLED_FRAME_RATE)]
+
+    start_time = time.perf_counter()
+    matches = [match_time_stamps(sampled, stream, time_per_frame / 5)
+               for stream in streams]
+    elapsed_time = time.perf_counter() - start_time
+    num_matched = sum(np.count_nonzero(match >= 0) for match in matches)
+    print("INFO: {} minutes, {} reference and {} other frames: {} matched in "
+          "{:.3f}s".format(num_minutes, len(sampled), sum(map(len, streams)),
+                           num_matched, elapsed_time))
+
+    # The exhaustive matching takes time quadratic in the length of the recording.
+    end_time_stamp = ref_stream[0] + num_exhaustive_minutes * 60 * 10**7
+    sampled = sampled[sampled < end_time_stamp]
+    streams = [stream[stream < end_time_stamp] for stream in streams]
+
+    elapsed_times = []
+    for match_function in (match_time_stamps, match_time_stamps_exhaustive):
+        start_time = time.perf_counter()
+        matches = [match_function(sampled, stream, time_per_frame / 5)
+                   for stream in streams]
+        elapsed_times.append(time.perf_counter() - start_time)
+        if match_function is match_time_stamps:
+            expected_matches = matches
+    assert all(np.array_equal(match, expected_match)
+               for match, expected_match in zip(matches, expected_matches))
+    print("INFO: first {} minutes: {:.3f}s, exhaustive {:.3f}s (~{:.0f}s for {} "
+          "minutes), same matches".format(
+              num_exhaustive_minutes, elapsed_times[0], elapsed_times[1],
+              elapsed_times[1] * (num_minutes / num_exhaustive_minutes)**2, num_minutes))
+
+
+def benchmark_staging(num_images):
+    temporary_path = tempfile.mkdtemp()
+    try:
+        source_path = os.path.join(temporary_path, "recording")
+        os.makedirs(source_path)
+        image = b"P5\n640 480\n255\n" + bytes(BENCHMARK_IMAGE_SIZE - 15)
+        source_paths = []
+        for i in range(num_images):
+            source_paths.append(os.path.join(source_path, "{}.pgm".format(i)))
+            with open(source_paths[-1], "wb") as fid:
+                fid.write(image)
+
+        for mode in STAGING_MODES:
+            target_path = os.path.join(temporary_path, mode)
+            os.makedirs(target_path)
+            start_time = time.perf_counter()
+            used_modes = set(
+                stage_image(path, os.path.join(target_path, os.path.basename(path)),
+                            mode)
+                for path in source_paths)
+            elapsed_time = time.perf_counter() - start_time
+            allocated_size = sum(
+                get_allocated_size(os.path.join(target_path, name))
+                for name in os.listdir(target_path))
+            print("INFO: {:8s} {} images in {:.3f}s, {:.1f} MB added{}".format(
+                mode, num_images, elapsed_time, allocated_size / 2**20,
+                "" if used_modes == {mode} else " (fell back to copies)"))
+    finally:
+        shutil.rmtree(temporary_path)
+
+
+def main(argv):
+    """Frame synchronization main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Time the matching of synthetic VLC time stamps and "
+                             "the staging of images")
+    parser.add_argument("--benchmark_minutes", type=float, default=180,
+                        help="Length of the synthetic recording")
+    parser.add_argument("--benchmark_exhaustive_minutes", type=float, default=10,
+                        help="Length of the part matched both ways, for comparison")
+    parser.add_argument("--benchmark_images", type=int, default=2000)
+    args = parser.parse_args(argv)
+
+    if not args.benchmark:
+        parser.error("nothing to do, pass --benchmark")
+
+    benchmark_matching(args.benchmark_minutes, args.benchmark_exhaustive_minutes)
+    benchmark_staging(args.benchmark_images)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,314 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Selects the frames of a recording to reconstruct from the camera motion """
+# pylint: disable=C0103
+
+import argparse
+import sys
+import time
+from collections import namedtuple
+
+import numpy as np
+
+from pair_selection import Camera, compute_frustum_samples, compute_overlap, \
+    get_image_intrinsics
+
+# Nominal intrinsics of the visible light cameras, see camera_params in
+# reconstruct_recording; only used to estimate how much two views overlap.
+VLC_CAMERA = Camera('PINHOLE', 640, 480, np.array([450.0, 450.0, 320.0, 240.0]))
+
+# Frames following the last keyframe whose motion is computed at once
+KEYFRAME_SEARCH_WINDOW = 64
+
+# Frames up to and including the one that moved too far, of which the sharpest
+# becomes the keyframe when sharpness scores are used
+SHARPNESS_WINDOW = 5
+
+# Bisection steps on the threshold scale to meet a keyframe budget
+KEYFRAME_BUDGET_ITERATIONS = 12
+
+# Frames per second the VLC cameras record at
+VLC_FRAME_RATE = 30.0
+
+# Coverage below which a frame counts as a gap between the selected frames
+COVERAGE_GAP_THRESHOLD = 0.5
+
+KeyframeSelectionStatistics = namedtuple(
+    'KeyframeSelectionStatistics',
+    'num_frames num_keyframes threshold_scale elapsed_time')
+
+
+def select_fixed_rate_frames(time_stamps, frame_rate):
+    """Returns the indices of the frames sampled at frame_rate from a 30 Hz stream,
+    time stamps in 100ns units, as synchronize_sensor_frames always did."""
+    time_per_frame_sampled = 10**7 / frame_rate
+    indices = []
+    prev_time_stamp = time_stamps[0]
+    for i in range(1, len(time_stamps)):
+        if time_stamps[i] - prev_time_stamp >= time_per_frame_sampled:
+            indices.append(i)
+            prev_time_stamp = time_stamps[i]
+    return indices
+
+
+def compute_sharpness(image_path):
+    """Returns the variance of the Laplacian of the image, higher when sharper."""
+    import cv2
+    image = cv2.imread(image_path, cv2.IMREAD_GRAYSCALE)
+    return cv2.Laplacian(image, cv2.CV_32F).var()
+
+
+def get_pose_arrays(poses):
+    """Returns the rotations and translations of world to camera poses."""
+    poses = np.array(poses)
+    return poses[:, :3, :3], poses[:, :3, 3]
+
+
+def select_keyframes(views, min_translation, min_rotation, min_overlap,
+                     threshold_scale=1.0, sharpness=None):
+    """Returns the indices of the keyframes.
+
+    The first frame is a keyframe; the next one is the first frame that moved at
+    least min_translation meters or min_rotation degrees from it, or whose view
+    overlaps less than min_overlap with it. All thresholds are relaxed by
+    threshold_scale. With sharpness, a function of the frame index, the sharpest of
+    the last SHARPNESS_WINDOW frames up to that one is taken instead.
+    """
+    samples, intrinsics, rotations, translations, centers = views
+    num_frames = len(rotations)
+
+    max_translation = threshold_scale * min_translation
+    max_cos_rotation = np.cos(np.radians(min(threshold_scale * min_rotation, 180.0)))
+    max_novelty = threshold_scale * (1.0 - min_overlap)
+
+    keyframes = [0]
+    start = 1
+    while start < num_frames:
+        keyframe = keyframes[-1]
+        indices = np.arange(start, min(num_frames, start + KEYFRAME_SEARCH_WINDOW))
+
+        # cos(angle) = (trace(R_i R_k^T) - 1) / 2
+        cos_rotations = (np.einsum('nij,ij->n', rotations[indices],
+                                   rotations[keyframe]) - 1.0) / 2.0
+        moved = (np.linalg.norm(centers[indices] - centers[keyframe], axis=1)
+                 >= max_translation) | (cos_rotations <= max_cos_rotation)
+
+        if max_novelty < 1.0:
+            keyframe_indices = np.full(len(indices), keyframe)
+            overlap = np.minimum(
+                compute_overlap(samples, intrinsics, rotations, translations,
+                                keyframe_indices, indices),
+                compute_overlap(samples, intrinsics, rotations, translations,
+                                indices, keyframe_indices))
+            moved |= 1.0 - overlap >= max_novelty
+
+        triggered = np.flatnonzero(moved)
+        if len(triggered) == 0:
+            start = indices[-1] + 1
+            continue
+
+        next_keyframe = int(indices[triggered[0]])
+        if sharpness is not None:
+            window_start = max(keyframe + 1, next_keyframe - SHARPNESS_WINDOW + 1)
+            next_keyframe = max(range(window_start, next_keyframe + 1), key=sharpness)
+
+        keyframes.append(next_keyframe)
+        start = next_keyframe + 1
+
+    return keyframes
+
+
+def prepare_views(poses, camera):
+    """Returns the frustum samples, intrinsics, rotations, translations and centers
+    of the frames, as select_keyframes uses them."""
+    rotations, translations = get_pose_arrays(poses)
+    camera_ids = np.ones(len(rotations), dtype=np.int64)
+    cameras = {1: camera}
+    samples = compute_frustum_samples(cameras, camera_ids, rotations, translations)
+    intrinsics = get_image_intrinsics(cameras, camera_ids)
+    centers = -np.einsum('nji,nj->ni', rotations, translations)
+    return samples, intrinsics, rotations, translations, centers
+
+
+def select_recording_keyframes(poses, image_paths=None, camera=VLC_CAMERA,
+                               min_translation=0.3, min_rotation=15.0,
+                               min_overlap=0.7, max_num_keyframes=-1):
+    """Returns the indices of the keyframes among the frames with the given world to
+    camera poses, and KeyframeSelectionStatistics.
+
+    Keyframes are selected with select_keyframes. For a budget of max_num_keyframes,
+    the thresholds are relaxed by the smallest scale found by bisection that meets
+    it. With image_paths, the sharpest frames are preferred.
+    """
+    start_time = time.perf_counter()
+
+    views = prepare_views(poses, camera)
+    thresholds = (min_translation, min_rotation, min_overlap)
+
+    threshold_scale = 1.0
+    if max_num_keyframes > 0 and \
+            len(select_keyframes(views, *thresholds)) > max_num_keyframes:
+        low, high = 1.0, 2.0
+        while len(select_keyframes(views, *thresholds, threshold_scale=high)) \
+                > max_num_keyframes:
+            low, high = high, 2.0 * high
+        for _ in range(KEYFRAME_BUDGET_ITERATIONS):
+            middle = (low + high) / 2.0
+            if len(select_keyframes(views, *thresholds, threshold_scale=middle)) \
+                    > max_num_keyframes:
+                low = middle
+            else:
+                high = middle
+        threshold_scale = high
+
+    sharpness = None
+    if image_paths is not None:
+        sharpness_scores = {}
+
+        def sharpness(index):
+            if index not in sharpness_scores:
+                sharpness_scores[index] = compute_sharpness(image_paths[index])
+            return sharpness_scores[index]
+
+    keyframes = select_keyframes(views, *thresholds, threshold_scale=threshold_scale,
+                                 sharpness=sharpness)
+
+    # Preferring sharp frames can move keyframes back and add one over the budget.
+    if max_num_keyframes > 0:
+        keyframes = keyframes[:max_num_keyframes]
+
+    return keyframes, KeyframeSelectionStatistics(
+        len(poses), len(keyframes), threshold_scale, time.perf_counter() - start_time)
+
+
+def compute_coverage(views, selected):
+    """Returns, for each frame, the largest fraction of its frustum seen by the
+    selected frames immediately before and after it."""
+    samples, intrinsics, rotations, translations, _ = views
+    selected = np.array(selected)
+    frames = np.arange(len(rotations))
+    next_index = np.minimum(np.searchsorted(selected, frames), len(selected) - 1)
+    previous_index = np.maximum(np.searchsorted(selected, frames, side='right') - 1, 0)
+    return np.maximum(
+        compute_overlap(samples, intrinsics, rotations, translations,
+                        frames, selected[previous_index]),
+        compute_overlap(samples, intrinsics, rotations, translations,
+                        frames, selected[next_index]))
+
+
+def create_synthetic_trajectory(num_frames):
+    """Returns the time stamps and world to camera poses of a 30 Hz camera on a head
+    that, every minute, stands still for 20s, walks a circle for 20s, turns around
+    quickly for 5s and looks around slowly for 15s."""
+    time_stamps = []
+    poses = []
+    position = np.zeros(3)
+    yaw = 0.0
+    for frame in range(num_frames):
+        time_in_seconds = frame / VLC_FRAME_RATE
+        phase = time_in_seconds % 60.0
+        if phase < 20.0:
+            yaw_rate, speed = 0.0, 0.0
+        elif phase < 40.0:
+            yaw_rate, speed = 2 * np.pi / 20.0, 1.0
+        elif phase < 45.0:
+            yaw_rate, speed = np.radians(120.0), 0.0
+        else:
+            yaw_rate, speed = np.radians(30.0) * np.sign(np.sin(phase)), 0.2
+        yaw += yaw_rate / VLC_FRAME_RATE
+        direction = np.array([np.sin(yaw), 0.0, np.cos(yaw)])
+        position = position + speed / VLC_FRAME_RATE * direction
+
+        camera_to_world = np.array([[np.cos(yaw), 0, np.sin(yaw)],
+                                    [0, 1, 0],
+                                    [-np.sin(yaw), 0, np.cos(yaw)]])
+        pose = np.eye(4)
+        pose[:3, :3] = camera_to_world.T
+        pose[:3, 3] = -camera_to_world.T.dot(position)
+        poses.append(pose)
+        time_stamps.append(int(frame * 10**7 / VLC_FRAME_RATE))
+
+    return np.array(time_stamps), poses
+
+
+def print_statistics(statistics):
+    print("INFO: {} of {} frames selected as keyframes (threshold scale {:.2f}) "
+          "in {:.3f}s".format(statistics.num_keyframes, statistics.num_frames,
+                              statistics.threshold_scale, statistics.elapsed_time))
+
+
+def print_selection(name, views, selected):
+    coverage = compute_coverage(views, selected)
+    print("INFO: {:10s} {:6d} frames, coverage mean {:.3f}, min {:.3f}, "
+          "{} frames below {:.1f}".format(
+              name, len(selected), coverage.mean(), coverage.min(),
+              np.count_nonzero(coverage < COVERAGE_GAP_THRESHOLD),
+              COVERAGE_GAP_THRESHOLD))
+
+
+def main(argv):
+    """Keyframe selection main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--recording_path",
+                        help="Extracted recording, with the PGM images and the CSV "
+                             "poses of --camera_name")
+    parser.add_argument("--camera_name", default="vlc_ll")
+    parser.add_argument("--min_translation", type=float, default=0.3,
+                        help="Camera motion, in meters, that starts a new keyframe")
+    parser.add_argument("--min_rotation", type=float, default=15.0,
+                        help="Camera rotation, in degrees, that starts a new keyframe")
+    parser.add_argument("--min_overlap", type=float, default=0.7,
+                        help="View overlap with the last keyframe below which a new "
+                             "keyframe starts")
+    parser.add_argument("--max_num_keyframes", type=int, default=-1)
+    parser.add_argument("--sharpness", action="store_true",
+                        help="Prefer the sharpest images, which reads them")
+    parser.add_argument("--frame_rate", type=int, default=5,
+                        help="Rate of the fixed rate sampling to compare with")
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Compare keyframes with fixed rate sampling, for a "
+                             "synthetic trajectory without --recording_path")
+    parser.add_argument("--benchmark_frames", type=int, default=54000,
+                        help="Frames of the synthetic trajectory, at 30 Hz")
+    args = parser.parse_args(argv)
+
+    image_paths = None
+    if args.recording_path is not None:
+        from recorder_console import read_sensor_images
+        image_paths, _, time_stamps, poses = \
+            read_sensor_images(args.recording_path, args.camera_name)
+        if not args.sharpness:
+            image_paths = None
+    elif args.benchmark:
+        time_stamps, poses = create_synthetic_trajectory(args.benchmark_frames)
+    else:
+        parser.error("the following arguments are required: --recording_path")
+
+    keyframes, statistics = select_recording_keyframes(
+        poses, image_paths=image_paths, min_translation=args.min_translation,
+        min_rotation=args.min_rotation, min_overlap=args.min_overlap,
+        max_num_keyframes=args.max_num_keyframes)
+    print_statistics(statistics)
+
+    if args.benchmark:
+        views = prepare_views(poses, VLC_CAMERA)
+        fixed_rate_frames = select_fixed_rate_frames(time_stamps, args.frame_rate)
+        print_selection("fixed rate", views, fixed_rate_frames)
+        print_selection("keyframes", views, keyframes)
+
+        # A fixed rate that selects as many frames as the keyframes
+        equal_rate = len(keyframes) * VLC_FRAME_RATE / len(time_stamps)
+        print_selection("equal rate", views, select_fixed_rate_frames(
+            time_stamps, equal_rate))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
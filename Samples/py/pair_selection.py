@@ -0,0 +1,423 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Selects the image pairs to match in COLMAP from the recorded HoloLens poses """
+# pylint: disable=C0103
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from collections import namedtuple
+
+import numpy as np
+
+# Depth range, in meters, over which the frustums of two images are compared. The
+# visible light cameras see a room; farther surfaces rarely yield matches anyway.
+FRUSTUM_NEAR_DEPTH = 0.5
+FRUSTUM_FAR_DEPTH = 4.0
+
+# Points sampled per frustum: a grid of image points, each at several depths
+FRUSTUM_SAMPLES_PER_AXIS = 4
+FRUSTUM_SAMPLE_DEPTHS = 3
+
+# Baseline, in meters, below which pairs are ranked lower: images taken from the
+# same spot add matches but nothing to triangulate.
+TRIANGULATION_BASELINE = 0.1
+
+# Candidates per image, as a multiple of the pairs per image, whose frustum overlap
+# is computed. The others are ranked out by viewing direction and distance alone.
+CANDIDATES_PER_PAIR = 4
+
+# Candidate pairs whose frustum overlap is computed at once, bounding memory use
+OVERLAP_CHUNK_SIZE = 20000
+
+# Camera models whose parameters start with a single focal length, see
+# https://colmap.github.io/cameras.html
+SINGLE_FOCAL_LENGTH_MODELS = ('SIMPLE_PINHOLE', 'SIMPLE_RADIAL', 'RADIAL',
+                              'SIMPLE_RADIAL_FISHEYE', 'RADIAL_FISHEYE')
+
+Camera = namedtuple('Camera', 'model width height params')
+
+PairSelectionStatistics = namedtuple(
+    'PairSelectionStatistics',
+    'num_images num_candidates num_pairs max_degree elapsed_time')
+
+
+def qvec2rotmat(qvec):
+    return np.array([
+        [1 - 2 * qvec[2]**2 - 2 * qvec[3]**2,
+         2 * qvec[1] * qvec[2] - 2 * qvec[0] * qvec[3],
+         2 * qvec[3] * qvec[1] + 2 * qvec[0] * qvec[2]],
+        [2 * qvec[1] * qvec[2] + 2 * qvec[0] * qvec[3],
+         1 - 2 * qvec[1]**2 - 2 * qvec[3]**2,
+         2 * qvec[2] * qvec[3] - 2 * qvec[0] * qvec[1]],
+        [2 * qvec[3] * qvec[1] - 2 * qvec[0] * qvec[2],
+         2 * qvec[2] * qvec[3] + 2 * qvec[0] * qvec[1],
+         1 - 2 * qvec[1]**2 - 2 * qvec[2]**2]])
+
+
+def read_cameras_text(path):
+    """Returns {camera id: Camera} from a COLMAP cameras.txt."""
+    cameras = {}
+    with open(path, "r") as fid:
+        for line in fid:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            elems = line.split()
+            cameras[int(elems[0])] = Camera(
+                elems[1], int(elems[2]), int(elems[3]),
+                np.array(list(map(float, elems[4:]))))
+    return cameras
+
+
+def read_images_text(path):
+    """Returns (names, camera ids, rotations, translations) from a COLMAP images.txt.
+
+    The poses transform from the world to the camera coordinate system, as written
+    by reconstruct_recording in recorder_console.py.
+    """
+    names = []
+    camera_ids = []
+    rotations = []
+    translations = []
+    with open(path, "r") as fid:
+        while True:
+            line = fid.readline()
+            if not line:
+                break
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            elems = line.split()
+            rotations.append(qvec2rotmat(np.array(list(map(float, elems[1:5])))))
+            translations.append(np.array(list(map(float, elems[5:8]))))
+            camera_ids.append(int(elems[8]))
+            names.append(elems[9])
+            # Skip the line of 2D points of the image.
+            fid.readline()
+    return names, np.array(camera_ids), np.array(rotations), np.array(translations)
+
+
+def get_pinhole_params(camera):
+    """Returns (fx, fy, cx, cy), ignoring distortion."""
+    if camera.model in SINGLE_FOCAL_LENGTH_MODELS:
+        return camera.params[0], camera.params[0], camera.params[1], camera.params[2]
+    return tuple(camera.params[:4])
+
+
+def compute_frustum_samples(cameras, camera_ids, rotations, translations):
+    """Returns the world coordinates of points sampled from each frustum, (N, S, 3)."""
+    camera_samples = {}
+    for camera_id, camera in cameras.items():
+        fx, fy, cx, cy = get_pinhole_params(camera)
+        steps = (np.arange(FRUSTUM_SAMPLES_PER_AXIS) + 0.5) / FRUSTUM_SAMPLES_PER_AXIS
+        u, v = np.meshgrid(steps * camera.width, steps * camera.height)
+        rays = np.stack([(u.ravel() - cx) / fx, (v.ravel() - cy) / fy,
+                         np.ones(u.size)], axis=1)
+        depths = np.linspace(FRUSTUM_NEAR_DEPTH, FRUSTUM_FAR_DEPTH, FRUSTUM_SAMPLE_DEPTHS)
+        camera_samples[camera_id] = (depths[:, None, None] * rays[None]).reshape(-1, 3)
+
+    samples = np.array([camera_samples[camera_id] for camera_id in camera_ids])
+
+    # X_world = R^T (X_camera - t)
+    return np.einsum('nji,nsj->nsi', rotations, samples - translations[:, None, :])
+
+
+def get_image_intrinsics(cameras, camera_ids):
+    """Returns (fx, fy, cx, cy, width, height) of each image, (N, 6)."""
+    camera_intrinsics = {
+        camera_id: get_pinhole_params(camera) + (camera.width, camera.height)
+        for camera_id, camera in cameras.items()}
+    return np.array([camera_intrinsics[camera_id] for camera_id in camera_ids])
+
+
+def compute_overlap(samples, intrinsics, rotations, translations, first, second):
+    """Returns the fraction of the frustum samples of the first images that the
+    second images see, for each pair."""
+    rotation = rotations[second]
+    translation = translations[second]
+    x, y, z = samples[first, :, 0], samples[first, :, 1], samples[first, :, 2]
+
+    def transform(row):
+        return rotation[:, row, 0:1] * x + rotation[:, row, 1:2] * y + \
+            rotation[:, row, 2:3] * z + translation[:, row:row + 1]
+
+    camera_x, camera_y, depths = transform(0), transform(1), transform(2)
+
+    # 0 <= fx * x / z + cx < width, multiplied by z > 0
+    fx, fy, cx, cy, width, height = (intrinsics[second, k:k + 1] for k in range(6))
+    u = fx * camera_x + cx * depths
+    v = fy * camera_y + cy * depths
+    visible = (depths > 0) & (u >= 0) & (u < width * depths) & (v >= 0) & (v < height * depths)
+    return visible.mean(axis=1)
+
+
+def find_nearby_pairs(centers, max_distance):
+    """Returns the pairs (i < j) of centers at most max_distance apart.
+
+    Centers are hashed into a uniform grid with cells of max_distance, so that only
+    the 27 cells around each center are searched.
+    """
+    cells = np.floor(centers / max_distance).astype(np.int64)
+    grid = {}
+    for index, cell in enumerate(map(tuple, cells)):
+        grid.setdefault(cell, []).append(index)
+    grid = {cell: np.array(indices) for cell, indices in grid.items()}
+
+    # Each pair of neighboring cells is visited once, from the lower one.
+    forward_offsets = [(dx, dy, dz)
+                       for dx in (-1, 0, 1) for dy in (-1, 0, 1) for dz in (-1, 0, 1)
+                       if (dx, dy, dz) > (0, 0, 0)]
+
+    pairs = []
+    for cell, indices in grid.items():
+        first, second = np.triu_indices(len(indices), 1)
+        pairs.append(np.stack([indices[first], indices[second]], axis=1))
+        for offset in forward_offsets:
+            neighbors = grid.get((cell[0] + offset[0], cell[1] + offset[1], cell[2] + offset[2]))
+            if neighbors is None:
+                continue
+            first, second = np.meshgrid(indices, neighbors, indexing='ij')
+            pairs.append(np.stack([first.ravel(), second.ravel()], axis=1))
+
+    pairs = np.sort(np.concatenate(pairs), axis=1) if pairs else np.zeros((0, 2), np.int64)
+    distances = np.linalg.norm(centers[pairs[:, 0]] - centers[pairs[:, 1]], axis=1)
+    return pairs[distances <= max_distance]
+
+
+def select_top_candidates(pairs, scores, num_images, max_candidates):
+    """Keeps the pairs that are among the max_candidates best scoring pairs of
+    either of their images."""
+    images = pairs.T.ravel()
+    indices = np.tile(np.arange(len(pairs)), 2)
+
+    # Sorts by image, then by descending score, with a single key in [image, image + 1)
+    normalized_scores = (scores - scores.min()) / (np.ptp(scores) + 1e-9) if len(scores) else scores
+    order = np.argsort(images + 0.5 * (1.0 - np.tile(normalized_scores, 2)))
+    group_starts = np.searchsorted(images[order], np.arange(num_images))
+    ranks = np.arange(len(order)) - group_starts[images[order]]
+    keep = np.zeros(len(pairs), dtype=bool)
+    keep[indices[order[ranks < max_candidates]]] = True
+    return pairs[keep]
+
+
+def select_bounded_degree_pairs(pairs, scores, num_images, max_degree):
+    """Greedily keeps the best scoring pairs whose images both have fewer than
+    max_degree pairs so far."""
+    degrees = [0] * num_images
+    selected = []
+    for index in np.argsort(-scores, kind='stable').tolist():
+        first, second = pairs[index]
+        if degrees[first] < max_degree and degrees[second] < max_degree:
+            degrees[first] += 1
+            degrees[second] += 1
+            selected.append(index)
+    return pairs[np.array(selected, dtype=np.int64)], max(degrees) if degrees else 0
+
+
+def select_image_pairs(cameras, camera_ids, rotations, translations,
+                       max_baseline=2.0, max_angle=60.0, min_overlap=0.1,
+                       max_degree=30):
+    """Returns the pairs of image indices to match, and PairSelectionStatistics.
+
+    Candidates are images whose centers are at most max_baseline meters apart and
+    whose viewing directions differ by at most max_angle degrees; of those, each
+    image keeps the CANDIDATES_PER_PAIR * max_degree most similar and closest. They
+    are scored by the smaller fraction of either frustum seen by the other image,
+    weighted down for baselines shorter than TRIANGULATION_BASELINE, and dropped
+    below min_overlap.
+    Each image is paired with at most max_degree others.
+    """
+    start_time = time.perf_counter()
+
+    centers = -np.einsum('nji,nj->ni', rotations, translations)
+    directions = rotations[:, 2, :]
+
+    candidates = find_nearby_pairs(centers, max_baseline)
+    num_candidates = len(candidates)
+
+    cosines = np.sum(directions[candidates[:, 0]] * directions[candidates[:, 1]], axis=1)
+    similar = cosines >= np.cos(np.radians(max_angle))
+    candidates, cosines = candidates[similar], cosines[similar]
+
+    baselines = np.linalg.norm(centers[candidates[:, 0]] - centers[candidates[:, 1]], axis=1)
+    candidates = select_top_candidates(
+        candidates, cosines - baselines / max_baseline, len(camera_ids),
+        CANDIDATES_PER_PAIR * max_degree)
+
+    samples = compute_frustum_samples(cameras, camera_ids, rotations, translations)
+    intrinsics = get_image_intrinsics(cameras, camera_ids)
+
+    scores = np.zeros(len(candidates))
+    for start in range(0, len(candidates), OVERLAP_CHUNK_SIZE):
+        chunk = candidates[start:start + OVERLAP_CHUNK_SIZE]
+        first, second = chunk[:, 0], chunk[:, 1]
+        overlap = np.minimum(
+            compute_overlap(samples, intrinsics, rotations, translations, first, second),
+            compute_overlap(samples, intrinsics, rotations, translations, second, first))
+        baselines = np.linalg.norm(centers[first] - centers[second], axis=1)
+        scores[start:start + len(chunk)] = np.where(
+            overlap >= min_overlap,
+            overlap * np.minimum(1.0, baselines / TRIANGULATION_BASELINE + 0.1),
+            0.0)
+
+    candidates, scores = candidates[scores > 0], scores[scores > 0]
+
+    pairs, degree = select_bounded_degree_pairs(
+        candidates, scores, len(camera_ids), max_degree)
+
+    return pairs, PairSelectionStatistics(
+        len(camera_ids), num_candidates, len(pairs), degree,
+        time.perf_counter() - start_time)
+
+
+def write_match_list(sparse_path, match_list_path, **kwargs):
+    """Writes the pairs for COLMAP's matches_importer (--match_type pairs) from the
+    cameras.txt and images.txt in sparse_path; returns PairSelectionStatistics."""
+    cameras = read_cameras_text(os.path.join(sparse_path, "cameras.txt"))
+    names, camera_ids, rotations, translations = \
+        read_images_text(os.path.join(sparse_path, "images.txt"))
+
+    pairs, statistics = select_image_pairs(
+        cameras, camera_ids, rotations, translations, **kwargs)
+
+    with open(match_list_path, "w") as fid:
+        for first, second in pairs.tolist():
+            fid.write("{} {}\n".format(names[first], names[second]))
+
+    return statistics
+
+
+def create_synthetic_recording(num_frames, frame_rate=5.0):
+    """Returns (cameras, camera ids, rotations, translations) of the four visible
+    light cameras on a head walking loops through a room, laid out roughly like
+    SyntheticSensorFrameSource does."""
+    cameras = {1: Camera('PINHOLE', 640, 480, np.array([450.0, 450.0, 320.0, 240.0]))}
+
+    # (x offset in meters, yaw in radians) of vlc_ll, vlc_lf, vlc_rf, vlc_rr
+    rig = ((-0.05, 0.8), (-0.03, 0.0), (0.03, 0.0), (0.05, -0.8))
+
+    camera_ids = []
+    rotations = []
+    translations = []
+    for frame in range(num_frames):
+        # Loops of 3m radius, every 20s, around a center drifting through the room
+        time_in_seconds = frame / frame_rate
+        angle = 2 * np.pi * time_in_seconds / 20.0
+        drift = 2 * np.pi * time_in_seconds / 300.0
+        head_center = np.array([3.0 * np.sin(angle) + 4.0 * np.sin(drift), 0.0,
+                                3.0 * np.cos(angle) + 4.0 * np.cos(drift)])
+        head_yaw = angle + np.pi
+        for offset, yaw in rig:
+            # Camera looks down its z axis; the rotation maps world to camera.
+            total_yaw = head_yaw + yaw
+            camera_to_world = np.array([[np.cos(total_yaw), 0, np.sin(total_yaw)],
+                                        [0, 1, 0],
+                                        [-np.sin(total_yaw), 0, np.cos(total_yaw)]])
+            center = head_center + camera_to_world.dot(np.array([offset, 0.0, 0.0]))
+            rotations.append(camera_to_world.T)
+            translations.append(-camera_to_world.T.dot(center))
+            camera_ids.append(1)
+
+    return cameras, np.array(camera_ids), np.array(rotations), np.array(translations)
+
+
+def time_colmap_matching(colmap_path, database_path, match_list_path):
+    """Returns the seconds COLMAP takes for exhaustive and for pose-guided matching,
+    each on a copy of the database."""
+    elapsed_times = []
+    temporary_path = tempfile.mkdtemp()
+    try:
+        for arguments in (["exhaustive_matcher"],
+                          ["matches_importer", "--match_list_path", match_list_path,
+                           "--match_type", "pairs"]):
+            database_copy_path = os.path.join(temporary_path, arguments[0] + ".db")
+            shutil.copyfile(database_path, database_copy_path)
+            start_time = time.perf_counter()
+            subprocess.call([colmap_path] + arguments + [
+                "--database_path", database_copy_path,
+                "--SiftMatching.guided_matching", "true",
+            ])
+            elapsed_times.append(time.perf_counter() - start_time)
+    finally:
+        shutil.rmtree(temporary_path)
+    return elapsed_times
+
+
+def print_statistics(statistics):
+    num_exhaustive_pairs = statistics.num_images * (statistics.num_images - 1) // 2
+    print("INFO: {} images: {} pairs ({:.2f}% of the {} exhaustive pairs, {} candidates), "
+          "max {} pairs per image, selected in {:.3f}s".format(
+              statistics.num_images, statistics.num_pairs,
+              100.0 * statistics.num_pairs / max(num_exhaustive_pairs, 1),
+              num_exhaustive_pairs, statistics.num_candidates,
+              statistics.max_degree, statistics.elapsed_time))
+
+
+def main(argv):
+    """Pair selection main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--sparse_path",
+                        help="Folder with the cameras.txt and images.txt of the recorded "
+                             "poses, i.e. reconstruction/sparse_hololens")
+    parser.add_argument("--output_path",
+                        help="Match list to write, for colmap matches_importer")
+    parser.add_argument("--max_baseline", type=float, default=2.0,
+                        help="Maximum distance of paired cameras, in meters")
+    parser.add_argument("--max_angle", type=float, default=60.0,
+                        help="Maximum angle between paired viewing directions, in degrees")
+    parser.add_argument("--min_overlap", type=float, default=0.1,
+                        help="Minimum fraction of either frustum seen by the other image")
+    parser.add_argument("--max_pairs_per_image", type=int, default=30)
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Select pairs for a synthetic recording, or time COLMAP "
+                             "matching against exhaustive matching for --sparse_path")
+    parser.add_argument("--benchmark_frames", type=int, default=5000,
+                        help="Frames of the synthetic recording, four images each")
+    parser.add_argument("--colmap_path", help="Path to COLMAP.bat executable")
+    parser.add_argument("--database_path",
+                        help="COLMAP database with the features of the --sparse_path images")
+    args = parser.parse_args(argv)
+
+    selection_args = dict(max_baseline=args.max_baseline, max_angle=args.max_angle,
+                          min_overlap=args.min_overlap,
+                          max_degree=args.max_pairs_per_image)
+
+    if args.benchmark and args.sparse_path is None:
+        cameras, camera_ids, rotations, translations = \
+            create_synthetic_recording(args.benchmark_frames)
+        _, statistics = select_image_pairs(
+            cameras, camera_ids, rotations, translations, **selection_args)
+        print_statistics(statistics)
+        return
+
+    if args.sparse_path is None:
+        parser.error("the following arguments are required: --sparse_path")
+
+    match_list_path = args.output_path or os.path.join(args.sparse_path, "match_list.txt")
+    print_statistics(write_match_list(args.sparse_path, match_list_path, **selection_args))
+
+    if args.benchmark:
+        if args.colmap_path is None or args.database_path is None:
+            parser.error("--benchmark with --sparse_path requires --colmap_path and "
+                         "--database_path")
+        exhaustive_time, pose_guided_time = time_colmap_matching(
+            args.colmap_path, args.database_path, match_list_path)
+        print("INFO: matching took {:.1f}s exhaustive, {:.1f}s pose-guided ({:.1f}x)".format(
+            exhaustive_time, pose_guided_time, exhaustive_time / max(pose_guided_time, 1e-6)))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
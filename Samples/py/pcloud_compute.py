@@ -8,6 +8,7 @@ import numpy as np
 import os
 
 from recorder_console import read_sensor_poses
+from recording_downloader import get_sensor_segments
 
 
 # Depth range for short throw and long throw, in meters (approximate)
@@ -66,14 +67,16 @@ def parse_projection_bin(path, w, h):
     return [u, v]
 
 
-def pgm2distance(img, encoded=False):
-    # See repo issue #19
-    img.byteswap(inplace=True)
+def pgm2distance(img, encoded=False, byteswap=True):
+    # See repo issue #19: 16-bit PGM pixels are written in little endian byte
+    # order, which OpenCV reads as big endian. PNG images are read correctly.
+    if byteswap:
+        img.byteswap(inplace=True)
     return img.astype(np.float)/1000.0
 
 
-def get_points(img, us, vs, cam2world, depth_range):
-    distance_img = pgm2distance(img, encoded=False)
+def get_points(img, us, vs, cam2world, depth_range, byteswap=True):
+    distance_img = pgm2distance(img, encoded=False, byteswap=byteswap)
 
     if cam2world is not None:
         R = cam2world[:3, :3]
@@ -134,13 +137,17 @@ def process_folder(args, cam):
     # From frame to world coordinate system
     sensor_poses = None
     if not args.ignore_sensor_poses:
-        sensor_poses = read_sensor_poses(os.path.join(folder, cam + ".csv"), identity_camera_to_image=True)        
+        # Segmented recordings list the CSV file of every segment in segments.csv.
+        sensor_poses = {}
+        for _, csv_path in get_sensor_segments(folder, cam):
+            sensor_poses.update(read_sensor_poses(csv_path, identity_camera_to_image=True))
 
     # Get appropriate depth thresholds
     depth_range = LONG_THROW_RANGE if 'long' in cam else SHORT_THROW_RANGE
 
     # Get depth paths
-    depth_paths = sorted(glob(os.path.join(cam_folder, "*pgm")))
+    depth_paths = sorted(glob(os.path.join(cam_folder, "*pgm")) +
+                         glob(os.path.join(cam_folder, "*png")))
     if args.max_num_frames == -1:
         args.max_num_frames = len(depth_paths)
     depth_paths = depth_paths[args.start_frame:(args.start_frame + args.max_num_frames)]    
@@ -153,7 +160,7 @@ def process_folder(args, cam):
     us = vs = None
     for i_path, path in enumerate(depth_paths):
         output_suffix = "_%s" % args.output_suffix if len(args.output_suffix) else ""
-        pcloud_output_path = os.path.join(output_folder, os.path.basename(path).replace(".pgm", "%s.obj" % output_suffix))
+        pcloud_output_path = os.path.join(output_folder, os.path.splitext(os.path.basename(path))[0] + "%s.obj" % output_suffix)
         print("Progress file (%d/%d): %s" %
               (i_path+1, len(depth_paths), pcloud_output_path))
         
@@ -166,7 +173,8 @@ def process_folder(args, cam):
             if us is None or vs is None:
                 us, vs = parse_projection_bin(bin_path, img.shape[1], img.shape[0])
             cam2world = get_cam2world(path, sensor_poses) if sensor_poses is not None else None
-            points = get_points(img, us, vs, cam2world, depth_range)  
+            is_pgm = os.path.splitext(path)[1].lower() == ".pgm"
+            points = get_points(img, us, vs, cam2world, depth_range, byteswap=is_pgm)
             
         if merge_points:
             points_merged.extend(points)
@@ -16,12 +16,21 @@ import glob
 import tarfile
 import argparse
 import sqlite3
-import shutil
 import json
 import subprocess
 import urllib.request
 import numpy as np
 
+from pair_selection import write_match_list, print_statistics
+import keyframe_selection
+import frame_synchronization
+import recording_downloader
+import recording_previews
+
+
+# Bitmaps as stored by the recorder, see RecordingImageCodec.h
+IMAGE_FILE_EXTENSIONS = (".pgm", ".png", ".jpg")
+
 
 def parse_args():
     parser = argparse.ArgumentParser()
@@ -31,6 +40,8 @@ def parse_args():
                         help="The username for the HoloLens Device Portal")
     parser.add_argument("--dev_portal_password", required=True,
                         help="The password for the HoloLens Device Portal")
+    parser.add_argument("--download_connections", type=int, default=4,
+                        help="Concurrent connections to download recordings over")
 
     parser.add_argument("--workspace_path", required=True,
                         help="Path to workspace folder used for downloading "
@@ -38,10 +49,26 @@ def parse_args():
     parser.add_argument("--colmap_path", help="Path to COLMAP.bat executable")
 
     parser.add_argument("--ref_camera_name", default="vlc_ll")
+    parser.add_argument("--frame_selection", default="keyframes",
+                        choices=["keyframes", "fixed_rate"],
+                        help="Select the frames to reconstruct from the camera "
+                             "motion, or at --frame_rate")
     parser.add_argument("--frame_rate", type=int, default=5)
+    parser.add_argument("--max_num_keyframes", type=int, default=-1)
+    parser.add_argument("--stage_images", default="hardlink",
+                        choices=frame_synchronization.STAGING_MODES,
+                        help="How to place the synchronized images in the "
+                             "reconstruction folder; links fall back to copies")
+    parser.add_argument("--keyframe_sharpness", action="store_true",
+                        help="Prefer the sharpest images as keyframes")
     parser.add_argument("--start_frame", type=int, default=-1)
     parser.add_argument("--max_num_frames", type=int, default=-1)
     parser.add_argument("--num_refinements", type=int, default=3)
+    parser.add_argument("--matcher", default="pose_guided",
+                        choices=["pose_guided", "exhaustive"],
+                        help="Match the image pairs selected from the recorded "
+                             "poses, or all image pairs")
+    parser.add_argument("--max_pairs_per_image", type=int, default=30)
 
     args = parser.parse_args()
 
@@ -134,7 +161,8 @@ class DevicePortalBrowser(object):
         except IndexError:
             print("=> Recording does not exist")
 
-    def download_recording(self, recording_idx, workspace_path):
+    def download_recording(self, recording_idx, workspace_path,
+                           num_connections=4):
         recording_name = self.get_recording_name(recording_idx)
         if recording_name is None:
             return
@@ -144,27 +172,10 @@ class DevicePortalBrowser(object):
 
         print("Downloading recording {}...".format(recording_name))
 
-        response = urllib.request.urlopen(
-            "{}/api/filesystem/apps/files?knownfolderid="
-            "LocalAppData&packagefullname={}&path=\\\\TempState\\{}".format(
-                self.url, self.package_full_name, recording_name))
-        files = json.loads(response.read().decode())
-
-        for file in files["Items"]:
-            if file["Type"] != 32:
-                continue
-
-            destination_path = os.path.join(recording_path, file["Id"])
-            if os.path.exists(destination_path):
-                print("=> Skipping, already downloaded:", file["Id"])
-                continue
-
-            print("=> Downloading:", file["Id"])
-            urllib.request.urlretrieve(
-                "{}/api/filesystem/apps/file?knownfolderid=LocalAppData&" \
-                "packagefullname={}&filename=\\\\TempState\\{}\\{}".format(
-                    self.url, self.package_full_name,
-                    recording_name, file["Id"]), destination_path)
+        downloader = recording_downloader.RecordingDownloader(
+            self.url, self.package_full_name, num_connections=num_connections)
+        recording_downloader.print_statistics(
+            downloader.download_recording(recording_name, recording_path))
 
     def delete_recording(self, recording_idx):
         recording_name = self.get_recording_name(recording_idx)
@@ -202,7 +213,8 @@ def read_sensor_poses(path, identity_camera_to_image=False):
             if not line:
                 continue
             elems = line.split(",")
-            assert len(elems) == 50
+            # Recordings of version 0.3 and later end with the ImageCodec column.
+            assert len(elems) in (50, 51)
             time_stamp = int(elems[0])
             # Compose the absolute camera pose from the two relative
             # camera poses provided by the recorder application.
@@ -225,11 +237,15 @@ def read_sensor_poses(path, identity_camera_to_image=False):
 
 
 def read_sensor_images(recording_path, camera_name):
-    image_poses = read_sensor_poses(os.path.join(
-        recording_path, camera_name + ".csv"))
+    image_poses = {}
+    for _, csv_path in recording_downloader.get_sensor_segments(
+            recording_path, camera_name):
+        image_poses.update(read_sensor_poses(csv_path))
 
-    image_paths = sorted(glob.glob(
-        os.path.join(recording_path, camera_name, "*.pgm")))
+    image_paths = sorted(
+        path for extension in IMAGE_FILE_EXTENSIONS
+        for path in glob.glob(
+            os.path.join(recording_path, camera_name, "*" + extension)))
 
     paths = []
     names = []
@@ -264,23 +280,22 @@ def synchronize_sensor_frames(args, recording_path, output_path, camera_names):
     assert np.all(ref_time_stamps >= 0)
 
     time_per_frame = 10**7 / 30.0
-    time_per_frame_sampled = 30.0 / args.frame_rate * time_per_frame
-
-    ref_image_paths_sampled = []
-    ref_image_names_sampled = []
-    ref_time_stamps_sampled = []
-    ref_image_poses_sampled = []
-    ref_prev_time_stamp = ref_time_stamps[0]
-    for i in range(1, len(ref_time_stamps)):
-        if ref_time_stamps[i] - ref_prev_time_stamp >= time_per_frame_sampled:
-            ref_image_paths_sampled.append(ref_image_paths[i])
-            ref_image_names_sampled.append(ref_image_names[i])
-            ref_time_stamps_sampled.append(ref_time_stamps[i])
-            ref_image_poses_sampled.append(ref_image_poses[i])
-            ref_prev_time_stamp = ref_time_stamps[i]
-    ref_image_paths, ref_image_names, ref_time_stamps, ref_image_poses = \
-        (ref_image_paths_sampled, ref_image_names_sampled,
-         ref_time_stamps_sampled, ref_image_poses_sampled)
+
+    if args.frame_selection == "keyframes":
+        sampled_indices, statistics = \
+            keyframe_selection.select_recording_keyframes(
+                ref_image_poses,
+                image_paths=ref_image_paths if args.keyframe_sharpness else None,
+                max_num_keyframes=args.max_num_keyframes)
+        keyframe_selection.print_statistics(statistics)
+    else:
+        sampled_indices = keyframe_selection.select_fixed_rate_frames(
+            ref_time_stamps, args.frame_rate)
+
+    ref_image_paths = [ref_image_paths[i] for i in sampled_indices]
+    ref_image_names = [ref_image_names[i] for i in sampled_indices]
+    ref_time_stamps = [ref_time_stamps[i] for i in sampled_indices]
+    ref_image_poses = [ref_image_poses[i] for i in sampled_indices]
 
     if args.max_num_frames > 0:
         assert args.start_frame < len(ref_image_paths)
@@ -289,6 +304,7 @@ def synchronize_sensor_frames(args, recording_path, output_path, camera_names):
         ref_image_paths = ref_image_paths[args.start_frame:end_frame]
         ref_image_names = ref_image_names[args.start_frame:end_frame]
         ref_time_stamps = ref_time_stamps[args.start_frame:end_frame]
+        ref_image_poses = ref_image_poses[args.start_frame:end_frame]
 
     sync_image_paths = {}
     sync_image_names = {}
@@ -305,18 +321,17 @@ def synchronize_sensor_frames(args, recording_path, output_path, camera_names):
             in images.items():
         if camera_name == args.ref_camera_name:
             continue
-        for image_path, image_name, time_stamp, image_pose in \
-                zip(image_paths, image_names, time_stamps, image_poses):
-            time_diffs = np.abs(time_stamp - ref_time_stamps)
-            min_time_diff_idx = np.argmin(time_diffs)
-            min_time_diff = time_diffs[min_time_diff_idx]
-            if min_time_diff < max_sync_time_diff:
-                sync_ref_image_name = ref_image_names[min_time_diff_idx]
+        ref_indices = frame_synchronization.match_time_stamps(
+            ref_time_stamps, time_stamps, max_sync_time_diff)
+        for image_path, image_name, ref_index, image_pose in \
+                zip(image_paths, image_names, ref_indices, image_poses):
+            if ref_index >= 0:
+                sync_ref_image_name = ref_image_names[ref_index]
                 sync_image_paths[sync_ref_image_name].append(image_path)
                 sync_image_names[sync_ref_image_name].append(image_name)
                 sync_image_poses[sync_ref_image_name].append(image_pose)
 
-    # Copy the frames to the output directory.
+    # Stage the frames in the output directory.
 
     for camera_name in camera_names:
         mkdir_if_not_exists(os.path.join(output_path, camera_name))
@@ -324,7 +339,6 @@ def synchronize_sensor_frames(args, recording_path, output_path, camera_names):
     sync_frames = []
     sync_poses = []
     for ref_image_name, ref_time_stamp in zip(ref_image_names, ref_time_stamps):
-        image_basename = "{}.pgm".format(ref_time_stamp)
         frame_images = []
         frame_poses = []
         for image_path, image_name, image_pose in \
@@ -333,10 +347,13 @@ def synchronize_sensor_frames(args, recording_path, output_path, camera_names):
                     sync_image_poses[ref_image_name]):
             if len(sync_image_paths[ref_image_name]) == 4:
                 camera_name = os.path.dirname(image_name)
+                # Keep the extension of the codec the image was recorded with.
+                image_basename = "{}{}".format(
+                    ref_time_stamp, os.path.splitext(image_path)[1])
                 new_image_path = os.path.join(
                     output_path, camera_name, image_basename)
-                if not os.path.exists(new_image_path):
-                    shutil.copyfile(image_path, new_image_path)
+                frame_synchronization.stage_image(
+                    image_path, new_image_path, args.stage_images)
                 new_image_name = os.path.join(camera_name, image_basename)
                 frame_images.append(new_image_name.replace("\\", "/"))
                 frame_poses.append(image_pose)
@@ -461,11 +478,24 @@ def reconstruct_recording(args, recording_path, dense=True):
     images_file.close()
     points_file.close()
 
-    subprocess.call([
-        args.colmap_path, "exhaustive_matcher",
-        "--database_path", database_path,
-        "--SiftMatching.guided_matching", "true",
-    ])
+    if args.matcher == "pose_guided":
+        match_list_path = os.path.join(reconstruction_path, "match_list.txt")
+        print_statistics(write_match_list(
+            sparse_hololens_path, match_list_path,
+            max_degree=args.max_pairs_per_image))
+        subprocess.call([
+            args.colmap_path, "matches_importer",
+            "--database_path", database_path,
+            "--match_list_path", match_list_path,
+            "--match_type", "pairs",
+            "--SiftMatching.guided_matching", "true",
+        ])
+    else:
+        subprocess.call([
+            args.colmap_path, "exhaustive_matcher",
+            "--database_path", database_path,
+            "--SiftMatching.guided_matching", "true",
+        ])
 
     with open(rig_config_path, "w") as fid:
         fid.write("""[
@@ -561,6 +591,8 @@ def print_help():
     print("  delete X:                 Delete recording X from the HoloLens")
     print("  delete all:               Delete all recordings from the HoloLens")
     print("  extract X:                Extract recording X in the workspace")
+    print("  previews X:               Write the preview contact sheets "
+                                      "of recording X in the workspace")
     print("  reconstruct X:            Perform sparse and dense reconstruction "
                                       "of recording X in the workspace")
     print("  reconstruct sparse X:     Perform sparse reconstruction "
@@ -628,7 +660,8 @@ def main():
             recording_idx = parse_command_and_index(command)
             if recording_idx is not None:
                 dev_portal_browser.download_recording(
-                    recording_idx, args.workspace_path)
+                    recording_idx, args.workspace_path,
+                    num_connections=args.download_connections)
         elif command.startswith("delete"):
             if command == "delete all":
                 for _ in range(len(dev_portal_browser.recording_names)):
@@ -648,6 +681,18 @@ def main():
                 else:
                     extract_recording(
                         os.path.join(args.workspace_path, recording_name))
+        elif command.startswith("previews"):
+            recording_idx = parse_command_and_index(command)
+            if recording_idx is not None:
+                try:
+                    recording_names = sorted(os.listdir(args.workspace_path))
+                    recording_name = recording_names[recording_idx]
+                except IndexError:
+                    print("=> Recording does not exist")
+                else:
+                    print("Writing preview contact sheets...")
+                    recording_previews.write_contact_sheets(
+                        os.path.join(args.workspace_path, recording_name))
         elif command.startswith("reconstruct"):
             if not args.colmap_path:
                 print("=> Cannot reconstruct, "
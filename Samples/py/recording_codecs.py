@@ -0,0 +1,223 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Estimates the size and speed of the image codecs of the recorder off device """
+# pylint: disable=C0103
+
+import argparse
+import glob
+import os
+import struct
+import sys
+import time
+import zlib
+
+import numpy as np
+
+# Image size and pixel layout of each sensor, as recorded: the VLC frames are Bgra8
+# bitmaps holding four gray pixels each, recorded as gray images four times as wide.
+SENSOR_IMAGE_SHAPES = {
+    "pv": (720, 1280, 3),
+    "short_throw_depth": (450, 448, 1),
+    "short_throw_reflectivity": (450, 448, 1),
+    "long_throw_depth": (450, 448, 1),
+    "long_throw_reflectivity": (450, 448, 1),
+    "vlc_lf": (480, 640, 1),
+}
+
+# The codec the Recorder app uses for each sensor, see Tools/Recorder/AppMain.cpp
+SENSOR_CODECS = {
+    "pv": "jpeg",
+    "short_throw_depth": "png",
+    "short_throw_reflectivity": "png",
+    "long_throw_depth": "png",
+    "long_throw_reflectivity": "png",
+    "vlc_lf": "png",
+}
+
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+
+
+def paeth_predictor(left, up, up_left):
+    left = left.astype(np.int16)
+    up = up.astype(np.int16)
+    up_left = up_left.astype(np.int16)
+    estimate = left + up - up_left
+    distance_left = np.abs(estimate - left)
+    distance_up = np.abs(estimate - up)
+    distance_up_left = np.abs(estimate - up_left)
+    return np.where((distance_left <= distance_up) & (distance_left <= distance_up_left),
+                    left, np.where(distance_up <= distance_up_left, up, up_left)
+                   ).astype(np.uint8)
+
+
+def filter_png_rows(rows, bytes_per_pixel):
+    """Applies the PNG filter to each row of bytes that minimizes the sum of its
+    absolute values, the heuristic of libpng, and prepends the filter types."""
+    left = np.zeros_like(rows)
+    left[:, bytes_per_pixel:] = rows[:, :-bytes_per_pixel]
+    up = np.zeros_like(rows)
+    up[1:] = rows[:-1]
+    up_left = np.zeros_like(rows)
+    up_left[1:] = left[:-1]
+
+    average = ((left.astype(np.uint16) + up) // 2).astype(np.uint8)
+    candidates = np.stack([
+        rows,
+        rows - left,
+        rows - up,
+        rows - average,
+        rows - paeth_predictor(left, up, up_left),
+    ])
+
+    costs = np.abs(candidates.view(np.int8).astype(np.int32)).sum(axis=2)
+    filter_types = np.argmin(costs, axis=0)
+    filtered = candidates[filter_types, np.arange(rows.shape[0])]
+
+    return np.hstack([filter_types.astype(np.uint8)[:, None], filtered])
+
+
+def png_chunk(chunk_type, data):
+    return struct.pack(">I", len(data)) + chunk_type + data + \
+        struct.pack(">I", zlib.crc32(chunk_type + data) & 0xffffffff)
+
+
+def encode_png(image, compression_level=6):
+    """Encodes a gray (8 or 16 bit) or RGB image as PNG."""
+    height, width = image.shape[:2]
+    channels = 1 if image.ndim == 2 else image.shape[2]
+    bit_depth = 8 * image.dtype.itemsize
+    color_type = 0 if channels == 1 else 2
+
+    # PNG stores 16-bit samples big endian.
+    samples = image.astype(">u2") if bit_depth == 16 else image
+    rows = np.ascontiguousarray(samples).view(np.uint8).reshape(height, -1)
+    filtered = filter_png_rows(rows, channels * image.dtype.itemsize)
+
+    header = struct.pack(">IIBBBBB", width, height, bit_depth, color_type, 0, 0, 0)
+    return PNG_SIGNATURE + png_chunk(b"IHDR", header) + \
+        png_chunk(b"IDAT", zlib.compress(filtered.tobytes(), compression_level)) + \
+        png_chunk(b"IEND", b"")
+
+
+def encode_netpbm(image):
+    """Encodes the image as the recorder's PGM/PPM files."""
+    height, width = image.shape[:2]
+    magic = "P5" if image.ndim == 2 else "P6"
+    maxval = 65535 if image.dtype == np.uint16 else 255
+    header = "{}\n{} {}\n{}\n".format(magic, width, height, maxval).encode("ascii")
+    # Gray16 pixels are recorded in the bitmap's (little endian) byte order.
+    return header + image.astype("<u2").tobytes() if maxval > 255 \
+        else header + image.tobytes()
+
+
+def encode_jpeg(image, quality):
+    """Encodes the image as JPEG with OpenCV, or returns None without it."""
+    try:
+        import cv2
+    except ImportError:
+        return None
+    _, data = cv2.imencode(".jpg", image, [cv2.IMWRITE_JPEG_QUALITY, quality])
+    return data.tobytes()
+
+
+def create_synthetic_image(name, shape, seed):
+    """A smooth scene with sensor noise, so that the codecs do not get it for free."""
+    random = np.random.RandomState(seed)
+    height, width, channels = shape
+    y, x = np.mgrid[0:height, 0:width].astype(np.float32)
+    phase = random.uniform(0, 2 * np.pi)
+    scene = np.sin(x / 37.0 + phase) * np.cos(y / 23.0) + 0.5 * np.sin((x + y) / 11.0)
+
+    if name.endswith("_depth"):
+        # Millimeters to a slanted surface, with pixels out of range set to zero.
+        depth = 1000 + 400 * scene + 2 * y + random.normal(0, 3, (height, width))
+        depth[scene > 1.2] = 0
+        return np.clip(depth, 0, 65535).astype(np.uint16)
+
+    gray = 128 + 60 * scene + random.normal(0, 2, (height, width))
+    if channels == 1:
+        return np.clip(gray, 0, 255).astype(np.uint8)
+    tint = np.array([1.0, 0.9, 0.8], dtype=np.float32)
+    return np.clip(gray[:, :, None] * tint, 0, 255).astype(np.uint8)
+
+
+def read_netpbm(path):
+    with open(path, "rb") as fid:
+        data = fid.read()
+    fields = data.split(maxsplit=4)
+    magic, width, height, maxval = fields[0], int(fields[1]), int(fields[2]), int(fields[3])
+    pixels = data[len(data) - width * height * (3 if magic == b"P6" else 1) *
+                  (2 if maxval > 255 else 1):]
+    if magic == b"P6":
+        return np.frombuffer(pixels, np.uint8).reshape(height, width, 3)
+    if maxval > 255:
+        return np.frombuffer(pixels, "<u2").reshape(height, width)
+    return np.frombuffer(pixels, np.uint8).reshape(height, width)
+
+
+def get_benchmark_images(recording_path, num_images):
+    """Yields (sensor name, images) from the recording's PGM/PPM files, or synthetic
+    images of every sensor without a recording."""
+    for name, shape in SENSOR_IMAGE_SHAPES.items():
+        if recording_path is None:
+            yield name, [create_synthetic_image(name, shape, seed)
+                         for seed in range(num_images)]
+            continue
+        paths = sorted(glob.glob(os.path.join(recording_path, name, "*.p[gp]m")))
+        if paths:
+            yield name, [read_netpbm(path) for path in paths[:num_images]]
+
+
+def benchmark_codecs(recording_path, num_images, jpeg_quality):
+    print("{:26s} {:6s} {:>8s} {:>8s} {:>10s}".format(
+        "sensor", "codec", "ratio", "MB/s", "ms/frame"))
+
+    for name, images in get_benchmark_images(recording_path, num_images):
+        raw_size = sum(len(encode_netpbm(image)) for image in images)
+
+        codecs = [("png", encode_png)]
+        if SENSOR_CODECS[name] == "jpeg":
+            # PV frames are encoded as BGR by OpenCV, as RGB by the recorder.
+            codecs.append(("jpeg", lambda image: encode_jpeg(image, jpeg_quality)))
+
+        for codec, encode in codecs:
+            start_time = time.perf_counter()
+            encoded = [encode(image) for image in images]
+            elapsed_time = time.perf_counter() - start_time
+            if any(data is None for data in encoded):
+                print("{:26s} {:6s} skipped, OpenCV is not installed".format(name, codec))
+                continue
+            print("{:26s} {:6s} {:8.2f} {:8.1f} {:10.2f}".format(
+                name, codec, raw_size / sum(map(len, encoded)),
+                raw_size / 1e6 / elapsed_time, 1000 * elapsed_time / len(images)))
+
+
+def main(argv):
+    """Recording codecs main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Report the compression ratio over the PGM/PPM files and "
+                             "the single threaded encoding throughput of each sensor")
+    parser.add_argument("--recording_path",
+                        help="Extracted recording with PGM/PPM files to use instead "
+                             "of synthetic images")
+    parser.add_argument("--benchmark_images", type=int, default=20)
+    parser.add_argument("--jpeg_quality", type=int, default=90)
+    args = parser.parse_args(argv)
+
+    if not args.benchmark:
+        parser.error("nothing to do, pass --benchmark")
+
+    benchmark_codecs(args.recording_path, args.benchmark_images, args.jpeg_quality)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,595 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Downloads recordings from the HoloLens Device Portal over parallel, resumable connections """
+# pylint: disable=C0103
+
+import argparse
+import hashlib
+import http.client
+import http.server
+import io
+import json
+import os
+import re
+import shutil
+import sys
+import tarfile
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from collections import namedtuple
+from concurrent.futures import ThreadPoolExecutor
+
+# Files larger than this are fetched as several ranges over parallel connections,
+# and a partial download resumes from the last completed range.
+DOWNLOAD_CHUNK_SIZE = 16 * 2**20
+
+# Bytes read from a response at a time
+DOWNLOAD_BLOCK_SIZE = 2**20
+
+# Attempts per range; each attempt continues where the previous one stopped
+DOWNLOAD_ATTEMPTS = 4
+
+# Suffixes of a partial download and of its list of completed ranges
+PARTIAL_SUFFIX = ".part"
+PARTIAL_STATE_SUFFIX = ".part.json"
+
+# Suffix of the index of the members of a downloaded tarball, see index_tar
+TAR_INDEX_SUFFIX = ".index"
+
+# Manifest of the finalized segments of a segmented recording, see
+# RecordingSegmentManifest.h. The segments of a sensor are <sensor>_<index>.tar and
+# .csv files; those not listed in the manifest yet are still being recorded.
+SEGMENT_MANIFEST = "segments.csv"
+SEGMENT_FILE_PATTERN = re.compile(r"^.+_\d{5}\.(tar|csv)$")
+
+# Device Portal file type of regular files
+FILE_TYPE = 32
+
+DownloadStatistics = namedtuple(
+    'DownloadStatistics',
+    'num_files num_skipped_files num_pending_files num_bytes num_resumed_bytes '
+    'elapsed_time')
+
+
+def get_files_url(url, package_full_name, recording_name):
+    return "{}/api/filesystem/apps/files?knownfolderid=" \
+        "LocalAppData&packagefullname={}&path=\\\\TempState\\{}".format(
+            url, package_full_name, recording_name)
+
+
+def get_file_url(url, package_full_name, recording_name, file_name):
+    return "{}/api/filesystem/apps/file?knownfolderid=LocalAppData&" \
+        "packagefullname={}&filename=\\\\TempState\\{}\\{}".format(
+            url, package_full_name, recording_name, file_name)
+
+
+def index_tar(tar_path):
+    """Verifies the header checksums of a tarball and writes <tar_path>.index, one
+    'name,offset,size' line per file, locating its data in the tarball without
+    scanning it again; see RecordedSensorStream in replay_server.py."""
+    index_path = tar_path + TAR_INDEX_SUFFIX
+    with tarfile.open(tar_path, 'r:') as tar, open(index_path + ".tmp", "w") as fid:
+        for member in tar:
+            if member.isfile():
+                fid.write("{},{},{}\n".format(
+                    member.name.replace('\\', '/').split('/')[-1],
+                    member.offset_data, member.size))
+    os.replace(index_path + ".tmp", index_path)
+
+
+def read_tar_index(tar_path):
+    """Returns {name: (offset, size)} from the index of a tarball, or None if it has
+    none or is older than the tarball."""
+    index_path = tar_path + TAR_INDEX_SUFFIX
+    if not os.path.exists(index_path) or \
+            os.path.getmtime(index_path) < os.path.getmtime(tar_path):
+        return None
+    members = {}
+    with open(index_path, "r") as fid:
+        for line in fid:
+            name, offset, size = line.strip().rsplit(',', 2)
+            members[name] = (int(offset), int(size))
+    return members
+
+
+def read_segment_manifest(recording_path):
+    """Returns the finalized segments listed in the manifest of a recording, as
+    {sensor name: [(tarball path, CSV path), ...]} in recording order, or None if the
+    recording is not segmented."""
+    manifest_path = os.path.join(recording_path, SEGMENT_MANIFEST)
+    if not os.path.exists(manifest_path):
+        return None
+    segments = {}
+    with open(manifest_path, "r") as fid:
+        fid.readline()
+        for line in fid:
+            elems = line.strip().split(",")
+            # The line of a segment being finalized may be incomplete.
+            if len(elems) != 8:
+                continue
+            segments.setdefault(elems[0], []).append((
+                int(elems[1]), os.path.join(recording_path, elems[2]),
+                os.path.join(recording_path, elems[3])))
+    return {name: [paths for _, *paths in sorted(sensor_segments)]
+            for name, sensor_segments in segments.items()}
+
+
+def get_sensor_segments(recording_path, sensor_name):
+    """Returns the (tarball path, CSV path) of each finalized segment of a sensor;
+    a recording that is not segmented has a single <sensor>.tar and .csv."""
+    segments = read_segment_manifest(recording_path)
+    if segments is None:
+        return [(os.path.join(recording_path, sensor_name + ".tar"),
+                 os.path.join(recording_path, sensor_name + ".csv"))]
+    return [tuple(paths) for paths in segments.get(sensor_name, [])]
+
+
+class PartialDownload(object):
+    """A file being downloaded into <path>.part, range by range. The completed
+    ranges are recorded in <path>.part.json, so that an interrupted download
+    resumes with the missing ones."""
+
+    def __init__(self, path, size, chunk_size):
+        self.path = path
+        self.size = size
+        self.chunk_size = chunk_size
+        self.num_chunks = max(1, (size + chunk_size - 1) // chunk_size)
+        self.lock = threading.Lock()
+        self.completed = set()
+
+        partial_path = path + PARTIAL_SUFFIX
+        state_path = path + PARTIAL_STATE_SUFFIX
+        if os.path.exists(partial_path) and os.path.exists(state_path):
+            with open(state_path, "r") as fid:
+                state = json.load(fid)
+            if state["size"] == size and state["chunk_size"] == chunk_size and \
+                    os.path.getsize(partial_path) == size:
+                self.completed = set(state["chunks"])
+
+        if not self.completed:
+            with open(partial_path, "wb") as fid:
+                fid.truncate(size)
+
+    def get_chunk_range(self, chunk):
+        begin = chunk * self.chunk_size
+        return begin, min(begin + self.chunk_size, self.size)
+
+    def get_missing_chunks(self):
+        return [chunk for chunk in range(self.num_chunks) if chunk not in self.completed]
+
+    def get_completed_bytes(self):
+        return sum(end - begin for begin, end in map(self.get_chunk_range, self.completed))
+
+    def complete_chunk(self, chunk):
+        """Records the chunk; returns True once all chunks are complete."""
+        with self.lock:
+            self.completed.add(chunk)
+            state_path = self.path + PARTIAL_STATE_SUFFIX
+            with open(state_path + ".tmp", "w") as fid:
+                json.dump({"size": self.size, "chunk_size": self.chunk_size,
+                           "chunks": sorted(self.completed)}, fid)
+            os.replace(state_path + ".tmp", state_path)
+            return len(self.completed) == self.num_chunks
+
+    def finish(self):
+        """Verifies the size of the download and moves it into place."""
+        partial_path = self.path + PARTIAL_SUFFIX
+        actual_size = os.path.getsize(partial_path)
+        if actual_size != self.size:
+            raise IOError("{}: downloaded {} of {} bytes".format(
+                self.path, actual_size, self.size))
+        if self.path.endswith(".tar"):
+            try:
+                index_tar(partial_path)
+            except tarfile.TarError:
+                os.remove(partial_path)
+                os.remove(self.path + PARTIAL_STATE_SUFFIX)
+                raise
+            os.replace(partial_path + TAR_INDEX_SUFFIX, self.path + TAR_INDEX_SUFFIX)
+        os.replace(partial_path, self.path)
+        os.remove(self.path + PARTIAL_STATE_SUFFIX)
+
+
+class RecordingDownloader(object):
+    """Downloads the files of recordings over up to num_connections concurrent
+    connections; files larger than chunk_size are split into HTTP ranges, which
+    also are the unit in which interrupted downloads resume. Uses the installed
+    urllib opener, i.e. the Device Portal credentials of DevicePortalBrowser."""
+
+    def __init__(self, url, package_full_name, num_connections=4,
+                 chunk_size=DOWNLOAD_CHUNK_SIZE):
+        self.url = url
+        self.package_full_name = package_full_name
+        self.num_connections = num_connections
+        self.chunk_size = chunk_size
+        self.supports_ranges = None
+        self.lock = threading.Lock()
+        self.num_bytes = 0
+
+    def list_files(self, recording_name):
+        """Returns the (name, size) of the files of a recording; the size is None if
+        the Device Portal does not report it."""
+        response = urllib.request.urlopen(get_files_url(
+            self.url, self.package_full_name, recording_name))
+        files = json.loads(response.read().decode())
+        return [(file["Id"], file.get("FileSize")) for file in files["Items"]
+                if file["Type"] == FILE_TYPE]
+
+    def probe_ranges(self, file_url):
+        request = urllib.request.Request(file_url, headers={"Range": "bytes=0-0"})
+        with urllib.request.urlopen(request) as response:
+            return response.status == 206
+
+    def fetch_range(self, file_url, path, begin, end):
+        """Writes bytes [begin, end) of the file to path at the same offset,
+        retrying from where an attempt stopped."""
+        offset = begin
+        for attempt in range(DOWNLOAD_ATTEMPTS):
+            try:
+                request = urllib.request.Request(
+                    file_url, headers={"Range": "bytes={}-{}".format(offset, end - 1)})
+                with urllib.request.urlopen(request) as response, \
+                        open(path, "r+b") as fid:
+                    if response.status != 206:
+                        raise IOError("{}: range requests not supported".format(file_url))
+                    fid.seek(offset)
+                    while offset < end:
+                        block = response.read(min(DOWNLOAD_BLOCK_SIZE, end - offset))
+                        if not block:
+                            break
+                        fid.write(block)
+                        offset += len(block)
+                        with self.lock:
+                            self.num_bytes += len(block)
+                if offset == end:
+                    return
+            except (urllib.error.URLError, http.client.HTTPException, ConnectionError):
+                if attempt + 1 == DOWNLOAD_ATTEMPTS:
+                    raise
+        raise IOError("{}: connection closed at byte {} of {}".format(
+            file_url, offset, end))
+
+    def fetch_file(self, file_url, path):
+        """Downloads a whole file in one request, for servers without ranges or
+        files of unknown size."""
+        with urllib.request.urlopen(file_url) as response, \
+                open(path + PARTIAL_SUFFIX, "wb") as fid:
+            while True:
+                block = response.read(DOWNLOAD_BLOCK_SIZE)
+                if not block:
+                    break
+                fid.write(block)
+                with self.lock:
+                    self.num_bytes += len(block)
+        if path.endswith(".tar"):
+            index_tar(path + PARTIAL_SUFFIX)
+            os.replace(path + PARTIAL_SUFFIX + TAR_INDEX_SUFFIX, path + TAR_INDEX_SUFFIX)
+        os.replace(path + PARTIAL_SUFFIX, path)
+
+    def download_recording(self, recording_name, recording_path):
+        """Downloads the missing or incomplete files of a recording into
+        recording_path; returns DownloadStatistics. Of a segmented recording, only
+        the segments finalized so far are downloaded, so that it can be downloaded
+        again, for the following segments, while the recording continues."""
+        start_time = time.perf_counter()
+        self.num_bytes = 0
+
+        files = self.list_files(recording_name)
+
+        # The manifest grows as segments are finalized, so it is always downloaded,
+        # to not download the segments that are still being written. The files are
+        # listed again after it, so that the sizes of the listed segments are final.
+        num_pending_files = 0
+        if any(file_name == SEGMENT_MANIFEST for file_name, _ in files):
+            self.fetch_file(
+                get_file_url(self.url, self.package_full_name, recording_name,
+                             SEGMENT_MANIFEST),
+                os.path.join(recording_path, SEGMENT_MANIFEST))
+            files = self.list_files(recording_name)
+            finalized_files = set()
+            for sensor_segments in read_segment_manifest(recording_path).values():
+                for paths in sensor_segments:
+                    finalized_files.update(os.path.basename(path) for path in paths)
+            num_pending_files = sum(
+                1 for file_name, _ in files
+                if SEGMENT_FILE_PATTERN.match(file_name) and
+                file_name not in finalized_files)
+            files = [(file_name, file_size) for file_name, file_size in files
+                     if file_name != SEGMENT_MANIFEST and
+                     (not SEGMENT_FILE_PATTERN.match(file_name) or
+                      file_name in finalized_files)]
+
+        downloads = []
+        num_skipped_files = 0
+        num_resumed_bytes = 0
+        whole_files = []
+        for file_name, file_size in files:
+            path = os.path.join(recording_path, file_name)
+            file_url = get_file_url(
+                self.url, self.package_full_name, recording_name, file_name)
+
+            if os.path.exists(path):
+                if file_size is None or os.path.getsize(path) == file_size:
+                    print("=> Skipping, already downloaded:", file_name)
+                    num_skipped_files += 1
+                    continue
+                print("=> Downloading again, size mismatch:", file_name)
+                os.remove(path)
+
+            if self.supports_ranges is None and file_size:
+                self.supports_ranges = self.probe_ranges(file_url)
+
+            if file_size is None or not self.supports_ranges:
+                print("=> Downloading:", file_name)
+                whole_files.append((file_url, path))
+                continue
+
+            download = PartialDownload(path, file_size, self.chunk_size)
+            if download.completed:
+                num_resumed_bytes += download.get_completed_bytes()
+                print("=> Resuming: {} ({} of {} bytes)".format(
+                    file_name, download.get_completed_bytes(), file_size))
+            else:
+                print("=> Downloading:", file_name)
+            downloads.append((file_url, download))
+
+        def fetch_chunk(file_url, download, chunk):
+            begin, end = download.get_chunk_range(chunk)
+            self.fetch_range(file_url, download.path + PARTIAL_SUFFIX, begin, end)
+            if download.complete_chunk(chunk):
+                download.finish()
+
+        # Ranges of large files interleave with small files on the connections, the
+        # first ranges of each file first, so that files complete early and in order.
+        with ThreadPoolExecutor(max_workers=self.num_connections) as executor:
+            futures = [executor.submit(self.fetch_file, file_url, path)
+                       for file_url, path in whole_files]
+            for file_url, download in downloads:
+                for chunk in download.get_missing_chunks():
+                    futures.append(executor.submit(fetch_chunk, file_url, download, chunk))
+            for future in futures:
+                future.result()
+
+        return DownloadStatistics(
+            len(files), num_skipped_files, num_pending_files, self.num_bytes,
+            num_resumed_bytes, time.perf_counter() - start_time)
+
+
+def print_statistics(statistics):
+    print("INFO: {} files ({} already downloaded, {} still being recorded), {:.1f} MB "
+          "in {:.3f}s ({:.1f} MB/s), {:.1f} MB resumed".format(
+              statistics.num_files, statistics.num_skipped_files,
+              statistics.num_pending_files,
+              statistics.num_bytes / 2**20, statistics.elapsed_time,
+              statistics.num_bytes / 2**20 / max(statistics.elapsed_time, 1e-6),
+              statistics.num_resumed_bytes / 2**20))
+
+
+class DevicePortalStandIn(object):
+    """Serves the files of a folder on the Device Portal endpoints the recorder
+    console uses, with HTTP ranges. Each connection is limited to
+    bytes_per_second, like a connection to the headset over Wi-Fi, and
+    interrupt_after drops all connections after some more bytes."""
+
+    def __init__(self, recordings_path, package_full_name, bytes_per_second=None,
+                 host="127.0.0.1", port=0):
+        self.recordings_path = recordings_path
+        self.package_full_name = package_full_name
+        self.bytes_per_second = bytes_per_second
+        self.fail_after_bytes = None
+        self.sent_bytes = 0
+        self.lock = threading.Lock()
+
+        stand_in = self
+
+        class Handler(http.server.BaseHTTPRequestHandler):
+            protocol_version = "HTTP/1.1"
+
+            def log_message(self, *args):
+                pass
+
+            def do_GET(self):
+                url = urllib.parse.urlparse(self.path)
+                query = urllib.parse.parse_qs(url.query)
+                if url.path == "/api/filesystem/apps/files":
+                    stand_in.send_listing(self, query["path"][0])
+                elif url.path == "/api/filesystem/apps/file":
+                    stand_in.send_file(self, query["filename"][0])
+                else:
+                    self.send_error(404)
+
+        self.server = http.server.ThreadingHTTPServer((host, port), Handler)
+        self.server.daemon_threads = True
+        self.url = "http://{}:{}".format(host, self.server.server_address[1])
+        self.thread = threading.Thread(target=self.server.serve_forever, daemon=True)
+        self.thread.start()
+
+    def interrupt_after(self, num_bytes):
+        """Drops the connections once num_bytes more are sent, or never if None."""
+        with self.lock:
+            self.fail_after_bytes = None if num_bytes is None else self.sent_bytes + num_bytes
+
+    def close(self):
+        self.server.shutdown()
+        self.server.server_close()
+
+    def get_local_path(self, device_path):
+        elems = [elem for elem in device_path.split("\\") if elem]
+        assert elems[0] == "TempState"
+        return os.path.join(self.recordings_path, *elems[1:])
+
+    def send_listing(self, handler, device_path):
+        path = self.get_local_path(device_path)
+        items = [{"Id": name, "Type": FILE_TYPE if os.path.isfile(os.path.join(path, name))
+                                      else 16,
+                  "FileSize": os.path.getsize(os.path.join(path, name))}
+                 for name in sorted(os.listdir(path))]
+        body = json.dumps({"Items": items}).encode()
+        handler.send_response(200)
+        handler.send_header("Content-Type", "application/json")
+        handler.send_header("Content-Length", str(len(body)))
+        handler.end_headers()
+        handler.wfile.write(body)
+
+    def send_file(self, handler, device_path):
+        path = self.get_local_path(device_path)
+        size = os.path.getsize(path)
+        begin, end = 0, size
+        range_header = handler.headers.get("Range")
+        if range_header:
+            first, last = range_header.split("=")[1].split("-")
+            begin, end = int(first), min(size, int(last) + 1)
+            handler.send_response(206)
+            handler.send_header("Content-Range", "bytes {}-{}/{}".format(begin, end - 1, size))
+        else:
+            handler.send_response(200)
+        handler.send_header("Content-Length", str(end - begin))
+        handler.end_headers()
+
+        start_time = time.perf_counter()
+        sent = 0
+        with open(path, "rb") as fid:
+            fid.seek(begin)
+            while sent < end - begin:
+                block = fid.read(min(256 * 2**10, end - begin - sent))
+                with self.lock:
+                    if self.fail_after_bytes is not None and \
+                            self.sent_bytes >= self.fail_after_bytes:
+                        handler.close_connection = True
+                        return
+                    self.sent_bytes += len(block)
+                handler.wfile.write(block)
+                sent += len(block)
+                if self.bytes_per_second:
+                    delay = start_time + sent / self.bytes_per_second - time.perf_counter()
+                    if delay > 0:
+                        time.sleep(delay)
+
+
+def create_synthetic_recording(recording_path, num_megabytes):
+    """Writes a tarball of num_megabytes of VLC-sized images and a CSV file."""
+    os.makedirs(recording_path)
+    image_size = 640 * 480
+    with tarfile.open(os.path.join(recording_path, "vlc_ll.tar"), "w") as tar:
+        for i in range(num_megabytes * 2**20 // image_size):
+            data = os.urandom(image_size)
+            info = tarfile.TarInfo("vlc_ll/{}.pgm".format(i))
+            info.size = len(data)
+            tar.addfile(info, fileobj=io.BytesIO(data))
+    with open(os.path.join(recording_path, "vlc_ll.csv"), "w") as fid:
+        fid.write("Timestamp,ImageFileName\n")
+        for i in range(1000):
+            fid.write("{},{}.pgm\n".format(i, i))
+
+
+def get_file_digests(path):
+    digests = {}
+    for name in sorted(os.listdir(path)):
+        with open(os.path.join(path, name), "rb") as fid:
+            digests[name] = hashlib.sha256(fid.read()).hexdigest()
+    return digests
+
+
+def run_benchmark(args):
+    package_full_name = "HoloLensForCV.Recorder_1.0.0.0_x86__0"
+    temporary_path = tempfile.mkdtemp()
+    try:
+        recordings_path = os.path.join(temporary_path, "device")
+        recording_name = "recording"
+        create_synthetic_recording(os.path.join(recordings_path, recording_name),
+                                   args.benchmark_megabytes)
+        expected_digests = get_file_digests(os.path.join(recordings_path, recording_name))
+
+        stand_in = DevicePortalStandIn(
+            recordings_path, package_full_name,
+            bytes_per_second=args.benchmark_connection_mbps * 2**20 / 8)
+        try:
+            # As DevicePortalBrowser.download_recording used to, one file at a time
+            sequential_path = os.path.join(temporary_path, "sequential")
+            os.makedirs(sequential_path)
+            start_time = time.perf_counter()
+            for file_name, _ in RecordingDownloader(
+                    stand_in.url, package_full_name).list_files(recording_name):
+                urllib.request.urlretrieve(
+                    get_file_url(stand_in.url, package_full_name, recording_name,
+                                 file_name),
+                    os.path.join(sequential_path, file_name))
+            print("INFO: sequential download in {:.3f}s".format(
+                time.perf_counter() - start_time))
+
+            parallel_path = os.path.join(temporary_path, "parallel")
+            os.makedirs(parallel_path)
+            downloader = RecordingDownloader(
+                stand_in.url, package_full_name, num_connections=args.num_connections,
+                chunk_size=args.chunk_megabytes * 2**20)
+
+            # Drops all connections after 60% of the data, then resumes.
+            stand_in.interrupt_after(args.benchmark_megabytes * 2**20 * 3 // 5)
+            try:
+                downloader.download_recording(recording_name, parallel_path)
+                print("ERROR: the interrupted download completed")
+            except (IOError, urllib.error.URLError, http.client.HTTPException,
+                    ConnectionError) as error:
+                print("INFO: download interrupted:", type(error).__name__)
+            stand_in.interrupt_after(None)
+
+            statistics = downloader.download_recording(recording_name, parallel_path)
+            print_statistics(statistics)
+
+            downloaded_digests = {
+                name: digest for name, digest in get_file_digests(parallel_path).items()
+                if not name.endswith(TAR_INDEX_SUFFIX)}
+            assert downloaded_digests == expected_digests, "downloaded files differ"
+            assert get_file_digests(sequential_path) == expected_digests
+
+            tar_path = os.path.join(parallel_path, "vlc_ll.tar")
+            members = read_tar_index(tar_path)
+            with tarfile.open(tar_path, "r:") as tar:
+                assert members == {
+                    member.name.split('/')[-1]: (member.offset_data, member.size)
+                    for member in tar if member.isfile()}
+            print("INFO: downloaded files and tar index verified")
+
+            statistics = downloader.download_recording(recording_name, parallel_path)
+            assert statistics.num_skipped_files == statistics.num_files
+        finally:
+            stand_in.close()
+    finally:
+        shutil.rmtree(temporary_path)
+
+
+def main(argv):
+    """Recording downloader main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num_connections", type=int, default=4)
+    parser.add_argument("--chunk_megabytes", type=int, default=DOWNLOAD_CHUNK_SIZE // 2**20)
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Download a synthetic recording from a local stand-in for "
+                             "the Device Portal, sequentially and in parallel, "
+                             "interrupting and resuming the parallel download")
+    parser.add_argument("--benchmark_megabytes", type=int, default=128)
+    parser.add_argument("--benchmark_connection_mbps", type=float, default=80,
+                        help="Throughput of each connection to the stand-in")
+    args = parser.parse_args(argv)
+
+    if not args.benchmark:
+        parser.error("nothing to do, pass --benchmark; recordings are downloaded "
+                     "with recorder_console.py")
+
+    run_benchmark(args)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
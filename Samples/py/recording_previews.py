@@ -0,0 +1,321 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Generates and reads the preview pyramids ("contact sheets") of a recording """
+# pylint: disable=C0103
+
+import argparse
+import mmap
+import os
+import shutil
+import struct
+import sys
+import tarfile
+import tempfile
+import time
+
+import numpy as np
+
+from sensor_receiver import SENSOR_STREAM_PORTS
+from recording_downloader import read_segment_manifest
+from replay_server import RecordedSensorStream, decode_image, parse_netpbm_header
+
+#
+# A contact sheet holds downscaled copies of every frame of one sensor, in
+# <sensor>_previews.bin next to the sensor's tarballs. All values are little endian:
+#
+#   header:     magic "HLCS", version, number of frames, number of levels, channels
+#               and bytes per channel, as six uint32
+#   levels:     scale, width, height (uint32) and file offset (uint64) of each level
+#   timestamps: one uint64 per frame, ascending
+#   tiles:      per level, page aligned, the previews of all frames back to back
+#
+# The preview of frame i at level l is thus found without reading anything but the
+# header. Color previews are BGRA, so that they can be shown as they are; gray and
+# depth previews keep the bytes per pixel of the sensor.
+#
+CONTACT_SHEET_SUFFIX = "_previews.bin"
+CONTACT_SHEET_MAGIC = b"HLCS"
+CONTACT_SHEET_VERSION = 1
+CONTACT_SHEET_HEADER_FORMAT = "<4sIIIII"
+CONTACT_SHEET_LEVEL_FORMAT = "<IIIQ"
+CONTACT_SHEET_ALIGNMENT = 4096
+
+# 1/4 and 1/16 of the width and height of the frames
+DEFAULT_PREVIEW_SCALES = (4, 16)
+
+
+def align(offset):
+    return (offset + CONTACT_SHEET_ALIGNMENT - 1) // \
+        CONTACT_SHEET_ALIGNMENT * CONTACT_SHEET_ALIGNMENT
+
+
+def get_frame_image(stream, index):
+    """Returns the frame as recorded: gray, 16-bit gray or RGB pixels, the latter
+    BGR for JPEG and PNG bitmaps. PGM/PPM bitmaps are not copied."""
+    frame = stream.frames[index]
+    data = stream.data[frame.segment]
+    if data[frame.offset:frame.offset + 1] != b"P":
+        return decode_image(data[frame.offset:frame.offset + frame.size])
+
+    magic, width, height, maxval, offset = parse_netpbm_header(data, frame.offset)
+    if magic == "P6":
+        return np.frombuffer(data, np.uint8, width * height * 3, offset).reshape(
+            height, width, 3)
+    # Gray16 pixels are recorded in the bitmap's (little endian) byte order.
+    if maxval > 255:
+        return np.frombuffer(data, "<u2", width * height, offset).reshape(height, width)
+    return np.frombuffer(data, np.uint8, width * height, offset).reshape(height, width)
+
+
+def to_bgra(image, is_rgb):
+    bgra = np.empty(image.shape[:2] + (4,), np.uint8)
+    bgra[:, :, :3] = image[:, :, ::-1] if is_rgb else image[:, :, :3]
+    bgra[:, :, 3] = 255
+    return bgra
+
+
+def downscale(image, factor):
+    """Averages blocks of factor x factor pixels, dropping partial blocks."""
+    height = image.shape[0] // factor
+    width = image.shape[1] // factor
+    rows = image[:height * factor, :width * factor].reshape(
+        (height, factor, width * factor) + image.shape[2:]).sum(axis=1, dtype=np.uint32)
+    sums = rows.reshape((height, width, factor) + image.shape[2:]).sum(axis=2)
+    return ((sums + factor * factor // 2) // (factor * factor)).astype(image.dtype)
+
+
+def write_contact_sheet(recording_path, name, scales=DEFAULT_PREVIEW_SCALES):
+    """Writes the contact sheet of the sensor and returns its number of frames."""
+    stream = RecordedSensorStream(recording_path, name)
+    # Images may be views of the stream's memory maps, which must go before them.
+    first_image = image = None
+    try:
+        if not stream.frames:
+            return 0
+
+        first_image = get_frame_image(stream, 0)
+        channels = 1 if first_image.ndim == 2 else 4
+        bytes_per_channel = first_image.dtype.itemsize
+
+        levels = []
+        offset = align(struct.calcsize(CONTACT_SHEET_HEADER_FORMAT) +
+                       len(scales) * struct.calcsize(CONTACT_SHEET_LEVEL_FORMAT) +
+                       len(stream.frames) * 8)
+        for scale in scales:
+            height = first_image.shape[0] // scale
+            width = first_image.shape[1] // scale
+            levels.append((scale, width, height, offset))
+            offset = align(offset + len(stream.frames) * width * height *
+                           channels * bytes_per_channel)
+
+        path = os.path.join(recording_path, name + CONTACT_SHEET_SUFFIX)
+        with open(path + ".tmp", "w+b") as fid:
+            fid.truncate(offset)
+            data = mmap.mmap(fid.fileno(), offset)
+
+            struct.pack_into(CONTACT_SHEET_HEADER_FORMAT, data, 0, CONTACT_SHEET_MAGIC,
+                             CONTACT_SHEET_VERSION, len(stream.frames), len(levels),
+                             channels, bytes_per_channel)
+            level_offset = struct.calcsize(CONTACT_SHEET_HEADER_FORMAT)
+            for level in levels:
+                struct.pack_into(CONTACT_SHEET_LEVEL_FORMAT, data, level_offset, *level)
+                level_offset += struct.calcsize(CONTACT_SHEET_LEVEL_FORMAT)
+            timestamps = np.frombuffer(data, "<u8", len(stream.frames), level_offset)
+            timestamps[:] = [frame.timestamp for frame in stream.frames]
+
+            tiles = [np.frombuffer(data, first_image.dtype,
+                                   len(stream.frames) * width * height * channels,
+                                   level_offset).reshape(
+                                       (len(stream.frames), height, width) +
+                                       ((channels,) if channels > 1 else ()))
+                     for _, width, height, level_offset in levels]
+
+            for index in range(len(stream.frames)):
+                stream.prefetch(index)
+                # Each level is downscaled from the previous one.
+                image = get_frame_image(stream, index)
+                is_rgb = data_is_netpbm(stream, index)
+                previous_scale = 1
+                for (scale, width, height, _), level_tiles in zip(levels, tiles):
+                    image = downscale(image, scale // previous_scale)
+                    level_tiles[index] = image[:height, :width] if channels == 1 else \
+                        to_bgra(image[:height, :width], is_rgb)
+                    previous_scale = scale
+
+            del timestamps, tiles, level_tiles
+            data.close()
+        os.replace(path + ".tmp", path)
+        return len(stream.frames)
+    finally:
+        first_image = image = None
+        stream.close()
+
+
+def data_is_netpbm(stream, index):
+    frame = stream.frames[index]
+    return stream.data[frame.segment][frame.offset:frame.offset + 1] == b"P"
+
+
+class ContactSheet(object):
+    """Memory maps a contact sheet; previews are returned without copies."""
+
+    def __init__(self, path):
+        self.file = open(path, "rb")
+        self.data = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, version, num_frames, num_levels, channels, bytes_per_channel = \
+            struct.unpack_from(CONTACT_SHEET_HEADER_FORMAT, self.data, 0)
+        if magic != CONTACT_SHEET_MAGIC or version != CONTACT_SHEET_VERSION:
+            raise ValueError("{} is not a contact sheet".format(path))
+        self.dtype = np.dtype("<u2" if bytes_per_channel == 2 else np.uint8)
+        self.channels = channels
+        offset = struct.calcsize(CONTACT_SHEET_HEADER_FORMAT)
+        self.levels = []
+        for _ in range(num_levels):
+            self.levels.append(
+                struct.unpack_from(CONTACT_SHEET_LEVEL_FORMAT, self.data, offset))
+            offset += struct.calcsize(CONTACT_SHEET_LEVEL_FORMAT)
+        self.timestamps = np.frombuffer(self.data, "<u8", num_frames, offset)
+
+    def close(self):
+        self.timestamps = None
+        self.data.close()
+        self.file.close()
+
+    def find_frame(self, timestamp):
+        """Returns the index of the last frame at or before the timestamp."""
+        return max(int(np.searchsorted(self.timestamps, timestamp, "right")) - 1, 0)
+
+    def get_preview(self, index, level):
+        _, width, height, offset = self.levels[level]
+        tile_size = width * height * self.channels
+        shape = (height, width) if self.channels == 1 else \
+            (height, width, self.channels)
+        return np.frombuffer(self.data, self.dtype, tile_size,
+                             offset + index * tile_size * self.dtype.itemsize).reshape(shape)
+
+
+def get_recorded_sensors(recording_path):
+    segments = read_segment_manifest(recording_path)
+    return [name for name in sorted(SENSOR_STREAM_PORTS.keys())
+            if (segments is None and
+                os.path.exists(os.path.join(recording_path, name + ".tar"))) or
+            (segments is not None and name in segments)]
+
+
+def write_contact_sheets(recording_path):
+    for name in get_recorded_sensors(recording_path):
+        start_time = time.perf_counter()
+        num_frames = write_contact_sheet(recording_path, name)
+        print("=> {}: {} previews in {:.2f}s".format(
+            name, num_frames, time.perf_counter() - start_time))
+
+
+def write_synthetic_recording(recording_path, num_frames):
+    """Writes PV (PPM) and VLC (PGM) frames of a HoloLens-sized recording."""
+    random = np.random.RandomState(0)
+    for name, magic, shape in (("pv", b"P6", (720, 1280, 3)),
+                               ("vlc_lf", b"P5", (480, 640))):
+        header = magic + "\n{} {}\n255\n".format(shape[1], shape[0]).encode("ascii")
+        pixels = random.randint(0, 256, shape, dtype=np.uint8).tobytes()
+        with tarfile.open(os.path.join(recording_path, name + ".tar"), "w") as tar, \
+                open(os.path.join(recording_path, name + ".csv"), "w") as fid:
+            fid.write("Timestamp,ImageFileName\n")
+            for i in range(num_frames):
+                bitmap_name = "{}/{:020d}.{}".format(
+                    name, 333333 * i, "ppm" if magic == b"P6" else "pgm")
+                info = tarfile.TarInfo(bitmap_name)
+                info.size = len(header) + len(pixels)
+                tar.addfile(info, _BytesReader(header + pixels))
+                fid.write("{},{}\n".format(333333 * i, bitmap_name))
+
+
+class _BytesReader(object):
+    def __init__(self, data):
+        self.data = memoryview(data)
+        self.offset = 0
+
+    def read(self, size=-1):
+        end = len(self.data) if size < 0 else self.offset + size
+        chunk = self.data[self.offset:end].tobytes()
+        self.offset += len(chunk)
+        return chunk
+
+
+def get_percentiles(latencies):
+    latencies = np.sort(latencies) * 1000
+    return latencies[len(latencies) // 2], latencies[int(len(latencies) * 0.99)]
+
+
+def benchmark(num_frames, num_fetches):
+    temporary_path = tempfile.mkdtemp()
+    try:
+        write_synthetic_recording(temporary_path, num_frames)
+        for name in get_recorded_sensors(temporary_path):
+            start_time = time.perf_counter()
+            write_contact_sheet(temporary_path, name)
+            elapsed_time = time.perf_counter() - start_time
+            path = os.path.join(temporary_path, name + CONTACT_SHEET_SUFFIX)
+            input_size = os.path.getsize(os.path.join(temporary_path, name + ".tar"))
+            print("INFO: {:6s} generated {} previews in {:.2f}s ({:.1f} frames/s, "
+                  "{:.1f} MB -> {:.1f} MB)".format(
+                      name, num_frames, elapsed_time, num_frames / elapsed_time,
+                      input_size / 2**20, os.path.getsize(path) / 2**20))
+
+            # Scrub to random frames, as the browser does.
+            indices = np.random.RandomState(1).randint(0, num_frames, num_fetches)
+            sheet = ContactSheet(path)
+            for level, (scale, width, height, _) in enumerate(sheet.levels):
+                latencies = []
+                for index in indices:
+                    start_time = time.perf_counter()
+                    np.array(sheet.get_preview(index, level))
+                    latencies.append(time.perf_counter() - start_time)
+                print("INFO: {:6s} 1/{:<2d} preview ({}x{}) fetch p50 {:.3f}ms, "
+                      "p99 {:.3f}ms".format(name, scale, width, height,
+                                            *get_percentiles(latencies)))
+            sheet.close()
+
+            stream = RecordedSensorStream(temporary_path, name)
+            latencies = []
+            for index in indices:
+                start_time = time.perf_counter()
+                np.array(get_frame_image(stream, index))
+                latencies.append(time.perf_counter() - start_time)
+            stream.close()
+            print("INFO: {:6s} full frame fetch p50 {:.3f}ms, p99 {:.3f}ms".format(
+                name, *get_percentiles(latencies)))
+    finally:
+        shutil.rmtree(temporary_path)
+
+
+def main(argv):
+    """Recording previews main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--recording_path",
+                        help="Write the contact sheets of the sensors of this "
+                             "downloaded recording")
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Time the generation of the contact sheets of a "
+                             "synthetic recording and the fetching of previews")
+    parser.add_argument("--benchmark_frames", type=int, default=300)
+    parser.add_argument("--benchmark_fetches", type=int, default=1000)
+    args = parser.parse_args(argv)
+
+    if args.recording_path:
+        write_contact_sheets(args.recording_path)
+    elif args.benchmark:
+        benchmark(args.benchmark_frames, args.benchmark_fetches)
+    else:
+        parser.error("nothing to do, pass --recording_path or --benchmark")
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
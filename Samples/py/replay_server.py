@@ -0,0 +1,430 @@
+"""
+ Copyright (c) Microsoft. All rights reserved.
+
+ This code is licensed under the MIT License (MIT).
+ THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+ ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+ IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+ PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+"""
+
+""" Replays a HoloLens recording over the sensor stream protocol """
+# pylint: disable=C0103
+
+import argparse
+import mmap
+import os
+import socket
+import struct
+import sys
+import tarfile
+import threading
+import time
+
+from sensor_receiver import (PIXEL_FORMAT_BGRA8, PIXEL_FORMAT_GRAY8, PIXEL_FORMAT_GRAY16,
+                             SENSOR_STREAM_COOKIE, SENSOR_STREAM_HEADER_FORMAT,
+                             SENSOR_STREAM_PORTS, SENSOR_STREAM_VERSION)
+from recording_downloader import get_sensor_segments, read_segment_manifest, \
+    read_tar_index
+
+# Frame types as sent by SensorFrameStreamer, see SensorType.h
+SENSOR_FRAME_TYPES = {
+    'pv': 0,
+    'short_throw_depth': 1,
+    'short_throw_reflectivity': 2,
+    'long_throw_depth': 3,
+    'long_throw_reflectivity': 4,
+    'vlc_ll': 5,
+    'vlc_lf': 6,
+    'vlc_rf': 7,
+    'vlc_rr': 8,
+}
+
+# Timestamps are in units of 100ns (Windows::Foundation::DateTime)
+TIMESTAMP_TICKS_PER_SECOND = 10000000
+
+# Number of frames ahead of the one being sent whose pages are requested from the OS
+PREFETCH_FRAMES = 8
+
+
+def parse_netpbm_header(data, offset):
+    """Returns (magic, width, height, maxval, payload offset) of a PGM/PPM file.
+
+    The recorder writes the header as "P5\\n<width> <height>\\n<maxval>\\n", see
+    SensorFrameRecorderSink.cpp.
+    """
+    fields = []
+    end = offset
+    while len(fields) < 4:
+        while data[end:end + 1].isspace():
+            end += 1
+        start = end
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[start:end])
+    magic = fields[0].decode('ascii')
+    return magic, int(fields[1]), int(fields[2]), int(fields[3]), end + 1
+
+
+def decode_image(data):
+    """Decodes a PNG or JPEG bitmap, see RecordingImageEncoder.cpp, keeping 16-bit
+    gray pixels. OpenCV is only needed to replay recordings with such bitmaps."""
+    import cv2
+    import numpy as np
+    return cv2.imdecode(np.frombuffer(data, np.uint8), cv2.IMREAD_UNCHANGED)
+
+
+class RecordedFrame(object):
+    """Location of one recorded bitmap inside one of the memory-mapped tarballs."""
+
+    __slots__ = ('timestamp', 'segment', 'offset', 'size')
+
+    def __init__(self, timestamp, segment, offset, size):
+        self.timestamp = timestamp
+        self.segment = segment
+        self.offset = offset
+        self.size = size
+
+
+class RecordedSensorStream(object):
+    """The frames of one sensor of a recording, read from <name>.tar and <name>.csv,
+    or from the tarball and CSV file of each segment of a segmented recording.
+
+    The tarballs are memory mapped; the frames are located once from their index, see
+    recording_downloader.py, or else from the tar headers, and their pages are
+    prefetched ahead of playback with madvise.
+    """
+
+    def __init__(self, recording_path, name):
+        self.name = name
+        self.frame_type = SENSOR_FRAME_TYPES[name]
+        self.frames = []
+        self.files = []
+        self.data = []
+
+        for tar_path, csv_path in get_sensor_segments(recording_path, name):
+            self.add_segment(tar_path, csv_path)
+
+        self.frames.sort(key=lambda frame: frame.timestamp)
+        self.prefetched = 0
+
+    def add_segment(self, tar_path, csv_path):
+        segment = len(self.data)
+        members = read_tar_index(tar_path)
+        if members is None:
+            members = {}
+            with tarfile.open(tar_path, 'r:') as tar:
+                for member in tar:
+                    if member.isfile():
+                        basename = member.name.replace('\\', '/').split('/')[-1]
+                        members[basename] = (member.offset_data, member.size)
+
+        if os.path.exists(csv_path):
+            with open(csv_path, 'r') as fid:
+                fid.readline()
+                for line in fid:
+                    elems = line.strip().split(',', 2)
+                    if len(elems) < 2:
+                        continue
+                    member = members.get(elems[1].replace('\\', '/').split('/')[-1])
+                    if member is not None:
+                        self.frames.append(
+                            RecordedFrame(int(elems[0]), segment, *member))
+        else:
+            # Bitmaps are named after their timestamps.
+            for basename, member in members.items():
+                self.frames.append(RecordedFrame(
+                    int(os.path.splitext(basename)[0]), segment, *member))
+
+        self.files.append(open(tar_path, 'rb'))
+        self.data.append(
+            mmap.mmap(self.files[-1].fileno(), 0, access=mmap.ACCESS_READ))
+
+    def close(self):
+        for data, file in zip(self.data, self.files):
+            data.close()
+            file.close()
+
+    def prefetch(self, index):
+        """Asks the OS to read the frames following index into the page cache."""
+        if not hasattr(mmap.mmap, 'madvise'):
+            return
+        end = min(index + PREFETCH_FRAMES, len(self.frames))
+        if self.prefetched >= end:
+            return
+        start = max(index, self.prefetched)
+        # The frames to prefetch may continue in the next segment.
+        while start < end:
+            first = self.frames[start]
+            last_index = start
+            while last_index + 1 < end and \
+                    self.frames[last_index + 1].segment == first.segment:
+                last_index += 1
+            last = self.frames[last_index]
+            begin = first.offset - first.offset % mmap.PAGESIZE
+            self.data[first.segment].madvise(
+                mmap.MADV_WILLNEED, begin, last.offset + last.size - begin)
+            start = last_index + 1
+        self.prefetched = end
+
+    def get_payload(self, index):
+        """Returns (width, height, pixel stride, pixel format, payload) as SensorFrameStreamer
+        sends them."""
+        frame = self.frames[index]
+        data = self.data[frame.segment]
+
+        if data[frame.offset:frame.offset + 1] != b'P':
+            return self.get_decoded_payload(
+                decode_image(data[frame.offset:frame.offset + frame.size]))
+
+        magic, width, height, maxval, offset = parse_netpbm_header(data, frame.offset)
+        payload = memoryview(data)[offset:frame.offset + frame.size]
+
+        if magic == 'P6':
+            # Photo video frames are recorded as RGB and streamed as BGRA.
+            num_pixels = width * height
+            bgra = bytearray(b'\xff') * (num_pixels * 4)
+            bgra[0::4] = payload[2::3]
+            bgra[1::4] = payload[1::3]
+            bgra[2::4] = payload[0::3]
+            return width, height, 4, PIXEL_FORMAT_BGRA8, bgra
+
+        if self.name.startswith('vlc'):
+            # Visible light camera frames are packed 8-bit pixels in a BGRA bitmap,
+            # which the recorder writes as a PGM four times as wide.
+            return width // 4, height, 4, PIXEL_FORMAT_BGRA8, payload
+
+        # Gray16 pixels are recorded in the bitmap's (little endian) byte order.
+        if maxval > 255:
+            return width, height, 2, PIXEL_FORMAT_GRAY16, payload
+        return width, height, 1, PIXEL_FORMAT_GRAY8, payload
+
+    def get_decoded_payload(self, image):
+        """Like get_payload, for a bitmap recorded as PNG or JPEG."""
+        height, width = image.shape[:2]
+
+        if image.ndim == 3:
+            # Photo video frames are decoded as BGR and streamed as BGRA.
+            if image.shape[2] == 3:
+                bgra = bytearray(b'\xff') * (width * height * 4)
+                flat = image.reshape(-1)
+                bgra[0::4] = flat[0::3].tobytes()
+                bgra[1::4] = flat[1::3].tobytes()
+                bgra[2::4] = flat[2::3].tobytes()
+                return width, height, 4, PIXEL_FORMAT_BGRA8, bgra
+            return width, height, 4, PIXEL_FORMAT_BGRA8, image.tobytes()
+
+        if self.name.startswith('vlc'):
+            return width // 4, height, 4, PIXEL_FORMAT_BGRA8, image.tobytes()
+
+        if image.dtype.itemsize == 2:
+            return width, height, 2, PIXEL_FORMAT_GRAY16, image.astype('<u2').tobytes()
+        return width, height, 1, PIXEL_FORMAT_GRAY8, image.tobytes()
+
+
+class ReplayClock(object):
+    """Maps recording timestamps to wall clock deadlines shared by all streams.
+
+    The clock starts when the first client connects, at the earliest timestamp of
+    the recording. A speed of 0 replays as fast as possible.
+    """
+
+    def __init__(self, first_timestamp, speed):
+        self.first_timestamp = first_timestamp
+        self.speed = speed
+        self.start_time = None
+        self.lock = threading.Lock()
+
+    def start(self):
+        with self.lock:
+            if self.start_time is None:
+                self.start_time = time.perf_counter()
+
+    def get_deadline(self, timestamp):
+        if self.speed <= 0:
+            return None
+        return self.start_time + \
+            (timestamp - self.first_timestamp) / (TIMESTAMP_TICKS_PER_SECOND * self.speed)
+
+
+class ReplayStatistics(object):
+    """Lateness of the frames sent by one stream relative to their deadlines."""
+
+    def __init__(self):
+        self.num_frames = 0
+        self.num_skipped = 0
+        self.num_bytes = 0
+        self.latenesses = []
+        self.start_time = None
+        self.end_time = None
+
+    def report(self, name):
+        if self.start_time is None:
+            print('INFO: {}: no client connected'.format(name))
+            return
+        elapsed = (self.end_time or time.perf_counter()) - self.start_time
+        message = '{}: sent {} frames ({} skipped) in {:.3f}s: {:.1f} frames/s, {:.1f} MB/s'.format(
+            name, self.num_frames, self.num_skipped, elapsed,
+            self.num_frames / max(elapsed, 1e-9), self.num_bytes / 1e6 / max(elapsed, 1e-9))
+        if self.latenesses:
+            latenesses = sorted(self.latenesses)
+            message += ', lateness mean {:.2f}ms, p50 {:.2f}ms, p95 {:.2f}ms, max {:.2f}ms'.format(
+                1000.0 * sum(latenesses) / len(latenesses),
+                1000.0 * latenesses[len(latenesses) // 2],
+                1000.0 * latenesses[min(len(latenesses) - 1, int(0.95 * len(latenesses)))],
+                1000.0 * latenesses[-1])
+        print('INFO: ' + message)
+
+
+class SensorStreamReplayServer(object):
+    """Serves one recorded sensor on its SensorFrameStreamer port.
+
+    Like the device, a client connecting late receives the frame that is due now
+    rather than a burst of the frames it missed; in as fast as possible mode every
+    frame is sent.
+    """
+
+    def __init__(self, stream, clock, host, port, loop=False):
+        self.stream = stream
+        self.clock = clock
+        self.loop = loop
+        self.statistics = ReplayStatistics()
+        self.server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.server_socket.bind((host, port))
+        self.server_socket.listen(1)
+        self.thread = threading.Thread(target=self.run)
+        self.thread.daemon = True
+
+    def run(self):
+        client, address = self.server_socket.accept()
+        client.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        print('INFO: {}: client {} connected'.format(self.stream.name, address[0]))
+        self.clock.start()
+        self.statistics.start_time = time.perf_counter()
+        try:
+            self.send_frames(client)
+        except (BrokenPipeError, ConnectionResetError):
+            print('INFO: {}: client disconnected'.format(self.stream.name))
+        finally:
+            self.statistics.end_time = time.perf_counter()
+            client.close()
+            self.server_socket.close()
+
+    def send_frames(self, client):
+        stream = self.stream
+        clock = self.clock
+        statistics = self.statistics
+        timestamp_offset = 0
+
+        while True:
+            for index in range(len(stream.frames)):
+                timestamp = stream.frames[index].timestamp + timestamp_offset
+                deadline = clock.get_deadline(timestamp)
+                now = time.perf_counter()
+
+                # Skip frames whose successor is already due, as a live stream would.
+                if deadline is not None and index + 1 < len(stream.frames) and \
+                        clock.get_deadline(stream.frames[index + 1].timestamp +
+                                           timestamp_offset) <= now:
+                    statistics.num_skipped += 1
+                    continue
+
+                stream.prefetch(index + 1)
+
+                # Prepare the frame before waiting, so that sending starts on time.
+                width, height, pixel_stride, pixel_format, payload = stream.get_payload(index)
+                header = struct.pack(SENSOR_STREAM_HEADER_FORMAT, SENSOR_STREAM_COOKIE,
+                                     SENSOR_STREAM_VERSION[0], SENSOR_STREAM_VERSION[1],
+                                     stream.frame_type, timestamp, width, height,
+                                     pixel_stride, width * pixel_stride, pixel_format)
+
+                if deadline is not None:
+                    now = time.perf_counter()
+                    if deadline > now:
+                        time.sleep(deadline - now)
+                    statistics.latenesses.append(time.perf_counter() - deadline)
+
+                client.sendall(header)
+                client.sendall(payload)
+                statistics.num_frames += 1
+                statistics.num_bytes += len(header) + len(payload)
+
+            if not self.loop or not stream.frames:
+                break
+
+            # Continue the timestamps past the end of the recording, one frame
+            # interval after its last frame.
+            duration = stream.frames[-1].timestamp - stream.frames[0].timestamp
+            interval = duration // max(len(stream.frames) - 1, 1)
+            timestamp_offset += duration + interval
+            stream.prefetched = 0
+
+
+def main(argv):
+    """Replay server main"""
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--recording_path", required=True,
+                        help="Folder containing the <sensor>.tar and <sensor>.csv "
+                             "files, or the segments listed in segments.csv")
+    parser.add_argument("-a", "--host", default="0.0.0.0",
+                        help="Address to listen on")
+    parser.add_argument("-s", "--sensors", nargs="+",
+                        choices=sorted(SENSOR_STREAM_PORTS.keys()),
+                        help="Sensors to replay, all recorded sensors by default")
+    parser.add_argument("--port_offset", type=int, default=0,
+                        help="Added to the SensorFrameStreamer ports")
+    parser.add_argument("--speed", type=float, default=1.0,
+                        help="Playback speed relative to the recording")
+    parser.add_argument("--as_fast_as_possible", action="store_true",
+                        help="Send every frame without waiting for its timestamp")
+    parser.add_argument("--loop", action="store_true",
+                        help="Restart from the first frame at the end of the recording")
+    args = parser.parse_args(argv)
+
+    segments = read_segment_manifest(args.recording_path)
+    names = args.sensors or [
+        name for name in sorted(SENSOR_STREAM_PORTS.keys())
+        if (segments is None and
+            os.path.exists(os.path.join(args.recording_path, name + '.tar'))) or
+        (segments is not None and name in segments)]
+    if not names:
+        print('ERROR: no sensor tarballs found in ' + args.recording_path)
+        return
+
+    streams = []
+    for name in names:
+        stream = RecordedSensorStream(args.recording_path, name)
+        print('INFO: {}: {} frames'.format(name, len(stream.frames)))
+        if stream.frames:
+            streams.append(stream)
+        else:
+            stream.close()
+
+    clock = ReplayClock(
+        min(stream.frames[0].timestamp for stream in streams),
+        0.0 if args.as_fast_as_possible else args.speed)
+
+    servers = []
+    for stream in streams:
+        port = SENSOR_STREAM_PORTS[stream.name] + args.port_offset
+        server = SensorStreamReplayServer(stream, clock, args.host, port, args.loop)
+        server.thread.start()
+        servers.append(server)
+        print('INFO: {}: listening on port {}'.format(stream.name, port))
+
+    try:
+        for server in servers:
+            while server.thread.is_alive():
+                server.thread.join(0.5)
+    except KeyboardInterrupt:
+        pass
+
+    for server in servers:
+        server.statistics.report(server.stream.name)
+    for stream in streams:
+        stream.close()
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
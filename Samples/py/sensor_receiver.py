@@ -11,15 +11,14 @@
 """ Sample code to access HoloLens Research mode sensor stream """
 # pylint: disable=C0103
 
-from __future__ import print_function
-
 import argparse
+import selectors
 import socket
-import sys
-import binascii
 import struct
+import sys
+import threading
+import time
 from collections import namedtuple
-import cv2
 import numpy as np
 
 PROCESS = True
@@ -28,83 +27,392 @@ PROCESS = True
 
 # Protocol Header Format
 # Cookie VersionMajor VersionMinor FrameType Timestamp ImageWidth
-# ImageHeight PixelStride RowStride
-SENSOR_STREAM_HEADER_FORMAT = "@IBBHqIIII"
+# ImageHeight PixelStride RowStride PixelFormat
+SENSOR_STREAM_HEADER_FORMAT = "@IBBHqIIIII"
+SENSOR_STREAM_HEADER_SIZE = struct.calcsize(SENSOR_STREAM_HEADER_FORMAT)
+
+SENSOR_STREAM_COOKIE = 0x484c524d
+SENSOR_STREAM_VERSION = (0x00, 0x02)
 
 SENSOR_FRAME_STREAM_HEADER = namedtuple(
     'SensorFrameStreamHeader',
-    'Cookie VersionMajor VersionMinor FrameType Timestamp ImageWidth ImageHeight PixelStride RowStride'
+    'Cookie VersionMajor VersionMinor FrameType Timestamp ImageWidth ImageHeight PixelStride RowStride '
+    'PixelFormat'
 )
 
-# Each port corresponds to a single stream type
+# PixelFormat values, see Windows.Graphics.Imaging.BitmapPixelFormat
+PIXEL_FORMAT_GRAY16 = 57
+PIXEL_FORMAT_GRAY8 = 62
+PIXEL_FORMAT_BGRA8 = 87
+PIXEL_FORMAT_NV12 = 103
+
+
+def get_payload_size(header):
+    """Number of image bytes following the header.
+
+    NV12 images are followed by their chroma plane, half as many rows again.
+    """
+    num_rows = header.ImageHeight
+    if header.PixelFormat == PIXEL_FORMAT_NV12:
+        num_rows += header.ImageHeight // 2
+    return num_rows * header.RowStride
+
+# Each port corresponds to a single stream type, see SensorFrameStreamer.cpp
 # Port for obtaining Photo Video Camera stream
 PV_STREAM_PORT = 23940
 
+SENSOR_STREAM_PORTS = {
+    'pv': PV_STREAM_PORT,
+    'short_throw_depth': 23941,
+    'short_throw_reflectivity': 23942,
+    'vlc_ll': 23943,
+    'vlc_lf': 23944,
+    'vlc_rf': 23945,
+    'vlc_rr': 23946,
+    'long_throw_depth': 23947,
+    'long_throw_reflectivity': 23948,
+}
+
+# Frame buffers are rounded up to this size, so that buffers of frames whose size
+# differs slightly (e.g. after a resolution change) can still be reused.
+FRAME_BUFFER_GRANULARITY = 4096
+
+
+class FrameBufferPool(object):
+    """Preallocated frame buffers, grouped by size.
+
+    Buffers are bytearrays that the sockets receive into directly; they go back to
+    the pool once the last reference to the frame using them is released.
+    """
+
+    def __init__(self, buffers_per_size=4):
+        self.buffers_per_size = buffers_per_size
+        self.free_buffers = {}
+        self.lock = threading.Lock()
+        self.num_allocations = 0
+        self.num_reuses = 0
+
+    def acquire(self, size):
+        """Returns a buffer of at least size bytes."""
+        size_class = -(-size // FRAME_BUFFER_GRANULARITY) * FRAME_BUFFER_GRANULARITY
+        with self.lock:
+            free_buffers = self.free_buffers.get(size_class)
+            if free_buffers:
+                self.num_reuses += 1
+                return free_buffers.pop()
+            self.num_allocations += 1
+        return bytearray(size_class)
+
+    def release(self, buffer):
+        """Returns a buffer to the pool, or drops it if enough are pooled."""
+        with self.lock:
+            free_buffers = self.free_buffers.setdefault(len(buffer), [])
+            if len(free_buffers) < self.buffers_per_size:
+                free_buffers.append(buffer)
+
+
+class SensorFrame(object):
+    """A received frame referencing a pooled buffer.
+
+    The image property is a NumPy view of the buffer, so no pixels are copied. Frames
+    are reference counted: consumers that keep a frame beyond the receive callback
+    call retain(), and every holder calls release() (or uses a with block) when done.
+    Views obtained from a frame must not be used after its last release.
+    """
+
+    def __init__(self, header, buffer, pool):
+        self.header = header
+        self.buffer = buffer
+        self.pool = pool
+        self.ref_count = 1
+
+    @property
+    def sensor_type(self):
+        return self.header.FrameType
+
+    @property
+    def timestamp(self):
+        return self.header.Timestamp
+
+    @property
+    def data(self):
+        """Payload as a memoryview of the frame buffer."""
+        return memoryview(self.buffer)[:get_payload_size(self.header)]
+
+    @property
+    def image(self):
+        """Payload as a NumPy array: HxW uint16 for Gray16 frames, HxWxC uint8 otherwise.
+
+        NV12 frames are (H * 3 / 2)xW uint8, as cv2.COLOR_YUV2BGR_NV12 expects; the first
+        H rows are the luma plane, i.e. the gray image.
+        """
+        header = self.header
+        if header.PixelFormat == PIXEL_FORMAT_NV12:
+            num_rows = header.ImageHeight + header.ImageHeight // 2
+            return np.frombuffer(self.buffer, dtype=np.uint8,
+                                 count=num_rows * header.RowStride).reshape(
+                                     (num_rows, header.RowStride))[:, :header.ImageWidth]
+        if header.PixelStride == 2:
+            return np.frombuffer(self.buffer, dtype=np.uint16,
+                                 count=header.ImageHeight * header.RowStride // 2).reshape(
+                                     (header.ImageHeight, header.RowStride // 2))[:, :header.ImageWidth]
+        image = np.frombuffer(self.buffer, dtype=np.uint8,
+                              count=header.ImageHeight * header.RowStride).reshape(
+                                  (header.ImageHeight, header.RowStride))
+        image = image[:, :header.ImageWidth * header.PixelStride]
+        if header.PixelStride == 1:
+            return image
+        return image.reshape((header.ImageHeight, header.ImageWidth, header.PixelStride))
+
+    def retain(self):
+        self.ref_count += 1
+        return self
+
+    def release(self):
+        self.ref_count -= 1
+        if self.ref_count == 0:
+            self.pool.release(self.buffer)
+            self.buffer = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.release()
+
+
+class SensorStreamConnection(object):
+    """Receives the frames of a single sensor stream without blocking.
+
+    Headers and payloads are read with recv_into into preallocated memory, so that a
+    frame is never assembled by concatenating chunks.
+    """
+
+    def __init__(self, name, sock, pool):
+        self.name = name
+        self.sock = sock
+        self.pool = pool
+        self.header_buffer = bytearray(SENSOR_STREAM_HEADER_SIZE)
+        self.header = None
+        self.buffer = None
+        self.view = memoryview(self.header_buffer)
+        self.offset = 0
+        self.closed = False
+
+    def fileno(self):
+        return self.sock.fileno()
+
+    def receive(self):
+        """Reads what is available; returns the completed frame, if any.
+
+        At most one frame is completed per call, so that its buffer can be released
+        before the next one is needed; the selector reports the socket as readable
+        again while more data is pending.
+        """
+        while True:
+            try:
+                num_bytes = self.sock.recv_into(self.view[self.offset:])
+            except BlockingIOError:
+                return None
+            except InterruptedError:
+                continue
+            if num_bytes == 0:
+                self.closed = True
+                return None
+            self.offset += num_bytes
+            if self.offset < len(self.view):
+                continue
+            if self.header is None:
+                self.start_payload()
+            else:
+                frame = SensorFrame(self.header, self.buffer, self.pool)
+                self.header = None
+                self.buffer = None
+                self.view = memoryview(self.header_buffer)
+                self.offset = 0
+                return frame
+
+    def start_payload(self):
+        header = SENSOR_FRAME_STREAM_HEADER(
+            *struct.unpack(SENSOR_STREAM_HEADER_FORMAT, self.header_buffer))
+        if header.Cookie != SENSOR_STREAM_COOKIE or \
+                (header.VersionMajor, header.VersionMinor) != SENSOR_STREAM_VERSION:
+            raise ValueError("{}: unexpected cookie/version 0x{:08x}/{}.{}".format(
+                self.name, header.Cookie, header.VersionMajor, header.VersionMinor))
+        payload_size = get_payload_size(header)
+        self.header = header
+        self.buffer = self.pool.acquire(payload_size)
+        self.view = memoryview(self.buffer)[:payload_size]
+        self.offset = 0
+
+
+class SensorStreamReceiver(object):
+    """Receives any number of sensor streams on one selector (epoll on Linux)."""
+
+    def __init__(self, pool=None):
+        self.pool = pool or FrameBufferPool()
+        self.selector = selectors.DefaultSelector()
+        self.connections = []
+
+    def connect(self, host, name, port):
+        sock = socket.create_connection((host, port))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.setblocking(False)
+        connection = SensorStreamConnection(name, sock, self.pool)
+        self.selector.register(sock, selectors.EVENT_READ, connection)
+        self.connections.append(connection)
+        print('INFO: Socket Connected to ' + host + ' on port ' + str(port) + ' (' + name + ')')
+
+    def poll(self, timeout=None):
+        """Waits for data on any stream; returns (connection name, frame) pairs.
+
+        Streams closed by the sender are dropped from the receiver.
+        """
+        frames = []
+        for key, _ in self.selector.select(timeout):
+            connection = key.data
+            frame = connection.receive()
+            if frame is not None:
+                frames.append((connection.name, frame))
+            if connection.closed:
+                print('INFO: ' + connection.name + ': connection closed')
+                self.selector.unregister(connection.sock)
+                connection.sock.close()
+                self.connections.remove(connection)
+        return frames
+
+    def close(self):
+        for connection in self.connections:
+            self.selector.unregister(connection.sock)
+            connection.sock.close()
+        self.connections = []
+        self.selector.close()
+
+
+def serve_synthetic_frames(server_socket, num_frames, width, height, pixel_stride, pixel_format):
+    """Sends num_frames frames of a fixed pattern to the first client to connect."""
+    client, _ = server_socket.accept()
+    frame_header = SENSOR_FRAME_STREAM_HEADER(
+        SENSOR_STREAM_COOKIE, SENSOR_STREAM_VERSION[0], SENSOR_STREAM_VERSION[1], 0, 0,
+        width, height, pixel_stride, width * pixel_stride, pixel_format)
+    payload = bytes(bytearray(i & 0xFF for i in range(get_payload_size(frame_header))))
+    try:
+        for i in range(num_frames):
+            header = struct.pack(SENSOR_STREAM_HEADER_FORMAT,
+                                 *frame_header._replace(Timestamp=i))
+            client.sendall(header)
+            client.sendall(payload)
+    finally:
+        client.close()
+
+
+def run_loopback_benchmark(num_streams, num_frames, width, height, pixel_stride,
+                           pixel_format=PIXEL_FORMAT_BGRA8):
+    """Measures frames/s and CPU time per frame against local synthetic streams."""
+    threads = []
+    receiver = SensorStreamReceiver()
+    for i in range(num_streams):
+        server_socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        server_socket.bind(('127.0.0.1', 0))
+        server_socket.listen(1)
+        thread = threading.Thread(target=serve_synthetic_frames,
+                                  args=(server_socket, num_frames, width, height, pixel_stride,
+                                        pixel_format))
+        thread.daemon = True
+        thread.start()
+        threads.append((thread, server_socket))
+        receiver.connect('127.0.0.1', 'synthetic{}'.format(i),
+                         server_socket.getsockname()[1])
+
+    num_received = 0
+    wall_start = time.perf_counter()
+    cpu_start = time.process_time()
+    while receiver.connections:
+        for _, frame in receiver.poll(1.0):
+            frame.release()
+            num_received += 1
+    wall_time = time.perf_counter() - wall_start
+    cpu_time = time.process_time() - cpu_start
+
+    receiver.close()
+    for thread, server_socket in threads:
+        thread.join()
+        server_socket.close()
+
+    # The sender threads run in this process too, so CPU time is an upper bound.
+    payload_size = get_payload_size(SENSOR_FRAME_STREAM_HEADER(
+        0, 0, 0, 0, 0, width, height, pixel_stride, width * pixel_stride, pixel_format))
+    megabytes = num_received * payload_size / 1e6
+    print('INFO: received {} frames of {}x{} ({} bytes) in {:.3f}s: {:.1f} frames/s, {:.1f} MB/s, '
+          '{:.3f}ms CPU per frame, {} buffer allocations, {} reuses'.format(
+              num_received, width, height, payload_size, wall_time,
+              num_received / wall_time, megabytes / wall_time,
+              1000.0 * cpu_time / max(num_received, 1),
+              receiver.pool.num_allocations, receiver.pool.num_reuses))
+
 
 def main(argv):
     """Receiver main"""
     parser = argparse.ArgumentParser()
-    required_named_group = parser.add_argument_group('named arguments')
-
-    required_named_group.add_argument("-a", "--host",
-                                      help="Host address to connect", required=True)
+    parser.add_argument("-a", "--host",
+                        help="Host address to connect")
+    parser.add_argument("-s", "--sensors", nargs="+", default=["pv"],
+                        choices=sorted(SENSOR_STREAM_PORTS.keys()),
+                        help="Sensor streams to receive")
+    parser.add_argument("--benchmark", action="store_true",
+                        help="Receive synthetic frames over loopback and report throughput")
+    parser.add_argument("--benchmark_streams", type=int, default=1)
+    parser.add_argument("--benchmark_frames", type=int, default=300)
+    parser.add_argument("--benchmark_nv12", action="store_true",
+                        help="Benchmark NV12 instead of BGRA photo video frames")
     args = parser.parse_args(argv)
 
-    # Create a TCP Stream socket
-    try:
-        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-    except (socket.error, msg):
-        print("ERROR: Failed to create socket. Code: " + str(msg[0]) + ', Message: ' + msg[1])
-        sys.exit()
+    if args.benchmark:
+        if args.benchmark_nv12:
+            run_loopback_benchmark(args.benchmark_streams, args.benchmark_frames,
+                                   1280, 720, 1, PIXEL_FORMAT_NV12)
+        else:
+            run_loopback_benchmark(args.benchmark_streams, args.benchmark_frames,
+                                   1280, 720, 4)
+        return
 
-    print('INFO: socket created')
+    if args.host is None:
+        parser.error("the following arguments are required: -a/--host")
 
-    # Try connecting to the address
-    s.connect((args.host, PV_STREAM_PORT))
+    import cv2
 
-    print('INFO: Socket Connected to ' + args.host + ' on port ' + str(PV_STREAM_PORT))
+    receiver = SensorStreamReceiver()
+    for name in args.sensors:
+        receiver.connect(args.host, name, SENSOR_STREAM_PORTS[name])
 
-    # Try receive data
     try:
-        quit = False
-        while not quit:
-            reply = s.recv(struct.calcsize(SENSOR_STREAM_HEADER_FORMAT))
-            if not reply:
-                print('ERROR: Failed to receive data')
-                sys.exit()
-
-            data = struct.unpack(SENSOR_STREAM_HEADER_FORMAT, reply)
-
-            # Parse the header
-            header = SENSOR_FRAME_STREAM_HEADER(*data)
-
-            # read the image in chunks
-            image_size_bytes = header.ImageHeight * header.RowStride
-            image_data = ''
-
-            while len(image_data) < image_size_bytes:
-                remaining_bytes = image_size_bytes - len(image_data)
-                image_data_chunk = s.recv(remaining_bytes)
-                if not image_data_chunk:
-                    print('ERROR: Failed to receive image data')
-                    sys.exit()
-                image_data += image_data_chunk
-
-            image_array = np.frombuffer(image_data, dtype=np.uint8).reshape((header.ImageHeight,
-                                        header.ImageWidth, header.PixelStride))
-            if PROCESS:
-                # process image
-                gray = cv2.cvtColor(image_array,cv2.COLOR_BGR2GRAY)
-                image_array = cv2.Canny(gray,50,150,apertureSize = 3)
-
-            cv2.imshow('Photo Video Camera Stream', image_array)
+        while receiver.connections:
+            for name, frame in receiver.poll(0.1):
+                with frame:
+                    image_array = frame.image
+                    if name.startswith('vlc'):
+                        # Visible light camera frames are packed 8-bit pixels.
+                        image_array = image_array.reshape((frame.header.ImageHeight, -1))
+                    elif PROCESS and name == 'pv':
+                        # process image
+                        if frame.header.PixelFormat == PIXEL_FORMAT_NV12:
+                            gray = image_array[:frame.header.ImageHeight]
+                        else:
+                            gray = cv2.cvtColor(image_array, cv2.COLOR_BGRA2GRAY)
+                        image_array = cv2.Canny(gray, 50, 150, apertureSize=3)
+                    elif image_array.dtype == np.uint16:
+                        image_array = cv2.convertScaleAbs(image_array, alpha=255.0 / 4000.0)
+
+                    cv2.imshow(name, image_array)
 
             if cv2.waitKey(1) & 0xFF == ord('q'):
                 break
     except KeyboardInterrupt:
         pass
+    except ValueError as error:
+        print('ERROR: ' + str(error))
 
-    s.close()
+    receiver.close()
     cv2.destroyAllWindows()
 
 
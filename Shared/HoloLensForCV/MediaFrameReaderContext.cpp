@@ -16,24 +16,19 @@ namespace HoloLensForCV
     MediaFrameReaderContext::MediaFrameReaderContext(
         _In_ SensorType sensorType,
         _In_ SpatialPerception^ spatialPerception,
-        _In_opt_ ISensorFrameSink^ sensorFrameSink)
+        _In_opt_ ISensorFrameSink^ sensorFrameSink,
+        _In_ SensorFrameMailbox^ sensorFrameMailbox)
         : _sensorType(sensorType)
         , _spatialPerception(spatialPerception)
         , _sensorFrameSink(sensorFrameSink)
+        , _sensorFrameMailbox(sensorFrameMailbox)
     {
+        REQUIRES(nullptr != _sensorFrameMailbox);
     }
 
     SensorFrame^ MediaFrameReaderContext::GetLatestSensorFrame()
     {
-        SensorFrame^ latestSensorFrame;
-
-        {
-            std::lock_guard<std::mutex> latestSensorFrameMutexLockGuard(
-                _latestSensorFrameMutex);
-            latestSensorFrame = _latestSensorFrame;
-        }
-
-        return latestSensorFrame;
+        return _sensorFrameMailbox->GetLatestFrame();
     }
 
     void MediaFrameReaderContext::FrameArrived(
@@ -305,17 +300,17 @@ namespace HoloLensForCV
                 frame->VideoMediaFrame->CameraIntrinsics;
         }
 
+        //
+        // Publish the frame to the app before handing it to the sink, which may block
+        // on I/O (e.g. the recorder).
+        //
+        _sensorFrameMailbox->Send(
+            sensorFrame);
+
         if (nullptr != _sensorFrameSink)
         {
             _sensorFrameSink->Send(
                 sensorFrame);
         }
-
-        {
-            std::lock_guard<std::mutex> latestSensorFrameMutexLockGuard(
-                _latestSensorFrameMutex);
-
-            _latestSensorFrame = sensorFrame;
-        }
     }
 }
@@ -23,7 +23,8 @@ namespace HoloLensForCV
         MediaFrameReaderContext(
             _In_ SensorType sensorType,
             _In_ SpatialPerception^ spatialPerception,
-            _In_opt_ ISensorFrameSink^ sensorFrameSink);
+            _In_opt_ ISensorFrameSink^ sensorFrameSink,
+            _In_ SensorFrameMailbox^ sensorFrameMailbox);
 
         SensorFrame^ GetLatestSensorFrame();
 
@@ -41,7 +42,6 @@ namespace HoloLensForCV
 
         Io::TimeConverter _timeConverter;
 
-        std::mutex _latestSensorFrameMutex;
-        SensorFrame^ _latestSensorFrame;
+        SensorFrameMailbox^ _sensorFrameMailbox;
     };
 }
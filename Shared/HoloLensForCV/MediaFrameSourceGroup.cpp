@@ -22,8 +22,15 @@ namespace HoloLensForCV
         _In_opt_ ISensorFrameSinkGroup^ optionalSensorFrameSinkGroup)
         : _mediaFrameSourceGroupType(mediaFrameSourceGroupType)
         , _spatialPerception(spatialPerception)
+        , _photoVideoPixelFormat(Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8)
         , _optionalSensorFrameSinkGroup(optionalSensorFrameSinkGroup)
     {
+        for (size_t i = 0; i < _sensorFrameMailboxes.size(); ++i)
+        {
+            _sensorFrameMailboxes[i] =
+                ref new SensorFrameMailbox(
+                    (SensorType)i);
+        }
     }
 
     void MediaFrameSourceGroup::EnableAll()
@@ -63,6 +70,21 @@ namespace HoloLensForCV
             true;
     }
 
+    Windows::Graphics::Imaging::BitmapPixelFormat MediaFrameSourceGroup::PhotoVideoPixelFormat::get()
+    {
+        return _photoVideoPixelFormat;
+    }
+
+    void MediaFrameSourceGroup::PhotoVideoPixelFormat::set(
+        Windows::Graphics::Imaging::BitmapPixelFormat value)
+    {
+        REQUIRES(
+            Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8 == value ||
+            Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == value);
+
+        _photoVideoPixelFormat = value;
+    }
+
     bool MediaFrameSourceGroup::IsEnabled(
         _In_ SensorType sensorType) const
     {
@@ -112,6 +134,19 @@ namespace HoloLensForCV
         return _frameReaders[sensorTypeAsIndex]->GetLatestSensorFrame();
     }
 
+    SensorFrameMailbox^ MediaFrameSourceGroup::GetSensorFrameMailbox(
+        SensorType sensorType)
+    {
+        const int32_t sensorTypeAsIndex =
+            (int32_t)sensorType;
+
+        REQUIRES(
+            0 <= sensorTypeAsIndex &&
+            sensorTypeAsIndex < (int32_t)_sensorFrameMailboxes.size());
+
+        return _sensorFrameMailboxes[sensorTypeAsIndex];
+    }
+
     Concurrency::task<void> MediaFrameSourceGroup::InitializeMediaSourceWorkerAsync()
     {
         return CleanupMediaCaptureAsync()
@@ -309,7 +344,8 @@ namespace HoloLensForCV
                                 ref new MediaFrameReaderContext(
                                     sensorType,
                                     _spatialPerception,
-                                    optionalSensorFrameSink);
+                                    optionalSensorFrameSink,
+                                    _sensorFrameMailboxes[(int32_t)sensorType]);
 
                             _frameReaders[(int32_t)sensorType] =
                                 frameReaderContext;
@@ -505,9 +541,12 @@ namespace HoloLensForCV
 #endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
 
             //
-            // For color sources, we accept anything and request that it be converted to Bgra8.
+            // For color sources, we accept anything and request that it be converted to Bgra8,
+            // unless NV12 frames were asked for.
             //
-            return Windows::Media::MediaProperties::MediaEncodingSubtypes::Bgra8;
+            return Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == _photoVideoPixelFormat
+                ? Windows::Media::MediaProperties::MediaEncodingSubtypes::Nv12
+                : Windows::Media::MediaProperties::MediaEncodingSubtypes::Bgra8;
 
 #if ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS
         case Windows::Media::Capture::Frames::MediaFrameSourceKind::Depth:
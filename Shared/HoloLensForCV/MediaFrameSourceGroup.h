@@ -29,6 +29,17 @@ namespace HoloLensForCV
         void Enable(
             _In_ SensorType sensorType);
 
+        /// <summary>
+        /// The pixel format of PhotoVideo frames: Bgra8 (the default) or Nv12, the native
+        /// format of the camera, which saves the color conversion and moves 1.5 instead
+        /// of 4 bytes per pixel through the rest of the pipeline. Set before StartAsync.
+        /// </summary>
+        property Windows::Graphics::Imaging::BitmapPixelFormat PhotoVideoPixelFormat
+        {
+            Windows::Graphics::Imaging::BitmapPixelFormat get();
+            void set(Windows::Graphics::Imaging::BitmapPixelFormat value);
+        }
+
         Windows::Foundation::IAsyncAction^ StartAsync();
 
 		    Windows::Foundation::IAsyncAction^ StopAsync();
@@ -36,6 +47,13 @@ namespace HoloLensForCV
         SensorFrame^ GetLatestSensorFrame(
             SensorType sensorType);
 
+        /// <summary>
+        /// Returns the mailbox the frames of the sensor are published to, which can be
+        /// waited on or subscribed to before the group is started.
+        /// </summary>
+        SensorFrameMailbox^ GetSensorFrameMailbox(
+            SensorType sensorType);
+
     private:
         /// <summary>
         /// Returns true if the sensor was explicitly enabled by the user.
@@ -79,12 +97,15 @@ namespace HoloLensForCV
         MediaFrameSourceGroupType _mediaFrameSourceGroupType;
         SpatialPerception^ _spatialPerception;
 
+        Windows::Graphics::Imaging::BitmapPixelFormat _photoVideoPixelFormat;
+
         Platform::Agile<Windows::Media::Capture::MediaCapture> _mediaCapture;
 
         std::vector<std::pair<Windows::Media::Capture::Frames::MediaFrameReader^, Windows::Foundation::EventRegistrationToken>> _frameEventRegistrations;
 
         std::array<bool, (size_t)SensorType::NumberOfSensorTypes> _enabledFrameReaders;
         std::array<MediaFrameReaderContext^, (size_t)SensorType::NumberOfSensorTypes> _frameReaders;
+        std::array<SensorFrameMailbox^, (size_t)SensorType::NumberOfSensorTypes> _sensorFrameMailboxes;
 
         ISensorFrameSinkGroup^ _optionalSensorFrameSinkGroup;
     };
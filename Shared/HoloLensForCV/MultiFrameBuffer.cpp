@@ -13,6 +13,11 @@
 
 namespace HoloLensForCV
 {
+    namespace
+    {
+        const size_t c_maximumNumberOfFramesPerSensor = 5;
+    }
+
     static double TimeDeltaAMinusB(
         Windows::Foundation::DateTime a,
         Windows::Foundation::DateTime b)
@@ -22,6 +27,22 @@ namespace HoloLensForCV
         return timeDiff100ns * 1e-7;
     }
 
+    static Windows::Foundation::DateTime GetTimestamp(
+        const BufferedSensorFrame& bufferedSensorFrame)
+    {
+        Windows::Foundation::DateTime timestamp;
+
+        timestamp.UniversalTime =
+            bufferedSensorFrame.sensorFrameData.timestamp;
+
+        return timestamp;
+    }
+
+    MultiFrameBuffer::MultiFrameBuffer()
+        : _pixelBufferPool(Io::PixelBufferPool::Create(c_maximumNumberOfFramesPerSensor))
+    {
+    }
+
     ISensorFrameSink^ MultiFrameBuffer::GetSensorFrameSink(
         _In_ SensorType /* sensorType */)
     {
@@ -31,13 +52,19 @@ namespace HoloLensForCV
     void MultiFrameBuffer::Send(
         SensorFrame^ sensorFrame)
     {
+        BufferedSensorFrame bufferedSensorFrame;
+
+        sensorFrame->ToSensorFrameData(
+            *_pixelBufferPool,
+            bufferedSensorFrame.sensorFrameData);
+
         std::lock_guard<std::mutex> lock(_framesMutex);
         
         auto& buffer = _frames[sensorFrame->FrameType];
         
-        buffer.push_back(sensorFrame);
+        buffer.push_back(std::move(bufferedSensorFrame));
         
-        while (buffer.size() > 5)
+        while (buffer.size() > c_maximumNumberOfFramesPerSensor)
         {
             buffer.pop_front();
         }
@@ -55,7 +82,7 @@ namespace HoloLensForCV
             return nullptr;
         }
 
-        return buffer.back();
+        return GetSensorFrame(buffer.back());
     }
 
     SensorFrame^ MultiFrameBuffer::GetFrameForTime(
@@ -73,11 +100,11 @@ namespace HoloLensForCV
                 std::abs(
                     TimeDeltaAMinusB(
                         Timestamp,
-                        f->Timestamp));
+                        GetTimestamp(f)));
 
             if (secondsDifference < toleranceInSeconds)
             {
-                return f;
+                return GetSensorFrame(f);
             }
         }
 
@@ -97,12 +124,12 @@ namespace HoloLensForCV
 
             for (auto& f : _frames[a])
             {
-                vta.push_back(f->Timestamp);
+                vta.push_back(GetTimestamp(f));
             }
 
             for (auto& f : _frames[b])
             {
-                vtb.push_back(f->Timestamp);
+                vtb.push_back(GetTimestamp(f));
             }
         }
 
@@ -125,4 +152,22 @@ namespace HoloLensForCV
 
         return best;
     }
+
+    Io::PixelBufferPoolStatistics MultiFrameBuffer::GetPixelBufferPoolStatistics()
+    {
+        return _pixelBufferPool->GetStatistics();
+    }
+
+    SensorFrame^ MultiFrameBuffer::GetSensorFrame(
+        _Inout_ BufferedSensorFrame& bufferedSensorFrame)
+    {
+        if (nullptr == bufferedSensorFrame.sensorFrame)
+        {
+            bufferedSensorFrame.sensorFrame =
+                SensorFrame::FromSensorFrameData(
+                    bufferedSensorFrame.sensorFrameData);
+        }
+
+        return bufferedSensorFrame.sensorFrame;
+    }
 }
@@ -13,11 +13,30 @@
 
 namespace HoloLensForCV
 {
+    //
+    // A frame kept by the MultiFrameBuffer.
+    //
+    struct BufferedSensorFrame
+    {
+        Io::SensorFrameData sensorFrameData;
+
+        // Created from the data when the frame is first asked for
+        SensorFrame^ sensorFrame;
+    };
+
+    //
+    // Keeps the last few frames of each sensor. The pixels of the frames are copied
+    // into pooled buffers when they are sent, since the media frame readers recycle
+    // the bitmaps of their frames while they are still buffered here; the frames
+    // handed out are created from those copies.
+    //
     public ref class MultiFrameBuffer sealed
         : public ISensorFrameSink
         , public ISensorFrameSinkGroup
     {
     public:
+        MultiFrameBuffer();
+
         virtual void Send(
             SensorFrame^ sensorFrame);
 
@@ -37,8 +56,16 @@ namespace HoloLensForCV
             SensorType b,
             float toleranceInSeconds);
 
+    internal:
+        Io::PixelBufferPoolStatistics GetPixelBufferPoolStatistics();
+
     private:
-        std::map<SensorType, std::deque<SensorFrame^>> _frames;
+        static SensorFrame^ GetSensorFrame(
+            _Inout_ BufferedSensorFrame& bufferedSensorFrame);
+
+        std::shared_ptr<Io::PixelBufferPool> _pixelBufferPool;
+
+        std::map<SensorType, std::deque<BufferedSensorFrame>> _frames;
         std::mutex _framesMutex;
     };
 }
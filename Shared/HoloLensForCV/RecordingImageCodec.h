@@ -0,0 +1,30 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // How the recorder stores the images of a sensor:
+    //
+    //   Netpbm: raw binary PGM (gray) or PPM (color) files, as recorded so far.
+    //   Png:    lossless PNG, 8 or 16 bits per gray pixel.
+    //   Jpeg:   lossy JPEG at SensorFrameRecorder::JpegQuality, for the PV camera.
+    //           16-bit images, i.e. depth, are stored as PNG instead.
+    //
+    public enum class RecordingImageCodec : int32_t
+    {
+        Netpbm = 0,
+        Png,
+        Jpeg
+    };
+}
@@ -0,0 +1,370 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    namespace
+    {
+        bool IsVisibleLightCamera(
+            _In_ const SensorType sensorType)
+        {
+#if ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS
+            return
+                sensorType == SensorType::VisibleLightLeftLeft ||
+                sensorType == SensorType::VisibleLightLeftFront ||
+                sensorType == SensorType::VisibleLightRightFront ||
+                sensorType == SensorType::VisibleLightRightRight;
+#else
+            (void)sensorType;
+            return false;
+#endif /* ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS */
+        }
+
+        void EncodeNetpbmImage(
+            _In_ const Io::PixelView& image,
+            _Out_ std::vector<uint8_t>& output)
+        {
+            const bool isColorImage =
+                image.format == Io::PixelFormat::Bgra8 ||
+                image.format == Io::PixelFormat::Nv12;
+
+            const int maxBitmapValue =
+                image.format == Io::PixelFormat::Gray16 ? 65535 : 255;
+
+            // Compose PGM header string.
+            std::stringstream header;
+            header << (isColorImage ? "P6" : "P5") << "\n"
+                << image.width << " "
+                << image.height << "\n"
+                << maxBitmapValue << "\n";
+            const std::string headerString = header.str();
+
+            if (!isColorImage)
+            {
+                //
+                // Gray pixels are stored as they are, Gray16 in the bitmap's (little endian)
+                // byte order, so their rows are copied once behind the header.
+                //
+                const size_t rowLength =
+                    static_cast<size_t>(image.width) * Io::GetBytesPerPixel(image.format);
+
+                output.clear();
+                output.reserve(headerString.size() + rowLength * image.height);
+
+                output.insert(
+                    output.end(),
+                    headerString.c_str(), headerString.c_str() + headerString.size());
+
+                for (int32_t y = 0; y < image.height; ++y)
+                {
+                    const uint8_t* row = image.GetRow(y);
+
+                    output.insert(
+                        output.end(),
+                        row, row + rowLength);
+                }
+
+                return;
+            }
+
+            const size_t numPixels = static_cast<size_t>(image.width) * image.height;
+
+            output.clear();
+            output.reserve(headerString.size() + numPixels * 3);
+
+            output.insert(
+                output.end(),
+                headerString.c_str(), headerString.c_str() + headerString.size());
+
+            output.resize(headerString.size() + numPixels * 3);
+
+            uint8_t* rgb = output.data() + headerString.size();
+
+            if (image.format == Io::PixelFormat::Nv12)
+            {
+                Io::ConvertNv12Image(
+                    image.data,
+                    image.stride,
+                    image.GetRow(image.height),
+                    image.stride,
+                    image.width,
+                    image.height,
+                    Io::Nv12OutputFormat::Rgb8,
+                    rgb,
+                    image.width * 3 /* outputStride */);
+            }
+            else
+            {
+                for (int32_t y = 0; y < image.height; ++y, rgb += image.width * 3)
+                {
+                    const uint8_t* bgra = image.GetRow(y);
+
+                    for (int32_t x = 0; x < image.width; ++x)
+                    {
+                        rgb[x * 3 + 0] = bgra[x * 4 + 2];
+                        rgb[x * 3 + 1] = bgra[x * 4 + 1];
+                        rgb[x * 3 + 2] = bgra[x * 4 + 0];
+                    }
+                }
+            }
+        }
+
+        void EncodeWicImage(
+            _In_ RecordingImageCodec codec,
+            _In_ int32_t jpegQuality,
+            _In_ const Io::PixelView& image,
+            _Out_ std::vector<uint8_t>& output)
+        {
+            //
+            // The encoders take tightly packed Gray8, Gray16 and Bgra8 pixels.
+            //
+            Windows::Graphics::Imaging::BitmapPixelFormat pixelFormat;
+
+            switch (image.format)
+            {
+            case Io::PixelFormat::Gray16:
+                pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray16;
+                break;
+
+            case Io::PixelFormat::Gray8:
+                pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray8;
+                break;
+
+            default:
+                pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
+                break;
+            }
+
+            const int32_t rowLength =
+                image.width * (image.format == Io::PixelFormat::Nv12 ? 4 : Io::GetBytesPerPixel(image.format));
+
+            const uint8_t* pixels = image.data;
+            std::vector<uint8_t> packedPixels;
+
+            if (image.format == Io::PixelFormat::Nv12)
+            {
+                packedPixels.resize(static_cast<size_t>(rowLength) * image.height);
+
+                Io::ConvertNv12Image(
+                    image.data,
+                    image.stride,
+                    image.GetRow(image.height),
+                    image.stride,
+                    image.width,
+                    image.height,
+                    Io::Nv12OutputFormat::Bgra8,
+                    packedPixels.data(),
+                    rowLength /* outputStride */);
+
+                pixels = packedPixels.data();
+            }
+            else if (image.stride != rowLength)
+            {
+                packedPixels.resize(static_cast<size_t>(rowLength) * image.height);
+
+                for (int32_t y = 0; y < image.height; ++y)
+                {
+                    memcpy(
+                        packedPixels.data() + static_cast<size_t>(y) * rowLength,
+                        image.GetRow(y),
+                        rowLength);
+                }
+
+                pixels = packedPixels.data();
+            }
+
+            const size_t pixelsSize =
+                static_cast<size_t>(rowLength) * image.height;
+
+            Windows::Storage::Streams::InMemoryRandomAccessStream^ stream =
+                ref new Windows::Storage::Streams::InMemoryRandomAccessStream();
+
+            Windows::Graphics::Imaging::BitmapEncoder^ encoder;
+
+            if (RecordingImageCodec::Jpeg == codec)
+            {
+                Windows::Graphics::Imaging::BitmapPropertySet^ encodingOptions =
+                    ref new Windows::Graphics::Imaging::BitmapPropertySet();
+
+                encodingOptions->Insert(
+                    L"ImageQuality",
+                    ref new Windows::Graphics::Imaging::BitmapTypedValue(
+                        jpegQuality / 100.0f,
+                        Windows::Foundation::PropertyType::Single));
+
+                encoder = concurrency::create_task(
+                    Windows::Graphics::Imaging::BitmapEncoder::CreateAsync(
+                        Windows::Graphics::Imaging::BitmapEncoder::JpegEncoderId,
+                        stream,
+                        encodingOptions)).get();
+            }
+            else
+            {
+                encoder = concurrency::create_task(
+                    Windows::Graphics::Imaging::BitmapEncoder::CreateAsync(
+                        Windows::Graphics::Imaging::BitmapEncoder::PngEncoderId,
+                        stream)).get();
+            }
+
+            encoder->SetPixelData(
+                pixelFormat,
+                Windows::Graphics::Imaging::BitmapAlphaMode::Ignore,
+                image.width,
+                image.height,
+                96.0 /* dpiX */,
+                96.0 /* dpiY */,
+                Platform::ArrayReference<uint8_t>(
+                    const_cast<uint8_t*>(pixels),
+                    static_cast<unsigned int>(pixelsSize)));
+
+            concurrency::create_task(
+                encoder->FlushAsync()).get();
+
+            const uint32_t encodedSize =
+                static_cast<uint32_t>(stream->Size);
+
+            output.resize(encodedSize);
+
+            Windows::Storage::Streams::DataReader^ dataReader =
+                ref new Windows::Storage::Streams::DataReader(
+                    stream->GetInputStreamAt(0));
+
+            concurrency::create_task(
+                dataReader->LoadAsync(encodedSize)).get();
+
+            dataReader->ReadBytes(
+                Platform::ArrayReference<uint8_t>(
+                    output.data(),
+                    encodedSize));
+        }
+    }
+
+    _Use_decl_annotations_
+    Io::PixelView GetRecordingImage(
+        const Io::SensorFrameData& sensorFrameData)
+    {
+        const SensorType sensorType =
+            static_cast<SensorType>(sensorFrameData.frameType);
+
+        Io::PixelView image =
+            sensorFrameData.pixels;
+
+        switch (image.format)
+        {
+        case Io::PixelFormat::Gray16:
+        case Io::PixelFormat::Gray8:
+            break;
+
+        case Io::PixelFormat::Bgra8:
+            if (IsVisibleLightCamera(sensorType))
+            {
+                image.format = Io::PixelFormat::Gray8;
+                image.width = image.width * 4;
+            }
+            else
+            {
+                ASSERT(sensorType == SensorType::PhotoVideo);
+            }
+            break;
+
+        case Io::PixelFormat::Nv12:
+            ASSERT(sensorType == SensorType::PhotoVideo);
+            break;
+
+        default:
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+            dbg::trace(
+                L"GetRecordingImage: unsupported pixel format");
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+
+            ASSERT(false);
+            break;
+        }
+
+        return image;
+    }
+
+    _Use_decl_annotations_
+    RecordingImageCodec EncodeRecordingImage(
+        RecordingImageCodec codec,
+        int32_t jpegQuality,
+        const Io::PixelView& image,
+        std::vector<uint8_t>& output)
+    {
+        if (RecordingImageCodec::Jpeg == codec &&
+            image.format == Io::PixelFormat::Gray16)
+        {
+            codec = RecordingImageCodec::Png;
+        }
+
+        if (RecordingImageCodec::Netpbm == codec)
+        {
+            EncodeNetpbmImage(
+                image,
+                output);
+        }
+        else
+        {
+            EncodeWicImage(
+                codec,
+                jpegQuality,
+                image,
+                output);
+        }
+
+        return codec;
+    }
+
+    _Use_decl_annotations_
+    const wchar_t* GetRecordingImageFileExtension(
+        RecordingImageCodec codec,
+        Io::PixelFormat pixelFormat)
+    {
+        switch (codec)
+        {
+        case RecordingImageCodec::Netpbm:
+            return
+                pixelFormat == Io::PixelFormat::Bgra8 ||
+                pixelFormat == Io::PixelFormat::Nv12 ? L"ppm" : L"pgm";
+
+        case RecordingImageCodec::Png:
+            return L"png";
+
+        case RecordingImageCodec::Jpeg:
+            return L"jpg";
+
+        default:
+            throw std::logic_error("unexpected recording image codec");
+        }
+    }
+
+    _Use_decl_annotations_
+    const wchar_t* GetRecordingImageCodecName(
+        RecordingImageCodec codec)
+    {
+        switch (codec)
+        {
+        case RecordingImageCodec::Netpbm:
+            return L"netpbm";
+
+        case RecordingImageCodec::Png:
+            return L"png";
+
+        case RecordingImageCodec::Jpeg:
+            return L"jpeg";
+
+        default:
+            throw std::logic_error("unexpected recording image codec");
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // Returns the image recorded for the frame, a view of its pixels that shares their
+    // buffer: Gray8, Gray16, Bgra8 or Nv12 as delivered, except for the VLC frames,
+    // whose Bgra8 pixels hold four gray pixels each and are recorded as a Gray8 image
+    // four times as wide.
+    //
+    Io::PixelView GetRecordingImage(
+        _In_ const Io::SensorFrameData& sensorFrameData);
+
+    //
+    // Encodes the image into output and returns the codec used: the requested one,
+    // or PNG for a 16-bit image that was requested as JPEG. The output is overwritten
+    // in place, reusing its capacity. PNG and JPEG use the Windows Imaging Component;
+    // those block on its asynchronous operations, so call them from a worker thread.
+    //
+    RecordingImageCodec EncodeRecordingImage(
+        _In_ RecordingImageCodec codec,
+        _In_ int32_t jpegQuality,
+        _In_ const Io::PixelView& image,
+        _Out_ std::vector<uint8_t>& output);
+
+    //
+    // "pgm", "ppm", "png" or "jpg".
+    //
+    const wchar_t* GetRecordingImageFileExtension(
+        _In_ RecordingImageCodec codec,
+        _In_ Io::PixelFormat pixelFormat);
+
+    //
+    // "netpbm", "png" or "jpeg", as recorded in the ImageCodec column of the CSV files.
+    //
+    const wchar_t* GetRecordingImageCodecName(
+        _In_ RecordingImageCodec codec);
+}
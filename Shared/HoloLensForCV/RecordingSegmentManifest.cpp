@@ -0,0 +1,91 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    _Use_decl_annotations_
+    RecordingSegmentManifest::RecordingSegmentManifest(
+        const std::wstring& fileName)
+        : _csvWriter(fileName)
+    {
+        std::vector<std::wstring> columns;
+
+        columns.push_back(L"SensorName");
+        columns.push_back(L"SegmentIndex");
+        columns.push_back(L"TarballFileName");
+        columns.push_back(L"CsvFileName");
+        columns.push_back(L"FirstTimestamp");
+        columns.push_back(L"LastTimestamp");
+        columns.push_back(L"NumberOfFrames");
+        columns.push_back(L"NumberOfBytes");
+
+        _csvWriter.WriteHeader(
+            columns);
+    }
+
+    _Use_decl_annotations_
+    void RecordingSegmentManifest::Append(
+        const RecordingSegment& segment)
+    {
+        std::lock_guard<std::mutex> manifestLockGuard(
+            _manifestMutex);
+
+        bool writeComma = false;
+
+        _csvWriter.WriteText(
+            segment.SensorName,
+            &writeComma);
+
+        _csvWriter.WriteInt32(
+            segment.SegmentIndex,
+            &writeComma);
+
+        _csvWriter.WriteText(
+            segment.TarballFileName,
+            &writeComma);
+
+        _csvWriter.WriteText(
+            segment.CsvFileName,
+            &writeComma);
+
+        _csvWriter.WriteUInt64(
+            segment.FirstTimestamp,
+            &writeComma);
+
+        _csvWriter.WriteUInt64(
+            segment.LastTimestamp,
+            &writeComma);
+
+        _csvWriter.WriteUInt64(
+            segment.NumberOfFrames,
+            &writeComma);
+
+        _csvWriter.WriteUInt64(
+            segment.NumberOfBytes,
+            &writeComma);
+
+        //
+        // Ends the line with std::endl, which flushes it to the file.
+        //
+        _csvWriter.EndLine();
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+        dbg::trace(
+            L"RecordingSegmentManifest::Append: %s segment %i finalized, %u frames, %llu bytes",
+            segment.SensorName.c_str(),
+            segment.SegmentIndex,
+            segment.NumberOfFrames,
+            segment.NumberOfBytes);
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+    }
+}
@@ -0,0 +1,82 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // When the recorder sinks move on to a new segment, i.e. a new tarball and CSV file:
+    // once the segment spans a maximum duration of sensor time, or once its tarball would
+    // exceed a maximum size. Zero disables a limit; with both disabled, each sensor is
+    // recorded into a single "<sensor>.tar" and "<sensor>.csv".
+    //
+    struct RecordingSegmentPolicy
+    {
+        RecordingSegmentPolicy()
+            : MaximumDuration(0)
+            , MaximumSize(0)
+        {
+        }
+
+        bool IsSegmented() const
+        {
+            return 0 != MaximumDuration || 0 != MaximumSize;
+        }
+
+        // In 100ns units, as sensor frame timestamps
+        int64_t MaximumDuration;
+
+        // In bytes
+        uint64_t MaximumSize;
+    };
+
+    //
+    // A finalized segment of the recording of one sensor.
+    //
+    struct RecordingSegment
+    {
+        std::wstring SensorName;
+        int32_t SegmentIndex;
+        std::wstring TarballFileName;
+        std::wstring CsvFileName;
+        uint64_t FirstTimestamp;
+        uint64_t LastTimestamp;
+        uint32_t NumberOfFrames;
+        uint64_t NumberOfBytes;
+    };
+
+    //
+    // Lists the segments of a recording in "segments.csv" as the recorder sinks finalize
+    // them, one line per segment:
+    //
+    //   SensorName,SegmentIndex,TarballFileName,CsvFileName,FirstTimestamp,
+    //   LastTimestamp,NumberOfFrames,NumberOfBytes
+    //
+    // Each line is flushed as it is appended, so that host tools can download and process
+    // the listed segments while the recording continues; the files of segments that are
+    // not listed yet are still being written.
+    //
+    class RecordingSegmentManifest
+    {
+    public:
+        RecordingSegmentManifest(
+            _In_ const std::wstring& fileName);
+
+        void Append(
+            _In_ const RecordingSegment& segment);
+
+    private:
+        std::mutex _manifestMutex;
+
+        CsvWriter _csvWriter;
+    };
+}
@@ -13,6 +13,59 @@
 
 namespace HoloLensForCV
 {
+    namespace
+    {
+        //
+        // What Io::SensorFrameData::cameraIntrinsics points to for frames originated on device.
+        //
+        struct SensorFrameCameraIntrinsics
+        {
+            Windows::Media::Devices::Core::CameraIntrinsics^ coreCameraIntrinsics;
+            CameraIntrinsics^ sensorStreamingCameraIntrinsics;
+        };
+
+        static_assert(
+            sizeof(Windows::Foundation::Numerics::float4x4) == sizeof(Io::Float4x4),
+            "float4x4 and Io::Float4x4 must have the same layout");
+
+        Io::Float4x4 ToFloat4x4(
+            _In_ const Windows::Foundation::Numerics::float4x4& matrix)
+        {
+            Io::Float4x4 result;
+
+            memcpy(result.data(), &matrix, sizeof(result));
+
+            return result;
+        }
+
+        Windows::Foundation::Numerics::float4x4 FromFloat4x4(
+            _In_ const Io::Float4x4& matrix)
+        {
+            Windows::Foundation::Numerics::float4x4 result;
+
+            memcpy(&result, matrix.data(), sizeof(result));
+
+            return result;
+        }
+
+        void CopyRows(
+            _In_ const uint8_t* source,
+            _In_ const int32_t sourceStride,
+            _In_ const int32_t rowLength,
+            _In_ const int32_t numberOfRows,
+            _Out_ uint8_t* destination,
+            _In_ const int32_t destinationStride)
+        {
+            for (int32_t y = 0; y < numberOfRows; ++y)
+            {
+                memcpy(
+                    destination + y * destinationStride,
+                    source + y * sourceStride,
+                    rowLength);
+            }
+        }
+    }
+
     SensorFrame::SensorFrame(
         _In_ SensorType frameType,
         _In_ Windows::Foundation::DateTime timestamp,
@@ -22,4 +75,202 @@ namespace HoloLensForCV
         Timestamp = timestamp;
         SoftwareBitmap = softwareBitmap;
     }
+
+    void SensorFrame::ToSensorFrameData(
+        _Inout_ Io::PixelBufferPool& pixelBufferPool,
+        _Out_ Io::SensorFrameData& sensorFrameData)
+    {
+        sensorFrameData.frameType = static_cast<int32_t>(FrameType);
+        sensorFrameData.timestamp = Timestamp.UniversalTime;
+        sensorFrameData.frameToOrigin = ToFloat4x4(FrameToOrigin);
+        sensorFrameData.cameraViewTransform = ToFloat4x4(CameraViewTransform);
+        sensorFrameData.cameraProjectionTransform = ToFloat4x4(CameraProjectionTransform);
+
+        if (nullptr != CoreCameraIntrinsics || nullptr != SensorStreamingCameraIntrinsics)
+        {
+            std::shared_ptr<SensorFrameCameraIntrinsics> cameraIntrinsics =
+                std::make_shared<SensorFrameCameraIntrinsics>();
+
+            cameraIntrinsics->coreCameraIntrinsics = CoreCameraIntrinsics;
+            cameraIntrinsics->sensorStreamingCameraIntrinsics = SensorStreamingCameraIntrinsics;
+
+            sensorFrameData.cameraIntrinsics = cameraIntrinsics;
+        }
+        else
+        {
+            sensorFrameData.cameraIntrinsics.reset();
+        }
+
+        Io::PixelFormat pixelFormat;
+
+        switch (SoftwareBitmap->BitmapPixelFormat)
+        {
+        case Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8:
+            pixelFormat = Io::PixelFormat::Bgra8;
+            break;
+
+        case Windows::Graphics::Imaging::BitmapPixelFormat::Gray16:
+            pixelFormat = Io::PixelFormat::Gray16;
+            break;
+
+        case Windows::Graphics::Imaging::BitmapPixelFormat::Gray8:
+            pixelFormat = Io::PixelFormat::Gray8;
+            break;
+
+        case Windows::Graphics::Imaging::BitmapPixelFormat::Nv12:
+            pixelFormat = Io::PixelFormat::Nv12;
+            break;
+
+        default:
+            REQUIRES(false);
+            return;
+        }
+
+        pixelBufferPool.AllocateView(
+            SoftwareBitmap->PixelWidth,
+            SoftwareBitmap->PixelHeight,
+            pixelFormat,
+            sensorFrameData.pixels);
+
+        Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+            SoftwareBitmap->LockBuffer(
+                Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+        uint32_t bitmapBufferDataLength = 0;
+
+        const uint8_t* bitmapBufferData =
+            Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                bitmapBuffer->CreateReference(),
+                bitmapBufferDataLength);
+
+        const Windows::Graphics::Imaging::BitmapPlaneDescription plane =
+            bitmapBuffer->GetPlaneDescription(0);
+
+        CopyRows(
+            bitmapBufferData + plane.StartIndex,
+            plane.Stride,
+            sensorFrameData.pixels.width * Io::GetBytesPerPixel(pixelFormat),
+            sensorFrameData.pixels.height,
+            sensorFrameData.pixels.data,
+            sensorFrameData.pixels.stride);
+
+        if (Io::PixelFormat::Nv12 == pixelFormat)
+        {
+            //
+            // The chroma plane has rows of width/2 U/V pairs.
+            //
+            const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                bitmapBuffer->GetPlaneDescription(1);
+
+            CopyRows(
+                bitmapBufferData + chromaPlane.StartIndex,
+                chromaPlane.Stride,
+                sensorFrameData.pixels.width,
+                sensorFrameData.pixels.height / 2,
+                sensorFrameData.pixels.GetRow(sensorFrameData.pixels.height),
+                sensorFrameData.pixels.stride);
+        }
+    }
+
+    SensorFrame^ SensorFrame::FromSensorFrameData(
+        _In_ const Io::SensorFrameData& sensorFrameData)
+    {
+        const Io::PixelView& pixels =
+            sensorFrameData.pixels;
+
+        REQUIRES(!pixels.IsEmpty());
+
+        Windows::Graphics::Imaging::BitmapPixelFormat bitmapPixelFormat;
+
+        switch (pixels.format)
+        {
+        case Io::PixelFormat::Bgra8:
+            bitmapPixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
+            break;
+
+        case Io::PixelFormat::Gray16:
+            bitmapPixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray16;
+            break;
+
+        case Io::PixelFormat::Nv12:
+            bitmapPixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Nv12;
+            break;
+
+        default:
+            bitmapPixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray8;
+            break;
+        }
+
+        Windows::Graphics::Imaging::SoftwareBitmap^ bitmap =
+            ref new Windows::Graphics::Imaging::SoftwareBitmap(
+                bitmapPixelFormat,
+                pixels.width,
+                pixels.height,
+                Windows::Graphics::Imaging::BitmapAlphaMode::Ignore);
+
+        {
+            Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+                bitmap->LockBuffer(
+                    Windows::Graphics::Imaging::BitmapBufferAccessMode::Write);
+
+            uint32_t bitmapBufferDataLength = 0;
+
+            uint8_t* bitmapBufferData =
+                Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                    bitmapBuffer->CreateReference(),
+                    bitmapBufferDataLength);
+
+            const Windows::Graphics::Imaging::BitmapPlaneDescription plane =
+                bitmapBuffer->GetPlaneDescription(0);
+
+            CopyRows(
+                pixels.data,
+                pixels.stride,
+                pixels.width * Io::GetBytesPerPixel(pixels.format),
+                pixels.height,
+                bitmapBufferData + plane.StartIndex,
+                plane.Stride);
+
+            if (Io::PixelFormat::Nv12 == pixels.format)
+            {
+                const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                    bitmapBuffer->GetPlaneDescription(1);
+
+                CopyRows(
+                    pixels.GetRow(pixels.height),
+                    pixels.stride,
+                    pixels.width,
+                    pixels.height / 2,
+                    bitmapBufferData + chromaPlane.StartIndex,
+                    chromaPlane.Stride);
+            }
+        }
+
+        Windows::Foundation::DateTime timestamp;
+
+        timestamp.UniversalTime =
+            sensorFrameData.timestamp;
+
+        SensorFrame^ sensorFrame =
+            ref new SensorFrame(
+                static_cast<SensorType>(sensorFrameData.frameType),
+                timestamp,
+                bitmap);
+
+        sensorFrame->FrameToOrigin = FromFloat4x4(sensorFrameData.frameToOrigin);
+        sensorFrame->CameraViewTransform = FromFloat4x4(sensorFrameData.cameraViewTransform);
+        sensorFrame->CameraProjectionTransform = FromFloat4x4(sensorFrameData.cameraProjectionTransform);
+
+        if (nullptr != sensorFrameData.cameraIntrinsics)
+        {
+            const SensorFrameCameraIntrinsics* cameraIntrinsics =
+                static_cast<const SensorFrameCameraIntrinsics*>(
+                    sensorFrameData.cameraIntrinsics.get());
+
+            sensorFrame->CoreCameraIntrinsics = cameraIntrinsics->coreCameraIntrinsics;
+            sensorFrame->SensorStreamingCameraIntrinsics = cameraIntrinsics->sensorStreamingCameraIntrinsics;
+        }
+
+        return sensorFrame;
+    }
 }
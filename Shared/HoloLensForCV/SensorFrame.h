@@ -34,5 +34,21 @@ namespace HoloLensForCV
         property Windows::Foundation::Numerics::float4x4 FrameToOrigin;
         property Windows::Foundation::Numerics::float4x4 CameraViewTransform;
         property Windows::Foundation::Numerics::float4x4 CameraProjectionTransform;
+
+    internal:
+        //
+        // Copies the frame into the platform-neutral representation, with the pixels in
+        // a buffer from the pool. The camera intrinsics are shared, not copied.
+        //
+        void ToSensorFrameData(
+            _Inout_ Io::PixelBufferPool& pixelBufferPool,
+            _Out_ Io::SensorFrameData& sensorFrameData);
+
+        //
+        // Creates a frame with a new SoftwareBitmap holding a copy of the pixels. The
+        // camera intrinsics are restored if the data was created by ToSensorFrameData.
+        //
+        static SensorFrame^ FromSensorFrameData(
+            _In_ const Io::SensorFrameData& sensorFrameData);
     };
 }
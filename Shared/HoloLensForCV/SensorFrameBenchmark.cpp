@@ -0,0 +1,644 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#if SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS
+namespace
+{
+    std::atomic<int64_t> g_numberOfAllocations(0);
+}
+
+void* operator new(
+    size_t size)
+{
+    ++g_numberOfAllocations;
+
+    void* memory = malloc(size ? size : 1);
+
+    if (nullptr == memory)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(
+    void* memory) noexcept
+{
+    free(memory);
+}
+#endif /* SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS */
+
+namespace HoloLensForCV
+{
+    namespace
+    {
+        struct StageStatistics
+        {
+            StageStatistics(
+                _In_ const wchar_t* stageName)
+                : name(stageName)
+                , bytes(0)
+                , outputBytes(0)
+                , allocations(0)
+            {
+            }
+
+            std::wstring name;
+            std::vector<double> latencies;
+            uint64_t bytes;
+
+            // Bytes produced by stages that encode the image, zero otherwise
+            uint64_t outputBytes;
+
+            int64_t allocations;
+        };
+
+        int64_t GetNumberOfAllocations()
+        {
+#if SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS
+            return g_numberOfAllocations;
+#else
+            return 0;
+#endif /* SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS */
+        }
+
+        //
+        // Times one invocation of a stage and accounts for its allocations.
+        //
+        template <typename TFunction>
+        void RunStage(
+            _Inout_ StageStatistics& statistics,
+            _In_ const uint64_t bytes,
+            _In_ const TFunction& function)
+        {
+            const int64_t allocationsBefore =
+                GetNumberOfAllocations();
+
+            dbg::Timer timer;
+
+            function();
+
+            statistics.latencies.push_back(
+                timer.GetMillisecondsFromStart());
+
+            statistics.allocations +=
+                GetNumberOfAllocations() - allocationsBefore;
+
+            statistics.bytes += bytes;
+        }
+
+        double GetPercentile(
+            _In_ const std::vector<double>& sortedValues,
+            _In_ const double percentile)
+        {
+            const size_t index =
+                static_cast<size_t>(percentile * (sortedValues.size() - 1) + 0.5);
+
+            return sortedValues[index];
+        }
+
+        void WriteStatistics(
+            _In_ const wchar_t* sensorName,
+            _Inout_ StageStatistics& statistics,
+            _Inout_ CsvWriter& csvWriter)
+        {
+            if (statistics.latencies.empty())
+            {
+                return;
+            }
+
+            std::sort(
+                statistics.latencies.begin(),
+                statistics.latencies.end());
+
+            double totalMilliseconds = 0.0;
+
+            for (const double latency : statistics.latencies)
+            {
+                totalMilliseconds += latency;
+            }
+
+            const int32_t numberOfFrames =
+                static_cast<int32_t>(statistics.latencies.size());
+
+            const double totalSeconds =
+                std::max(totalMilliseconds, 1e-6) / 1000.0;
+
+            bool writeComma = false;
+
+            csvWriter.WriteText(sensorName, &writeComma);
+            csvWriter.WriteText(statistics.name, &writeComma);
+            csvWriter.WriteInt32(numberOfFrames, &writeComma);
+            csvWriter.WriteDouble(numberOfFrames / totalSeconds, &writeComma);
+            csvWriter.WriteDouble(statistics.bytes / 1e6 / totalSeconds, &writeComma);
+            csvWriter.WriteDouble(GetPercentile(statistics.latencies, 0.5), &writeComma);
+            csvWriter.WriteDouble(GetPercentile(statistics.latencies, 0.9), &writeComma);
+            csvWriter.WriteDouble(GetPercentile(statistics.latencies, 0.99), &writeComma);
+            csvWriter.WriteDouble(statistics.latencies.back(), &writeComma);
+
+#if SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS
+            csvWriter.WriteDouble(static_cast<double>(statistics.allocations) / numberOfFrames, &writeComma);
+#else
+            csvWriter.WriteDouble(-1.0, &writeComma);
+#endif /* SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS */
+
+            csvWriter.WriteDouble(
+                0 != statistics.outputBytes ? static_cast<double>(statistics.bytes) / statistics.outputBytes : -1.0,
+                &writeComma);
+
+            csvWriter.EndLine();
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+            dbg::trace(
+                L"SensorFrameBenchmark: %s %s: %.1f frames/s, p50 %.03fms, p99 %.03fms",
+                sensorName,
+                statistics.name.c_str(),
+                numberOfFrames / totalSeconds,
+                GetPercentile(statistics.latencies, 0.5),
+                GetPercentile(statistics.latencies, 0.99));
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+        }
+
+        const wchar_t* GetSensorName(
+            _In_ const SensorType sensorType)
+        {
+            switch (sensorType)
+            {
+            case SensorType::PhotoVideo:
+                return L"pv";
+
+#if ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS
+            case SensorType::ShortThrowToFDepth:
+                return L"short_throw_depth";
+
+            case SensorType::ShortThrowToFReflectivity:
+                return L"short_throw_reflectivity";
+
+            case SensorType::LongThrowToFDepth:
+                return L"long_throw_depth";
+
+            case SensorType::LongThrowToFReflectivity:
+                return L"long_throw_reflectivity";
+
+            case SensorType::VisibleLightLeftLeft:
+                return L"vlc_ll";
+
+            case SensorType::VisibleLightLeftFront:
+                return L"vlc_lf";
+
+            case SensorType::VisibleLightRightFront:
+                return L"vlc_rf";
+
+            case SensorType::VisibleLightRightRight:
+                return L"vlc_rr";
+#endif /* ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS */
+
+            default:
+                return L"undefined";
+            }
+        }
+
+        struct BenchmarkRun
+        {
+            SensorType sensorType;
+
+            // Unknown for the default format of the sensor
+            Windows::Graphics::Imaging::BitmapPixelFormat pixelFormat;
+
+            const wchar_t* name;
+        };
+
+        std::vector<BenchmarkRun> GetBenchmarkRuns()
+        {
+            std::vector<BenchmarkRun> runs;
+
+            for (int32_t sensorTypeIndex = 0; sensorTypeIndex < (int32_t)SensorType::NumberOfSensorTypes; ++sensorTypeIndex)
+            {
+                const SensorType sensorType =
+                    static_cast<SensorType>(sensorTypeIndex);
+
+                runs.push_back({
+                    sensorType,
+                    Windows::Graphics::Imaging::BitmapPixelFormat::Unknown,
+                    GetSensorName(sensorType) });
+
+                //
+                // The native NV12 PV path, for comparison with the Bgra8 one.
+                //
+                if (SensorType::PhotoVideo == sensorType)
+                {
+                    runs.push_back({
+                        sensorType,
+                        Windows::Graphics::Imaging::BitmapPixelFormat::Nv12,
+                        L"pv_nv12" });
+                }
+            }
+
+            return runs;
+        }
+
+        //
+        // Memory budget of the flight recorder stage, per sensor; smaller than the
+        // frames of a run of the larger sensors, so that the ring drops frames.
+        //
+        const uint64_t kFlightRecorderSize = 64 * 1024 * 1024;
+
+        //
+        // The codec the recorder app stores the sensor's images with.
+        //
+        RecordingImageCodec GetRecordingImageCodec(
+            _In_ const SensorType sensorType)
+        {
+            return SensorType::PhotoVideo == sensorType ?
+                RecordingImageCodec::Jpeg :
+                RecordingImageCodec::Png;
+        }
+
+        const int32_t kJpegQuality = 90;
+
+        bool IsVisibleLightCamera(
+            _In_ const SensorType sensorType)
+        {
+#if ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS
+            return
+                sensorType == SensorType::VisibleLightLeftLeft ||
+                sensorType == SensorType::VisibleLightLeftFront ||
+                sensorType == SensorType::VisibleLightRightFront ||
+                sensorType == SensorType::VisibleLightRightRight;
+#else
+            (void)sensorType;
+            return false;
+#endif /* ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS */
+        }
+    }
+
+    void SensorFrameBenchmark::Run(
+        _In_ Windows::Storage::StorageFolder^ outputFolder,
+        _In_ int32_t numberOfFramesPerSensor)
+    {
+        REQUIRES(nullptr != outputFolder);
+        REQUIRES(numberOfFramesPerSensor > 0);
+
+        wchar_t csvFileName[MAX_PATH] = {};
+
+        swprintf_s(
+            csvFileName,
+            L"%s\\sensor_frame_benchmark.csv",
+            outputFolder->Path->Data());
+
+        CsvWriter csvWriter(
+            csvFileName);
+
+        {
+            std::vector<std::wstring> columns;
+
+            columns.push_back(L"SensorType");
+            columns.push_back(L"Stage");
+            columns.push_back(L"Frames");
+            columns.push_back(L"FramesPerSecond");
+            columns.push_back(L"MegabytesPerSecond");
+            columns.push_back(L"LatencyP50Milliseconds");
+            columns.push_back(L"LatencyP90Milliseconds");
+            columns.push_back(L"LatencyP99Milliseconds");
+            columns.push_back(L"LatencyMaxMilliseconds");
+            columns.push_back(L"AllocationsPerFrame");
+            columns.push_back(L"CompressionRatio");
+
+            csvWriter.WriteHeader(columns);
+        }
+
+        MultiFrameBuffer^ multiFrameBuffer =
+            ref new MultiFrameBuffer();
+
+        Windows::Storage::Streams::DataWriter^ dataWriter =
+            ref new Windows::Storage::Streams::DataWriter();
+
+        Windows::Foundation::DateTime startTimestamp;
+
+        {
+            FILETIME currentTime;
+
+            GetSystemTimeAsFileTime(
+                &currentTime);
+
+            startTimestamp.UniversalTime =
+                Io::TimeConverter().FileTimeToAbsoluteTicks(
+                    currentTime).count();
+        }
+
+        std::vector<uint8_t> kernelOutput;
+
+        std::shared_ptr<Io::PixelBufferPool> pixelBufferPool =
+            Io::PixelBufferPool::Create();
+
+        Io::SensorFrameData sensorFrameData;
+        std::vector<uint8_t> encodedImage;
+
+        Io::TaskExecutor taskExecutor;
+
+        const std::vector<BenchmarkRun> runs =
+            GetBenchmarkRuns();
+
+        for (size_t runIndex = 0; runIndex < runs.size(); ++runIndex)
+        {
+            const SensorType sensorType =
+                runs[runIndex].sensorType;
+
+            const wchar_t* sensorName =
+                runs[runIndex].name;
+
+            SyntheticSensorFrameSource^ source =
+                ref new SyntheticSensorFrameSource(
+                    sensorType,
+                    startTimestamp);
+
+            if (Windows::Graphics::Imaging::BitmapPixelFormat::Unknown != runs[runIndex].pixelFormat)
+            {
+                source->PixelFormat = runs[runIndex].pixelFormat;
+            }
+
+            SensorFrameRecorderSink^ recorderSink =
+                ref new SensorFrameRecorderSink(
+                    sensorType,
+                    ref new Platform::String(sensorName));
+
+            recorderSink->Start(
+                outputFolder);
+
+            //
+            // The same frames in flight recorder mode, into a ring bounded by memory,
+            // which is persisted once all frames were sent.
+            //
+            SensorFrameRecorderSink^ flightRecorderSink =
+                ref new SensorFrameRecorderSink(
+                    sensorType,
+                    ref new Platform::String(
+                        (std::wstring(sensorName) + L"_flight").c_str()));
+
+            flightRecorderSink->StartFlightRecording(
+                0 /* maximumDuration */,
+                kFlightRecorderSize);
+
+            StageStatistics generateStatistics(L"Generate");
+            StageStatistics streamStatistics(L"Stream");
+            StageStatistics recordStatistics(L"Record");
+            StageStatistics encodeStatistics(L"Encode");
+            StageStatistics flightRecordStatistics(L"FlightRecord");
+            StageStatistics persistStatistics(L"Persist");
+            StageStatistics bufferStatistics(L"Buffer");
+            StageStatistics kernelStatistics(L"Kernel");
+            StageStatistics scheduleStatistics(L"Schedule");
+
+            for (int32_t i = 0; i < numberOfFramesPerSensor; ++i)
+            {
+                SensorFrame^ sensorFrame;
+
+                RunStage(generateStatistics, 0, [&]()
+                {
+                    sensorFrame = source->GetNextFrame();
+                });
+
+                Windows::Graphics::Imaging::SoftwareBitmap^ bitmap =
+                    sensorFrame->SoftwareBitmap;
+
+                const uint32_t pixelStride =
+                    bitmap->BitmapPixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8 ? 4 :
+                    bitmap->BitmapPixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Gray16 ? 2 : 1;
+
+                const bool isNv12 =
+                    bitmap->BitmapPixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Nv12;
+
+                const uint32_t imageBufferSize =
+                    bitmap->PixelWidth * (isNv12 ? bitmap->PixelHeight * 3 / 2 : bitmap->PixelHeight) * pixelStride;
+
+                //
+                // The per-frame work of SensorFrameStreamingServer::Send, minus the socket.
+                //
+                RunStage(streamStatistics, imageBufferSize, [&]()
+                {
+                    Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+                        bitmap->LockBuffer(
+                            Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+                    uint32_t bitmapBufferDataSize = 0;
+
+                    uint8_t* bitmapBufferData =
+                        Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                            bitmapBuffer->CreateReference(),
+                            bitmapBufferDataSize);
+
+                    SensorFrameStreamHeader^ header =
+                        ref new SensorFrameStreamHeader();
+
+                    header->FrameType = sensorFrame->FrameType;
+                    header->Timestamp = sensorFrame->Timestamp.UniversalTime;
+                    header->ImageWidth = bitmap->PixelWidth;
+                    header->ImageHeight = bitmap->PixelHeight;
+                    header->PixelStride = pixelStride;
+                    header->RowStride = bitmap->PixelWidth * pixelStride;
+                    header->PixelFormat = bitmap->BitmapPixelFormat;
+
+                    SensorFrameStreamHeader::Write(
+                        header,
+                        dataWriter);
+
+                    dataWriter->WriteBytes(
+                        ref new Platform::Array<uint8_t>(
+                            bitmapBufferData,
+                            imageBufferSize));
+
+                    dataWriter->DetachBuffer();
+                });
+
+                RunStage(recordStatistics, imageBufferSize, [&]()
+                {
+                    recorderSink->Send(sensorFrame);
+                });
+
+                //
+                // What the recorder's encoder threads do per frame with the codec the
+                // recorder app uses for the sensor.
+                //
+                RunStage(encodeStatistics, imageBufferSize, [&]()
+                {
+                    sensorFrame->ToSensorFrameData(
+                        *pixelBufferPool,
+                        sensorFrameData);
+
+                    EncodeRecordingImage(
+                        GetRecordingImageCodec(sensorType),
+                        kJpegQuality,
+                        GetRecordingImage(sensorFrameData),
+                        encodedImage);
+                });
+
+                encodeStatistics.outputBytes += encodedImage.size();
+
+                RunStage(flightRecordStatistics, imageBufferSize, [&]()
+                {
+                    flightRecorderSink->Send(sensorFrame);
+                });
+
+                RunStage(bufferStatistics, 0, [&]()
+                {
+                    multiFrameBuffer->Send(sensorFrame);
+
+                    ASSERT(nullptr != multiFrameBuffer->GetFrameForTime(
+                        sensorType,
+                        sensorFrame->Timestamp,
+                        0.001f /* toleranceInSeconds */));
+                });
+
+                if (IsVisibleLightCamera(sensorType))
+                {
+                    //
+                    // The VLC preview transform of SensorStreamViewer: downsample by two and
+                    // rotate into an upright Bgra8 image.
+                    //
+                    RunStage(kernelStatistics, imageBufferSize, [&]()
+                    {
+                        Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+                            bitmap->LockBuffer(
+                                Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+                        uint32_t bitmapBufferDataSize = 0;
+
+                        const uint8_t* bitmapBufferData =
+                            Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                                bitmapBuffer->CreateReference(),
+                                bitmapBufferDataSize);
+
+                        const int32_t width = bitmap->PixelWidth * 4;
+                        const int32_t height = bitmap->PixelHeight;
+
+                        int32_t outputWidth = 0, outputHeight = 0;
+
+                        Io::GetTransformedGray8ImageSize(
+                            width,
+                            height,
+                            2 /* downsampleFactor */,
+                            Io::ImageOrientation::Rotate90Clockwise,
+                            outputWidth,
+                            outputHeight);
+
+                        kernelOutput.resize(
+                            outputWidth * outputHeight * 4);
+
+                        Io::TransformGray8Image(
+                            bitmapBufferData,
+                            width,
+                            height,
+                            width /* inputStride */,
+                            2 /* downsampleFactor */,
+                            Io::ImageOrientation::Rotate90Clockwise,
+                            Io::ImageKernelOutputFormat::Bgra8,
+                            kernelOutput.data(),
+                            outputWidth * 4 /* outputStride */);
+                    });
+                }
+                else if (isNv12)
+                {
+                    //
+                    // What consumers of NV12 frames pay to get the image the Bgra8 path
+                    // delivers; gray consumers use the luma plane as is.
+                    //
+                    RunStage(kernelStatistics, imageBufferSize, [&]()
+                    {
+                        Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+                            bitmap->LockBuffer(
+                                Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+                        uint32_t bitmapBufferDataSize = 0;
+
+                        const uint8_t* bitmapBufferData =
+                            Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                                bitmapBuffer->CreateReference(),
+                                bitmapBufferDataSize);
+
+                        const Windows::Graphics::Imaging::BitmapPlaneDescription lumaPlane =
+                            bitmapBuffer->GetPlaneDescription(0);
+
+                        const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                            bitmapBuffer->GetPlaneDescription(1);
+
+                        kernelOutput.resize(
+                            bitmap->PixelWidth * bitmap->PixelHeight * 4);
+
+                        Io::ConvertNv12Image(
+                            bitmapBufferData + lumaPlane.StartIndex,
+                            lumaPlane.Stride,
+                            bitmapBufferData + chromaPlane.StartIndex,
+                            chromaPlane.Stride,
+                            bitmap->PixelWidth,
+                            bitmap->PixelHeight,
+                            Io::Nv12OutputFormat::Bgra8,
+                            kernelOutput.data(),
+                            bitmap->PixelWidth * 4 /* outputStride */);
+                    });
+                }
+
+                //
+                // The scheduling overhead of handing a frame to a worker thread and waiting
+                // for the worker to finish with it.
+                //
+                RunStage(scheduleStatistics, 0, [&]()
+                {
+                    taskExecutor.SubmitLatest(
+                        Io::TaskLane::Compute,
+                        static_cast<uint64_t>(runIndex),
+                        [sensorFrame]()
+                    {
+                        (void)sensorFrame->Timestamp;
+                    });
+
+                    taskExecutor.WaitForIdle();
+                });
+            }
+
+            recorderSink->Stop();
+
+            SensorFrameRingStatistics ringStatistics = {};
+
+            RunStage(persistStatistics, 0, [&]()
+            {
+                ringStatistics = flightRecorderSink->PersistFlightRecording(
+                    outputFolder);
+            });
+
+            persistStatistics.bytes = ringStatistics.NumberOfBytes;
+
+            flightRecorderSink->Stop();
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+            dbg::trace(
+                L"SensorFrameBenchmark: %s flight recorder: %u frames in %llu bytes (peak %llu), %llu dropped",
+                sensorName,
+                ringStatistics.NumberOfFrames,
+                ringStatistics.NumberOfBytes,
+                ringStatistics.PeakNumberOfBytes,
+                ringStatistics.NumberOfDroppedFrames);
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+
+            WriteStatistics(sensorName, generateStatistics, csvWriter);
+            WriteStatistics(sensorName, streamStatistics, csvWriter);
+            WriteStatistics(sensorName, recordStatistics, csvWriter);
+            WriteStatistics(sensorName, encodeStatistics, csvWriter);
+            WriteStatistics(sensorName, flightRecordStatistics, csvWriter);
+            WriteStatistics(sensorName, persistStatistics, csvWriter);
+            WriteStatistics(sensorName, bufferStatistics, csvWriter);
+            WriteStatistics(sensorName, kernelStatistics, csvWriter);
+            WriteStatistics(sensorName, scheduleStatistics, csvWriter);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, operator new is replaced in this library to count the heap allocations
+// made by each benchmark stage. Leave disabled outside of benchmark builds.
+//
+#define SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS 0
+
+namespace HoloLensForCV
+{
+    //
+    // Feeds synthetic frames of all sensor types through the per-frame work of the
+    // streamer (header and payload serialization), the recorder (PGM encoding, tar
+    // and CSV writing), the PNG or JPEG encoding the recorder app uses for the sensor
+    // ("Encode"), the recorder in flight recorder mode (into its ring, and a
+    // single "Persist" of the ring at the end), the multi-frame buffer, the VLC and
+    // NV12 image kernels and the hand-off to an Io::TaskExecutor worker, timing each
+    // stage. PV frames run twice, as Bgra8 ("pv") and as NV12 ("pv_nv12"). The results
+    // are written to "sensor_frame_benchmark.csv" in the output folder, one row per
+    // sensor and stage, for tracking regressions across builds:
+    //
+    //   SensorType,Stage,Frames,FramesPerSecond,MegabytesPerSecond,
+    //   LatencyP50Milliseconds,LatencyP90Milliseconds,LatencyP99Milliseconds,
+    //   LatencyMaxMilliseconds,AllocationsPerFrame,CompressionRatio
+    //
+    // AllocationsPerFrame is -1 unless SENSOR_FRAME_BENCHMARK_COUNT_ALLOCATIONS is set.
+    // CompressionRatio, raw image bytes over encoded bytes, is -1 for all stages but
+    // Encode.
+    // Runs synchronously; call it from a background thread.
+    //
+    public ref class SensorFrameBenchmark sealed
+    {
+    public:
+        static void Run(
+            _In_ Windows::Storage::StorageFolder^ outputFolder,
+            _In_ int32_t numberOfFramesPerSensor);
+    };
+}
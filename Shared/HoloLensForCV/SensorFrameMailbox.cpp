@@ -0,0 +1,369 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    namespace
+    {
+#if SENSOR_FRAME_MAILBOX_MEASURE_LATENCY
+        const size_t c_latencyReportInterval = 300;
+#endif /* SENSOR_FRAME_MAILBOX_MEASURE_LATENCY */
+    }
+
+    SensorFrameMailbox::SensorFrameMailbox(
+        _In_ SensorType sensorType)
+        : _sensorType(sensorType)
+        , _numberOfWaiters(0)
+        , _nextSubscriptionToken(1)
+        , _numberOfSubscribers(0)
+        , _callingSubscriptionToken(0)
+        , _dispatchScheduled(false)
+        , _lastDispatchedTimestamp(0)
+    {
+    }
+
+    void SensorFrameMailbox::Send(
+        _In_ SensorFrame^ sensorFrame)
+    {
+        std::shared_ptr<Entry> entry =
+            std::make_shared<Entry>();
+
+        entry->sensorFrame = sensorFrame;
+        entry->timestamp = sensorFrame->Timestamp.UniversalTime;
+
+#if SENSOR_FRAME_MAILBOX_MEASURE_LATENCY
+        entry->consumed = false;
+#endif /* SENSOR_FRAME_MAILBOX_MEASURE_LATENCY */
+
+        std::atomic_store(
+            &_latestEntry,
+            entry);
+
+        if (_numberOfWaiters > 0)
+        {
+            std::vector<std::pair<int64_t, Concurrency::task_completion_event<SensorFrame^>>> completedWaits;
+
+            {
+                std::lock_guard<std::mutex> lock(_waitMutex);
+
+                auto asyncWait = _asyncWaits.begin();
+
+                while (asyncWait != _asyncWaits.end())
+                {
+                    if (asyncWait->first < entry->timestamp)
+                    {
+                        completedWaits.push_back(*asyncWait);
+                        asyncWait = _asyncWaits.erase(asyncWait);
+
+                        --_numberOfWaiters;
+                    }
+                    else
+                    {
+                        ++asyncWait;
+                    }
+                }
+            }
+
+            _frameArrived.notify_all();
+
+            for (auto& completedWait : completedWaits)
+            {
+                RecordLatency(*entry, Consumer::Wait);
+
+                completedWait.second.set(
+                    sensorFrame);
+            }
+        }
+
+        if (_numberOfSubscribers > 0 && !_dispatchScheduled.exchange(true))
+        {
+            SensorFrameMailbox^ mailbox = this;
+
+            Concurrency::create_task([mailbox]()
+            {
+                mailbox->DispatchToSubscribers();
+            });
+        }
+    }
+
+    SensorFrame^ SensorFrameMailbox::GetLatestFrame()
+    {
+        std::shared_ptr<Entry> entry =
+            LoadLatestEntry();
+
+        if (nullptr == entry)
+        {
+            return nullptr;
+        }
+
+        RecordLatency(*entry, Consumer::Polling);
+
+        return entry->sensorFrame;
+    }
+
+    SensorFrame^ SensorFrameMailbox::WaitForFrameNewerThan(
+        _In_ Windows::Foundation::DateTime timestamp,
+        _In_ int32_t timeoutInMilliseconds)
+    {
+        std::shared_ptr<Entry> entry;
+
+        {
+            std::unique_lock<std::mutex> lock(_waitMutex);
+
+            ++_numberOfWaiters;
+
+            _frameArrived.wait_for(
+                lock,
+                std::chrono::milliseconds(timeoutInMilliseconds),
+                [&]()
+            {
+                entry = LoadLatestEntry();
+
+                return nullptr != entry && entry->timestamp > timestamp.UniversalTime;
+            });
+
+            --_numberOfWaiters;
+        }
+
+        if (nullptr == entry || entry->timestamp <= timestamp.UniversalTime)
+        {
+            return nullptr;
+        }
+
+        RecordLatency(*entry, Consumer::Wait);
+
+        return entry->sensorFrame;
+    }
+
+    Windows::Foundation::IAsyncOperation<SensorFrame^>^ SensorFrameMailbox::WaitForFrameNewerThanAsync(
+        _In_ Windows::Foundation::DateTime timestamp)
+    {
+        Concurrency::task_completion_event<SensorFrame^> frameArrived;
+
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+
+            ++_numberOfWaiters;
+
+            //
+            // Check after registering: a frame published before the registration is
+            // seen here, one published after it completes the wait in Send.
+            //
+            std::shared_ptr<Entry> entry =
+                LoadLatestEntry();
+
+            if (nullptr != entry && entry->timestamp > timestamp.UniversalTime)
+            {
+                --_numberOfWaiters;
+
+                frameArrived.set(
+                    entry->sensorFrame);
+            }
+            else
+            {
+                _asyncWaits.push_back(
+                    std::make_pair(
+                        timestamp.UniversalTime,
+                        frameArrived));
+            }
+        }
+
+        return Concurrency::create_async([frameArrived]()
+        {
+            return Concurrency::create_task(frameArrived);
+        });
+    }
+
+    int64_t SensorFrameMailbox::Subscribe(
+        _In_ SensorFrameArrivedHandler^ handler)
+    {
+        REQUIRES(nullptr != handler);
+
+        std::lock_guard<std::mutex> lock(_subscribersMutex);
+
+        const int64_t subscriptionToken =
+            _nextSubscriptionToken++;
+
+        _subscribers[subscriptionToken] = handler;
+        _numberOfSubscribers = static_cast<int32_t>(_subscribers.size());
+
+        return subscriptionToken;
+    }
+
+    void SensorFrameMailbox::Unsubscribe(
+        _In_ int64_t subscriptionToken)
+    {
+        std::unique_lock<std::mutex> lock(_subscribersMutex);
+
+        _subscribers.erase(subscriptionToken);
+        _numberOfSubscribers = static_cast<int32_t>(_subscribers.size());
+
+        //
+        // The handler may be running on the dispatch thread. Waiting for it from within
+        // a handler would never return.
+        //
+        if (0 != _callingSubscriptionToken &&
+            _callingThreadId == std::this_thread::get_id())
+        {
+            return;
+        }
+
+        _handlerReturned.wait(
+            lock,
+            [&]() { return _callingSubscriptionToken != subscriptionToken; });
+    }
+
+    std::shared_ptr<SensorFrameMailbox::Entry> SensorFrameMailbox::LoadLatestEntry() const
+    {
+        return std::atomic_load(
+            &_latestEntry);
+    }
+
+    void SensorFrameMailbox::DispatchToSubscribers()
+    {
+        //
+        // Only one dispatch runs at a time (see _dispatchScheduled), so the handlers of
+        // a mailbox are never called concurrently.
+        //
+        while (true)
+        {
+            std::shared_ptr<Entry> entry =
+                LoadLatestEntry();
+
+            if (nullptr == entry || entry->timestamp <= _lastDispatchedTimestamp)
+            {
+                _dispatchScheduled = false;
+
+                //
+                // A frame published after the load above but before the flag was cleared
+                // did not schedule a dispatch; pick it up here unless another one did.
+                //
+                entry = LoadLatestEntry();
+
+                if (nullptr == entry ||
+                    entry->timestamp <= _lastDispatchedTimestamp ||
+                    _dispatchScheduled.exchange(true))
+                {
+                    return;
+                }
+            }
+
+            _lastDispatchedTimestamp = entry->timestamp;
+
+            RecordLatency(*entry, Consumer::Callback);
+
+            //
+            // Walk the subscribers in token order, looking each one up right before its
+            // handler is called, so that a subscriber that was unsubscribed in the
+            // meantime is skipped, and Unsubscribe can wait for the call in progress.
+            //
+            int64_t previousSubscriptionToken = 0;
+
+            while (true)
+            {
+                SensorFrameArrivedHandler^ handler;
+
+                {
+                    std::lock_guard<std::mutex> lock(_subscribersMutex);
+
+                    const auto subscriber =
+                        _subscribers.upper_bound(previousSubscriptionToken);
+
+                    if (subscriber == _subscribers.end())
+                    {
+                        break;
+                    }
+
+                    previousSubscriptionToken = subscriber->first;
+                    handler = subscriber->second;
+
+                    _callingSubscriptionToken = subscriber->first;
+                    _callingThreadId = std::this_thread::get_id();
+                }
+
+                try
+                {
+                    handler(entry->sensorFrame);
+                }
+                catch (Platform::Exception^ exception)
+                {
+#if DBG_ENABLE_ERROR_LOGGING
+                    dbg::trace(
+                        L"SensorFrameMailbox::DispatchToSubscribers: handler failed with error: %s",
+                        exception->Message->Data());
+#endif /* DBG_ENABLE_ERROR_LOGGING */
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_subscribersMutex);
+
+                    _callingSubscriptionToken = 0;
+                }
+
+                _handlerReturned.notify_all();
+            }
+        }
+    }
+
+    void SensorFrameMailbox::RecordLatency(
+        _In_ Entry& entry,
+        _In_ const Consumer consumer)
+    {
+#if SENSOR_FRAME_MAILBOX_MEASURE_LATENCY
+        //
+        // Only the first consumer of a frame counts: polling picks up the same frame
+        // many times, and all but the first are not delays.
+        //
+        if (entry.consumed.exchange(true))
+        {
+            return;
+        }
+
+        const double latency =
+            entry.publishTimer.GetMillisecondsFromStart();
+
+        std::lock_guard<std::mutex> lock(_latencyMutex);
+
+        std::vector<double>& latencies =
+            _latencies[(size_t)consumer];
+
+        latencies.push_back(
+            latency);
+
+        if (latencies.size() < c_latencyReportInterval)
+        {
+            return;
+        }
+
+        std::sort(
+            latencies.begin(),
+            latencies.end());
+
+        static const wchar_t* c_consumerNames[] = { L"polling", L"wait", L"callback" };
+
+        dbg::trace(
+            L"SensorFrameMailbox: %s, %s: publish to consumption p50 %.03fms, p90 %.03fms, p99 %.03fms, max %.03fms",
+            _sensorType.ToString()->Data(),
+            c_consumerNames[(size_t)consumer],
+            latencies[latencies.size() / 2],
+            latencies[latencies.size() * 9 / 10],
+            latencies[latencies.size() * 99 / 100],
+            latencies.back());
+
+        latencies.clear();
+#else
+        (void)entry;
+        (void)consumer;
+#endif /* SENSOR_FRAME_MAILBOX_MEASURE_LATENCY */
+    }
+}
@@ -0,0 +1,143 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, the time from a frame being published to a consumer first picking it up
+// is measured separately for GetLatestFrame (polling), the waits and the subscriber
+// callbacks, and its percentiles are traced periodically.
+//
+#define SENSOR_FRAME_MAILBOX_MEASURE_LATENCY 0
+
+namespace HoloLensForCV
+{
+    public delegate void SensorFrameArrivedHandler(
+        SensorFrame^ sensorFrame);
+
+    //
+    // Holds the latest frame of one sensor and notifies consumers when a newer one is
+    // published, so that processing can run at the sensor rate instead of polling from
+    // the render loop:
+    //
+    //  - Send publishes a frame with an atomic pointer swap; it only takes a lock when
+    //    a consumer is blocked in a wait.
+    //  - GetLatestFrame returns the latest frame without locking.
+    //  - WaitForFrameNewerThan(Async) completes as soon as a frame with a newer timestamp
+    //    than the given one is published.
+    //  - Subscribed handlers are called on the PPL thread pool, one at a time and always
+    //    with the newest frame: a handler slower than the sensor skips frames instead of
+    //    queueing them.
+    //
+    public ref class SensorFrameMailbox sealed
+        : public ISensorFrameSink
+    {
+    public:
+        SensorFrameMailbox(
+            _In_ SensorType sensorType);
+
+        property SensorType FrameType
+        {
+            SensorType get() { return _sensorType; }
+        }
+
+        virtual void Send(
+            _In_ SensorFrame^ sensorFrame);
+
+        SensorFrame^ GetLatestFrame();
+
+        //
+        // Returns nullptr if no newer frame arrived within the timeout.
+        //
+        SensorFrame^ WaitForFrameNewerThan(
+            _In_ Windows::Foundation::DateTime timestamp,
+            _In_ int32_t timeoutInMilliseconds);
+
+        Windows::Foundation::IAsyncOperation<SensorFrame^>^ WaitForFrameNewerThanAsync(
+            _In_ Windows::Foundation::DateTime timestamp);
+
+        int64_t Subscribe(
+            _In_ SensorFrameArrivedHandler^ handler);
+
+        //
+        // Once this returns, the handler is not called anymore: a call in progress is
+        // waited for, unless the handler unsubscribes itself.
+        //
+        void Unsubscribe(
+            _In_ int64_t subscriptionToken);
+
+    private:
+        struct Entry
+        {
+            SensorFrame^ sensorFrame;
+            int64_t timestamp;
+
+#if SENSOR_FRAME_MAILBOX_MEASURE_LATENCY
+            // Started when the frame is published
+            dbg::Timer publishTimer;
+            std::atomic_bool consumed;
+#endif /* SENSOR_FRAME_MAILBOX_MEASURE_LATENCY */
+        };
+
+        enum class Consumer
+        {
+            Polling,
+            Wait,
+            Callback,
+
+            NumberOfConsumers
+        };
+
+        std::shared_ptr<Entry> LoadLatestEntry() const;
+
+        void DispatchToSubscribers();
+
+        void RecordLatency(
+            _In_ Entry& entry,
+            _In_ const Consumer consumer);
+
+        SensorType _sensorType;
+
+        std::shared_ptr<Entry> _latestEntry;
+
+        //
+        // Waiters register themselves before checking for a newer frame, so that Send
+        // knows whether it needs to take the lock and notify.
+        //
+        std::atomic<int32_t> _numberOfWaiters;
+        std::mutex _waitMutex;
+        std::condition_variable _frameArrived;
+        std::vector<std::pair<int64_t, Concurrency::task_completion_event<SensorFrame^>>> _asyncWaits;
+
+        std::mutex _subscribersMutex;
+        std::map<int64_t, SensorFrameArrivedHandler^> _subscribers;
+        int64_t _nextSubscriptionToken;
+        std::atomic<int32_t> _numberOfSubscribers;
+
+        // The subscriber whose handler is being called, or zero, and the calling thread
+        int64_t _callingSubscriptionToken;
+        std::thread::id _callingThreadId;
+        std::condition_variable _handlerReturned;
+
+        std::atomic_bool _dispatchScheduled;
+
+        //
+        // Read by a dispatch that is about to return while the next one may already
+        // be running.
+        //
+        std::atomic<int64_t> _lastDispatchedTimestamp;
+
+#if SENSOR_FRAME_MAILBOX_MEASURE_LATENCY
+        std::mutex _latencyMutex;
+        std::array<std::vector<double>, (size_t)Consumer::NumberOfConsumers> _latencies;
+#endif /* SENSOR_FRAME_MAILBOX_MEASURE_LATENCY */
+    };
+}
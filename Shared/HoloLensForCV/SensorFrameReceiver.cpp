@@ -95,7 +95,7 @@ namespace HoloLensForCV
     {
         return concurrency::create_task(
             _reader->LoadAsync(
-                header->ImageHeight * header->RowStride)).
+                header->ImageBufferSize)).
             then([this, header](concurrency::task<unsigned int> frameBytesLoadedTaskResult)
         {
             //
@@ -105,12 +105,12 @@ namespace HoloLensForCV
             //
             const size_t frameBytesLoaded = frameBytesLoadedTaskResult.get();
 
-            if (header->ImageHeight * header->RowStride != frameBytesLoaded)
+            if (header->ImageBufferSize != frameBytesLoaded)
             {
 #if DBG_ENABLE_ERROR_LOGGING
                 dbg::trace(
                     L"SensorFrameReceiver::ReceiveAsync: expected image frame data of %i bytes, got %i bytes",
-                    header->ImageHeight * header->RowStride,
+                    header->ImageBufferSize,
                     frameBytesLoaded);
 #endif /* DBG_ENABLE_ERROR_LOGGING */
 
@@ -127,7 +127,10 @@ namespace HoloLensForCV
             switch (header->FrameType)
             {
             case SensorType::PhotoVideo:
-                pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
+                pixelFormat =
+                    Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == header->PixelFormat
+                        ? Windows::Graphics::Imaging::BitmapPixelFormat::Nv12
+                        : Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
                 break;
 
             case SensorType::ShortThrowToFDepth:
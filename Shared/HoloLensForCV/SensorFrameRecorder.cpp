@@ -14,7 +14,13 @@
 namespace HoloLensForCV
 {
     SensorFrameRecorder::SensorFrameRecorder()
+        : _flightRecorderDuration(0)
+        , _flightRecorderSize(0)
+        , _flightRecorderStarted(false)
+        , _jpegQuality(90)
     {
+        _imageCodecs.fill(
+            RecordingImageCodec::Netpbm);
     }
 
     SensorFrameRecorder::~SensorFrameRecorder()
@@ -62,24 +68,199 @@ namespace HoloLensForCV
             sensorFrameSink;
     }
 
+    int32_t SensorFrameRecorder::SegmentDurationInSeconds::get()
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        return (int32_t)(_segmentPolicy.MaximumDuration / 10000000);
+    }
+
+    void SensorFrameRecorder::SegmentDurationInSeconds::set(
+        int32_t value)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        REQUIRES(
+            0 <= value &&
+            nullptr == _archiveSourceFolder);
+
+        _segmentPolicy.MaximumDuration =
+            (int64_t)value * 10000000;
+    }
+
+    int32_t SensorFrameRecorder::SegmentSizeInMegabytes::get()
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        return (int32_t)(_segmentPolicy.MaximumSize / (1024 * 1024));
+    }
+
+    void SensorFrameRecorder::SegmentSizeInMegabytes::set(
+        int32_t value)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        REQUIRES(
+            0 <= value &&
+            nullptr == _archiveSourceFolder);
+
+        _segmentPolicy.MaximumSize =
+            (uint64_t)value * 1024 * 1024;
+    }
+
+    int32_t SensorFrameRecorder::FlightRecorderDurationInSeconds::get()
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        return (int32_t)(_flightRecorderDuration / 10000000);
+    }
+
+    void SensorFrameRecorder::FlightRecorderDurationInSeconds::set(
+        int32_t value)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        REQUIRES(
+            0 <= value &&
+            !_flightRecorderStarted &&
+            nullptr == _archiveSourceFolder);
+
+        _flightRecorderDuration =
+            (int64_t)value * 10000000;
+    }
+
+    int32_t SensorFrameRecorder::FlightRecorderSizeInMegabytes::get()
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        return (int32_t)(_flightRecorderSize / (1024 * 1024));
+    }
+
+    void SensorFrameRecorder::FlightRecorderSizeInMegabytes::set(
+        int32_t value)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        REQUIRES(
+            0 <= value &&
+            !_flightRecorderStarted &&
+            nullptr == _archiveSourceFolder);
+
+        _flightRecorderSize =
+            (uint64_t)value * 1024 * 1024;
+    }
+
+    int32_t SensorFrameRecorder::JpegQuality::get()
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        return _jpegQuality;
+    }
+
+    void SensorFrameRecorder::JpegQuality::set(
+        int32_t value)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        REQUIRES(
+            0 <= value && value <= 100 &&
+            !_flightRecorderStarted &&
+            nullptr == _archiveSourceFolder);
+
+        _jpegQuality = value;
+    }
+
+    void SensorFrameRecorder::SetImageCodec(
+        _In_ SensorType sensorType,
+        _In_ RecordingImageCodec imageCodec)
+    {
+        std::lock_guard<std::mutex> recorderLockGuard(
+            _recorderMutex);
+
+        const int32_t sensorTypeAsIndex =
+            (int32_t)sensorType;
+
+        REQUIRES(
+            0 <= sensorTypeAsIndex &&
+            sensorTypeAsIndex < (int32_t)_imageCodecs.size() &&
+            !_flightRecorderStarted &&
+            nullptr == _archiveSourceFolder);
+
+        _imageCodecs[sensorTypeAsIndex] =
+            imageCodec;
+    }
+
     Windows::Foundation::IAsyncAction^ SensorFrameRecorder::StartAsync()
     {
         return concurrency::create_async(
             [this]()
         {
-            Windows::Storage::StorageFolder^ temporaryStorageFolder =
-                Windows::Storage::ApplicationData::Current->TemporaryFolder;
+            {
+                std::lock_guard<std::mutex> recorderLockGuard(
+                    _recorderMutex);
+
+                //
+                // In flight recorder mode, nothing is written until the recording is
+                // persisted.
+                //
+                if (0 != _flightRecorderDuration)
+                {
+                    REQUIRES(!_flightRecorderStarted);
+
+                    SetImageEncoding();
+
+                    for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
+                    {
+                        if (nullptr == sensorFrameSink)
+                        {
+                            continue;
+                        }
+
+                        sensorFrameSink->StartFlightRecording(
+                            _flightRecorderDuration,
+                            _flightRecorderSize);
+                    }
 
-            return concurrency::create_task(temporaryStorageFolder->CreateFolderAsync(
-                L"archiveSource",
-                Windows::Storage::CreationCollisionOption::ReplaceExisting)).then(
-                    [&](Windows::Storage::StorageFolder^ archiveSourceFolder)
+                    _flightRecorderStarted = true;
+
+                    return concurrency::task_from_result();
+                }
+            }
+
+            return CreateRecordingFolderAsync().then(
+                [&](Windows::Storage::StorageFolder^ archiveSourceFolder)
                 {
                     std::lock_guard<std::mutex> recorderLockGuard(
                         _recorderMutex);
 
                     _archiveSourceFolder = archiveSourceFolder;
 
+                    //
+                    // Add recording version information.
+                    //
+                    ReportRecorderVersioningInformation(
+                        _archiveSourceFolder);
+
+                    SetImageEncoding();
+
+                    if (_segmentPolicy.IsSegmented())
+                    {
+                        _segmentManifest =
+                            std::make_shared<RecordingSegmentManifest>(
+                                std::wstring(_archiveSourceFolder->Path->Data()) +
+                                L"\\segments.csv");
+                    }
+
                     for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
                     {
                         if (nullptr == sensorFrameSink)
@@ -87,99 +268,267 @@ namespace HoloLensForCV
                             continue;
                         }
 
+                        sensorFrameSink->SetSegmentation(
+                            _segmentPolicy,
+                            _segmentManifest);
+
                         sensorFrameSink->Start(_archiveSourceFolder);
                     }
                 });
         });
     }
 
+    Windows::Foundation::IAsyncAction^ SensorFrameRecorder::PersistFlightRecordingAsync()
+    {
+        return concurrency::create_async(
+            [this]()
+        {
+            //
+            // Measures the latency from the trigger to the last file written.
+            //
+            const dbg::Timer triggerTimer;
+
+            //
+            // The frames are taken out of the rings at the trigger, under the recorder
+            // lock, and written without it, so that the recorder can be stopped or
+            // triggered again while they are written.
+            //
+            typedef std::vector<std::pair<SensorFrameRecorderSink^, SensorFrameFlightRecording>> FlightRecordings;
+
+            std::shared_ptr<FlightRecordings> flightRecordings =
+                std::make_shared<FlightRecordings>();
+
+            {
+                std::lock_guard<std::mutex> recorderLockGuard(
+                    _recorderMutex);
+
+                REQUIRES(_flightRecorderStarted);
+
+                for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
+                {
+                    if (nullptr == sensorFrameSink)
+                    {
+                        continue;
+                    }
+
+                    flightRecordings->emplace_back(
+                        sensorFrameSink,
+                        sensorFrameSink->TakeFlightRecording());
+                }
+            }
+
+            return CreateRecordingFolderAsync().then(
+                [this, triggerTimer, flightRecordings](Windows::Storage::StorageFolder^ recordingFolder)
+                {
+                    ReportRecorderVersioningInformation(
+                        recordingFolder);
+
+                    //
+                    // Account for the memory each sensor's ring held and the time its
+                    // frames took to write, in "flight_recording.csv".
+                    //
+                    wchar_t fileName[MAX_PATH] = {};
+
+                    swprintf_s(
+                        fileName,
+                        L"%s\\flight_recording.csv",
+                        recordingFolder->Path->Data());
+
+                    CsvWriter csvWriter(
+                        fileName);
+
+                    {
+                        std::vector<std::wstring> columns;
+
+                        columns.push_back(L"SensorName");
+                        columns.push_back(L"NumberOfFrames");
+                        columns.push_back(L"FirstTimestamp");
+                        columns.push_back(L"LastTimestamp");
+                        columns.push_back(L"NumberOfBytes");
+                        columns.push_back(L"PeakNumberOfBytes");
+                        columns.push_back(L"NumberOfDroppedFrames");
+                        columns.push_back(L"PersistMilliseconds");
+                        columns.push_back(L"TriggerToPersistMilliseconds");
+
+                        csvWriter.WriteHeader(
+                            columns);
+                    }
+
+                    dbg::Timer persistTimer;
+
+                    for (const auto& flightRecording : *flightRecordings)
+                    {
+                        SensorFrameRecorderSink^ sensorFrameSink =
+                            flightRecording.first;
+
+                        const SensorFrameRingStatistics& statistics =
+                            flightRecording.second.Statistics;
+
+                        persistTimer.MarkEvent();
+
+                        sensorFrameSink->WriteFlightRecording(
+                            flightRecording.second,
+                            recordingFolder);
+
+                        bool writeComma = false;
+
+                        csvWriter.WriteText(sensorFrameSink->GetSensorName()->Data(), &writeComma);
+                        csvWriter.WriteUInt64(statistics.NumberOfFrames, &writeComma);
+                        csvWriter.WriteUInt64(statistics.FirstTimestamp, &writeComma);
+                        csvWriter.WriteUInt64(statistics.LastTimestamp, &writeComma);
+                        csvWriter.WriteUInt64(statistics.NumberOfBytes, &writeComma);
+                        csvWriter.WriteUInt64(statistics.PeakNumberOfBytes, &writeComma);
+                        csvWriter.WriteUInt64(statistics.NumberOfDroppedFrames, &writeComma);
+                        csvWriter.WriteDouble(persistTimer.GetMillisecondsFromLastEvent(), &writeComma);
+                        csvWriter.WriteDouble(triggerTimer.GetMillisecondsFromStart(), &writeComma);
+                        csvWriter.EndLine();
+                    }
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+                    dbg::trace(
+                        L"SensorFrameRecorder::PersistFlightRecordingAsync: %s persisted %.03fms after the trigger",
+                        recordingFolder->Name->Data(),
+                        triggerTimer.GetMillisecondsFromStart());
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+                });
+        });
+    }
+
     void SensorFrameRecorder::Stop()
     {
         std::lock_guard<std::mutex> recorderLockGuard(
             _recorderMutex);
 
-        //
-        // Build a list of files to archive.
-        //
-        std::vector<std::wstring> sourceFiles;
-
-		for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
-		{
-			if (nullptr == sensorFrameSink)
-			{
-				continue;
-			}
+        if (_flightRecorderStarted)
+        {
+            //
+            // Discards the frames that were not persisted.
+            //
+            for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
+            {
+                if (nullptr == sensorFrameSink)
+                {
+                    continue;
+                }
 
-			sensorFrameSink->Stop();
+                sensorFrameSink->Stop();
+            }
 
-		}
+            _flightRecorderStarted = false;
 
-		for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
-		{
-			if (nullptr == sensorFrameSink)
-			{
-				continue;
-			}
+            return;
+        }
 
-            sensorFrameSink->ReportArchiveSourceFiles(sourceFiles);
+        if (nullptr == _archiveSourceFolder)
+        {
+            return;
         }
 
         //
-        // Add recording version information.
+        // Each sink only finalizes the segment it is recording (and writes its camera
+        // calibration, if no segment was finalized yet), so that stopping takes about
+        // as long for a long recording as for a short one.
         //
-        ReportRecorderVersioningInformation(sourceFiles);
+        for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
+        {
+            if (nullptr == sensorFrameSink)
+            {
+                continue;
+            }
 
-        //
-        // Add a description of camera intrinsics.
-        //
-        ReportCameraCalibrationInformation(sourceFiles);
+            sensorFrameSink->Stop();
+        }
+
+        _segmentManifest.reset();
+
+        _archiveSourceFolder = nullptr;
+    }
 
+    void SensorFrameRecorder::SetImageEncoding()
+    {
         //
-        // Create a TAR file containing all the recording files reported so far.
+        // Netpbm files are cheap enough to write on the sensor threads; the other codecs
+        // share two encoder threads, leaving the remaining cores to the application.
         //
+        const bool anyImagesToEncode =
+            std::any_of(
+                _imageCodecs.begin(),
+                _imageCodecs.end(),
+                [](RecordingImageCodec imageCodec) { return RecordingImageCodec::Netpbm != imageCodec; });
+
+        if (anyImagesToEncode && nullptr == _encoderExecutor)
         {
-            const auto timeNow =
-                _time64(
-                    nullptr /* timer */);
-
-            std::tm timeNowUtc;
-
-            ASSERT(0 == _gmtime64_s(
-                &timeNowUtc,
-                &timeNow));
-
-            wchar_t archiveName[MAX_PATH] = {};
-
-            swprintf_s(
-                archiveName,
-                L"HoloLensRecording__%04i_%02i_%02i__%02i_%02i_%02i",
-                timeNowUtc.tm_year + 1900,
-                timeNowUtc.tm_mon + 1,
-                timeNowUtc.tm_mday,
-                timeNowUtc.tm_hour,
-                timeNowUtc.tm_min,
-                timeNowUtc.tm_sec);
-
-            Platform::String^ archiveNameString =
-                ref new Platform::String(archiveName);
-            _archiveSourceFolder->RenameAsync(archiveNameString);
+            _encoderExecutor =
+                std::make_shared<Io::TaskExecutor>(
+                    2 /* numberOfWorkers */);
         }
 
-        _archiveSourceFolder = nullptr;
+        for (size_t sensorTypeAsIndex = 0; sensorTypeAsIndex < _sensorFrameSinks.size(); ++sensorTypeAsIndex)
+        {
+            SensorFrameRecorderSink^ sensorFrameSink =
+                _sensorFrameSinks[sensorTypeAsIndex];
+
+            if (nullptr == sensorFrameSink)
+            {
+                continue;
+            }
+
+            const RecordingImageCodec imageCodec =
+                _imageCodecs[sensorTypeAsIndex];
+
+            sensorFrameSink->SetImageEncoding(
+                imageCodec,
+                _jpegQuality,
+                RecordingImageCodec::Netpbm != imageCodec ? _encoderExecutor : nullptr);
+        }
+    }
+
+    concurrency::task<Windows::Storage::StorageFolder^> SensorFrameRecorder::CreateRecordingFolderAsync()
+    {
+        Windows::Storage::StorageFolder^ temporaryStorageFolder =
+            Windows::Storage::ApplicationData::Current->TemporaryFolder;
+
+        //
+        // Recording folders are named when they are created, when the recording is
+        // started or a flight recording is persisted, so that the segments of a
+        // recording can be downloaded while it continues.
+        //
+        const auto timeNow =
+            _time64(
+                nullptr /* timer */);
+
+        std::tm timeNowUtc;
+
+        ASSERT(0 == _gmtime64_s(
+            &timeNowUtc,
+            &timeNow));
+
+        wchar_t recordingName[MAX_PATH] = {};
+
+        swprintf_s(
+            recordingName,
+            L"HoloLensRecording__%04i_%02i_%02i__%02i_%02i_%02i",
+            timeNowUtc.tm_year + 1900,
+            timeNowUtc.tm_mon + 1,
+            timeNowUtc.tm_mday,
+            timeNowUtc.tm_hour,
+            timeNowUtc.tm_min,
+            timeNowUtc.tm_sec);
+
+        return concurrency::create_task(temporaryStorageFolder->CreateFolderAsync(
+            ref new Platform::String(recordingName),
+            Windows::Storage::CreationCollisionOption::GenerateUniqueName));
     }
 
     void SensorFrameRecorder::ReportRecorderVersioningInformation(
-        _Inout_ std::vector<std::wstring>& sourceFiles)
+        _In_ Windows::Storage::StorageFolder^ recordingFolder)
     {
         wchar_t fileName[MAX_PATH] = {};
 
         swprintf_s(
             fileName,
             L"%s\\recording_version_information.csv",
-            _archiveSourceFolder->Path->Data());
-
-        sourceFiles.push_back(
-            L"recording_version_information.csv");
+            recordingFolder->Path->Data());
 
         CsvWriter csvWriter(
             fileName);
@@ -207,69 +556,6 @@ namespace HoloLensForCV
         csvWriter.EndLine();
     }
 
-    void SensorFrameRecorder::ReportCameraCalibrationInformation(
-        _Inout_ std::vector<std::wstring>& sourceFiles)
-    {
-        // TODO: Support PV calibration.
-
-        for (SensorFrameRecorderSink^ sensorFrameSink : _sensorFrameSinks)
-        {
-            if (nullptr == sensorFrameSink)
-            {
-                continue;
-            }
-
-            auto cameraIntrinsics =
-                sensorFrameSink->GetCameraIntrinsics();
-
-            if (nullptr == cameraIntrinsics)
-            {
-                continue;
-            }
-
-            wchar_t fileName[MAX_PATH] = {};
-
-            swprintf_s(
-                fileName,
-                L"%s\\%s_camera_space_projection.bin",
-                _archiveSourceFolder->Path->Data(),
-                sensorFrameSink->GetSensorName()->Data());
-
-            sourceFiles.push_back(fileName);
-
-            std::vector<Windows::Foundation::Point> pointList;
-            pointList.resize(cameraIntrinsics->ImageWidth * cameraIntrinsics->ImageHeight);
-            size_t index = 0;
-            for (unsigned int x = 0; x < cameraIntrinsics->ImageWidth; ++x)
-            {
-                for (unsigned int y = 0; y < cameraIntrinsics->ImageHeight; ++y)
-                {
-                    Windows::Foundation::Point uv = { float(x), float(y) }, xy;
-                    cameraIntrinsics->MapImagePointToCameraUnitPlane(uv, &xy);
-                    pointList[index++] = xy;
-                }
-            }
-
-            //TODO: Better conversion to char*
-            std::wstring ws(fileName);
-            std::string outputFilePath;
-            outputFilePath.assign(ws.begin(), ws.end());
-
-            FILE* file = nullptr;
-            ASSERT(0 == fopen_s(&file, outputFilePath.c_str(), "wb"));
-
-            size_t expectedSize = pointList.size() * sizeof(Windows::Foundation::Point);
-            ASSERT(expectedSize == fwrite(
-                reinterpret_cast<uint8_t*>(&pointList[0]),
-                sizeof(uint8_t),
-                expectedSize,
-                file));
-
-            ASSERT(0 == fclose(file));
-
-        }
-    }
-
     ISensorFrameSink^ SensorFrameRecorder::GetSensorFrameSink(
         _In_ SensorType sensorType)
     {
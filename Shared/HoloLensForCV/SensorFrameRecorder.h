@@ -15,8 +15,23 @@ namespace HoloLensForCV
 {
     //
     // Collects sensor frames for all the enabled sensors. Uses the recorder sink to save
-    // the individual sensor frames to disk. Once recording is stopped, collects all the
-    // images and meta-data and combines them into a single tarball.
+    // the individual sensor frames to disk, into a "HoloLensRecording__<start time>" folder
+    // with a tarball and a CSV file per sensor.
+    //
+    // With a segment duration or size set, each sensor is instead recorded into a series of
+    // segments, which are listed in the folder's "segments.csv" as they are finalized (see
+    // RecordingSegmentManifest). Host tools can download the listed segments while the
+    // recording continues, and stopping only needs to finalize the current segments.
+    //
+    // With a flight recorder duration set, the recorder keeps the frames of the last
+    // seconds of every enabled sensor in memory once started, and only writes them to
+    // a recording when PersistFlightRecordingAsync is called, e.g. when something of
+    // interest happened.
+    //
+    // Images are stored as binary PGM/PPM files unless another codec is set for their
+    // sensor. Those are encoded on a small pool of worker threads rather than on the
+    // threads that deliver the sensor frames, and the codec of every frame is listed in
+    // the ImageCodec column of the sensor's CSV file.
     //
     // Refer to 'Samples\BatchProcessing' for an example use of the recorded information.
     //
@@ -33,9 +48,60 @@ namespace HoloLensForCV
 
         static property uint8_t RecordingVersionMinor
         {
-            uint8_t get() { return 0x01; }
+            uint8_t get() { return 0x03; }
+        }
+
+        //
+        // Maximum sensor time, in seconds, and tarball size, in megabytes, of a segment.
+        // Zero, the default, does not limit it. Must be set before the recording is started.
+        //
+        property int32_t SegmentDurationInSeconds
+        {
+            int32_t get();
+            void set(int32_t value);
+        }
+
+        property int32_t SegmentSizeInMegabytes
+        {
+            int32_t get();
+            void set(int32_t value);
+        }
+
+        //
+        // Sensor time, in seconds, kept for each sensor in flight recorder mode, and
+        // the most memory, in megabytes, each sensor's frames may take; the oldest
+        // frames are dropped once either is exceeded. Zero, the default duration,
+        // disables the flight recorder mode. Must be set before the recorder is started.
+        //
+        property int32_t FlightRecorderDurationInSeconds
+        {
+            int32_t get();
+            void set(int32_t value);
         }
 
+        property int32_t FlightRecorderSizeInMegabytes
+        {
+            int32_t get();
+            void set(int32_t value);
+        }
+
+        //
+        // Quality, from 0 to 100, of the images stored as JPEG. Defaults to 90.
+        //
+        property int32_t JpegQuality
+        {
+            int32_t get();
+            void set(int32_t value);
+        }
+
+        //
+        // Sets the codec of the images of the sensor. Must be set before the recorder is
+        // started.
+        //
+        void SetImageCodec(
+            _In_ SensorType sensorType,
+            _In_ RecordingImageCodec imageCodec);
+
         void EnableAll();
 
         void Enable(
@@ -43,6 +109,13 @@ namespace HoloLensForCV
 
         Windows::Foundation::IAsyncAction^ StartAsync();
 
+        //
+        // Writes the frames kept in flight recorder mode to a new recording, with the
+        // memory each sensor held and the trigger-to-persist latency in its
+        // "flight_recording.csv". The recorder continues to keep the following frames.
+        //
+        Windows::Foundation::IAsyncAction^ PersistFlightRecordingAsync();
+
         void Stop();
 
         virtual ISensorFrameSink^ GetSensorFrameSink(
@@ -54,17 +127,29 @@ namespace HoloLensForCV
         const wchar_t* GetSensorName(
             SensorType sensorType);
 
+        concurrency::task<Windows::Storage::StorageFolder^> CreateRecordingFolderAsync();
+
         void ReportRecorderVersioningInformation(
-            _Inout_ std::vector<std::wstring>& sourceFiles);
+            _In_ Windows::Storage::StorageFolder^ recordingFolder);
 
-        void ReportCameraCalibrationInformation(
-            _Inout_ std::vector<std::wstring>& sourceFiles);
+        void SetImageEncoding();
 
     private:
         std::mutex _recorderMutex;
 
         Windows::Storage::StorageFolder^ _archiveSourceFolder;
 
+        RecordingSegmentPolicy _segmentPolicy;
+        std::shared_ptr<RecordingSegmentManifest> _segmentManifest;
+
+        int64_t _flightRecorderDuration;
+        uint64_t _flightRecorderSize;
+        bool _flightRecorderStarted;
+
+        std::array<RecordingImageCodec, (size_t)SensorType::NumberOfSensorTypes> _imageCodecs;
+        int32_t _jpegQuality;
+        std::shared_ptr<Io::TaskExecutor> _encoderExecutor;
+
         std::array<SensorFrameRecorderSink^, (size_t)SensorType::NumberOfSensorTypes> _sensorFrameSinks;
     };
 }
@@ -13,10 +13,27 @@
 
 namespace HoloLensForCV
 {
+	namespace
+	{
+		//
+		// How many frames of a sensor may wait for the encoders before new frames
+		// are dropped.
+		//
+		const uint32_t kMaximumNumberOfFramesInFlight = 8;
+	}
+
 	SensorFrameRecorderSink::SensorFrameRecorderSink(
 		_In_ SensorType sensorType,
 		_In_ Platform::String^ sensorName)
 		: _sensorType(sensorType), _sensorName(sensorName)
+		, _cameraCalibrationWritten(false)
+		, _pixelBufferPool(Io::PixelBufferPool::Create(kMaximumNumberOfFramesInFlight + 1))
+		, _imageCodec(RecordingImageCodec::Netpbm)
+		, _jpegQuality(90)
+		, _nextSequenceNumber(0)
+		, _nextCommittedSequenceNumber(0)
+		, _numberOfFramesInFlight(0)
+		, _numberOfDroppedFrames(0)
 	{
 	}
 
@@ -25,27 +42,222 @@ namespace HoloLensForCV
 		Stop();
 	}
 
+	void SensorFrameRecorderSink::SetSegmentation(
+		_In_ const RecordingSegmentPolicy& segmentPolicy,
+		_In_ const std::shared_ptr<RecordingSegmentManifest>& segmentManifest)
+	{
+		std::lock_guard<std::mutex> guard(_sinkMutex);
+
+		REQUIRES(nullptr == _archiveSourceFolder);
+
+		_segmentPolicy = segmentPolicy;
+		_segmentManifest = segmentManifest;
+	}
+
+	void SensorFrameRecorderSink::SetImageEncoding(
+		_In_ RecordingImageCodec imageCodec,
+		_In_ int32_t jpegQuality,
+		_In_ const std::shared_ptr<Io::TaskExecutor>& encoderExecutor)
+	{
+		std::lock_guard<std::mutex> guard(_sinkMutex);
+
+		REQUIRES(nullptr == _archiveSourceFolder && nullptr == _frameRing);
+		REQUIRES(0 <= jpegQuality && jpegQuality <= 100);
+
+		_imageCodec = imageCodec;
+		_jpegQuality = jpegQuality;
+		_encoderExecutor = encoderExecutor;
+	}
+
 	void SensorFrameRecorderSink::Start(
 		_In_ Windows::Storage::StorageFolder^ archiveSourceFolder)
 	{
 		std::lock_guard<std::mutex> guard(_sinkMutex);
 
 		// Remember the root folder for the recorded sensor meta-data.
-		REQUIRES(nullptr == _archiveSourceFolder);
+		REQUIRES(nullptr == _archiveSourceFolder && nullptr == _frameRing);
 		_archiveSourceFolder = archiveSourceFolder;
 
+		_cameraCalibrationWritten = false;
+
+		_segment.SensorName = _sensorName->Data();
+		_segment.SegmentIndex = 0;
+
+		OpenSegment();
+	}
+
+	void SensorFrameRecorderSink::Stop()
+	{
+		std::unique_lock<std::mutex> lock(_sinkMutex);
+
+		// Let the frames being encoded make it into the recording.
+		_framesInFlightCondition.wait(
+			lock,
+			[this]() { return 0 == _numberOfFramesInFlight; });
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+		if (0 != _numberOfDroppedFrames)
+		{
+			dbg::trace(
+				L"SensorFrameRecorderSink::Stop: %s: dropped %llu frames the encoders could not keep up with",
+				_sensorName->Data(),
+				_numberOfDroppedFrames);
+		}
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+
+		_numberOfDroppedFrames = 0;
+
+		// Frames that were not persisted are discarded.
+		_frameRing.reset();
+
+		if (nullptr == _archiveSourceFolder)
+		{
+			return;
+		}
+
+		// Only the segment being recorded is left to finalize.
+		FinalizeSegment();
+
+		if (!_cameraCalibrationWritten)
+		{
+			WriteCameraCalibration(
+				_archiveSourceFolder,
+				_cameraIntrinsics);
+
+			_cameraCalibrationWritten = true;
+		}
+
+		_archiveSourceFolder = nullptr;
+	}
+
+	void SensorFrameRecorderSink::StartFlightRecording(
+		_In_ int64_t maximumDuration,
+		_In_ uint64_t maximumSize)
+	{
+		std::lock_guard<std::mutex> guard(_sinkMutex);
+
+		REQUIRES(nullptr == _archiveSourceFolder && nullptr == _frameRing);
+
+		_frameRing.reset(
+			new SensorFrameRing(
+				maximumDuration,
+				maximumSize));
+	}
+
+	SensorFrameFlightRecording SensorFrameRecorderSink::TakeFlightRecording()
+	{
+		std::lock_guard<std::mutex> guard(_sinkMutex);
+
+		REQUIRES(nullptr != _frameRing);
+
+		SensorFrameFlightRecording flightRecording;
+
+		flightRecording.Statistics = _frameRing->GetStatistics();
+		flightRecording.Frames = _frameRing->TakeFrames();
+		flightRecording.SensorCameraIntrinsics = _cameraIntrinsics;
+
+		return flightRecording;
+	}
+
+	void SensorFrameRecorderSink::WriteFlightRecording(
+		_In_ const SensorFrameFlightRecording& flightRecording,
+		_In_ Windows::Storage::StorageFolder^ folder)
+	{
+		{
+			wchar_t tarballFileName[MAX_PATH] = {};
+			swprintf_s(
+				tarballFileName,
+				L"%s\\%s.tar",
+				folder->Path->Data(),
+				_sensorName->Data());
+
+			wchar_t csvFileName[MAX_PATH] = {};
+			swprintf_s(
+				csvFileName,
+				L"%s\\%s.csv",
+				folder->Path->Data(),
+				_sensorName->Data());
+
+			Io::Tarball tarball(tarballFileName);
+			CsvWriter csvWriter(csvFileName);
+
+			WriteCsvHeader(
+				csvWriter);
+
+			for (const RecordedSensorFrame& frame : flightRecording.Frames)
+			{
+				WriteFrame(
+					frame,
+					tarball,
+					csvWriter);
+			}
+		}
+
+		WriteCameraCalibration(
+			folder,
+			flightRecording.SensorCameraIntrinsics);
+	}
+
+	SensorFrameRingStatistics SensorFrameRecorderSink::PersistFlightRecording(
+		_In_ Windows::Storage::StorageFolder^ folder)
+	{
+		// The ring continues to fill while the frames taken out of it are written.
+
+		const SensorFrameFlightRecording flightRecording =
+			TakeFlightRecording();
+
+		WriteFlightRecording(
+			flightRecording,
+			folder);
+
+		return flightRecording.Statistics;
+	}
+
+	Io::PixelBufferPoolStatistics SensorFrameRecorderSink::GetPixelBufferPoolStatistics()
+	{
+		return _pixelBufferPool->GetStatistics();
+	}
+
+	void SensorFrameRecorderSink::OpenSegment()
+	{
+		// Segments are numbered; an unsegmented recording keeps the plain file names.
+
+		wchar_t segmentName[MAX_PATH] = {};
+
+		if (_segmentPolicy.IsSegmented())
+		{
+			swprintf_s(
+				segmentName,
+				L"%s_%05i",
+				_sensorName->Data(),
+				_segment.SegmentIndex);
+		}
+		else
+		{
+			swprintf_s(
+				segmentName,
+				L"%s",
+				_sensorName->Data());
+		}
+
+		_segment.TarballFileName = std::wstring(segmentName) + L".tar";
+		_segment.CsvFileName = std::wstring(segmentName) + L".csv";
+		_segment.FirstTimestamp = 0;
+		_segment.LastTimestamp = 0;
+		_segment.NumberOfFrames = 0;
+		_segment.NumberOfBytes = 0;
+
 		// Create the tarball for the bitmap files.
-		
+
 		{
 			wchar_t fileName[MAX_PATH] = {};
 			swprintf_s(
 				fileName,
-				L"%s\\%s.tar",
+				L"%s\\%s",
 				_archiveSourceFolder->Path->Data(),
-				_sensorName->Data());
+				_segment.TarballFileName.c_str());
 			_bitmapTarball.reset(new Io::Tarball(fileName));
 		}
-		
 
 		// Create the csv file for the frame information.
 
@@ -53,45 +265,157 @@ namespace HoloLensForCV
 			wchar_t fileName[MAX_PATH] = {};
 			swprintf_s(
 				fileName,
-				L"%s\\%s.csv",
+				L"%s\\%s",
 				_archiveSourceFolder->Path->Data(),
-				_sensorName->Data());
+				_segment.CsvFileName.c_str());
 			_csvWriter.reset(new CsvWriter(fileName));
 		}
 
 		// Write header information to csv file.
 
+		WriteCsvHeader(
+			*_csvWriter);
+	}
+
+	void SensorFrameRecorderSink::FinalizeSegment()
+	{
+		_bitmapTarball.reset();
+		_csvWriter.reset();
+
+		// Closing the tarball appended its two terminating blocks of zeros.
+		_segment.NumberOfBytes += 2 * 512;
+
+		// Write the calibration before listing the first segment, so that it is
+		// available along with it.
+		if (!_cameraCalibrationWritten && nullptr != _cameraIntrinsics)
 		{
-			std::vector<std::wstring> columns;
+			WriteCameraCalibration(
+				_archiveSourceFolder,
+				_cameraIntrinsics);
 
-			columns.push_back(L"Timestamp");
-			columns.push_back(L"ImageFileName");
+			_cameraCalibrationWritten = true;
+		}
 
-			columns.push_back(L"FrameToOrigin.m11"); columns.push_back(L"FrameToOrigin.m12"); columns.push_back(L"FrameToOrigin.m13"); columns.push_back(L"FrameToOrigin.m14");
-			columns.push_back(L"FrameToOrigin.m21"); columns.push_back(L"FrameToOrigin.m22"); columns.push_back(L"FrameToOrigin.m23"); columns.push_back(L"FrameToOrigin.m24");
-			columns.push_back(L"FrameToOrigin.m31"); columns.push_back(L"FrameToOrigin.m32"); columns.push_back(L"FrameToOrigin.m33"); columns.push_back(L"FrameToOrigin.m34");
-			columns.push_back(L"FrameToOrigin.m41"); columns.push_back(L"FrameToOrigin.m42"); columns.push_back(L"FrameToOrigin.m43"); columns.push_back(L"FrameToOrigin.m44");
+		if (nullptr != _segmentManifest)
+		{
+			_segmentManifest->Append(
+				_segment);
+		}
+	}
+
+	void SensorFrameRecorderSink::WriteCameraCalibration(
+		_In_ Windows::Storage::StorageFolder^ folder,
+		_In_ CameraIntrinsics^ cameraIntrinsics)
+	{
+		// TODO: Support PV calibration.
 
-			columns.push_back(L"CameraViewTransform.m11"); columns.push_back(L"CameraViewTransform.m12"); columns.push_back(L"CameraViewTransform.m13"); columns.push_back(L"CameraViewTransform.m14");
-			columns.push_back(L"CameraViewTransform.m21"); columns.push_back(L"CameraViewTransform.m22"); columns.push_back(L"CameraViewTransform.m23"); columns.push_back(L"CameraViewTransform.m24");
-			columns.push_back(L"CameraViewTransform.m31"); columns.push_back(L"CameraViewTransform.m32"); columns.push_back(L"CameraViewTransform.m33"); columns.push_back(L"CameraViewTransform.m34");
-			columns.push_back(L"CameraViewTransform.m41"); columns.push_back(L"CameraViewTransform.m42"); columns.push_back(L"CameraViewTransform.m43"); columns.push_back(L"CameraViewTransform.m44");
+		if (nullptr == cameraIntrinsics)
+		{
+			return;
+		}
 
-			columns.push_back(L"CameraProjectionTransform.m11"); columns.push_back(L"CameraProjectionTransform.m12"); columns.push_back(L"CameraProjectionTransform.m13"); columns.push_back(L"CameraProjectionTransform.m14");
-			columns.push_back(L"CameraProjectionTransform.m21"); columns.push_back(L"CameraProjectionTransform.m22"); columns.push_back(L"CameraProjectionTransform.m23"); columns.push_back(L"CameraProjectionTransform.m24");
-			columns.push_back(L"CameraProjectionTransform.m31"); columns.push_back(L"CameraProjectionTransform.m32"); columns.push_back(L"CameraProjectionTransform.m33"); columns.push_back(L"CameraProjectionTransform.m34");
-			columns.push_back(L"CameraProjectionTransform.m41"); columns.push_back(L"CameraProjectionTransform.m42"); columns.push_back(L"CameraProjectionTransform.m43"); columns.push_back(L"CameraProjectionTransform.m44");
+		wchar_t fileName[MAX_PATH] = {};
 
-			_csvWriter->WriteHeader(columns);
+		swprintf_s(
+			fileName,
+			L"%s\\%s_camera_space_projection.bin",
+			folder->Path->Data(),
+			_sensorName->Data());
+
+		std::vector<Windows::Foundation::Point> pointList;
+		pointList.resize(cameraIntrinsics->ImageWidth * cameraIntrinsics->ImageHeight);
+		size_t index = 0;
+		for (unsigned int x = 0; x < cameraIntrinsics->ImageWidth; ++x)
+		{
+			for (unsigned int y = 0; y < cameraIntrinsics->ImageHeight; ++y)
+			{
+				Windows::Foundation::Point uv = { float(x), float(y) }, xy;
+				cameraIntrinsics->MapImagePointToCameraUnitPlane(uv, &xy);
+				pointList[index++] = xy;
+			}
 		}
+
+		//TODO: Better conversion to char*
+		std::wstring ws(fileName);
+		std::string outputFilePath;
+		outputFilePath.assign(ws.begin(), ws.end());
+
+		FILE* file = nullptr;
+		ASSERT(0 == fopen_s(&file, outputFilePath.c_str(), "wb"));
+
+		size_t expectedSize = pointList.size() * sizeof(Windows::Foundation::Point);
+		ASSERT(expectedSize == fwrite(
+			reinterpret_cast<uint8_t*>(&pointList[0]),
+			sizeof(uint8_t),
+			expectedSize,
+			file));
+
+		ASSERT(0 == fclose(file));
 	}
 
-	void SensorFrameRecorderSink::Stop()
+	void SensorFrameRecorderSink::WriteCsvHeader(
+		_Inout_ CsvWriter& csvWriter)
 	{
-		std::lock_guard<std::mutex> guard(_sinkMutex);
-		_bitmapTarball.reset();
-		_csvWriter.reset();
-		_archiveSourceFolder = nullptr;
+		std::vector<std::wstring> columns;
+
+		columns.push_back(L"Timestamp");
+		columns.push_back(L"ImageFileName");
+
+		columns.push_back(L"FrameToOrigin.m11"); columns.push_back(L"FrameToOrigin.m12"); columns.push_back(L"FrameToOrigin.m13"); columns.push_back(L"FrameToOrigin.m14");
+		columns.push_back(L"FrameToOrigin.m21"); columns.push_back(L"FrameToOrigin.m22"); columns.push_back(L"FrameToOrigin.m23"); columns.push_back(L"FrameToOrigin.m24");
+		columns.push_back(L"FrameToOrigin.m31"); columns.push_back(L"FrameToOrigin.m32"); columns.push_back(L"FrameToOrigin.m33"); columns.push_back(L"FrameToOrigin.m34");
+		columns.push_back(L"FrameToOrigin.m41"); columns.push_back(L"FrameToOrigin.m42"); columns.push_back(L"FrameToOrigin.m43"); columns.push_back(L"FrameToOrigin.m44");
+
+		columns.push_back(L"CameraViewTransform.m11"); columns.push_back(L"CameraViewTransform.m12"); columns.push_back(L"CameraViewTransform.m13"); columns.push_back(L"CameraViewTransform.m14");
+		columns.push_back(L"CameraViewTransform.m21"); columns.push_back(L"CameraViewTransform.m22"); columns.push_back(L"CameraViewTransform.m23"); columns.push_back(L"CameraViewTransform.m24");
+		columns.push_back(L"CameraViewTransform.m31"); columns.push_back(L"CameraViewTransform.m32"); columns.push_back(L"CameraViewTransform.m33"); columns.push_back(L"CameraViewTransform.m34");
+		columns.push_back(L"CameraViewTransform.m41"); columns.push_back(L"CameraViewTransform.m42"); columns.push_back(L"CameraViewTransform.m43"); columns.push_back(L"CameraViewTransform.m44");
+
+		columns.push_back(L"CameraProjectionTransform.m11"); columns.push_back(L"CameraProjectionTransform.m12"); columns.push_back(L"CameraProjectionTransform.m13"); columns.push_back(L"CameraProjectionTransform.m14");
+		columns.push_back(L"CameraProjectionTransform.m21"); columns.push_back(L"CameraProjectionTransform.m22"); columns.push_back(L"CameraProjectionTransform.m23"); columns.push_back(L"CameraProjectionTransform.m24");
+		columns.push_back(L"CameraProjectionTransform.m31"); columns.push_back(L"CameraProjectionTransform.m32"); columns.push_back(L"CameraProjectionTransform.m33"); columns.push_back(L"CameraProjectionTransform.m34");
+		columns.push_back(L"CameraProjectionTransform.m41"); columns.push_back(L"CameraProjectionTransform.m42"); columns.push_back(L"CameraProjectionTransform.m43"); columns.push_back(L"CameraProjectionTransform.m44");
+
+		columns.push_back(L"ImageCodec");
+
+		csvWriter.WriteHeader(columns);
+	}
+
+	void SensorFrameRecorderSink::WriteFrame(
+		_In_ const RecordedSensorFrame& frame,
+		_Inout_ Io::Tarball& tarball,
+		_Inout_ CsvWriter& csvWriter)
+	{
+		// Add the bitmap to the tarball.
+		tarball.AddFile(frame.BitmapPath, frame.BitmapData.data(), frame.BitmapData.size());
+
+		//
+		// Record the sensor frame meta data to the csv file.
+		//
+
+		bool writeComma = false;
+
+		csvWriter.WriteUInt64(
+			frame.Timestamp, &writeComma);
+
+		{
+			csvWriter.WriteText(
+				frame.BitmapPath, &writeComma);
+		}
+
+		csvWriter.WriteFloat4x4(
+			frame.FrameToOrigin, &writeComma);
+
+		csvWriter.WriteFloat4x4(
+			frame.CameraViewTransform, &writeComma);
+
+		csvWriter.WriteFloat4x4(
+			frame.CameraProjectionTransform, &writeComma);
+
+		csvWriter.WriteText(
+			GetRecordingImageCodecName(frame.ImageCodec), &writeComma);
+
+		csvWriter.EndLine();
 	}
 
 	Platform::String^ SensorFrameRecorderSink::GetSensorName()
@@ -104,19 +428,6 @@ namespace HoloLensForCV
 		return _cameraIntrinsics;
 	}
 
-	void SensorFrameRecorderSink::ReportArchiveSourceFiles(
-		_Inout_ std::vector<std::wstring>& sourceFiles)
-	{
-		wchar_t csvFileName[MAX_PATH] = {};
-
-		swprintf_s(
-			csvFileName,
-			L"%s.csv",
-			_sensorName->Data());
-
-		sourceFiles.push_back(csvFileName);
-	}
-
 	void SensorFrameRecorderSink::Send(
 		SensorFrame^ sensorFrame)
 	{
@@ -126,7 +437,7 @@ namespace HoloLensForCV
 
 		std::lock_guard<std::mutex> lockGuard(_sinkMutex);
 
-		if (nullptr == _archiveSourceFolder)
+		if (nullptr == _archiveSourceFolder && nullptr == _frameRing)
 		{
 			return;
 		}
@@ -145,171 +456,208 @@ namespace HoloLensForCV
 		_prevFrameTimestamp = sensorFrame->Timestamp;
 
 		//
-		// Write the sensor frame as a bitmap to the archive.
+		// Copy the pixels out of the bitmap, which is recycled once Send returns, into
+		// a pooled buffer that is returned to the pool once the frame was encoded.
 		//
 
-#if DBG_ENABLE_VERBOSE_LOGGING
-		dbg::trace(
-			L"SensorFrameRecorderSink::Send: saving sensor frame to %s",
-			bitmapPath);
-#endif /* DBG_ENABLE_VERBOSE_LOGGING */
+		Io::SensorFrameData sensorFrameData;
 
-		Windows::Graphics::Imaging::SoftwareBitmap^ softwareBitmap =
-			sensorFrame->SoftwareBitmap;
+		sensorFrame->ToSensorFrameData(
+			*_pixelBufferPool,
+			sensorFrameData);
 
-		// Determine metadata information about frame.
+		Io::PixelView image =
+			GetRecordingImage(
+				sensorFrameData);
 
-		int maxBitmapValue = 0;
-		int actualBitmapWidth = softwareBitmap->PixelWidth;
+		RecordedSensorFrame frame;
 
-		switch (softwareBitmap->BitmapPixelFormat)
+		// Once the ring is full, encode into the bitmap of the frame that last fell out.
+		if (nullptr != _frameRing)
 		{
+			frame.BitmapData = _frameRing->TakeSpareBuffer();
+		}
 
-		case Windows::Graphics::Imaging::BitmapPixelFormat::Gray16:
-			maxBitmapValue = 65535;
-			break;
+		frame.Timestamp = sensorFrame->Timestamp.UniversalTime;
+		frame.ImageCodec = _imageCodec;
+		frame.FrameToOrigin = sensorFrame->FrameToOrigin;
+		frame.CameraViewTransform = sensorFrame->CameraViewTransform;
+		frame.CameraProjectionTransform = sensorFrame->CameraProjectionTransform;
 
-		case Windows::Graphics::Imaging::BitmapPixelFormat::Gray8:
-			maxBitmapValue = 255;
-			break;
+		if (nullptr == _encoderExecutor)
+		{
+			EncodeFrame(
+				image,
+				frame);
 
-		case Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8:
-			if ((_sensorType == SensorType::VisibleLightLeftFront) ||
-				(_sensorType == SensorType::VisibleLightLeftLeft) ||
-				(_sensorType == SensorType::VisibleLightRightFront) ||
-				(_sensorType == SensorType::VisibleLightRightRight))
-			{
-				maxBitmapValue = 255;
-				actualBitmapWidth = actualBitmapWidth * 4;
-			}
-            else if (_sensorType == SensorType::PhotoVideo)
-            {
-                maxBitmapValue = 255;
-            }
-			else
-			{
-				ASSERT(false);
-			}
+			CommitFrame(
+				std::move(frame));
 
-			break;
+			return;
+		}
 
-		default:
-			// Unsupported by PGM format. Need to update save logic
-#if DBG_ENABLE_INFORMATIONAL_LOGGING
+		//
+		// Encode on the worker pool. Frames are committed in the order they were sent;
+		// when the encoders fall too far behind, new frames are dropped rather than
+		// queued without bound.
+		//
+
+		if (_numberOfFramesInFlight >= kMaximumNumberOfFramesInFlight)
+		{
+			++_numberOfDroppedFrames;
+
+			return;
+		}
+
+		const uint64_t sequenceNumber =
+			_nextSequenceNumber++;
+
+		++_numberOfFramesInFlight;
+
+		SensorFrameRecorderSink^ sink = this;
+
+		_encoderExecutor->Submit(
+			Io::TaskLane::Compute,
+			[sink, sequenceNumber, image = std::move(image), frame = std::move(frame)]() mutable
+		{
+			sink->EncodeFrame(
+				image,
+				frame);
+
+			sink->CompleteFrame(
+				sequenceNumber,
+				std::move(frame));
+		});
+	}
+
+	void SensorFrameRecorderSink::EncodeFrame(
+		_In_ const Io::PixelView& image,
+		_Inout_ RecordedSensorFrame& frame)
+	{
+		try
+		{
+			frame.ImageCodec = EncodeRecordingImage(
+				frame.ImageCodec,
+				_jpegQuality,
+				image,
+				frame.BitmapData);
+		}
+		catch (Platform::Exception^ exception)
+		{
+#if DBG_ENABLE_ERROR_LOGGING
 			dbg::trace(
-				L"SensorFrameRecorderSink::Send: unsupported bitmap pixel format for PGM");
-#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+				L"SensorFrameRecorderSink::EncodeFrame: failed to encode frame %llu: %s",
+				frame.Timestamp,
+				exception->Message->Data());
+#endif /* DBG_ENABLE_ERROR_LOGGING */
 
-			ASSERT(false);
-			break;
+			frame.BitmapData.clear();
+
+			return;
 		}
 
-        // Determine which bitmap format to use.
-        std::string bitmapFormat;
-        std::wstring bitmapFileExtension;
-        if (_sensorType == SensorType::PhotoVideo)
-        {
-            bitmapFormat = "P6";
-            bitmapFileExtension = L"ppm";
-        }
-        else 
-        {
-            bitmapFormat = "P5";
-            bitmapFileExtension = L"pgm";
-        }
-
-        // Compose the output file name.
-        wchar_t bitmapPath[MAX_PATH];
-        swprintf_s(
-            bitmapPath, L"%s\\%020llu.%s",
-            _sensorName->Data(),
-            sensorFrame->Timestamp.UniversalTime,
-            bitmapFileExtension.c_str());
-
-		// Compose PGM header string.
-		std::stringstream header;
-		header << bitmapFormat << "\n"
-			<< actualBitmapWidth << " "
-			<< softwareBitmap->PixelHeight << "\n"
-			<< maxBitmapValue << "\n";
-		const std::string headerString = header.str();
-
-		// Get bitmap buffer object of the frame.
-		Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
-			softwareBitmap->LockBuffer(
-				Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
-
-		// Get raw pointer to the buffer object.
-		uint32_t pixelBufferDataLength = 0;
-		const uint8_t* pixelBufferData =
-			Io::GetTypedPointerToMemoryBuffer<uint8_t>(
-				bitmapBuffer->CreateReference(),
-				pixelBufferDataLength);
-
-        // Convert the software bitmap to raw bytes.
-        std::vector<uint8_t> bitmapData;
-        if (_sensorType == SensorType::PhotoVideo)
-        {
-            const uint32_t numPixels = softwareBitmap->PixelWidth * softwareBitmap->PixelHeight;
-
-            // Allocate data for PGM bitmap file.
-            bitmapData.reserve(headerString.size() + numPixels * 3);
-
-            // Add PGM header data.
-            bitmapData.insert(
-                bitmapData.end(),
-                headerString.c_str(), headerString.c_str() + headerString.size());
-
-            for (uint32_t i = 0; i < numPixels; ++i)
-            {
-                for (uint32_t j = 0; j < 3; ++j)
-                {
-                    bitmapData.push_back(pixelBufferData[i * 4 + 2 - j]);
-                }
-            }
-        }
-        else
-        {
-            // Allocate data for PGM bitmap file.
-            bitmapData.reserve(headerString.size() + pixelBufferDataLength);
-
-            // Add PGM header data.
-            bitmapData.insert(
-                bitmapData.end(),
-                headerString.c_str(), headerString.c_str() + headerString.size());
-
-            // Add raw pixel data.
-            bitmapData.insert(
-                bitmapData.end(),
-                pixelBufferData, pixelBufferData + pixelBufferDataLength);
-        }
+		// Compose the output file name.
+		wchar_t bitmapPath[MAX_PATH];
+		swprintf_s(
+			bitmapPath, L"%s\\%020llu.%s",
+			_sensorName->Data(),
+			frame.Timestamp,
+			GetRecordingImageFileExtension(frame.ImageCodec, image.format));
 
-		// Add the bitmap to the tarball.
-		_bitmapTarball->AddFile(bitmapPath, bitmapData.data(), bitmapData.size());
+#if DBG_ENABLE_VERBOSE_LOGGING
+		dbg::trace(
+			L"SensorFrameRecorderSink::EncodeFrame: saving sensor frame to %s",
+			bitmapPath);
+#endif /* DBG_ENABLE_VERBOSE_LOGGING */
 
-		//
-		// Record the sensor frame meta data to the csv file.
-		//
+		frame.BitmapPath = bitmapPath;
+	}
 
-		bool writeComma = false;
+	void SensorFrameRecorderSink::CompleteFrame(
+		_In_ uint64_t sequenceNumber,
+		_Inout_ RecordedSensorFrame&& frame)
+	{
+		{
+			std::lock_guard<std::mutex> guard(_sinkMutex);
+
+			_encodedFrames.emplace(
+				sequenceNumber,
+				std::move(frame));
+
+			// Commit the frames that are next in line.
+			while (!_encodedFrames.empty() &&
+				_encodedFrames.begin()->first == _nextCommittedSequenceNumber)
+			{
+				CommitFrame(
+					std::move(_encodedFrames.begin()->second));
+
+				_encodedFrames.erase(
+					_encodedFrames.begin());
 
-		_csvWriter->WriteUInt64(
-			sensorFrame->Timestamp.UniversalTime, &writeComma);
+				++_nextCommittedSequenceNumber;
+				--_numberOfFramesInFlight;
+			}
+		}
+
+		_framesInFlightCondition.notify_all();
+	}
+
+	void SensorFrameRecorderSink::CommitFrame(
+		_Inout_ RecordedSensorFrame&& frame)
+	{
+		// Frames that failed to encode are left out of the recording.
+		if (frame.BitmapData.empty())
+		{
+			return;
+		}
 
+		// In flight recorder mode, keep the frame until the recording is persisted.
+		if (nullptr != _frameRing)
 		{
-			_csvWriter->WriteText(
-				bitmapPath, &writeComma);
+			_frameRing->Push(
+				std::move(frame));
+
+			return;
 		}
 
-		_csvWriter->WriteFloat4x4(
-			sensorFrame->FrameToOrigin, &writeComma);
+		// Each file takes a header block and its data padded to whole blocks.
+		const uint64_t tarballEntrySize =
+			512 + (frame.BitmapData.size() + 511) / 512 * 512;
 
-		_csvWriter->WriteFloat4x4(
-			sensorFrame->CameraViewTransform, &writeComma);
+		// Move on to the next segment once the current one is full.
+		if (_segmentPolicy.IsSegmented() && 0 != _segment.NumberOfFrames)
+		{
+			const bool maximumDurationReached =
+				0 != _segmentPolicy.MaximumDuration &&
+				static_cast<int64_t>(frame.Timestamp - _segment.FirstTimestamp) >=
+					_segmentPolicy.MaximumDuration;
+
+			const bool maximumSizeReached =
+				0 != _segmentPolicy.MaximumSize &&
+				_segment.NumberOfBytes + tarballEntrySize + 2 * 512 > _segmentPolicy.MaximumSize;
+
+			if (maximumDurationReached || maximumSizeReached)
+			{
+				FinalizeSegment();
+
+				++_segment.SegmentIndex;
+
+				OpenSegment();
+			}
+		}
+
+		if (0 == _segment.NumberOfFrames)
+		{
+			_segment.FirstTimestamp = frame.Timestamp;
+		}
 
-		_csvWriter->WriteFloat4x4(
-			sensorFrame->CameraProjectionTransform, &writeComma);
+		_segment.LastTimestamp = frame.Timestamp;
+		++_segment.NumberOfFrames;
+		_segment.NumberOfBytes += tarballEntrySize;
 
-		_csvWriter->EndLine();
+		WriteFrame(
+			frame,
+			*_bitmapTarball,
+			*_csvWriter);
 	}
 }
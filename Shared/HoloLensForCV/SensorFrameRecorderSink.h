@@ -15,10 +15,25 @@
 
 namespace HoloLensForCV
 {
+	//
+	// The frames taken out of a sink's flight recorder ring, with what is needed to
+	// write them to a recording.
+	//
+	struct SensorFrameFlightRecording
+	{
+		std::deque<RecordedSensorFrame> Frames;
+		SensorFrameRingStatistics Statistics;
+		CameraIntrinsics^ SensorCameraIntrinsics;
+	};
+
 	//
 	// Saves sensor images originated on device to disk and collects sensor frame
 	// metadata that will be used to create the per-sensor recording manifest CSV
-	// file.
+	// file. With a segment policy, the images and metadata are split into segments
+	// of bounded duration or size, each finalized and listed in the recording's
+	// segment manifest as soon as the sink moves on to the next one. In flight
+	// recorder mode, the encoded frames are instead kept in a bounded ring in memory
+	// and only written when the recording is persisted.
 	//
 	public ref class SensorFrameRecorderSink sealed
 		: public ISensorFrameSink
@@ -39,12 +54,96 @@ namespace HoloLensForCV
 
 		CameraIntrinsics^ GetCameraIntrinsics();
 
-		void ReportArchiveSourceFiles(
-			_Inout_ std::vector<std::wstring>& sourceFiles);
+		//
+		// Records in segments according to the policy, appending each finalized
+		// segment to the manifest. Call before Start.
+		//
+		void SetSegmentation(
+			_In_ const RecordingSegmentPolicy& segmentPolicy,
+			_In_ const std::shared_ptr<RecordingSegmentManifest>& segmentManifest);
+
+		//
+		// Stores the images with the codec. With an executor, the images are encoded
+		// on its workers rather than on the thread that sends the frames, and frames
+		// are dropped while too many of them are still being encoded. Call before
+		// Start or StartFlightRecording.
+		//
+		void SetImageEncoding(
+			_In_ RecordingImageCodec imageCodec,
+			_In_ int32_t jpegQuality,
+			_In_ const std::shared_ptr<Io::TaskExecutor>& encoderExecutor);
+
+		//
+		// Keeps the frames of the last maximumDuration of sensor time, and at most
+		// maximumSize bytes of them, in memory instead of writing them (see
+		// SensorFrameRing). Stop discards them.
+		//
+		void StartFlightRecording(
+			_In_ int64_t maximumDuration,
+			_In_ uint64_t maximumSize);
+
+		//
+		// Takes the frames kept so far out of the ring, which continues to fill.
+		//
+		SensorFrameFlightRecording TakeFlightRecording();
+
+		//
+		// Writes the frames to "<sensor>.tar" and "<sensor>.csv" in the folder, along
+		// with the camera calibration. Does not lock the sink.
+		//
+		void WriteFlightRecording(
+			_In_ const SensorFrameFlightRecording& flightRecording,
+			_In_ Windows::Storage::StorageFolder^ folder);
+
+		//
+		// Takes the frames kept so far and writes them to the folder. The sink is
+		// locked only while the frames are taken out of the ring.
+		//
+		SensorFrameRingStatistics PersistFlightRecording(
+			_In_ Windows::Storage::StorageFolder^ folder);
+
+		//
+		// The pool the pixels of the sent frames are copied into until they are encoded.
+		//
+		Io::PixelBufferPoolStatistics GetPixelBufferPoolStatistics();
 
 	private:
 		~SensorFrameRecorderSink();
 
+		void EncodeFrame(
+			_In_ const Io::PixelView& image,
+			_Inout_ RecordedSensorFrame& frame);
+
+		//
+		// Commits the encoded frame once all frames sent before it were committed.
+		//
+		void CompleteFrame(
+			_In_ uint64_t sequenceNumber,
+			_Inout_ RecordedSensorFrame&& frame);
+
+		//
+		// Adds the frame to the ring or to the segment being recorded. Call with the
+		// sink locked.
+		//
+		void CommitFrame(
+			_Inout_ RecordedSensorFrame&& frame);
+
+		void OpenSegment();
+
+		void FinalizeSegment();
+
+		void WriteCameraCalibration(
+			_In_ Windows::Storage::StorageFolder^ folder,
+			_In_ CameraIntrinsics^ cameraIntrinsics);
+
+		static void WriteCsvHeader(
+			_Inout_ CsvWriter& csvWriter);
+
+		static void WriteFrame(
+			_In_ const RecordedSensorFrame& frame,
+			_Inout_ Io::Tarball& tarball,
+			_Inout_ CsvWriter& csvWriter);
+
 		Platform::String^ _sensorName;
 
 		SensorType _sensorType;
@@ -57,6 +156,30 @@ namespace HoloLensForCV
 		std::unique_ptr<CsvWriter> _csvWriter;
 
 		CameraIntrinsics^ _cameraIntrinsics;
+		bool _cameraCalibrationWritten;
+
+		RecordingSegmentPolicy _segmentPolicy;
+		std::shared_ptr<RecordingSegmentManifest> _segmentManifest;
+
+		// The segment being recorded
+		RecordingSegment _segment;
+
+		// The frames kept in flight recorder mode
+		std::unique_ptr<SensorFrameRing> _frameRing;
+
+		std::shared_ptr<Io::PixelBufferPool> _pixelBufferPool;
+
+		RecordingImageCodec _imageCodec;
+		int32_t _jpegQuality;
+		std::shared_ptr<Io::TaskExecutor> _encoderExecutor;
+
+		// Frames handed to the encoders but not yet committed, by sequence number
+		uint64_t _nextSequenceNumber;
+		uint64_t _nextCommittedSequenceNumber;
+		std::map<uint64_t, RecordedSensorFrame> _encodedFrames;
+		uint32_t _numberOfFramesInFlight;
+		uint64_t _numberOfDroppedFrames;
+		std::condition_variable _framesInFlightCondition;
 
 		Windows::Foundation::DateTime _prevFrameTimestamp;
 	};
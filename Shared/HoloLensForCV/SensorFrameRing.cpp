@@ -0,0 +1,126 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    _Use_decl_annotations_
+    SensorFrameRing::SensorFrameRing(
+        int64_t maximumDuration,
+        uint64_t maximumSize)
+        : _maximumDuration(maximumDuration)
+        , _maximumSize(maximumSize)
+        , _numberOfBytes(0)
+        , _peakNumberOfBytes(0)
+        , _numberOfDroppedFrames(0)
+    {
+        REQUIRES(0 <= maximumDuration);
+    }
+
+    _Use_decl_annotations_
+    void SensorFrameRing::Push(
+        RecordedSensorFrame&& frame)
+    {
+        _numberOfBytes += GetFrameSize(frame);
+
+        _frames.push_back(
+            std::move(frame));
+
+        const uint64_t newestTimestamp =
+            _frames.back().Timestamp;
+
+        //
+        // The newest frame is kept even if it alone exceeds the budget.
+        //
+        while (_frames.size() > 1)
+        {
+            const bool outsideOfWindow =
+                0 != _maximumDuration &&
+                newestTimestamp - _frames.front().Timestamp > static_cast<uint64_t>(_maximumDuration);
+
+            const bool overBudget =
+                0 != _maximumSize &&
+                _numberOfBytes > _maximumSize;
+
+            if (!outsideOfWindow && !overBudget)
+            {
+                break;
+            }
+
+            _numberOfBytes -= GetFrameSize(_frames.front());
+
+            _spareBuffer = std::move(
+                _frames.front().BitmapData);
+
+            _frames.pop_front();
+
+            ++_numberOfDroppedFrames;
+        }
+
+        _peakNumberOfBytes = std::max(
+            _peakNumberOfBytes,
+            _numberOfBytes);
+    }
+
+    std::deque<RecordedSensorFrame> SensorFrameRing::TakeFrames()
+    {
+        std::deque<RecordedSensorFrame> frames;
+
+        frames.swap(
+            _frames);
+
+        _numberOfBytes = 0;
+
+        return frames;
+    }
+
+    std::vector<uint8_t> SensorFrameRing::TakeSpareBuffer()
+    {
+        std::vector<uint8_t> spareBuffer;
+
+        spareBuffer.swap(
+            _spareBuffer);
+
+        spareBuffer.clear();
+
+        return spareBuffer;
+    }
+
+    SensorFrameRingStatistics SensorFrameRing::GetStatistics() const
+    {
+        SensorFrameRingStatistics statistics = {};
+
+        statistics.NumberOfFrames = static_cast<uint32_t>(_frames.size());
+
+        if (!_frames.empty())
+        {
+            statistics.FirstTimestamp = _frames.front().Timestamp;
+            statistics.LastTimestamp = _frames.back().Timestamp;
+        }
+
+        statistics.NumberOfBytes = _numberOfBytes;
+        statistics.PeakNumberOfBytes = _peakNumberOfBytes;
+        statistics.NumberOfDroppedFrames = _numberOfDroppedFrames;
+
+        return statistics;
+    }
+
+    _Use_decl_annotations_
+    uint64_t SensorFrameRing::GetFrameSize(
+        const RecordedSensorFrame& frame)
+    {
+        return
+            sizeof(RecordedSensorFrame) +
+            frame.BitmapData.capacity() +
+            frame.BitmapPath.capacity() * sizeof(wchar_t);
+    }
+}
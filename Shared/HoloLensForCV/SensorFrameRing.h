@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // A sensor frame as the recorder sink writes it: the encoded bitmap and the
+    // meta-data of its line in the CSV file.
+    //
+    struct RecordedSensorFrame
+    {
+        uint64_t Timestamp;
+        std::wstring BitmapPath;
+        std::vector<uint8_t> BitmapData;
+        RecordingImageCodec ImageCodec;
+
+        Windows::Foundation::Numerics::float4x4 FrameToOrigin;
+        Windows::Foundation::Numerics::float4x4 CameraViewTransform;
+        Windows::Foundation::Numerics::float4x4 CameraProjectionTransform;
+    };
+
+    //
+    // Memory accounting of a sensor frame ring.
+    //
+    struct SensorFrameRingStatistics
+    {
+        uint32_t NumberOfFrames;
+        uint64_t FirstTimestamp;
+        uint64_t LastTimestamp;
+
+        // Bytes held by the frames in the ring, and the most it held
+        uint64_t NumberOfBytes;
+        uint64_t PeakNumberOfBytes;
+
+        // Frames that fell out of the window or over the budget
+        uint64_t NumberOfDroppedFrames;
+    };
+
+    //
+    // Keeps the most recent frames of one sensor: those within a maximum duration of
+    // sensor time of the newest frame, and at most a maximum number of bytes of them
+    // (zero does not limit either). Used by the recorder sink in flight recorder mode.
+    // Not thread safe; the sink serializes access to it.
+    //
+    class SensorFrameRing
+    {
+    public:
+        SensorFrameRing(
+            _In_ int64_t maximumDuration,
+            _In_ uint64_t maximumSize);
+
+        //
+        // Adds the frame as the newest, then drops the oldest frames until the ring
+        // fits its window and budget again.
+        //
+        void Push(
+            _Inout_ RecordedSensorFrame&& frame);
+
+        //
+        // Moves the frames out of the ring, oldest first, leaving it empty.
+        //
+        std::deque<RecordedSensorFrame> TakeFrames();
+
+        //
+        // Returns an empty buffer with the capacity of the bitmap of the last dropped
+        // frame, so that a full ring does not allocate a new bitmap for every frame.
+        //
+        std::vector<uint8_t> TakeSpareBuffer();
+
+        SensorFrameRingStatistics GetStatistics() const;
+
+    private:
+        static uint64_t GetFrameSize(
+            _In_ const RecordedSensorFrame& frame);
+
+        int64_t _maximumDuration;
+        uint64_t _maximumSize;
+
+        std::deque<RecordedSensorFrame> _frames;
+        std::vector<uint8_t> _spareBuffer;
+
+        uint64_t _numberOfBytes;
+        uint64_t _peakNumberOfBytes;
+        uint64_t _numberOfDroppedFrames;
+    };
+}
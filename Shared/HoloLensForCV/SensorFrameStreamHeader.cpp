@@ -24,6 +24,7 @@ namespace HoloLensForCV
         ImageHeight = 0;
         PixelStride = 0;
         RowStride = 0;
+        PixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Unknown;
     }
 
     /* static */ void SensorFrameStreamHeader::Read(
@@ -42,6 +43,7 @@ namespace HoloLensForCV
         header->ImageHeight = dataReader->ReadUInt32();
         header->PixelStride = dataReader->ReadUInt32();
         header->RowStride = dataReader->ReadUInt32();
+        header->PixelFormat = (Windows::Graphics::Imaging::BitmapPixelFormat)dataReader->ReadUInt32();
 
         *headerReference = header;
     }
@@ -59,5 +61,6 @@ namespace HoloLensForCV
         dataWriter->WriteUInt32(header->ImageHeight);
         dataWriter->WriteUInt32(header->PixelStride);
         dataWriter->WriteUInt32(header->RowStride);
+        dataWriter->WriteUInt32((uint32_t)header->PixelFormat);
     }
 }
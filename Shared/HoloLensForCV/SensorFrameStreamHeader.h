@@ -30,7 +30,8 @@ namespace HoloLensForCV
                     2 * sizeof(uint8_t) /* VersionMajor, VersionMinor */ +
                     sizeof(uint16_t) /* FrameType */ +
                     sizeof(uint64_t) /* Timestamp */ +
-                    4 * sizeof(uint32_t) /* ImageWidth, ImageHeight, PixelStride, RowStride */;
+                    4 * sizeof(uint32_t) /* ImageWidth, ImageHeight, PixelStride, RowStride */ +
+                    sizeof(uint32_t) /* PixelFormat */;
             }
         }
 
@@ -46,7 +47,7 @@ namespace HoloLensForCV
 
         static property uint8_t ProtocolVersionMinor
         {
-            uint8_t get() { return 0x01; }
+            uint8_t get() { return 0x02; }
         }
 
         property uint32_t Cookie;
@@ -59,6 +60,28 @@ namespace HoloLensForCV
         property uint32_t PixelStride;
         property uint32_t RowStride;
 
+        //
+        // Sent as the numeric value of the enumeration. NV12 images are followed by
+        // their chroma plane: ImageHeight / 2 more rows of RowStride bytes.
+        //
+        property Windows::Graphics::Imaging::BitmapPixelFormat PixelFormat;
+
+        //
+        // The number of image bytes following the header.
+        //
+        property uint32_t ImageBufferSize
+        {
+            uint32_t get()
+            {
+                const uint32_t numberOfRows =
+                    Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == PixelFormat
+                        ? ImageHeight + ImageHeight / 2
+                        : ImageHeight;
+
+                return numberOfRows * RowStride;
+            }
+        }
+
         static void Read(
             _Inout_ Windows::Storage::Streams::DataReader^ dataReader,
             _Out_ SensorFrameStreamHeader^* header);
@@ -107,6 +107,7 @@ namespace HoloLensForCV
         int32_t imageHeight = 0;
         int32_t pixelStride = 1;
         int32_t rowStride = 0;
+        int32_t numberOfRows = 0;
 
         Platform::Array<uint8_t>^ imageBufferAsPlatformArray;
         int32_t imageBufferSize = 0;
@@ -123,6 +124,7 @@ namespace HoloLensForCV
 
             imageWidth = bitmap->PixelWidth;
             imageHeight = bitmap->PixelHeight;
+            numberOfRows = imageHeight;
 
             bitmapBuffer =
                 bitmap->LockBuffer(
@@ -152,6 +154,15 @@ namespace HoloLensForCV
                 pixelStride = 1;
                 break;
 
+            case Windows::Graphics::Imaging::BitmapPixelFormat::Nv12:
+                //
+                // The luma plane is followed by a chroma plane of half the rows. Both
+                // are sent without the padding of their rows, see below.
+                //
+                pixelStride = 1;
+                numberOfRows = imageHeight + imageHeight / 2;
+                break;
+
             default:
 #if DBG_ENABLE_INFORMATIONAL_LOGGING
                 dbg::trace(
@@ -165,15 +176,60 @@ namespace HoloLensForCV
                 imageWidth * pixelStride;
 
             imageBufferSize =
-                imageHeight * rowStride;
+                numberOfRows * rowStride;
 
-            ASSERT(
-                imageBufferSize == (int32_t)bitmapBufferDataSize);
+            if (Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == bitmap->BitmapPixelFormat)
+            {
+                //
+                // The planes' rows may be padded, and the chroma plane may not follow
+                // the luma plane directly, so copy them row by row like
+                // SensorFrame::ToSensorFrameData does.
+                //
+                const Windows::Graphics::Imaging::BitmapPlaneDescription lumaPlane =
+                    bitmapBuffer->GetPlaneDescription(0);
+
+                const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                    bitmapBuffer->GetPlaneDescription(1);
+
+                ASSERT(
+                    lumaPlane.StartIndex + (imageHeight - 1) * lumaPlane.Stride + imageWidth <= (int32_t)bitmapBufferDataSize);
+
+                ASSERT(
+                    chromaPlane.StartIndex + (imageHeight / 2 - 1) * chromaPlane.Stride + imageWidth <= (int32_t)bitmapBufferDataSize);
+
+                imageBufferAsPlatformArray =
+                    ref new Platform::Array<uint8_t>(
+                        imageBufferSize);
+
+                uint8_t* imageBufferData =
+                    imageBufferAsPlatformArray->Data;
+
+                for (int32_t y = 0; y < imageHeight; ++y, imageBufferData += rowStride)
+                {
+                    memcpy(
+                        imageBufferData,
+                        bitmapBufferData + lumaPlane.StartIndex + y * lumaPlane.Stride,
+                        rowStride);
+                }
+
+                for (int32_t y = 0; y < imageHeight / 2; ++y, imageBufferData += rowStride)
+                {
+                    memcpy(
+                        imageBufferData,
+                        bitmapBufferData + chromaPlane.StartIndex + y * chromaPlane.Stride,
+                        rowStride);
+                }
+            }
+            else
+            {
+                ASSERT(
+                    imageBufferSize == (int32_t)bitmapBufferDataSize);
 
-            imageBufferAsPlatformArray =
-                ref new Platform::Array<uint8_t>(
-                    bitmapBufferData,
-                    imageBufferSize);
+                imageBufferAsPlatformArray =
+                    ref new Platform::Array<uint8_t>(
+                        bitmapBufferData,
+                        imageBufferSize);
+            }
         }
 
         SensorFrameStreamHeader^ header =
@@ -185,6 +241,7 @@ namespace HoloLensForCV
         header->ImageHeight = imageHeight;
         header->PixelStride = pixelStride;
         header->RowStride = rowStride;
+        header->PixelFormat = bitmap->BitmapPixelFormat;
 
         SendImage(
             header,
@@ -0,0 +1,642 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    namespace
+    {
+        const int32_t kNumberOfFramesPerCheck = 30;
+
+        //
+        // The MultiFrameBuffer keeps five frames per sensor and copies a new frame
+        // before it drops the oldest one.
+        //
+        const uint64_t kMaximumNumberOfBufferAllocations = 6;
+
+        //
+        // One buffer per frame waiting for the encoders, and one for the frame being
+        // sent; see SensorFrameRecorderSink.
+        //
+        const uint64_t kMaximumNumberOfEncoderAllocations = 8 + 1;
+
+        //
+        // The frames pushed into the ring are spaced and sized so that its window and
+        // its budget each hold kNumberOfFramesInRing of them.
+        //
+        const int32_t kNumberOfFramesInRing = 6;
+        const uint64_t kRingFrameInterval = 333333;
+        const size_t kRingBitmapSize = 64 * 1024;
+
+        Windows::Foundation::DateTime GetStartTimestamp()
+        {
+            FILETIME currentTime;
+
+            GetSystemTimeAsFileTime(
+                &currentTime);
+
+            Windows::Foundation::DateTime startTimestamp;
+
+            startTimestamp.UniversalTime =
+                Io::TimeConverter().FileTimeToAbsoluteTicks(
+                    currentTime).count();
+
+            return startTimestamp;
+        }
+
+        Windows::Storage::StorageFolder^ CreateFolder(
+            _In_ Windows::Storage::StorageFolder^ outputFolder,
+            _In_ Platform::String^ folderName)
+        {
+            return concurrency::create_task(
+                outputFolder->CreateFolderAsync(
+                    folderName,
+                    Windows::Storage::CreationCollisionOption::ReplaceExisting)).get();
+        }
+
+        std::vector<std::wstring> ReadLines(
+            _In_ Windows::Storage::StorageFolder^ folder,
+            _In_ const wchar_t* fileName)
+        {
+            std::wifstream file(
+                (std::wstring(folder->Path->Data()) + L"\\" + fileName).c_str());
+
+            std::vector<std::wstring> lines;
+            std::wstring line;
+
+            //
+            // Skips the empty line a CsvWriter ends its file with.
+            //
+            while (std::getline(file, line))
+            {
+                if (!line.empty())
+                {
+                    lines.push_back(line);
+                }
+            }
+
+            return lines;
+        }
+
+        std::vector<std::wstring> SplitCsvLine(
+            _In_ const std::wstring& line)
+        {
+            std::wstringstream lineStream(line);
+
+            std::vector<std::wstring> fields;
+            std::wstring field;
+
+            while (std::getline(lineStream, field, L','))
+            {
+                fields.push_back(field);
+            }
+
+            return fields;
+        }
+
+        bool HaveSamePixels(
+            _In_ Windows::Graphics::Imaging::SoftwareBitmap^ expectedBitmap,
+            _In_ Windows::Graphics::Imaging::SoftwareBitmap^ bitmap)
+        {
+            if (expectedBitmap->BitmapPixelFormat != bitmap->BitmapPixelFormat ||
+                expectedBitmap->PixelWidth != bitmap->PixelWidth ||
+                expectedBitmap->PixelHeight != bitmap->PixelHeight)
+            {
+                return false;
+            }
+
+            Windows::Graphics::Imaging::BitmapBuffer^ expectedBitmapBuffer =
+                expectedBitmap->LockBuffer(
+                    Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+            Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+                bitmap->LockBuffer(
+                    Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+            uint32_t expectedBitmapBufferDataLength = 0;
+
+            const uint8_t* expectedBitmapBufferData =
+                Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                    expectedBitmapBuffer->CreateReference(),
+                    expectedBitmapBufferDataLength);
+
+            uint32_t bitmapBufferDataLength = 0;
+
+            const uint8_t* bitmapBufferData =
+                Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                    bitmapBuffer->CreateReference(),
+                    bitmapBufferDataLength);
+
+            const bool isNv12 =
+                Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == bitmap->BitmapPixelFormat;
+
+            const int32_t bytesPerPixel =
+                Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8 == bitmap->BitmapPixelFormat ? 4 :
+                Windows::Graphics::Imaging::BitmapPixelFormat::Gray16 == bitmap->BitmapPixelFormat ? 2 : 1;
+
+            //
+            // The NV12 chroma plane has half as many rows of width/2 U/V pairs.
+            //
+            for (int32_t planeIndex = 0; planeIndex < (isNv12 ? 2 : 1); ++planeIndex)
+            {
+                const Windows::Graphics::Imaging::BitmapPlaneDescription expectedPlane =
+                    expectedBitmapBuffer->GetPlaneDescription(planeIndex);
+
+                const Windows::Graphics::Imaging::BitmapPlaneDescription plane =
+                    bitmapBuffer->GetPlaneDescription(planeIndex);
+
+                const int32_t numberOfRows =
+                    0 == planeIndex ? bitmap->PixelHeight : bitmap->PixelHeight / 2;
+
+                for (int32_t y = 0; y < numberOfRows; ++y)
+                {
+                    if (0 != memcmp(
+                        expectedBitmapBufferData + expectedPlane.StartIndex + y * expectedPlane.Stride,
+                        bitmapBufferData + plane.StartIndex + y * plane.Stride,
+                        bitmap->PixelWidth * bytesPerPixel))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool ValidateMultiFrameBuffer(
+            _In_ Windows::Graphics::Imaging::BitmapPixelFormat pixelFormat)
+        {
+            SyntheticSensorFrameSource^ source =
+                ref new SyntheticSensorFrameSource(
+                    SensorType::PhotoVideo,
+                    GetStartTimestamp());
+
+            source->PixelFormat = pixelFormat;
+
+            MultiFrameBuffer^ multiFrameBuffer =
+                ref new MultiFrameBuffer();
+
+            bool passed = true;
+
+            for (int32_t i = 0; i < kNumberOfFramesPerCheck; ++i)
+            {
+                SensorFrame^ sensorFrame =
+                    source->GetNextFrame();
+
+                multiFrameBuffer->Send(
+                    sensorFrame);
+
+                SensorFrame^ bufferedSensorFrame =
+                    multiFrameBuffer->GetFrameForTime(
+                        SensorType::PhotoVideo,
+                        sensorFrame->Timestamp,
+                        0.001f /* toleranceInSeconds */);
+
+                passed =
+                    passed &&
+                    nullptr != bufferedSensorFrame &&
+                    bufferedSensorFrame->Timestamp.UniversalTime == sensorFrame->Timestamp.UniversalTime &&
+                    HaveSamePixels(sensorFrame->SoftwareBitmap, bufferedSensorFrame->SoftwareBitmap);
+            }
+
+            const Io::PixelBufferPoolStatistics statistics =
+                multiFrameBuffer->GetPixelBufferPoolStatistics();
+
+            passed =
+                passed &&
+                statistics.numberOfAllocations <= kMaximumNumberOfBufferAllocations &&
+                statistics.numberOfAllocations + statistics.numberOfReuses == static_cast<uint64_t>(kNumberOfFramesPerCheck);
+
+            dbg::trace(
+                L"SensorFrameValidation: MultiFrameBuffer (%s): %s, %llu allocations and %llu reuses for %i frames",
+                Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == pixelFormat ? L"nv12" : L"bgra8",
+                passed ? L"passed" : L"FAILED",
+                statistics.numberOfAllocations,
+                statistics.numberOfReuses,
+                kNumberOfFramesPerCheck);
+
+            return passed;
+        }
+
+        bool ValidateRecorderSinkPixelBuffers(
+            _In_ Windows::Storage::StorageFolder^ outputFolder,
+            _In_ const std::shared_ptr<Io::TaskExecutor>& encoderExecutor)
+        {
+            Windows::Storage::StorageFolder^ folder =
+                CreateFolder(
+                    outputFolder,
+                    ref new Platform::String(
+                        nullptr != encoderExecutor ? L"pixel_buffers_executor" : L"pixel_buffers"));
+
+            SyntheticSensorFrameSource^ source =
+                ref new SyntheticSensorFrameSource(
+                    SensorType::PhotoVideo,
+                    GetStartTimestamp());
+
+            SensorFrameRecorderSink^ recorderSink =
+                ref new SensorFrameRecorderSink(
+                    SensorType::PhotoVideo,
+                    ref new Platform::String(L"pv"));
+
+            recorderSink->SetImageEncoding(
+                RecordingImageCodec::Netpbm,
+                90 /* jpegQuality */,
+                encoderExecutor);
+
+            recorderSink->Start(
+                folder);
+
+            for (int32_t i = 0; i < kNumberOfFramesPerCheck; ++i)
+            {
+                recorderSink->Send(
+                    source->GetNextFrame());
+            }
+
+            recorderSink->Stop();
+
+            const Io::PixelBufferPoolStatistics statistics =
+                recorderSink->GetPixelBufferPoolStatistics();
+
+            //
+            // Encoding on the sending thread needs a single buffer.
+            //
+            const uint64_t maximumNumberOfAllocations =
+                nullptr != encoderExecutor ? kMaximumNumberOfEncoderAllocations : 1;
+
+            const bool passed =
+                0 == statistics.numberOfBuffersInUse &&
+                statistics.numberOfAllocations <= maximumNumberOfAllocations &&
+                statistics.numberOfAllocations + statistics.numberOfReuses == static_cast<uint64_t>(kNumberOfFramesPerCheck);
+
+            dbg::trace(
+                L"SensorFrameValidation: recorder sink pixel buffers (%s): %s, %llu allocations and %llu reuses for %i frames, %llu in use",
+                nullptr != encoderExecutor ? L"executor" : L"synchronous",
+                passed ? L"passed" : L"FAILED",
+                statistics.numberOfAllocations,
+                statistics.numberOfReuses,
+                kNumberOfFramesPerCheck,
+                statistics.numberOfBuffersInUse);
+
+            return passed;
+        }
+
+        bool ValidateSensorFrameRing(
+            _In_ bool limitSize)
+        {
+            SensorFrameRing frameRing(
+                limitSize ? 0 : (kNumberOfFramesInRing - 1) * kRingFrameInterval,
+                limitSize ? kNumberOfFramesInRing * kRingBitmapSize + kRingBitmapSize / 2 : 0);
+
+            bool passed = true;
+            uint64_t numberOfAllocations = 0;
+
+            for (int32_t i = 0; i < kNumberOfFramesPerCheck; ++i)
+            {
+                //
+                // As in the recorder sink, a frame is encoded into the bitmap of the
+                // frame that last fell out of the ring.
+                //
+                RecordedSensorFrame frame = {};
+
+                frame.Timestamp = i * kRingFrameInterval;
+                frame.BitmapData = frameRing.TakeSpareBuffer();
+
+                if (0 == frame.BitmapData.capacity())
+                {
+                    ++numberOfAllocations;
+                }
+
+                frame.BitmapData.resize(
+                    kRingBitmapSize,
+                    static_cast<uint8_t>(i));
+
+                frameRing.Push(
+                    std::move(frame));
+
+                const SensorFrameRingStatistics statistics =
+                    frameRing.GetStatistics();
+
+                const int32_t numberOfFrames =
+                    std::min(i + 1, kNumberOfFramesInRing);
+
+                const int32_t firstFrameIndex =
+                    i + 1 - numberOfFrames;
+
+                passed =
+                    passed &&
+                    statistics.NumberOfFrames == static_cast<uint32_t>(numberOfFrames) &&
+                    statistics.FirstTimestamp == firstFrameIndex * kRingFrameInterval &&
+                    statistics.LastTimestamp == i * kRingFrameInterval &&
+                    statistics.NumberOfDroppedFrames == static_cast<uint64_t>(firstFrameIndex);
+            }
+
+            //
+            // The ring keeps the newest frames, oldest first, and every frame after the
+            // first one that fell out of it reused a dropped frame's bitmap.
+            //
+            const std::deque<RecordedSensorFrame> frames =
+                frameRing.TakeFrames();
+
+            passed =
+                passed &&
+                frames.size() == static_cast<size_t>(kNumberOfFramesInRing) &&
+                numberOfAllocations == static_cast<uint64_t>(kNumberOfFramesInRing + 1);
+
+            for (size_t j = 0; passed && j < frames.size(); ++j)
+            {
+                const int32_t frameIndex =
+                    kNumberOfFramesPerCheck - kNumberOfFramesInRing + static_cast<int32_t>(j);
+
+                passed =
+                    frames[j].Timestamp == frameIndex * kRingFrameInterval &&
+                    frames[j].BitmapData.size() == kRingBitmapSize &&
+                    frames[j].BitmapData.front() == static_cast<uint8_t>(frameIndex) &&
+                    frames[j].BitmapData.back() == static_cast<uint8_t>(frameIndex);
+            }
+
+            const SensorFrameRingStatistics statistics =
+                frameRing.GetStatistics();
+
+            passed =
+                passed &&
+                0 == statistics.NumberOfFrames &&
+                0 == statistics.NumberOfBytes;
+
+            dbg::trace(
+                L"SensorFrameValidation: SensorFrameRing (%s): %s, %llu allocations for %i frames",
+                limitSize ? L"size" : L"duration",
+                passed ? L"passed" : L"FAILED",
+                numberOfAllocations,
+                kNumberOfFramesPerCheck);
+
+            return passed;
+        }
+
+        bool ValidateFlightRecorderSink(
+            _In_ Windows::Storage::StorageFolder^ outputFolder)
+        {
+            Windows::Storage::StorageFolder^ folder =
+                CreateFolder(
+                    outputFolder,
+                    ref new Platform::String(L"flight_recording"));
+
+            SyntheticSensorFrameSource^ source =
+                ref new SyntheticSensorFrameSource(
+                    SensorType::PhotoVideo,
+                    GetStartTimestamp());
+
+            SensorFrameRecorderSink^ recorderSink =
+                ref new SensorFrameRecorderSink(
+                    SensorType::PhotoVideo,
+                    ref new Platform::String(L"pv"));
+
+            recorderSink->SetImageEncoding(
+                RecordingImageCodec::Netpbm,
+                90 /* jpegQuality */,
+                nullptr /* encoderExecutor */);
+
+            recorderSink->StartFlightRecording(
+                (kNumberOfFramesInRing - 1) * source->FrameIntervalInTicks,
+                0 /* maximumSize */);
+
+            int64_t lastTimestamp = 0;
+
+            for (int32_t i = 0; i < kNumberOfFramesPerCheck; ++i)
+            {
+                SensorFrame^ sensorFrame =
+                    source->GetNextFrame();
+
+                lastTimestamp = sensorFrame->Timestamp.UniversalTime;
+
+                recorderSink->Send(
+                    sensorFrame);
+            }
+
+            const SensorFrameRingStatistics statistics =
+                recorderSink->PersistFlightRecording(
+                    folder);
+
+            recorderSink->Stop();
+
+            //
+            // The CSV file has a header line and a line per persisted frame.
+            //
+            const std::vector<std::wstring> lines =
+                ReadLines(
+                    folder,
+                    L"pv.csv");
+
+            const bool passed =
+                statistics.NumberOfFrames == static_cast<uint32_t>(kNumberOfFramesInRing) &&
+                statistics.NumberOfDroppedFrames == static_cast<uint64_t>(kNumberOfFramesPerCheck - kNumberOfFramesInRing) &&
+                statistics.LastTimestamp == static_cast<uint64_t>(lastTimestamp) &&
+                lines.size() == static_cast<size_t>(kNumberOfFramesInRing + 1);
+
+            dbg::trace(
+                L"SensorFrameValidation: flight recorder sink: %s, %u frames persisted, %llu dropped",
+                passed ? L"passed" : L"FAILED",
+                statistics.NumberOfFrames,
+                statistics.NumberOfDroppedFrames);
+
+            return passed;
+        }
+
+        //
+        // Records frames of the synthetic source into segments and checks the lines of
+        // "segments.csv" against the frames that were sent: the segments are numbered
+        // in order and list all frames, every segment respects the policy's limits,
+        // and all but the last one were full when the sink moved on. The last segment
+        // is finalized by Stop, whether it is full or not.
+        //
+        bool ValidateRecordingSegments(
+            _In_ Windows::Storage::StorageFolder^ outputFolder,
+            _In_ const wchar_t* checkName,
+            _In_ int32_t maximumDurationInFrames,
+            _In_ uint64_t maximumSize,
+            _In_ int32_t numberOfFrames)
+        {
+            Windows::Storage::StorageFolder^ folder =
+                CreateFolder(
+                    outputFolder,
+                    ref new Platform::String(
+                        (std::wstring(L"segments_") + checkName).c_str()));
+
+            SyntheticSensorFrameSource^ source =
+                ref new SyntheticSensorFrameSource(
+                    SensorType::PhotoVideo,
+                    GetStartTimestamp());
+
+            RecordingSegmentPolicy segmentPolicy;
+
+            segmentPolicy.MaximumDuration = maximumDurationInFrames * source->FrameIntervalInTicks;
+            segmentPolicy.MaximumSize = maximumSize;
+
+            SensorFrameRecorderSink^ recorderSink =
+                ref new SensorFrameRecorderSink(
+                    SensorType::PhotoVideo,
+                    ref new Platform::String(L"pv"));
+
+            recorderSink->SetImageEncoding(
+                RecordingImageCodec::Netpbm,
+                90 /* jpegQuality */,
+                nullptr /* encoderExecutor */);
+
+            recorderSink->SetSegmentation(
+                segmentPolicy,
+                std::make_shared<RecordingSegmentManifest>(
+                    std::wstring(folder->Path->Data()) +
+                    L"\\segments.csv"));
+
+            recorderSink->Start(
+                folder);
+
+            std::vector<uint64_t> timestamps;
+
+            for (int32_t i = 0; i < numberOfFrames; ++i)
+            {
+                SensorFrame^ sensorFrame =
+                    source->GetNextFrame();
+
+                timestamps.push_back(
+                    sensorFrame->Timestamp.UniversalTime);
+
+                recorderSink->Send(
+                    sensorFrame);
+            }
+
+            recorderSink->Stop();
+
+            const std::vector<std::wstring> lines =
+                ReadLines(
+                    folder,
+                    L"segments.csv");
+
+            bool passed =
+                !lines.empty() &&
+                lines[0] == L"SensorName,SegmentIndex,TarballFileName,CsvFileName,FirstTimestamp,LastTimestamp,NumberOfFrames,NumberOfBytes";
+
+            // The index of the first frame of the segment
+            size_t frameIndex = 0;
+            uint32_t numberOfFramesInLastSegment = 0;
+
+            for (size_t i = 1; passed && i < lines.size(); ++i)
+            {
+                const std::vector<std::wstring> fields =
+                    SplitCsvLine(
+                        lines[i]);
+
+                if (8 != fields.size())
+                {
+                    passed = false;
+                    break;
+                }
+
+                const int32_t segmentIndex = std::stoi(fields[1]);
+                const uint64_t firstTimestamp = std::stoull(fields[4]);
+                const uint64_t lastTimestamp = std::stoull(fields[5]);
+                const uint32_t numberOfSegmentFrames = std::stoul(fields[6]);
+                const uint64_t numberOfBytes = std::stoull(fields[7]);
+
+                const bool isLastSegment =
+                    lines.size() - 1 == i;
+
+                //
+                // The segment's CSV file has a header line and a line per frame.
+                //
+                passed =
+                    L"pv" == fields[0] &&
+                    segmentIndex == static_cast<int32_t>(i - 1) &&
+                    0 != numberOfSegmentFrames &&
+                    frameIndex + numberOfSegmentFrames <= timestamps.size() &&
+                    (isLastSegment || frameIndex + numberOfSegmentFrames < timestamps.size()) &&
+                    firstTimestamp == timestamps[frameIndex] &&
+                    lastTimestamp == timestamps[frameIndex + numberOfSegmentFrames - 1] &&
+                    ReadLines(folder, fields[3].c_str()).size() == numberOfSegmentFrames + 1;
+
+                if (passed && 0 != segmentPolicy.MaximumDuration)
+                {
+                    passed =
+                        static_cast<int64_t>(lastTimestamp - firstTimestamp) < segmentPolicy.MaximumDuration &&
+                        (isLastSegment ||
+                            static_cast<int64_t>(timestamps[frameIndex + numberOfSegmentFrames] - firstTimestamp) >=
+                                segmentPolicy.MaximumDuration);
+                }
+
+                if (passed && 0 != segmentPolicy.MaximumSize)
+                {
+                    //
+                    // The frames of the synthetic source all encode to the same size;
+                    // the tarball ends with two blocks of zeros.
+                    //
+                    const uint64_t tarballEntrySize =
+                        (numberOfBytes - 2 * 512) / numberOfSegmentFrames;
+
+                    passed =
+                        numberOfBytes <= segmentPolicy.MaximumSize &&
+                        (isLastSegment || numberOfBytes + tarballEntrySize > segmentPolicy.MaximumSize);
+                }
+
+                frameIndex += numberOfSegmentFrames;
+                numberOfFramesInLastSegment = numberOfSegmentFrames;
+            }
+
+            //
+            // At least one rollover happened, and every frame sent was listed.
+            //
+            passed =
+                passed &&
+                lines.size() > 2 &&
+                frameIndex == timestamps.size();
+
+            dbg::trace(
+                L"SensorFrameValidation: segments (%s): %s, %zu segments for %i frames, %u in the last one",
+                checkName,
+                passed ? L"passed" : L"FAILED",
+                lines.empty() ? 0 : lines.size() - 1,
+                numberOfFrames,
+                numberOfFramesInLastSegment);
+
+            return passed;
+        }
+    }
+
+    bool SensorFrameValidation::Run(
+        _In_ Windows::Storage::StorageFolder^ outputFolder)
+    {
+        REQUIRES(nullptr != outputFolder);
+
+        bool passed = true;
+
+        passed = ValidateMultiFrameBuffer(Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8) && passed;
+        passed = ValidateMultiFrameBuffer(Windows::Graphics::Imaging::BitmapPixelFormat::Nv12) && passed;
+
+        passed = ValidateRecorderSinkPixelBuffers(outputFolder, nullptr) && passed;
+        passed = ValidateRecorderSinkPixelBuffers(outputFolder, std::make_shared<Io::TaskExecutor>(2 /* numberOfWorkers */)) && passed;
+
+        passed = ValidateSensorFrameRing(false /* limitSize */) && passed;
+        passed = ValidateSensorFrameRing(true /* limitSize */) && passed;
+        passed = ValidateFlightRecorderSink(outputFolder) && passed;
+
+        //
+        // Stopping three frames into the sixth five-frame segment leaves it partial.
+        //
+        passed = ValidateRecordingSegments(outputFolder, L"duration", 5, 0, kNumberOfFramesPerCheck) && passed;
+        passed = ValidateRecordingSegments(outputFolder, L"size", 0, 8 * 1024 * 1024, kNumberOfFramesPerCheck) && passed;
+        passed = ValidateRecordingSegments(outputFolder, L"stop", 5, 0, kNumberOfFramesPerCheck - 2) && passed;
+
+        dbg::trace(
+            L"SensorFrameValidation: %s",
+            passed ? L"passed" : L"FAILED");
+
+        return passed;
+    }
+}
@@ -0,0 +1,41 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // Checks the buffering and recording of sensor frames against frames of the
+    // synthetic sensor source, so that they can be verified without the sensors:
+    //
+    //  - The MultiFrameBuffer hands out the pixels that were sent to it, as Bgra8 and
+    //    NV12, and its pixel buffer pool stops allocating once the buffer is full.
+    //  - The recorder sink returns the pixel buffers of the frames it encoded to its
+    //    pool, encoding on the sending thread and on an executor.
+    //  - The SensorFrameRing keeps the newest frames within its window or budget,
+    //    oldest first, and hands out the bitmaps of the frames it dropped for reuse.
+    //  - A flight recorder sink persists the frames its ring kept.
+    //  - A segmented recording rolls over at the duration and size limits, lists
+    //    every segment in the eight columns of "segments.csv", and Stop finalizes
+    //    the segment being recorded.
+    //
+    // The recordings are written to subfolders of the output folder. Traces the result
+    // of each check and returns true if all of them passed. Runs synchronously; call it
+    // from a background thread.
+    //
+    public ref class SensorFrameValidation sealed
+    {
+    public:
+        static bool Run(
+            _In_ Windows::Storage::StorageFolder^ outputFolder);
+    };
+}
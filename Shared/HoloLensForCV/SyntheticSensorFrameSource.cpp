@@ -0,0 +1,262 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace HoloLensForCV
+{
+    namespace
+    {
+        const int64_t c_ticksPerSecond = 10000000;
+
+        //
+        // The synthetic head walks around a circle of this radius once per period,
+        // looking towards its center.
+        //
+        const float c_trajectoryRadiusInMeters = 1.5f;
+        const float c_trajectoryPeriodInSeconds = 20.0f;
+
+        const float c_pi = 3.14159265f;
+    }
+
+    SyntheticSensorFrameSource::SyntheticSensorFrameSource(
+        _In_ SensorType sensorType,
+        _In_ Windows::Foundation::DateTime startTimestamp)
+        : _sensorType(sensorType)
+        , _timestamp(startTimestamp)
+        , _frameIndex(0)
+    {
+        namespace WFN = Windows::Foundation::Numerics;
+
+        float horizontalFieldOfViewInRadians = 0.0f;
+
+        //
+        // Camera positions relative to the head, roughly as laid out on the device.
+        //
+        WFN::float3 cameraOffset(0.0f, 0.0f, 0.0f);
+        float cameraYawInRadians = 0.0f;
+
+        switch (sensorType)
+        {
+        case SensorType::PhotoVideo:
+            _pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
+            _bitmapWidth = 1280;
+            _bitmapHeight = 720;
+            _frameIntervalInTicks = c_ticksPerSecond / 30;
+            horizontalFieldOfViewInRadians = 1.05f;
+            cameraOffset = WFN::float3(0.0f, 0.02f, 0.0f);
+            break;
+
+#if ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS
+        case SensorType::ShortThrowToFDepth:
+        case SensorType::LongThrowToFDepth:
+            _pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray16;
+            _bitmapWidth = 448;
+            _bitmapHeight = 450;
+            _frameIntervalInTicks = c_ticksPerSecond / (sensorType == SensorType::ShortThrowToFDepth ? 30 : 5);
+            horizontalFieldOfViewInRadians = 2.1f;
+            break;
+
+        case SensorType::ShortThrowToFReflectivity:
+        case SensorType::LongThrowToFReflectivity:
+            _pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Gray8;
+            _bitmapWidth = 448;
+            _bitmapHeight = 450;
+            _frameIntervalInTicks = c_ticksPerSecond / (sensorType == SensorType::ShortThrowToFReflectivity ? 30 : 5);
+            horizontalFieldOfViewInRadians = 2.1f;
+            break;
+
+        case SensorType::VisibleLightLeftLeft:
+        case SensorType::VisibleLightLeftFront:
+        case SensorType::VisibleLightRightFront:
+        case SensorType::VisibleLightRightRight:
+            //
+            // The VLC cameras deliver 640x480 8-bit pixels, four to a Bgra8 pixel.
+            //
+            _pixelFormat = Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8;
+            _bitmapWidth = 640 / 4;
+            _bitmapHeight = 480;
+            _frameIntervalInTicks = c_ticksPerSecond / 30;
+            horizontalFieldOfViewInRadians = 1.5f;
+
+            if (sensorType == SensorType::VisibleLightLeftLeft)
+            {
+                cameraOffset = WFN::float3(-0.05f, 0.0f, 0.0f);
+                cameraYawInRadians = 0.8f;
+            }
+            else if (sensorType == SensorType::VisibleLightLeftFront)
+            {
+                cameraOffset = WFN::float3(-0.03f, 0.0f, 0.0f);
+            }
+            else if (sensorType == SensorType::VisibleLightRightFront)
+            {
+                cameraOffset = WFN::float3(0.03f, 0.0f, 0.0f);
+            }
+            else
+            {
+                cameraOffset = WFN::float3(0.05f, 0.0f, 0.0f);
+                cameraYawInRadians = -0.8f;
+            }
+            break;
+#endif /* ENABLE_HOLOLENS_RESEARCH_MODE_SENSORS */
+
+        default:
+            REQUIRES(false);
+            break;
+        }
+
+        _cameraViewTransform =
+            WFN::make_float4x4_rotation_y(cameraYawInRadians) *
+            WFN::make_float4x4_translation(-cameraOffset);
+
+        _cameraProjectionTransform =
+            WFN::make_float4x4_perspective_field_of_view(
+                horizontalFieldOfViewInRadians,
+                1.0f /* aspect ratio */,
+                0.1f /* near plane distance */,
+                20.0f /* far plane distance */);
+    }
+
+    void SyntheticSensorFrameSource::PixelFormat::set(
+        Windows::Graphics::Imaging::BitmapPixelFormat value)
+    {
+        REQUIRES(
+            value == _pixelFormat ||
+            (_sensorType == SensorType::PhotoVideo &&
+                (value == Windows::Graphics::Imaging::BitmapPixelFormat::Bgra8 ||
+                 value == Windows::Graphics::Imaging::BitmapPixelFormat::Nv12)));
+
+        _pixelFormat = value;
+    }
+
+    SensorFrame^ SyntheticSensorFrameSource::GetNextFrame()
+    {
+        namespace WFN = Windows::Foundation::Numerics;
+
+        Windows::Graphics::Imaging::SoftwareBitmap^ bitmap =
+            ref new Windows::Graphics::Imaging::SoftwareBitmap(
+                _pixelFormat,
+                _bitmapWidth,
+                _bitmapHeight,
+                Windows::Graphics::Imaging::BitmapAlphaMode::Ignore);
+
+        FillBitmap(
+            bitmap);
+
+        SensorFrame^ sensorFrame =
+            ref new SensorFrame(
+                _sensorType,
+                _timestamp,
+                bitmap);
+
+        const float angle =
+            2.0f * c_pi * static_cast<float>(_frameIndex * _frameIntervalInTicks) /
+            (c_trajectoryPeriodInSeconds * c_ticksPerSecond);
+
+        //
+        // The frame-to-origin transform of a head on the circle, facing its center
+        // (the camera looks down the negative z axis).
+        //
+        sensorFrame->FrameToOrigin =
+            WFN::make_float4x4_rotation_y(-angle) *
+            WFN::make_float4x4_translation(
+                c_trajectoryRadiusInMeters * std::sin(angle),
+                0.0f,
+                c_trajectoryRadiusInMeters * std::cos(angle));
+
+        sensorFrame->CameraViewTransform = _cameraViewTransform;
+        sensorFrame->CameraProjectionTransform = _cameraProjectionTransform;
+
+        _timestamp.UniversalTime += _frameIntervalInTicks;
+        ++_frameIndex;
+
+        return sensorFrame;
+    }
+
+    void SyntheticSensorFrameSource::FillBitmap(
+        _In_ Windows::Graphics::Imaging::SoftwareBitmap^ bitmap)
+    {
+        Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+            bitmap->LockBuffer(
+                Windows::Graphics::Imaging::BitmapBufferAccessMode::Write);
+
+        Windows::Foundation::IMemoryBufferReference^ bitmapBufferReference =
+            bitmapBuffer->CreateReference();
+
+        uint32_t bitmapBufferDataLength = 0;
+
+        uint8_t* bitmapBufferData =
+            Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                bitmapBufferReference,
+                bitmapBufferDataLength);
+
+        const Windows::Graphics::Imaging::BitmapPlaneDescription plane =
+            bitmapBuffer->GetPlaneDescription(0);
+
+        if (_pixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Nv12)
+        {
+            //
+            // Both planes are width bytes wide, the chroma plane has half the rows.
+            //
+            const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                bitmapBuffer->GetPlaneDescription(1);
+
+            for (int32_t y = 0; y < _bitmapHeight + _bitmapHeight / 2; ++y)
+            {
+                uint8_t* row =
+                    y < _bitmapHeight
+                        ? bitmapBufferData + plane.StartIndex + y * plane.Stride
+                        : bitmapBufferData + chromaPlane.StartIndex + (y - _bitmapHeight) * chromaPlane.Stride;
+
+                for (int32_t x = 0; x < _bitmapWidth; ++x)
+                {
+                    row[x] =
+                        static_cast<uint8_t>((x ^ y) + _frameIndex);
+                }
+            }
+
+            return;
+        }
+
+        //
+        // A pattern that moves by one pixel per frame, so that consecutive frames
+        // differ like camera images do and do not compress to nothing.
+        //
+        for (int32_t y = 0; y < plane.Height; ++y)
+        {
+            uint8_t* row =
+                bitmapBufferData + plane.StartIndex + y * plane.Stride;
+
+            if (_pixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Gray16)
+            {
+                uint16_t* depthRow =
+                    reinterpret_cast<uint16_t*>(row);
+
+                for (int32_t x = 0; x < plane.Width; ++x)
+                {
+                    depthRow[x] =
+                        static_cast<uint16_t>(500 + ((x + y + _frameIndex) * 7) % 3500);
+                }
+            }
+            else
+            {
+                const int32_t rowLength =
+                    plane.Width * (_pixelFormat == Windows::Graphics::Imaging::BitmapPixelFormat::Gray8 ? 1 : 4);
+
+                for (int32_t x = 0; x < rowLength; ++x)
+                {
+                    row[x] =
+                        static_cast<uint8_t>((x ^ y) + _frameIndex);
+                }
+            }
+        }
+    }
+}
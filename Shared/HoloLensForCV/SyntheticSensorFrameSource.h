@@ -0,0 +1,74 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace HoloLensForCV
+{
+    //
+    // Produces sensor frames with the resolution, pixel format and frame rate of the
+    // given HoloLens sensor, and a smooth head trajectory for the poses. Lets the
+    // recorder, streamer and processing code be exercised without the sensors:
+    //
+    //  - PhotoVideo: 1280x720 Bgra8 (or Nv12) at 30Hz.
+    //  - VisibleLight*: 640x480 Gray8 packed into a 160x480 Bgra8 bitmap at 30Hz.
+    //  - *ToFDepth: 448x450 Gray16 in millimeters, at 30Hz (short throw) or 5Hz (long throw).
+    //  - *ToFReflectivity: 448x450 Gray8, at the rate of the matching depth sensor.
+    //
+    // Timestamps advance by one frame interval per frame, regardless of wall time.
+    //
+    public ref class SyntheticSensorFrameSource sealed
+    {
+    public:
+        SyntheticSensorFrameSource(
+            _In_ SensorType sensorType,
+            _In_ Windows::Foundation::DateTime startTimestamp);
+
+        property SensorType FrameType
+        {
+            SensorType get() { return _sensorType; }
+        }
+
+        property int64_t FrameIntervalInTicks
+        {
+            int64_t get() { return _frameIntervalInTicks; }
+        }
+
+        //
+        // Must be a format the sensor can deliver; PhotoVideo frames can be switched to
+        // Nv12 (see MediaFrameSourceGroup::PhotoVideoPixelFormat).
+        //
+        property Windows::Graphics::Imaging::BitmapPixelFormat PixelFormat
+        {
+            Windows::Graphics::Imaging::BitmapPixelFormat get() { return _pixelFormat; }
+            void set(Windows::Graphics::Imaging::BitmapPixelFormat value);
+        }
+
+        SensorFrame^ GetNextFrame();
+
+    private:
+        void FillBitmap(
+            _In_ Windows::Graphics::Imaging::SoftwareBitmap^ bitmap);
+
+        SensorType _sensorType;
+
+        Windows::Graphics::Imaging::BitmapPixelFormat _pixelFormat;
+        int32_t _bitmapWidth;
+        int32_t _bitmapHeight;
+        int64_t _frameIntervalInTicks;
+
+        Windows::Foundation::Numerics::float4x4 _cameraViewTransform;
+        Windows::Foundation::Numerics::float4x4 _cameraProjectionTransform;
+
+        Windows::Foundation::DateTime _timestamp;
+        uint32_t _frameIndex;
+    };
+}
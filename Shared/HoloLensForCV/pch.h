@@ -12,11 +12,15 @@
 #pragma once
 
 #include <map>
+#include <atomic>
 #include <array>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <ctime>
 #include <deque>
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <sstream>
@@ -51,16 +55,22 @@
 #include "SpatialPerception.h"
 
 #include "SensorType.h"
+#include "RecordingImageCodec.h"
 #include "SensorFrame.h"
 
 #include "ISensorFrameSink.h"
 #include "ISensorFrameSinkGroup.h"
 
+#include "SensorFrameMailbox.h"
+
 #include "SensorFrameStreamHeader.h"
 #include "SensorFrameStreamingServer.h"
 #include "SensorFrameStreamer.h"
 #include "SensorFrameReceiver.h"
 
+#include "RecordingSegmentManifest.h"
+#include "RecordingImageEncoder.h"
+#include "SensorFrameRing.h"
 #include "SensorFrameRecorderSink.h"
 #include "SensorFrameRecorder.h"
 
@@ -69,3 +79,7 @@
 #include "MediaFrameSourceGroup.h"
 
 #include "MultiFrameBuffer.h"
+
+#include "SyntheticSensorFrameSource.h"
+#include "SensorFrameBenchmark.h"
+#include "SensorFrameValidation.h"
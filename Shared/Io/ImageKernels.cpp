@@ -0,0 +1,606 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define IO_IMAGE_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define IO_IMAGE_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Io
+{
+    namespace
+    {
+        //
+        // Number of downsampled rows per band, and the width and height of the tiles
+        // the bands are transposed in.
+        //
+        const int32_t c_tileSize = 16;
+
+        void WritePixel(
+            _In_ const uint8_t value,
+            _In_ const ImageKernelOutputFormat outputFormat,
+            _Out_ uint8_t* output,
+            _In_ const int32_t outputStride,
+            _In_ const int32_t x,
+            _In_ const int32_t y)
+        {
+            if (ImageKernelOutputFormat::Gray8 == outputFormat)
+            {
+                output[y * outputStride + x] = value;
+            }
+            else
+            {
+                uint8_t* pixel = output + y * outputStride + 4 * x;
+
+                pixel[0] = value;
+                pixel[1] = value;
+                pixel[2] = value;
+                pixel[3] = 255;
+            }
+        }
+
+        //
+        // Averages downsampleFactor input rows into one output row.
+        //
+        void DownsampleRow(
+            _In_ const uint8_t* input,
+            _In_ const int32_t inputStride,
+            _In_ const int32_t downsampleFactor,
+            _In_ const int32_t outputWidth,
+            _Out_ uint8_t* output)
+        {
+            int32_t x = 0;
+
+            if (1 == downsampleFactor)
+            {
+                memcpy(output, input, outputWidth);
+
+                return;
+            }
+
+#if defined(IO_IMAGE_KERNELS_SSE2)
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+
+            if (2 == downsampleFactor)
+            {
+                for (; x + 16 <= outputWidth; x += 16)
+                {
+                    __m128i sums[2];
+
+                    for (int32_t half = 0; half < 2; ++half)
+                    {
+                        const __m128i row0 = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(input + 2 * x + 16 * half));
+                        const __m128i row1 = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(input + inputStride + 2 * x + 16 * half));
+
+                        //
+                        // Add the even and odd bytes of both rows as 16-bit lanes.
+                        //
+                        sums[half] = _mm_add_epi16(
+                            _mm_add_epi16(_mm_and_si128(row0, lowBytes), _mm_srli_epi16(row0, 8)),
+                            _mm_add_epi16(_mm_and_si128(row1, lowBytes), _mm_srli_epi16(row1, 8)));
+                    }
+
+                    _mm_storeu_si128(
+                        reinterpret_cast<__m128i*>(output + x),
+                        _mm_packus_epi16(_mm_srli_epi16(sums[0], 2), _mm_srli_epi16(sums[1], 2)));
+                }
+            }
+            else if (4 == downsampleFactor)
+            {
+                const __m128i lowWords = _mm_set1_epi32(0x0000FFFF);
+
+                for (; x + 8 <= outputWidth; x += 8)
+                {
+                    __m128i sums[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+
+                    for (int32_t row = 0; row < 4; ++row)
+                    {
+                        for (int32_t half = 0; half < 2; ++half)
+                        {
+                            const __m128i pixels = _mm_loadu_si128(
+                                reinterpret_cast<const __m128i*>(input + row * inputStride + 4 * x + 16 * half));
+
+                            sums[half] = _mm_add_epi16(
+                                sums[half],
+                                _mm_add_epi16(_mm_and_si128(pixels, lowBytes), _mm_srli_epi16(pixels, 8)));
+                        }
+                    }
+
+                    //
+                    // Sums of 4x4 blocks fit in 12 bits, so the signed saturating packs
+                    // are exact.
+                    //
+                    const __m128i blockSums0 = _mm_srli_epi32(
+                        _mm_add_epi32(_mm_and_si128(sums[0], lowWords), _mm_srli_epi32(sums[0], 16)), 4);
+                    const __m128i blockSums1 = _mm_srli_epi32(
+                        _mm_add_epi32(_mm_and_si128(sums[1], lowWords), _mm_srli_epi32(sums[1], 16)), 4);
+
+                    _mm_storel_epi64(
+                        reinterpret_cast<__m128i*>(output + x),
+                        _mm_packus_epi16(_mm_packs_epi32(blockSums0, blockSums1), _mm_setzero_si128()));
+                }
+            }
+#elif defined(IO_IMAGE_KERNELS_NEON)
+            if (2 == downsampleFactor)
+            {
+                for (; x + 16 <= outputWidth; x += 16)
+                {
+                    uint16x8_t sums[2];
+
+                    for (int32_t half = 0; half < 2; ++half)
+                    {
+                        sums[half] = vpadalq_u8(
+                            vpaddlq_u8(vld1q_u8(input + 2 * x + 16 * half)),
+                            vld1q_u8(input + inputStride + 2 * x + 16 * half));
+                    }
+
+                    vst1q_u8(
+                        output + x,
+                        vcombine_u8(vshrn_n_u16(sums[0], 2), vshrn_n_u16(sums[1], 2)));
+                }
+            }
+            else if (4 == downsampleFactor)
+            {
+                for (; x + 8 <= outputWidth; x += 8)
+                {
+                    uint16x8_t sums[2] = { vdupq_n_u16(0), vdupq_n_u16(0) };
+
+                    for (int32_t row = 0; row < 4; ++row)
+                    {
+                        for (int32_t half = 0; half < 2; ++half)
+                        {
+                            sums[half] = vpadalq_u8(
+                                sums[half],
+                                vld1q_u8(input + row * inputStride + 4 * x + 16 * half));
+                        }
+                    }
+
+                    const uint16x8_t blockSums = vcombine_u16(
+                        vshrn_n_u32(vpaddlq_u16(sums[0]), 4),
+                        vshrn_n_u32(vpaddlq_u16(sums[1]), 4));
+
+                    vst1_u8(
+                        output + x,
+                        vmovn_u16(blockSums));
+                }
+            }
+#endif
+
+            const int32_t blockArea =
+                downsampleFactor * downsampleFactor;
+
+            for (; x < outputWidth; ++x)
+            {
+                uint32_t sum = 0;
+
+                for (int32_t dy = 0; dy < downsampleFactor; ++dy)
+                {
+                    for (int32_t dx = 0; dx < downsampleFactor; ++dx)
+                    {
+                        sum += input[dy * inputStride + x * downsampleFactor + dx];
+                    }
+                }
+
+                output[x] = static_cast<uint8_t>(sum / blockArea);
+            }
+        }
+
+        //
+        // Writes a row of gray pixels to the output, expanding it to BGRA if needed.
+        //
+        void WriteRow(
+            _In_ const uint8_t* values,
+            _In_ const int32_t width,
+            _In_ const ImageKernelOutputFormat outputFormat,
+            _Out_ uint8_t* output)
+        {
+            if (ImageKernelOutputFormat::Gray8 == outputFormat)
+            {
+                memcpy(output, values, width);
+
+                return;
+            }
+
+            int32_t x = 0;
+
+#if defined(IO_IMAGE_KERNELS_SSE2)
+            const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m128i gray = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(values + x));
+
+                const __m128i grayGray[2] = { _mm_unpacklo_epi8(gray, gray), _mm_unpackhi_epi8(gray, gray) };
+                const __m128i grayOpaque[2] = { _mm_unpacklo_epi8(gray, opaque), _mm_unpackhi_epi8(gray, opaque) };
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    _mm_storeu_si128(
+                        reinterpret_cast<__m128i*>(output + 4 * x + 32 * half),
+                        _mm_unpacklo_epi16(grayGray[half], grayOpaque[half]));
+
+                    _mm_storeu_si128(
+                        reinterpret_cast<__m128i*>(output + 4 * x + 32 * half + 16),
+                        _mm_unpackhi_epi16(grayGray[half], grayOpaque[half]));
+                }
+            }
+#elif defined(IO_IMAGE_KERNELS_NEON)
+            for (; x + 16 <= width; x += 16)
+            {
+                const uint8x16_t gray = vld1q_u8(values + x);
+
+                uint8x16x4_t bgra;
+
+                bgra.val[0] = gray;
+                bgra.val[1] = gray;
+                bgra.val[2] = gray;
+                bgra.val[3] = vdupq_n_u8(0xFF);
+
+                vst4q_u8(
+                    output + 4 * x,
+                    bgra);
+            }
+#endif
+
+            for (; x < width; ++x)
+            {
+                output[4 * x + 0] = values[x];
+                output[4 * x + 1] = values[x];
+                output[4 * x + 2] = values[x];
+                output[4 * x + 3] = 255;
+            }
+        }
+
+#if defined(IO_IMAGE_KERNELS_SSE2)
+        //
+        // Transposes a 16x16 block of bytes with four rounds of interleaving: after the
+        // round on 2^k-byte lanes, each lane holds 2^k consecutive rows of one column.
+        //
+        void Transpose16x16(
+            _In_reads_(c_tileSize) const uint8_t* const* rows,
+            _Out_writes_(c_tileSize * c_tileSize) uint8_t* tile)
+        {
+            __m128i a[16], b[16];
+
+            for (int32_t i = 0; i < 8; ++i)
+            {
+                const __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[2 * i]));
+                const __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[2 * i + 1]));
+
+                a[i] = _mm_unpacklo_epi8(row0, row1);
+                a[i + 8] = _mm_unpackhi_epi8(row0, row1);
+            }
+
+            for (int32_t group = 0; group < 2; ++group)
+            {
+                for (int32_t j = 0; j < 4; ++j)
+                {
+                    b[group * 8 + j] = _mm_unpacklo_epi16(a[group * 8 + 2 * j], a[group * 8 + 2 * j + 1]);
+                    b[group * 8 + j + 4] = _mm_unpackhi_epi16(a[group * 8 + 2 * j], a[group * 8 + 2 * j + 1]);
+                }
+            }
+
+            for (int32_t quad = 0; quad < 4; ++quad)
+            {
+                const __m128i* c = b + quad * 4;
+
+                const __m128i columns01Rows0To7 = _mm_unpacklo_epi32(c[0], c[1]);
+                const __m128i columns23Rows0To7 = _mm_unpackhi_epi32(c[0], c[1]);
+                const __m128i columns01Rows8To15 = _mm_unpacklo_epi32(c[2], c[3]);
+                const __m128i columns23Rows8To15 = _mm_unpackhi_epi32(c[2], c[3]);
+
+                __m128i* columns = reinterpret_cast<__m128i*>(tile + quad * 4 * c_tileSize);
+
+                _mm_storeu_si128(columns + 0, _mm_unpacklo_epi64(columns01Rows0To7, columns01Rows8To15));
+                _mm_storeu_si128(columns + 1, _mm_unpackhi_epi64(columns01Rows0To7, columns01Rows8To15));
+                _mm_storeu_si128(columns + 2, _mm_unpacklo_epi64(columns23Rows0To7, columns23Rows8To15));
+                _mm_storeu_si128(columns + 3, _mm_unpackhi_epi64(columns23Rows0To7, columns23Rows8To15));
+            }
+        }
+#else
+        void Transpose16x16(
+            _In_reads_(c_tileSize) const uint8_t* const* rows,
+            _Out_writes_(c_tileSize * c_tileSize) uint8_t* tile)
+        {
+            for (int32_t y = 0; y < c_tileSize; ++y)
+            {
+                for (int32_t x = 0; x < c_tileSize; ++x)
+                {
+                    tile[x * c_tileSize + y] = rows[y][x];
+                }
+            }
+        }
+#endif
+    }
+
+    void GetTransformedGray8ImageSize(
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _Out_ int32_t& outputWidth,
+        _Out_ int32_t& outputHeight)
+    {
+        REQUIRES(1 == downsampleFactor || 2 == downsampleFactor || 4 == downsampleFactor);
+
+        const int32_t downsampledWidth = inputWidth / downsampleFactor;
+        const int32_t downsampledHeight = inputHeight / downsampleFactor;
+
+        if (ImageOrientation::Identity == orientation)
+        {
+            outputWidth = downsampledWidth;
+            outputHeight = downsampledHeight;
+        }
+        else
+        {
+            outputWidth = downsampledHeight;
+            outputHeight = downsampledWidth;
+        }
+    }
+
+    void TransformGray8Image(
+        _In_ const uint8_t* input,
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t inputStride,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _In_ const ImageKernelOutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride)
+    {
+        int32_t outputWidth, outputHeight;
+
+        GetTransformedGray8ImageSize(
+            inputWidth,
+            inputHeight,
+            downsampleFactor,
+            orientation,
+            outputWidth,
+            outputHeight);
+
+#if IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE
+        dbg::Timer timer;
+#endif /* IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE */
+
+        const int32_t width = inputWidth / downsampleFactor;
+        const int32_t height = inputHeight / downsampleFactor;
+
+        std::vector<uint8_t> band(
+            c_tileSize * width);
+
+        uint8_t tile[c_tileSize * c_tileSize];
+        const uint8_t* tileRows[c_tileSize];
+
+        for (int32_t y0 = 0; y0 < height; y0 += c_tileSize)
+        {
+            const int32_t bandHeight =
+                std::min(c_tileSize, height - y0);
+
+            for (int32_t y = 0; y < bandHeight; ++y)
+            {
+                DownsampleRow(
+                    input + (y0 + y) * downsampleFactor * inputStride,
+                    inputStride,
+                    downsampleFactor,
+                    width,
+                    band.data() + y * width);
+            }
+
+            if (ImageOrientation::Identity == orientation)
+            {
+                for (int32_t y = 0; y < bandHeight; ++y)
+                {
+                    WriteRow(
+                        band.data() + y * width,
+                        width,
+                        outputFormat,
+                        output + (y0 + y) * outputStride);
+                }
+
+                continue;
+            }
+
+            //
+            // Row x of the downsampled image becomes column x of the output for a
+            // transpose, which the rotations then flip horizontally (clockwise, by
+            // feeding the band rows to the tile bottom up) or vertically.
+            //
+            const bool clockwise = ImageOrientation::Rotate90Clockwise == orientation;
+            const bool counterClockwise = ImageOrientation::Rotate90CounterClockwise == orientation;
+
+            int32_t x0 = 0;
+
+            if (c_tileSize == bandHeight)
+            {
+                for (int32_t y = 0; y < c_tileSize; ++y)
+                {
+                    tileRows[y] = band.data() + (clockwise ? c_tileSize - 1 - y : y) * width;
+                }
+
+                const int32_t outputColumn =
+                    clockwise ? height - c_tileSize - y0 : y0;
+
+                for (; x0 + c_tileSize <= width; x0 += c_tileSize)
+                {
+                    Transpose16x16(
+                        tileRows,
+                        tile);
+
+                    for (int32_t x = 0; x < c_tileSize; ++x)
+                    {
+                        const int32_t outputRow =
+                            counterClockwise ? width - 1 - (x0 + x) : x0 + x;
+
+                        uint8_t* outputPixels =
+                            output + outputRow * outputStride +
+                            outputColumn * (ImageKernelOutputFormat::Gray8 == outputFormat ? 1 : 4);
+
+                        WriteRow(
+                            tile + x * c_tileSize,
+                            c_tileSize,
+                            outputFormat,
+                            outputPixels);
+                    }
+
+                    for (int32_t y = 0; y < c_tileSize; ++y)
+                    {
+                        tileRows[y] += c_tileSize;
+                    }
+                }
+            }
+
+            //
+            // Partial tiles along the right and bottom edges.
+            //
+            for (int32_t y = 0; y < bandHeight; ++y)
+            {
+                for (int32_t x = x0; x < width; ++x)
+                {
+                    const int32_t outputRow =
+                        counterClockwise ? width - 1 - x : x;
+
+                    const int32_t outputColumn =
+                        clockwise ? height - 1 - (y0 + y) : y0 + y;
+
+                    WritePixel(
+                        band[y * width + x],
+                        outputFormat,
+                        output,
+                        outputStride,
+                        outputColumn,
+                        outputRow);
+                }
+            }
+        }
+
+#if IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE
+        const double elapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+        const int32_t outputRowBytes =
+            outputWidth * (ImageKernelOutputFormat::Gray8 == outputFormat ? 1 : 4);
+
+        std::vector<uint8_t> reference(
+            outputHeight * outputRowBytes);
+
+        timer.Reset();
+
+        TransformGray8ImageReference(
+            input,
+            inputWidth,
+            inputHeight,
+            inputStride,
+            downsampleFactor,
+            orientation,
+            outputFormat,
+            reference.data(),
+            outputRowBytes);
+
+        const double referenceElapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+        int32_t numberOfMismatchedBytes = 0;
+
+        for (int32_t y = 0; y < outputHeight; ++y)
+        {
+            for (int32_t x = 0; x < outputRowBytes; ++x)
+            {
+                if (output[y * outputStride + x] != reference[y * outputRowBytes + x])
+                {
+                    ++numberOfMismatchedBytes;
+                }
+            }
+        }
+
+        dbg::trace(
+            L"Io::TransformGray8Image: %ix%i -> %ix%i in %.03fms, reference %.03fms, %i mismatched bytes",
+            inputWidth,
+            inputHeight,
+            outputWidth,
+            outputHeight,
+            elapsedTimeInMilliseconds,
+            referenceElapsedTimeInMilliseconds,
+            numberOfMismatchedBytes);
+#endif /* IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE */
+    }
+
+    void TransformGray8ImageReference(
+        _In_ const uint8_t* input,
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t inputStride,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _In_ const ImageKernelOutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride)
+    {
+        int32_t outputWidth, outputHeight;
+
+        GetTransformedGray8ImageSize(
+            inputWidth,
+            inputHeight,
+            downsampleFactor,
+            orientation,
+            outputWidth,
+            outputHeight);
+
+        const int32_t width = inputWidth / downsampleFactor;
+        const int32_t height = inputHeight / downsampleFactor;
+
+        for (int32_t y = 0; y < height; ++y)
+        {
+            for (int32_t x = 0; x < width; ++x)
+            {
+                uint32_t sum = 0;
+
+                for (int32_t dy = 0; dy < downsampleFactor; ++dy)
+                {
+                    for (int32_t dx = 0; dx < downsampleFactor; ++dx)
+                    {
+                        sum += input[(y * downsampleFactor + dy) * inputStride + x * downsampleFactor + dx];
+                    }
+                }
+
+                const uint8_t value =
+                    static_cast<uint8_t>(sum / (downsampleFactor * downsampleFactor));
+
+                switch (orientation)
+                {
+                case ImageOrientation::Identity:
+                    WritePixel(value, outputFormat, output, outputStride, x, y);
+                    break;
+
+                case ImageOrientation::Transpose:
+                    WritePixel(value, outputFormat, output, outputStride, y, x);
+                    break;
+
+                case ImageOrientation::Rotate90Clockwise:
+                    WritePixel(value, outputFormat, output, outputStride, height - 1 - y, x);
+                    break;
+
+                case ImageOrientation::Rotate90CounterClockwise:
+                    WritePixel(value, outputFormat, output, outputStride, y, width - 1 - x);
+                    break;
+                }
+            }
+        }
+    }
+}
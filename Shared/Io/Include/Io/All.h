@@ -18,4 +18,9 @@
 #include <Io/Tar.h>
 #include <Io/BufferHelpers.h>
 #include <Io/StringHelpers.h>
-#include <Io/IoHelpers.h>
\ No newline at end of file
+#include <Io/IoHelpers.h>
+#include <Io/ImageKernels.h>
+#include <Io/PixelBuffer.h>
+#include <Io/SensorFrameData.h>
+#include <Io/TaskExecutor.h>
+#include <Io/Nv12Kernels.h>
\ No newline at end of file
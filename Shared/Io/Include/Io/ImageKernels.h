@@ -0,0 +1,88 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, every call to TransformGray8Image is also run through the scalar
+// reference implementation; the timings of both and any mismatching pixels are traced.
+//
+#define IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE 0
+
+namespace Io
+{
+    enum class ImageOrientation
+    {
+        Identity,
+        Transpose,
+        Rotate90Clockwise,
+        Rotate90CounterClockwise
+    };
+
+    enum class ImageKernelOutputFormat
+    {
+        Gray8,
+
+        //
+        // Opaque gray, i.e. B = G = R = value and A = 255.
+        //
+        Bgra8
+    };
+
+    //
+    // Size of the image produced by TransformGray8Image. Rows and columns that do not
+    // fill a whole downsampling block are dropped.
+    //
+    void GetTransformedGray8ImageSize(
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _Out_ int32_t& outputWidth,
+        _Out_ int32_t& outputHeight);
+
+    //
+    // Downsamples a packed 8-bit gray image by 1, 2 or 4 with a box filter (rounding
+    // down), reorients it and optionally expands it to BGRA, in a single pass over the
+    // input. Strides are in bytes and may include padding. Used for the visible light
+    // cameras, whose frames are delivered as packed Gray8 pixels in a Bgra8 bitmap a
+    // quarter of the actual width.
+    //
+    // Bands of 16 downsampled rows are produced with SSE2 or NEON and transposed in
+    // 16x16 tiles, so that both the reads and the writes of the transpose stay within
+    // a few cache lines.
+    //
+    void TransformGray8Image(
+        _In_ const uint8_t* input,
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t inputStride,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _In_ const ImageKernelOutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride);
+
+    //
+    // Straightforward per-pixel implementation of TransformGray8Image, which the
+    // vectorized version matches bit for bit.
+    //
+    void TransformGray8ImageReference(
+        _In_ const uint8_t* input,
+        _In_ const int32_t inputWidth,
+        _In_ const int32_t inputHeight,
+        _In_ const int32_t inputStride,
+        _In_ const int32_t downsampleFactor,
+        _In_ const ImageOrientation orientation,
+        _In_ const ImageKernelOutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride);
+}
@@ -0,0 +1,96 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace Io
+{
+    //
+    // NV12 images consist of a full resolution luma plane, which doubles as a Gray8
+    // image, followed by a half resolution plane of interleaved U and V samples. Both
+    // planes have the same row stride; width and height are even.
+    //
+    enum class Nv12OutputFormat
+    {
+        Bgr8,
+
+        // Byte order of binary PPM files
+        Rgb8,
+
+        // Opaque, i.e. A = 255
+        Bgra8
+    };
+
+    //
+    // Returns a view of the luma plane of an NV12 view, sharing its buffer.
+    //
+    PixelView GetNv12LumaView(
+        _In_ const PixelView& nv12View);
+
+    //
+    // Converts an NV12 image to packed color pixels using fixed point BT.601 (limited
+    // range) coefficients, the color space the PV camera delivers. 16 pixels are
+    // converted at a time with SSE2 or NEON.
+    //
+    void ConvertNv12Image(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _In_ const Nv12OutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride);
+
+    //
+    // Straightforward per-pixel implementation of ConvertNv12Image, which the
+    // vectorized version matches bit for bit.
+    //
+    void ConvertNv12ImageReference(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _In_ const Nv12OutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride);
+
+    //
+    // Halves the resolution of an NV12 image, averaging 2x2 blocks of luma and of
+    // chroma samples (rounding to nearest). Width and height must be multiples of 4.
+    //
+    void DownsampleNv12Image(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _Out_ uint8_t* outputLuma,
+        _In_ const int32_t outputLumaStride,
+        _Out_ uint8_t* outputChroma,
+        _In_ const int32_t outputChromaStride);
+
+    void DownsampleNv12ImageReference(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _Out_ uint8_t* outputLuma,
+        _In_ const int32_t outputLumaStride,
+        _Out_ uint8_t* outputChroma,
+        _In_ const int32_t outputChromaStride);
+}
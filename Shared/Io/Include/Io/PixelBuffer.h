@@ -0,0 +1,156 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace Io
+{
+    enum class PixelFormat
+    {
+        Gray8,
+        Gray16,
+        Bgra8,
+
+        // Luma plane followed by the interleaved U/V plane, see Nv12Kernels.h
+        Nv12
+    };
+
+    //
+    // For NV12, the bytes per pixel of the luma plane.
+    //
+    int32_t GetBytesPerPixel(
+        _In_ const PixelFormat format);
+
+    //
+    // A block of pixel memory, aligned for SIMD loads. Buffers are handed out by a
+    // PixelBufferPool as std::shared_ptr: copying the pointer adds a reference, and the
+    // buffer returns to its pool (or is freed, if the pool is gone) when the last
+    // reference is released.
+    //
+    class PixelBuffer
+    {
+    public:
+        PixelBuffer(
+            _In_ const size_t capacity);
+
+        uint8_t* GetData() const
+        {
+            return _data;
+        }
+
+        size_t GetCapacity() const
+        {
+            return _capacity;
+        }
+
+    private:
+        std::unique_ptr<uint8_t[]> _memory;
+        uint8_t* _data;
+        size_t _capacity;
+    };
+
+    //
+    // A strided image in a pixel buffer. The view holds a reference to the buffer, so
+    // views can be passed around and stored without copying pixels. NV12 views span
+    // both planes: the chroma plane starts at GetRow(height), with the same stride.
+    //
+    struct PixelView
+    {
+        PixelView()
+            : data(nullptr)
+            , width(0)
+            , height(0)
+            , stride(0)
+            , format(PixelFormat::Gray8)
+        {
+        }
+
+        bool IsEmpty() const
+        {
+            return nullptr == data;
+        }
+
+        uint8_t* GetRow(
+            _In_ const int32_t y) const
+        {
+            return data + static_cast<ptrdiff_t>(y) * stride;
+        }
+
+        std::shared_ptr<PixelBuffer> buffer;
+
+        uint8_t* data;
+        int32_t width;
+        int32_t height;
+
+        // In bytes
+        int32_t stride;
+
+        PixelFormat format;
+    };
+
+    struct PixelBufferPoolStatistics
+    {
+        uint64_t numberOfAllocations;
+        uint64_t numberOfReuses;
+
+        // Buffers handed out and not yet released
+        uint64_t numberOfBuffersInUse;
+
+        uint64_t numberOfBytesAllocated;
+    };
+
+    //
+    // Recycles pixel buffers, so that streaming frames of a steady resolution stops
+    // allocating after the first few frames. Requests are rounded up to size classes
+    // of 64KB, so buffers for slightly different sizes (e.g. padded rows) are shared;
+    // at most maximumNumberOfFreeBuffers are kept per size class, the rest is freed.
+    //
+    // Thread-safe. Always created through Create, since released buffers find their way
+    // back through a weak reference to the pool.
+    //
+    class PixelBufferPool
+        : public std::enable_shared_from_this<PixelBufferPool>
+    {
+    public:
+        static std::shared_ptr<PixelBufferPool> Create(
+            _In_ const size_t maximumNumberOfFreeBuffers = 4);
+
+        std::shared_ptr<PixelBuffer> Acquire(
+            _In_ const size_t size);
+
+        //
+        // Acquires a buffer for, and fills out, a view of the given size with rows
+        // padded to 16 bytes.
+        //
+        void AllocateView(
+            _In_ const int32_t width,
+            _In_ const int32_t height,
+            _In_ const PixelFormat format,
+            _Out_ PixelView& view);
+
+        PixelBufferPoolStatistics GetStatistics() const;
+
+    private:
+        PixelBufferPool(
+            _In_ const size_t maximumNumberOfFreeBuffers);
+
+        static void Recycle(
+            _In_ const std::weak_ptr<PixelBufferPool>& pool,
+            _In_ PixelBuffer* buffer);
+
+        const size_t _maximumNumberOfFreeBuffers;
+
+        mutable std::mutex _mutex;
+        std::map<size_t, std::vector<std::unique_ptr<PixelBuffer>>> _freeBuffers;
+
+        PixelBufferPoolStatistics _statistics;
+    };
+}
@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace Io
+{
+    //
+    // Row-major 4x4 matrix, laid out like Windows::Foundation::Numerics::float4x4
+    // (m11, m12, ..., m44).
+    //
+    typedef std::array<float, 16> Float4x4;
+
+    //
+    // Platform-neutral counterpart of HoloLensForCV::SensorFrame: plain values plus a
+    // pixel view into a pooled buffer, so that frame processing, recording and streaming
+    // logic does not depend on SoftwareBitmap. Copies share the pixels.
+    //
+    // See HoloLensForCV::SensorFrame::ToSensorFrameData and FromSensorFrameData for
+    // the conversion from and to the WinRT type. The recorder sink encodes frames in
+    // this form, and the MultiFrameBuffer keeps them in it.
+    //
+    struct SensorFrameData
+    {
+        SensorFrameData()
+            : frameType(-1)
+            , timestamp(0)
+            , frameToOrigin()
+            , cameraViewTransform()
+            , cameraProjectionTransform()
+        {
+        }
+
+        // HoloLensForCV::SensorType
+        int32_t frameType;
+
+        // Universal time, in hundreds of nanoseconds since January 1st, 1601
+        int64_t timestamp;
+
+        Float4x4 frameToOrigin;
+        Float4x4 cameraViewTransform;
+        Float4x4 cameraProjectionTransform;
+
+        //
+        // Opaque handle to the camera intrinsics of the sensor, shared between frames.
+        // On device this holds a HoloLensForCV::CameraIntrinsics reference.
+        //
+        std::shared_ptr<void> cameraIntrinsics;
+
+        PixelView pixels;
+    };
+}
@@ -0,0 +1,193 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Io
+{
+    //
+    // Lanes, in order of priority: idle workers always pick up capture work first,
+    // then compute work, then I/O.
+    //
+    enum class TaskLane : int32_t
+    {
+        Capture = 0,
+        Compute,
+        Io,
+
+        NumberOfTaskLanes
+    };
+
+    struct TaskLaneStatistics
+    {
+        uint64_t numberOfTasksSubmitted;
+        uint64_t numberOfTasksExecuted;
+
+        // Latest-wins tasks superseded by a newer task for the same key before they ran
+        uint64_t numberOfTasksReplaced;
+
+        // Tasks executed by a worker other than the one they were queued on
+        uint64_t numberOfTasksStolen;
+
+        uint64_t queueDepth;
+        uint64_t maximumQueueDepth;
+
+        // Time from submission to the start of execution
+        uint64_t totalQueueLatencyInMicroseconds;
+        uint64_t maximumQueueLatencyInMicroseconds;
+    };
+
+    //
+    // Runs per-frame work on a fixed set of worker threads. Every worker owns a queue
+    // per lane: tasks submitted from a worker go to its own queue, where it picks up
+    // the newest one first while it is still warm in the cache, and tasks submitted
+    // from other threads are spread across the workers round robin. Workers that run
+    // out of work steal the oldest task from the others, so one busy queue never holds
+    // back the rest.
+    //
+    // SubmitLatest is meant for work where only the newest input matters, such as
+    // tracking on the latest camera frame: tasks for the same key run one at a time,
+    // and a task submitted while another one is still waiting replaces it rather than
+    // queueing behind it or being dropped.
+    //
+    // Tasks must not throw. The destructor waits for all submitted tasks to finish.
+    //
+    class TaskExecutor
+    {
+    public:
+        //
+        // Zero workers stands for one per hardware thread.
+        //
+        TaskExecutor(
+            _In_ const size_t numberOfWorkers = 0);
+
+        ~TaskExecutor();
+
+        void Submit(
+            _In_ const TaskLane lane,
+            _In_ std::function<void()> task);
+
+        void SubmitLatest(
+            _In_ const TaskLane lane,
+            _In_ const uint64_t key,
+            _In_ std::function<void()> task);
+
+        //
+        // Blocks until every submitted task, including those submitted by tasks in the
+        // meantime, has finished. Must not be called from a task.
+        //
+        void WaitForIdle();
+
+        size_t GetNumberOfWorkers() const;
+
+        TaskLaneStatistics GetStatistics(
+            _In_ const TaskLane lane) const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Task
+        {
+            std::function<void()> function;
+            Clock::time_point submissionTime;
+        };
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::array<std::deque<Task>, static_cast<size_t>(TaskLane::NumberOfTaskLanes)> queues;
+            std::thread thread;
+        };
+
+        struct LatestTask
+        {
+            LatestTask()
+                : scheduled(false)
+                , running(false)
+                , lane(TaskLane::Compute)
+            {
+            }
+
+            std::function<void()> pendingFunction;
+
+            // A runner for this key is queued
+            bool scheduled;
+
+            // The runner is executing a function for this key
+            bool running;
+
+            TaskLane lane;
+        };
+
+        struct LaneCounters
+        {
+            std::atomic<uint64_t> numberOfTasksSubmitted;
+            std::atomic<uint64_t> numberOfTasksExecuted;
+            std::atomic<uint64_t> numberOfTasksReplaced;
+            std::atomic<uint64_t> numberOfTasksStolen;
+            std::atomic<uint64_t> queueDepth;
+            std::atomic<uint64_t> maximumQueueDepth;
+            std::atomic<uint64_t> totalQueueLatencyInMicroseconds;
+            std::atomic<uint64_t> maximumQueueLatencyInMicroseconds;
+        };
+
+        void Enqueue(
+            _In_ const TaskLane lane,
+            _In_ std::function<void()> function);
+
+        bool TryDequeue(
+            _In_ const size_t workerIndex,
+            _Out_ Task& task,
+            _Out_ TaskLane& lane);
+
+        void RunLatest(
+            _In_ const uint64_t key);
+
+        void WorkerLoop(
+            _In_ const size_t workerIndex);
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::atomic<size_t> _nextWorkerIndex;
+
+        //
+        // Workers sleep on _wakeCondition while no task is queued anywhere.
+        //
+        std::mutex _wakeMutex;
+        std::condition_variable _wakeCondition;
+        std::atomic<size_t> _numberOfQueuedTasks;
+        std::atomic<size_t> _numberOfSleepingWorkers;
+        bool _stopping;
+
+        //
+        // Queued or running tasks, for WaitForIdle.
+        //
+        std::mutex _idleMutex;
+        std::condition_variable _idleCondition;
+        std::atomic<size_t> _numberOfUnfinishedTasks;
+
+        std::mutex _latestTasksMutex;
+        std::map<uint64_t, LatestTask> _latestTasks;
+
+        std::array<LaneCounters, static_cast<size_t>(TaskLane::NumberOfTaskLanes)> _laneCounters;
+    };
+}
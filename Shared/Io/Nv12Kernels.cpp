@@ -0,0 +1,664 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define IO_NV12_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define IO_NV12_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Io
+{
+    namespace
+    {
+        //
+        // BT.601 limited range coefficients scaled by 64, small enough for 16-bit lanes:
+        //
+        //   R = (75 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+        //   G = (75 * (Y - 16) - 25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+        //   B = (75 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+        //
+        // Only B can exceed the 16-bit range, and only when the result saturates to 255
+        // anyway, so saturating vector additions match the 32-bit scalar arithmetic.
+        //
+        const int32_t c_lumaScale = 75;
+        const int32_t c_redFromV = 102;
+        const int32_t c_greenFromU = 25;
+        const int32_t c_greenFromV = 52;
+        const int32_t c_blueFromU = 129;
+
+        uint8_t ClampToByte(
+            _In_ const int32_t value)
+        {
+            return static_cast<uint8_t>(
+                value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+
+        int32_t GetBytesPerOutputPixel(
+            _In_ const Nv12OutputFormat outputFormat)
+        {
+            return Nv12OutputFormat::Bgra8 == outputFormat ? 4 : 3;
+        }
+
+        void WriteColorPixel(
+            _In_ const uint8_t red,
+            _In_ const uint8_t green,
+            _In_ const uint8_t blue,
+            _In_ const Nv12OutputFormat outputFormat,
+            _Out_ uint8_t* pixel)
+        {
+            switch (outputFormat)
+            {
+            case Nv12OutputFormat::Bgr8:
+                pixel[0] = blue;
+                pixel[1] = green;
+                pixel[2] = red;
+                break;
+
+            case Nv12OutputFormat::Rgb8:
+                pixel[0] = red;
+                pixel[1] = green;
+                pixel[2] = blue;
+                break;
+
+            case Nv12OutputFormat::Bgra8:
+                pixel[0] = blue;
+                pixel[1] = green;
+                pixel[2] = red;
+                pixel[3] = 255;
+                break;
+            }
+        }
+
+        void ConvertPixel(
+            _In_ const uint8_t y,
+            _In_ const uint8_t u,
+            _In_ const uint8_t v,
+            _In_ const Nv12OutputFormat outputFormat,
+            _Out_ uint8_t* pixel)
+        {
+            const int32_t luma = c_lumaScale * (y - 16) + 32;
+            const int32_t d = u - 128;
+            const int32_t e = v - 128;
+
+            WriteColorPixel(
+                ClampToByte((luma + c_redFromV * e) >> 6),
+                ClampToByte((luma - c_greenFromU * d - c_greenFromV * e) >> 6),
+                ClampToByte((luma + c_blueFromU * d) >> 6),
+                outputFormat,
+                pixel);
+        }
+
+        //
+        // Converts one row of pixels, starting at an even x coordinate.
+        //
+        void ConvertRow(
+            _In_ const uint8_t* lumaRow,
+            _In_ const uint8_t* chromaRow,
+            _In_ const int32_t width,
+            _In_ const Nv12OutputFormat outputFormat,
+            _Out_ uint8_t* outputRow)
+        {
+            const int32_t bytesPerOutputPixel =
+                GetBytesPerOutputPixel(outputFormat);
+
+            int32_t x = 0;
+
+#if defined(IO_NV12_KERNELS_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+            const __m128i lumaOffset = _mm_set1_epi16(16);
+            const __m128i chromaOffset = _mm_set1_epi16(128);
+            const __m128i rounding = _mm_set1_epi16(32);
+            const __m128i lumaScale = _mm_set1_epi16(c_lumaScale);
+            const __m128i redFromV = _mm_set1_epi16(c_redFromV);
+            const __m128i greenFromU = _mm_set1_epi16(c_greenFromU);
+            const __m128i greenFromV = _mm_set1_epi16(c_greenFromV);
+            const __m128i blueFromU = _mm_set1_epi16(c_blueFromU);
+            const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m128i lumaPixels = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(lumaRow + x));
+
+                //
+                // 8 U/V pairs cover the 16 pixels; split them into 16-bit lanes.
+                //
+                const __m128i chromaPairs = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(chromaRow + x));
+
+                const __m128i d = _mm_sub_epi16(_mm_and_si128(chromaPairs, lowBytes), chromaOffset);
+                const __m128i e = _mm_sub_epi16(_mm_srli_epi16(chromaPairs, 8), chromaOffset);
+
+                const __m128i redChroma = _mm_mullo_epi16(e, redFromV);
+                const __m128i greenChroma = _mm_sub_epi16(
+                    zero,
+                    _mm_add_epi16(_mm_mullo_epi16(d, greenFromU), _mm_mullo_epi16(e, greenFromV)));
+                const __m128i blueChroma = _mm_mullo_epi16(d, blueFromU);
+
+                __m128i channels[3][2];
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    const __m128i y16 = 0 == half
+                        ? _mm_unpacklo_epi8(lumaPixels, zero)
+                        : _mm_unpackhi_epi8(lumaPixels, zero);
+
+                    const __m128i luma = _mm_add_epi16(
+                        _mm_mullo_epi16(_mm_sub_epi16(y16, lumaOffset), lumaScale),
+                        rounding);
+
+                    //
+                    // Every chroma sample covers two horizontally adjacent pixels.
+                    //
+                    const __m128i redChromaPerPixel = 0 == half
+                        ? _mm_unpacklo_epi16(redChroma, redChroma)
+                        : _mm_unpackhi_epi16(redChroma, redChroma);
+                    const __m128i greenChromaPerPixel = 0 == half
+                        ? _mm_unpacklo_epi16(greenChroma, greenChroma)
+                        : _mm_unpackhi_epi16(greenChroma, greenChroma);
+                    const __m128i blueChromaPerPixel = 0 == half
+                        ? _mm_unpacklo_epi16(blueChroma, blueChroma)
+                        : _mm_unpackhi_epi16(blueChroma, blueChroma);
+
+                    channels[0][half] = _mm_srai_epi16(_mm_adds_epi16(luma, blueChromaPerPixel), 6);
+                    channels[1][half] = _mm_srai_epi16(_mm_adds_epi16(luma, greenChromaPerPixel), 6);
+                    channels[2][half] = _mm_srai_epi16(_mm_adds_epi16(luma, redChromaPerPixel), 6);
+                }
+
+                const __m128i blue = _mm_packus_epi16(channels[0][0], channels[0][1]);
+                const __m128i green = _mm_packus_epi16(channels[1][0], channels[1][1]);
+                const __m128i red = _mm_packus_epi16(channels[2][0], channels[2][1]);
+
+                uint8_t* output = outputRow + x * bytesPerOutputPixel;
+
+                if (Nv12OutputFormat::Bgra8 == outputFormat)
+                {
+                    const __m128i blueGreen0 = _mm_unpacklo_epi8(blue, green);
+                    const __m128i blueGreen1 = _mm_unpackhi_epi8(blue, green);
+                    const __m128i redAlpha0 = _mm_unpacklo_epi8(red, opaque);
+                    const __m128i redAlpha1 = _mm_unpackhi_epi8(red, opaque);
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_unpacklo_epi16(blueGreen0, redAlpha0));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16), _mm_unpackhi_epi16(blueGreen0, redAlpha0));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 32), _mm_unpacklo_epi16(blueGreen1, redAlpha1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 48), _mm_unpackhi_epi16(blueGreen1, redAlpha1));
+                }
+                else
+                {
+                    //
+                    // SSE2 has no byte shuffle, so 3-byte pixels are interleaved in scalar code.
+                    //
+                    uint8_t blueBytes[16], greenBytes[16], redBytes[16];
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(blueBytes), blue);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(greenBytes), green);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(redBytes), red);
+
+                    for (int32_t i = 0; i < 16; ++i)
+                    {
+                        WriteColorPixel(
+                            redBytes[i],
+                            greenBytes[i],
+                            blueBytes[i],
+                            outputFormat,
+                            output + 3 * i);
+                    }
+                }
+            }
+#elif defined(IO_NV12_KERNELS_NEON)
+            const int16x8_t lumaOffset = vdupq_n_s16(16);
+            const int16x8_t chromaOffset = vdupq_n_s16(128);
+            const int16x8_t rounding = vdupq_n_s16(32);
+
+            for (; x + 16 <= width; x += 16)
+            {
+                const uint8x16_t lumaPixels = vld1q_u8(lumaRow + x);
+
+                //
+                // Loads the 8 U/V pairs covering the 16 pixels, deinterleaved.
+                //
+                const uint8x8x2_t chromaPairs = vld2_u8(chromaRow + x);
+
+                const int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chromaPairs.val[0])), chromaOffset);
+                const int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(chromaPairs.val[1])), chromaOffset);
+
+                //
+                // Every chroma sample covers two horizontally adjacent pixels.
+                //
+                const int16x8x2_t redChroma = vzipq_s16(
+                    vmulq_n_s16(e, c_redFromV),
+                    vmulq_n_s16(e, c_redFromV));
+
+                const int16x8_t greenChroma8 = vnegq_s16(
+                    vmlaq_n_s16(vmulq_n_s16(d, c_greenFromU), e, c_greenFromV));
+
+                const int16x8x2_t greenChroma = vzipq_s16(
+                    greenChroma8,
+                    greenChroma8);
+
+                const int16x8x2_t blueChroma = vzipq_s16(
+                    vmulq_n_s16(d, c_blueFromU),
+                    vmulq_n_s16(d, c_blueFromU));
+
+                uint8x8_t channels[3][2];
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    const int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(
+                        0 == half ? vget_low_u8(lumaPixels) : vget_high_u8(lumaPixels)));
+
+                    const int16x8_t luma = vaddq_s16(
+                        vmulq_n_s16(vsubq_s16(y16, lumaOffset), c_lumaScale),
+                        rounding);
+
+                    channels[0][half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(luma, blueChroma.val[half]), 6));
+                    channels[1][half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(luma, greenChroma.val[half]), 6));
+                    channels[2][half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(luma, redChroma.val[half]), 6));
+                }
+
+                const uint8x16_t blue = vcombine_u8(channels[0][0], channels[0][1]);
+                const uint8x16_t green = vcombine_u8(channels[1][0], channels[1][1]);
+                const uint8x16_t red = vcombine_u8(channels[2][0], channels[2][1]);
+
+                uint8_t* output = outputRow + x * bytesPerOutputPixel;
+
+                switch (outputFormat)
+                {
+                case Nv12OutputFormat::Bgr8:
+                {
+                    const uint8x16x3_t pixels = { { blue, green, red } };
+                    vst3q_u8(output, pixels);
+                    break;
+                }
+
+                case Nv12OutputFormat::Rgb8:
+                {
+                    const uint8x16x3_t pixels = { { red, green, blue } };
+                    vst3q_u8(output, pixels);
+                    break;
+                }
+
+                case Nv12OutputFormat::Bgra8:
+                {
+                    const uint8x16x4_t pixels = { { blue, green, red, vdupq_n_u8(255) } };
+                    vst4q_u8(output, pixels);
+                    break;
+                }
+                }
+            }
+#endif
+
+            for (; x < width; ++x)
+            {
+                const uint8_t* chromaPair =
+                    chromaRow + (x & ~1);
+
+                ConvertPixel(
+                    lumaRow[x],
+                    chromaPair[0],
+                    chromaPair[1],
+                    outputFormat,
+                    outputRow + x * bytesPerOutputPixel);
+            }
+        }
+
+        //
+        // Averages 2x2 blocks of a luma plane into one output row.
+        //
+        void DownsampleLumaRow(
+            _In_ const uint8_t* input,
+            _In_ const int32_t inputStride,
+            _In_ const int32_t outputWidth,
+            _Out_ uint8_t* output)
+        {
+            int32_t x = 0;
+
+#if defined(IO_NV12_KERNELS_SSE2)
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+            const __m128i rounding = _mm_set1_epi16(2);
+
+            for (; x + 16 <= outputWidth; x += 16)
+            {
+                __m128i averages[2];
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    const __m128i row0 = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(input + 2 * x + 16 * half));
+                    const __m128i row1 = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(input + inputStride + 2 * x + 16 * half));
+
+                    const __m128i sums = _mm_add_epi16(
+                        _mm_add_epi16(_mm_and_si128(row0, lowBytes), _mm_srli_epi16(row0, 8)),
+                        _mm_add_epi16(_mm_and_si128(row1, lowBytes), _mm_srli_epi16(row1, 8)));
+
+                    averages[half] = _mm_srli_epi16(_mm_add_epi16(sums, rounding), 2);
+                }
+
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(output + x),
+                    _mm_packus_epi16(averages[0], averages[1]));
+            }
+#elif defined(IO_NV12_KERNELS_NEON)
+            for (; x + 16 <= outputWidth; x += 16)
+            {
+                uint8x8_t averages[2];
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    averages[half] = vrshrn_n_u16(
+                        vpadalq_u8(
+                            vpaddlq_u8(vld1q_u8(input + 2 * x + 16 * half)),
+                            vld1q_u8(input + inputStride + 2 * x + 16 * half)),
+                        2);
+                }
+
+                vst1q_u8(
+                    output + x,
+                    vcombine_u8(averages[0], averages[1]));
+            }
+#endif
+
+            for (; x < outputWidth; ++x)
+            {
+                const uint32_t sum =
+                    input[2 * x] + input[2 * x + 1] +
+                    input[inputStride + 2 * x] + input[inputStride + 2 * x + 1];
+
+                output[x] = static_cast<uint8_t>((sum + 2) >> 2);
+            }
+        }
+
+        //
+        // Averages 2x2 blocks of U and of V samples of a chroma plane into one output
+        // row of interleaved U/V pairs. Widths are in pairs.
+        //
+        void DownsampleChromaRow(
+            _In_ const uint8_t* input,
+            _In_ const int32_t inputStride,
+            _In_ const int32_t outputWidth,
+            _Out_ uint8_t* output)
+        {
+            int32_t x = 0;
+
+#if defined(IO_NV12_KERNELS_SSE2)
+            const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+            const __m128i ones = _mm_set1_epi16(1);
+            const __m128i rounding = _mm_set1_epi32(2);
+
+            for (; x + 8 <= outputWidth; x += 8)
+            {
+                __m128i uAverages[2], vAverages[2];
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    const __m128i row0 = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(input + 4 * x + 16 * half));
+                    const __m128i row1 = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(input + inputStride + 4 * x + 16 * half));
+
+                    //
+                    // Multiplying by one and adding adjacent lanes sums the two U (or V)
+                    // samples of a block row into a 32-bit lane.
+                    //
+                    const __m128i uSums = _mm_add_epi32(
+                        _mm_madd_epi16(_mm_and_si128(row0, lowBytes), ones),
+                        _mm_madd_epi16(_mm_and_si128(row1, lowBytes), ones));
+                    const __m128i vSums = _mm_add_epi32(
+                        _mm_madd_epi16(_mm_srli_epi16(row0, 8), ones),
+                        _mm_madd_epi16(_mm_srli_epi16(row1, 8), ones));
+
+                    uAverages[half] = _mm_srli_epi32(_mm_add_epi32(uSums, rounding), 2);
+                    vAverages[half] = _mm_srli_epi32(_mm_add_epi32(vSums, rounding), 2);
+                }
+
+                const __m128i u = _mm_packs_epi32(uAverages[0], uAverages[1]);
+                const __m128i v = _mm_packs_epi32(vAverages[0], vAverages[1]);
+
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(output + 2 * x),
+                    _mm_or_si128(u, _mm_slli_epi16(v, 8)));
+            }
+#elif defined(IO_NV12_KERNELS_NEON)
+            for (; x + 8 <= outputWidth; x += 8)
+            {
+                const uint8x16x2_t row0 = vld2q_u8(input + 4 * x);
+                const uint8x16x2_t row1 = vld2q_u8(input + inputStride + 4 * x);
+
+                uint8x8x2_t averages;
+
+                averages.val[0] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(row0.val[0]), row1.val[0]), 2);
+                averages.val[1] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(row0.val[1]), row1.val[1]), 2);
+
+                vst2_u8(
+                    output + 2 * x,
+                    averages);
+            }
+#endif
+
+            for (; x < outputWidth; ++x)
+            {
+                for (int32_t channel = 0; channel < 2; ++channel)
+                {
+                    const uint32_t sum =
+                        input[4 * x + channel] + input[4 * x + 2 + channel] +
+                        input[inputStride + 4 * x + channel] + input[inputStride + 4 * x + 2 + channel];
+
+                    output[2 * x + channel] = static_cast<uint8_t>((sum + 2) >> 2);
+                }
+            }
+        }
+    }
+
+    PixelView GetNv12LumaView(
+        _In_ const PixelView& nv12View)
+    {
+        REQUIRES(PixelFormat::Nv12 == nv12View.format);
+
+        PixelView lumaView = nv12View;
+
+        lumaView.format = PixelFormat::Gray8;
+
+        return lumaView;
+    }
+
+    void ConvertNv12Image(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _In_ const Nv12OutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride)
+    {
+        REQUIRES(0 == width % 2 && 0 == height % 2);
+
+#if IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE
+        dbg::Timer timer;
+#endif /* IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE */
+
+        for (int32_t y = 0; y < height; ++y)
+        {
+            ConvertRow(
+                luma + y * lumaStride,
+                chroma + (y / 2) * chromaStride,
+                width,
+                outputFormat,
+                output + y * outputStride);
+        }
+
+#if IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE
+        const double elapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+        const int32_t outputRowBytes =
+            width * GetBytesPerOutputPixel(outputFormat);
+
+        std::vector<uint8_t> reference(
+            height * outputRowBytes);
+
+        timer.Reset();
+
+        ConvertNv12ImageReference(
+            luma,
+            lumaStride,
+            chroma,
+            chromaStride,
+            width,
+            height,
+            outputFormat,
+            reference.data(),
+            outputRowBytes);
+
+        const double referenceElapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+        int32_t numberOfMismatchedBytes = 0;
+
+        for (int32_t y = 0; y < height; ++y)
+        {
+            for (int32_t x = 0; x < outputRowBytes; ++x)
+            {
+                if (output[y * outputStride + x] != reference[y * outputRowBytes + x])
+                {
+                    ++numberOfMismatchedBytes;
+                }
+            }
+        }
+
+        dbg::trace(
+            L"Io::ConvertNv12Image: %ix%i in %.03fms, reference %.03fms, %i mismatched bytes",
+            width,
+            height,
+            elapsedTimeInMilliseconds,
+            referenceElapsedTimeInMilliseconds,
+            numberOfMismatchedBytes);
+#endif /* IO_IMAGE_KERNELS_VALIDATE_AGAINST_REFERENCE */
+    }
+
+    void ConvertNv12ImageReference(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _In_ const Nv12OutputFormat outputFormat,
+        _Out_ uint8_t* output,
+        _In_ const int32_t outputStride)
+    {
+        const int32_t bytesPerOutputPixel =
+            GetBytesPerOutputPixel(outputFormat);
+
+        for (int32_t y = 0; y < height; ++y)
+        {
+            for (int32_t x = 0; x < width; ++x)
+            {
+                const uint8_t* chromaPair =
+                    chroma + (y / 2) * chromaStride + (x / 2) * 2;
+
+                ConvertPixel(
+                    luma[y * lumaStride + x],
+                    chromaPair[0],
+                    chromaPair[1],
+                    outputFormat,
+                    output + y * outputStride + x * bytesPerOutputPixel);
+            }
+        }
+    }
+
+    void DownsampleNv12Image(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _Out_ uint8_t* outputLuma,
+        _In_ const int32_t outputLumaStride,
+        _Out_ uint8_t* outputChroma,
+        _In_ const int32_t outputChromaStride)
+    {
+        REQUIRES(0 == width % 4 && 0 == height % 4);
+
+        for (int32_t y = 0; y < height / 2; ++y)
+        {
+            DownsampleLumaRow(
+                luma + 2 * y * lumaStride,
+                lumaStride,
+                width / 2,
+                outputLuma + y * outputLumaStride);
+        }
+
+        for (int32_t y = 0; y < height / 4; ++y)
+        {
+            DownsampleChromaRow(
+                chroma + 2 * y * chromaStride,
+                chromaStride,
+                width / 4,
+                outputChroma + y * outputChromaStride);
+        }
+    }
+
+    void DownsampleNv12ImageReference(
+        _In_ const uint8_t* luma,
+        _In_ const int32_t lumaStride,
+        _In_ const uint8_t* chroma,
+        _In_ const int32_t chromaStride,
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _Out_ uint8_t* outputLuma,
+        _In_ const int32_t outputLumaStride,
+        _Out_ uint8_t* outputChroma,
+        _In_ const int32_t outputChromaStride)
+    {
+        for (int32_t y = 0; y < height / 2; ++y)
+        {
+            for (int32_t x = 0; x < width / 2; ++x)
+            {
+                const uint8_t* block =
+                    luma + 2 * y * lumaStride + 2 * x;
+
+                const uint32_t sum =
+                    block[0] + block[1] + block[lumaStride] + block[lumaStride + 1];
+
+                outputLuma[y * outputLumaStride + x] =
+                    static_cast<uint8_t>((sum + 2) >> 2);
+            }
+        }
+
+        for (int32_t y = 0; y < height / 4; ++y)
+        {
+            for (int32_t x = 0; x < width / 2; ++x)
+            {
+                //
+                // Byte x of the output row is channel x % 2 of output pair x / 2.
+                //
+                const uint8_t* block =
+                    chroma + 2 * y * chromaStride + (x / 2) * 4 + x % 2;
+
+                const uint32_t sum =
+                    block[0] + block[2] + block[chromaStride] + block[chromaStride + 2];
+
+                outputChroma[y * outputChromaStride + x] =
+                    static_cast<uint8_t>((sum + 2) >> 2);
+            }
+        }
+    }
+}
@@ -0,0 +1,182 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace Io
+{
+    namespace
+    {
+        const size_t c_sizeClassGranularity = 64 * 1024;
+
+        const size_t c_bufferAlignment = 64;
+
+        const int32_t c_rowAlignment = 16;
+    }
+
+    int32_t GetBytesPerPixel(
+        _In_ const PixelFormat format)
+    {
+        switch (format)
+        {
+        case PixelFormat::Gray8:
+        case PixelFormat::Nv12:
+            return 1;
+
+        case PixelFormat::Gray16:
+            return 2;
+
+        case PixelFormat::Bgra8:
+            return 4;
+
+        default:
+            REQUIRES(false);
+            return 0;
+        }
+    }
+
+    PixelBuffer::PixelBuffer(
+        _In_ const size_t capacity)
+        : _memory(new uint8_t[capacity + c_bufferAlignment - 1])
+        , _capacity(capacity)
+    {
+        const uintptr_t address =
+            reinterpret_cast<uintptr_t>(_memory.get());
+
+        _data =
+            _memory.get() + (c_bufferAlignment - address % c_bufferAlignment) % c_bufferAlignment;
+    }
+
+    PixelBufferPool::PixelBufferPool(
+        _In_ const size_t maximumNumberOfFreeBuffers)
+        : _maximumNumberOfFreeBuffers(maximumNumberOfFreeBuffers)
+        , _statistics()
+    {
+    }
+
+    std::shared_ptr<PixelBufferPool> PixelBufferPool::Create(
+        _In_ const size_t maximumNumberOfFreeBuffers)
+    {
+        return std::shared_ptr<PixelBufferPool>(
+            new PixelBufferPool(
+                maximumNumberOfFreeBuffers));
+    }
+
+    std::shared_ptr<PixelBuffer> PixelBufferPool::Acquire(
+        _In_ const size_t size)
+    {
+        const size_t sizeClass =
+            std::max<size_t>(1, (size + c_sizeClassGranularity - 1) / c_sizeClassGranularity) *
+            c_sizeClassGranularity;
+
+        std::unique_ptr<PixelBuffer> buffer;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto& freeBuffers = _freeBuffers[sizeClass];
+
+            if (!freeBuffers.empty())
+            {
+                buffer = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+
+                ++_statistics.numberOfReuses;
+            }
+            else
+            {
+                ++_statistics.numberOfAllocations;
+                _statistics.numberOfBytesAllocated += sizeClass;
+            }
+
+            ++_statistics.numberOfBuffersInUse;
+        }
+
+        if (nullptr == buffer)
+        {
+            buffer.reset(
+                new PixelBuffer(sizeClass));
+        }
+
+        const std::weak_ptr<PixelBufferPool> pool =
+            shared_from_this();
+
+        return std::shared_ptr<PixelBuffer>(
+            buffer.release(),
+            [pool](PixelBuffer* releasedBuffer)
+        {
+            Recycle(pool, releasedBuffer);
+        });
+    }
+
+    void PixelBufferPool::AllocateView(
+        _In_ const int32_t width,
+        _In_ const int32_t height,
+        _In_ const PixelFormat format,
+        _Out_ PixelView& view)
+    {
+        REQUIRES(width > 0 && height > 0);
+        REQUIRES(PixelFormat::Nv12 != format || (0 == width % 2 && 0 == height % 2));
+
+        const int32_t stride =
+            (width * GetBytesPerPixel(format) + c_rowAlignment - 1) / c_rowAlignment * c_rowAlignment;
+
+        const int32_t numberOfRows =
+            PixelFormat::Nv12 == format
+                ? height + height / 2
+                : height;
+
+        view.buffer = Acquire(
+            static_cast<size_t>(stride) * numberOfRows);
+
+        view.data = view.buffer->GetData();
+        view.width = width;
+        view.height = height;
+        view.stride = stride;
+        view.format = format;
+    }
+
+    PixelBufferPoolStatistics PixelBufferPool::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        return _statistics;
+    }
+
+    void PixelBufferPool::Recycle(
+        _In_ const std::weak_ptr<PixelBufferPool>& pool,
+        _In_ PixelBuffer* buffer)
+    {
+        std::unique_ptr<PixelBuffer> releasedBuffer(
+            buffer);
+
+        const std::shared_ptr<PixelBufferPool> owner =
+            pool.lock();
+
+        if (nullptr == owner)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(owner->_mutex);
+
+        --owner->_statistics.numberOfBuffersInUse;
+
+        auto& freeBuffers =
+            owner->_freeBuffers[releasedBuffer->GetCapacity()];
+
+        if (freeBuffers.size() < owner->_maximumNumberOfFreeBuffers)
+        {
+            freeBuffers.push_back(
+                std::move(releasedBuffer));
+        }
+    }
+}
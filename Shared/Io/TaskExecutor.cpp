@@ -0,0 +1,436 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace Io
+{
+    namespace
+    {
+        //
+        // The executor and worker the current thread belongs to, if any, so that tasks
+        // submitted from a task are queued on the worker that runs it.
+        //
+        thread_local const void* t_currentExecutor = nullptr;
+        thread_local size_t t_currentWorkerIndex = 0;
+
+        void UpdateMaximum(
+            _Inout_ std::atomic<uint64_t>& maximum,
+            _In_ const uint64_t value)
+        {
+            uint64_t currentMaximum =
+                maximum.load();
+
+            while (currentMaximum < value &&
+                !maximum.compare_exchange_weak(currentMaximum, value))
+            {
+            }
+        }
+    }
+
+    TaskExecutor::TaskExecutor(
+        _In_ const size_t numberOfWorkers)
+        : _nextWorkerIndex(0)
+        , _numberOfQueuedTasks(0)
+        , _numberOfSleepingWorkers(0)
+        , _stopping(false)
+        , _numberOfUnfinishedTasks(0)
+    {
+        for (auto& laneCounters : _laneCounters)
+        {
+            laneCounters.numberOfTasksSubmitted = 0;
+            laneCounters.numberOfTasksExecuted = 0;
+            laneCounters.numberOfTasksReplaced = 0;
+            laneCounters.numberOfTasksStolen = 0;
+            laneCounters.queueDepth = 0;
+            laneCounters.maximumQueueDepth = 0;
+            laneCounters.totalQueueLatencyInMicroseconds = 0;
+            laneCounters.maximumQueueLatencyInMicroseconds = 0;
+        }
+
+        const size_t actualNumberOfWorkers =
+            numberOfWorkers > 0
+                ? numberOfWorkers
+                : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+        //
+        // All workers must exist before any of them starts looking for work to steal.
+        //
+        for (size_t i = 0; i < actualNumberOfWorkers; ++i)
+        {
+            _workers.emplace_back(
+                new Worker());
+        }
+
+        for (size_t i = 0; i < actualNumberOfWorkers; ++i)
+        {
+            _workers[i]->thread = std::thread(
+                [this, i]()
+            {
+                WorkerLoop(i);
+            });
+        }
+    }
+
+    TaskExecutor::~TaskExecutor()
+    {
+        WaitForIdle();
+
+        {
+            std::lock_guard<std::mutex> lock(_wakeMutex);
+
+            _stopping = true;
+        }
+
+        _wakeCondition.notify_all();
+
+        for (auto& worker : _workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    void TaskExecutor::Submit(
+        _In_ const TaskLane lane,
+        _In_ std::function<void()> task)
+    {
+        REQUIRES(lane < TaskLane::NumberOfTaskLanes);
+        REQUIRES(!!task);
+
+        Enqueue(
+            lane,
+            std::move(task));
+    }
+
+    void TaskExecutor::SubmitLatest(
+        _In_ const TaskLane lane,
+        _In_ const uint64_t key,
+        _In_ std::function<void()> task)
+    {
+        REQUIRES(lane < TaskLane::NumberOfTaskLanes);
+        REQUIRES(!!task);
+
+        bool schedule = false;
+
+        {
+            std::lock_guard<std::mutex> lock(_latestTasksMutex);
+
+            LatestTask& latestTask =
+                _latestTasks[key];
+
+            if (latestTask.pendingFunction)
+            {
+                ++_laneCounters[static_cast<size_t>(latestTask.lane)].numberOfTasksReplaced;
+            }
+
+            latestTask.pendingFunction = std::move(task);
+            latestTask.lane = lane;
+
+            //
+            // A running task reschedules the runner itself once it is done, so that tasks
+            // for the same key never run concurrently.
+            //
+            if (!latestTask.scheduled && !latestTask.running)
+            {
+                latestTask.scheduled = true;
+                schedule = true;
+            }
+        }
+
+        if (schedule)
+        {
+            Enqueue(
+                lane,
+                [this, key]()
+            {
+                RunLatest(key);
+            });
+        }
+    }
+
+    void TaskExecutor::WaitForIdle()
+    {
+        REQUIRES(t_currentExecutor != this);
+
+        std::unique_lock<std::mutex> lock(_idleMutex);
+
+        _idleCondition.wait(
+            lock,
+            [this]()
+        {
+            return 0 == _numberOfUnfinishedTasks.load();
+        });
+    }
+
+    size_t TaskExecutor::GetNumberOfWorkers() const
+    {
+        return _workers.size();
+    }
+
+    TaskLaneStatistics TaskExecutor::GetStatistics(
+        _In_ const TaskLane lane) const
+    {
+        REQUIRES(lane < TaskLane::NumberOfTaskLanes);
+
+        const LaneCounters& laneCounters =
+            _laneCounters[static_cast<size_t>(lane)];
+
+        TaskLaneStatistics statistics;
+
+        statistics.numberOfTasksSubmitted = laneCounters.numberOfTasksSubmitted;
+        statistics.numberOfTasksExecuted = laneCounters.numberOfTasksExecuted;
+        statistics.numberOfTasksReplaced = laneCounters.numberOfTasksReplaced;
+        statistics.numberOfTasksStolen = laneCounters.numberOfTasksStolen;
+        statistics.queueDepth = laneCounters.queueDepth;
+        statistics.maximumQueueDepth = laneCounters.maximumQueueDepth;
+        statistics.totalQueueLatencyInMicroseconds = laneCounters.totalQueueLatencyInMicroseconds;
+        statistics.maximumQueueLatencyInMicroseconds = laneCounters.maximumQueueLatencyInMicroseconds;
+
+        return statistics;
+    }
+
+    void TaskExecutor::Enqueue(
+        _In_ const TaskLane lane,
+        _In_ std::function<void()> function)
+    {
+        const size_t workerIndex =
+            t_currentExecutor == this
+                ? t_currentWorkerIndex
+                : _nextWorkerIndex++ % _workers.size();
+
+        LaneCounters& laneCounters =
+            _laneCounters[static_cast<size_t>(lane)];
+
+        ++laneCounters.numberOfTasksSubmitted;
+
+        UpdateMaximum(
+            laneCounters.maximumQueueDepth,
+            ++laneCounters.queueDepth);
+
+        ++_numberOfUnfinishedTasks;
+
+        //
+        // Counted before the task becomes visible, so that a thief taking it right away
+        // never drives the count below zero.
+        //
+        ++_numberOfQueuedTasks;
+
+        {
+            Worker& worker =
+                *_workers[workerIndex];
+
+            std::lock_guard<std::mutex> lock(worker.mutex);
+
+            Task task;
+
+            task.function = std::move(function);
+            task.submissionTime = Clock::now();
+
+            worker.queues[static_cast<size_t>(lane)].push_back(
+                std::move(task));
+        }
+
+        //
+        // Workers register as sleeping before they check for queued tasks, so either the
+        // worker sees this task or this thread sees the worker. Taking the lock makes sure
+        // the worker is waiting by the time it is notified.
+        //
+        if (_numberOfSleepingWorkers.load() > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+            }
+
+            _wakeCondition.notify_one();
+        }
+    }
+
+    bool TaskExecutor::TryDequeue(
+        _In_ const size_t workerIndex,
+        _Out_ Task& task,
+        _Out_ TaskLane& lane)
+    {
+        const size_t numberOfWorkers =
+            _workers.size();
+
+        for (size_t laneIndex = 0; laneIndex < static_cast<size_t>(TaskLane::NumberOfTaskLanes); ++laneIndex)
+        {
+            for (size_t i = 0; i < numberOfWorkers; ++i)
+            {
+                const size_t victimIndex =
+                    (workerIndex + i) % numberOfWorkers;
+
+                Worker& victim =
+                    *_workers[victimIndex];
+
+                std::lock_guard<std::mutex> lock(victim.mutex);
+
+                std::deque<Task>& queue =
+                    victim.queues[laneIndex];
+
+                if (queue.empty())
+                {
+                    continue;
+                }
+
+                //
+                // The owner takes its newest task, thieves take the oldest.
+                //
+                if (victimIndex == workerIndex)
+                {
+                    task = std::move(queue.back());
+                    queue.pop_back();
+                }
+                else
+                {
+                    task = std::move(queue.front());
+                    queue.pop_front();
+
+                    ++_laneCounters[laneIndex].numberOfTasksStolen;
+                }
+
+                --_numberOfQueuedTasks;
+                --_laneCounters[laneIndex].queueDepth;
+
+                lane = static_cast<TaskLane>(laneIndex);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void TaskExecutor::RunLatest(
+        _In_ const uint64_t key)
+    {
+        std::function<void()> function;
+
+        {
+            std::lock_guard<std::mutex> lock(_latestTasksMutex);
+
+            LatestTask& latestTask =
+                _latestTasks[key];
+
+            latestTask.scheduled = false;
+            latestTask.running = true;
+
+            function = std::move(latestTask.pendingFunction);
+            latestTask.pendingFunction = nullptr;
+        }
+
+        function();
+
+        bool schedule = false;
+        TaskLane lane;
+
+        {
+            std::lock_guard<std::mutex> lock(_latestTasksMutex);
+
+            auto latestTaskIterator =
+                _latestTasks.find(key);
+
+            LatestTask& latestTask =
+                latestTaskIterator->second;
+
+            latestTask.running = false;
+
+            if (latestTask.pendingFunction)
+            {
+                latestTask.scheduled = true;
+
+                schedule = true;
+                lane = latestTask.lane;
+            }
+            else
+            {
+                _latestTasks.erase(
+                    latestTaskIterator);
+            }
+        }
+
+        if (schedule)
+        {
+            Enqueue(
+                lane,
+                [this, key]()
+            {
+                RunLatest(key);
+            });
+        }
+    }
+
+    void TaskExecutor::WorkerLoop(
+        _In_ const size_t workerIndex)
+    {
+        t_currentExecutor = this;
+        t_currentWorkerIndex = workerIndex;
+
+        while (true)
+        {
+            Task task;
+            TaskLane lane;
+
+            if (!TryDequeue(workerIndex, task, lane))
+            {
+                std::unique_lock<std::mutex> lock(_wakeMutex);
+
+                ++_numberOfSleepingWorkers;
+
+                _wakeCondition.wait(
+                    lock,
+                    [this]()
+                {
+                    return _stopping || _numberOfQueuedTasks.load() > 0;
+                });
+
+                --_numberOfSleepingWorkers;
+
+                if (_stopping && 0 == _numberOfQueuedTasks.load())
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            LaneCounters& laneCounters =
+                _laneCounters[static_cast<size_t>(lane)];
+
+            const uint64_t queueLatencyInMicroseconds =
+                static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - task.submissionTime).count());
+
+            laneCounters.totalQueueLatencyInMicroseconds += queueLatencyInMicroseconds;
+
+            UpdateMaximum(
+                laneCounters.maximumQueueLatencyInMicroseconds,
+                queueLatencyInMicroseconds);
+
+            task.function();
+            task.function = nullptr;
+
+            ++laneCounters.numberOfTasksExecuted;
+
+            if (0 == --_numberOfUnfinishedTasks)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_idleMutex);
+                }
+
+                _idleCondition.notify_all();
+            }
+        }
+
+        t_currentExecutor = nullptr;
+    }
+}
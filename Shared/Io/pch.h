@@ -11,10 +11,16 @@
 
 #pragma once
 
+#include <map>
+#include <array>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #include <cstddef>
+#include <cstring>
 #include <cstdlib>
 #include <cstdio>
 
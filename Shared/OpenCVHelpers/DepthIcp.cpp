@@ -0,0 +1,779 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const float c_radiansToDegrees = 57.2957795f;
+
+        cv::Matx44f InvertRigidTransform(
+            _In_ const cv::Matx44f& transform)
+        {
+            const cv::Matx33f rotationTransposed =
+                transform.get_minor<3, 3>(0, 0).t();
+
+            const cv::Vec3f translation =
+                -(rotationTransposed * cv::Vec3f(transform(0, 3), transform(1, 3), transform(2, 3)));
+
+            return cv::Matx44f(
+                rotationTransposed(0, 0), rotationTransposed(0, 1), rotationTransposed(0, 2), translation[0],
+                rotationTransposed(1, 0), rotationTransposed(1, 1), rotationTransposed(1, 2), translation[1],
+                rotationTransposed(2, 0), rotationTransposed(2, 1), rotationTransposed(2, 2), translation[2],
+                0.0f, 0.0f, 0.0f, 1.0f);
+        }
+
+        cv::Matx44f TwistToTransform(
+            _In_ const cv::Vec6d& twist)
+        {
+            cv::Matx33d rotation;
+
+            cv::Rodrigues(
+                cv::Vec3d(twist[0], twist[1], twist[2]),
+                rotation);
+
+            return cv::Matx44f(
+                static_cast<float>(rotation(0, 0)), static_cast<float>(rotation(0, 1)), static_cast<float>(rotation(0, 2)), static_cast<float>(twist[3]),
+                static_cast<float>(rotation(1, 0)), static_cast<float>(rotation(1, 1)), static_cast<float>(rotation(1, 2)), static_cast<float>(twist[4]),
+                static_cast<float>(rotation(2, 0)), static_cast<float>(rotation(2, 1)), static_cast<float>(rotation(2, 2)), static_cast<float>(twist[5]),
+                0.0f, 0.0f, 0.0f, 1.0f);
+        }
+
+        void GetMotionMagnitude(
+            _In_ const cv::Matx44f& transform,
+            _Out_ float& translationInMeters,
+            _Out_ float& rotationInDegrees)
+        {
+            translationInMeters =
+                std::sqrt(
+                    transform(0, 3) * transform(0, 3) +
+                    transform(1, 3) * transform(1, 3) +
+                    transform(2, 3) * transform(2, 3));
+
+            const float cosine =
+                0.5f * (transform(0, 0) + transform(1, 1) + transform(2, 2) - 1.0f);
+
+            rotationInDegrees =
+                std::acos(std::min(1.0f, std::max(-1.0f, cosine))) * c_radiansToDegrees;
+        }
+
+        //
+        // Computes sum(a[i] * b[i] * weights[i]). The accumulation of the normal equations
+        // spends nearly all of its time here, so the loop is written with the OpenCV
+        // universal intrinsics, which map to SSE on the HoloLens and NEON on ARM.
+        //
+        float WeightedDotProduct(
+            _In_reads_(count) const float* a,
+            _In_reads_(count) const float* b,
+            _In_reads_(count) const float* weights,
+            _In_ const int32_t count)
+        {
+            int32_t i = 0;
+            float sum = 0.0f;
+
+#if CV_SIMD128
+            cv::v_float32x4 sum4 = cv::v_setzero_f32();
+
+            for (; i + 4 <= count; i += 4)
+            {
+                sum4 += cv::v_load(a + i) * cv::v_load(b + i) * cv::v_load(weights + i);
+            }
+
+            sum = cv::v_reduce_sum(sum4);
+#endif /* CV_SIMD128 */
+
+            for (; i < count; ++i)
+            {
+                sum += a[i] * b[i] * weights[i];
+            }
+
+            return sum;
+        }
+    }
+
+    DepthIcpSettings::DepthIcpSettings()
+        : MinimumDepthInMeters(0.2f)
+        , MaximumDepthInMeters(4.0f)
+        , MaximumRelativeDepthJump(0.05f)
+        , IterationsPerPyramidLevel({ 10, 5, 4 })
+        , MaximumCorrespondenceDistanceInMeters(0.1f)
+        , MinimumNormalDotProduct(0.8f)
+        , HuberThresholdInMeters(0.01f)
+        , MinimumNumberOfCorrespondences(1000)
+        , KeyFrameTranslationInMeters(0.15f)
+        , KeyFrameRotationInDegrees(10.0f)
+    {
+    }
+
+    DepthIcp::NormalEquations::NormalEquations()
+        : SquaredResidualSum(0.0)
+        , NumberOfCorrespondences(0)
+        , NumberOfSamples(0)
+    {
+        std::fill(std::begin(Hessian), std::end(Hessian), 0.0);
+        std::fill(std::begin(Gradient), std::end(Gradient), 0.0);
+    }
+
+    void DepthIcp::NormalEquations::Add(
+        _In_ const NormalEquations& other)
+    {
+        for (int32_t i = 0; i < 21; ++i)
+        {
+            Hessian[i] += other.Hessian[i];
+        }
+
+        for (int32_t i = 0; i < 6; ++i)
+        {
+            Gradient[i] += other.Gradient[i];
+        }
+
+        SquaredResidualSum += other.SquaredResidualSum;
+        NumberOfCorrespondences += other.NumberOfCorrespondences;
+        NumberOfSamples += other.NumberOfSamples;
+    }
+
+    //
+    // Accumulates stripes of the current frame in parallel; every stripe sums into its
+    // own NormalEquations and merges them into the shared result once done.
+    //
+    class DepthIcp::NormalEquationsBody
+        : public cv::ParallelLoopBody
+    {
+    public:
+        NormalEquationsBody(
+            _In_ const DepthIcp& icp,
+            _In_ const size_t levelIndex,
+            _In_ const cv::Matx44f& currentToKeyFrame,
+            _Inout_ NormalEquations& equations)
+            : _icp(icp)
+            , _levelIndex(levelIndex)
+            , _currentToKeyFrame(currentToKeyFrame)
+            , _equations(equations)
+        {
+        }
+
+        virtual void operator()(
+            const cv::Range& rows) const override
+        {
+            NormalEquations stripeEquations;
+
+            _icp.AccumulateRows(
+                _levelIndex,
+                _currentToKeyFrame,
+                rows,
+                stripeEquations);
+
+            std::lock_guard<std::mutex> lock(_equationsMutex);
+
+            _equations.Add(
+                stripeEquations);
+        }
+
+    private:
+        const DepthIcp& _icp;
+        const size_t _levelIndex;
+        const cv::Matx44f _currentToKeyFrame;
+
+        NormalEquations& _equations;
+        mutable std::mutex _equationsMutex;
+    };
+
+    DepthIcp::DepthIcp(
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const DepthIcpSettings& settings)
+        : _settings(settings)
+    {
+        REQUIRES(CV_32FC2 == cameraUnitPlane.type());
+        REQUIRES(!_settings.IterationsPerPyramidLevel.empty());
+
+        _unitPlanePyramid.resize(
+            _settings.IterationsPerPyramidLevel.size());
+
+        _unitPlanePyramid[0].CameraUnitPlane =
+            cameraUnitPlane.clone();
+
+        for (size_t levelIndex = 1; levelIndex < _unitPlanePyramid.size(); ++levelIndex)
+        {
+            SubsampleMap(
+                _unitPlanePyramid[levelIndex - 1].CameraUnitPlane,
+                _unitPlanePyramid[levelIndex].CameraUnitPlane);
+        }
+
+        for (auto& level : _unitPlanePyramid)
+        {
+            BuildPixelLookup(
+                level);
+        }
+
+        Reset();
+    }
+
+    void DepthIcp::Reset()
+    {
+        _statistics = DepthIcpStatistics();
+        _hasKeyFrame = false;
+    }
+
+    const DepthIcpStatistics& DepthIcp::GetStatistics() const
+    {
+        return _statistics;
+    }
+
+    bool DepthIcp::Refine(
+        _In_ const cv::Mat& depthImage,
+        _In_ const cv::Matx44f& predictedCameraToWorld,
+        _Out_ cv::Matx44f& refinedCameraToWorld)
+    {
+        REQUIRES(depthImage.size() == _unitPlanePyramid[0].CameraUnitPlane.size());
+
+        dbg::Timer timer;
+
+        _statistics = DepthIcpStatistics();
+
+        BuildFramePyramid(
+            depthImage,
+            _currentFrame);
+
+        if (!_hasKeyFrame)
+        {
+            //
+            // Nothing to register against yet: the first frame anchors the refined
+            // trajectory to the one reported by the headset.
+            //
+            refinedCameraToWorld = predictedCameraToWorld;
+
+            std::swap(_currentFrame, _keyFrame);
+
+            _hasKeyFrame = true;
+            _keyFramePredictedCameraToWorld = predictedCameraToWorld;
+            _keyFrameRefinedCameraToWorld = predictedCameraToWorld;
+
+            _statistics.KeyFrameUpdated = true;
+            _statistics.ElapsedTimeInMilliseconds = timer.GetMillisecondsFromStart();
+
+            return false;
+        }
+
+        const cv::Matx44f predictedCurrentToKeyFrame =
+            InvertRigidTransform(_keyFramePredictedCameraToWorld) * predictedCameraToWorld;
+
+        cv::Matx44f currentToKeyFrame =
+            predictedCurrentToKeyFrame;
+
+        EvaluateFit(
+            currentToKeyFrame,
+            _statistics.InitialRmsResidualInMeters,
+            _statistics.InitialTruncatedRmsResidualInMeters,
+            _statistics.InitialNumberOfInliers);
+
+        bool converged = true;
+
+        for (size_t levelIndex = _unitPlanePyramid.size(); converged && levelIndex-- > 0;)
+        {
+            //
+            // Every pyramid level has a quarter of the pixels of the one below it.
+            //
+            const int32_t minimumNumberOfCorrespondences =
+                _settings.MinimumNumberOfCorrespondences >> (2 * levelIndex);
+
+            for (int32_t iteration = 0; iteration < _settings.IterationsPerPyramidLevel[levelIndex]; ++iteration)
+            {
+                NormalEquations equations;
+
+                AccumulateNormalEquations(
+                    levelIndex,
+                    currentToKeyFrame,
+                    equations);
+
+                _statistics.NumberOfCorrespondences =
+                    equations.NumberOfCorrespondences;
+
+                if (equations.NumberOfCorrespondences < minimumNumberOfCorrespondences)
+                {
+                    converged = false;
+                    break;
+                }
+
+                cv::Matx66d hessian;
+                cv::Vec6d negativeGradient;
+
+                for (int32_t i = 0, k = 0; i < 6; ++i)
+                {
+                    for (int32_t j = i; j < 6; ++j, ++k)
+                    {
+                        hessian(i, j) = hessian(j, i) = equations.Hessian[k];
+                    }
+
+                    negativeGradient[i] = -equations.Gradient[i];
+                }
+
+                cv::Vec6d twist;
+
+                if (!cv::solve(hessian, negativeGradient, twist, cv::DECOMP_CHOLESKY))
+                {
+                    converged = false;
+                    break;
+                }
+
+                currentToKeyFrame =
+                    TwistToTransform(twist) * currentToKeyFrame;
+
+                if (cv::norm(twist) < 1e-6)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (converged)
+        {
+            EvaluateFit(
+                currentToKeyFrame,
+                _statistics.FinalRmsResidualInMeters,
+                _statistics.FinalTruncatedRmsResidualInMeters,
+                _statistics.FinalNumberOfInliers);
+
+            //
+            // Degenerate geometry (e.g. a single wall) can make ICP slide along the
+            // surface; never accept a pose that fits the key frame worse than the
+            // headset's own estimate. Both poses are scored on the same samples, so a
+            // pose cannot win by pushing its worst correspondences out of the gate.
+            //
+            converged =
+                _statistics.FinalTruncatedRmsResidualInMeters <= _statistics.InitialTruncatedRmsResidualInMeters;
+        }
+
+        if (!converged)
+        {
+            currentToKeyFrame = predictedCurrentToKeyFrame;
+
+            _statistics.FinalRmsResidualInMeters =
+                _statistics.InitialRmsResidualInMeters;
+
+            _statistics.FinalTruncatedRmsResidualInMeters =
+                _statistics.InitialTruncatedRmsResidualInMeters;
+
+            _statistics.FinalNumberOfInliers =
+                _statistics.InitialNumberOfInliers;
+        }
+
+        _statistics.Converged = converged;
+
+        refinedCameraToWorld =
+            _keyFrameRefinedCameraToWorld * currentToKeyFrame;
+
+        GetMotionMagnitude(
+            InvertRigidTransform(predictedCameraToWorld) * refinedCameraToWorld,
+            _statistics.CorrectionTranslationInMeters,
+            _statistics.CorrectionRotationInDegrees);
+
+        float keyFrameTranslationInMeters, keyFrameRotationInDegrees;
+
+        GetMotionMagnitude(
+            currentToKeyFrame,
+            keyFrameTranslationInMeters,
+            keyFrameRotationInDegrees);
+
+        if (!converged ||
+            keyFrameTranslationInMeters > _settings.KeyFrameTranslationInMeters ||
+            keyFrameRotationInDegrees > _settings.KeyFrameRotationInDegrees)
+        {
+            std::swap(_currentFrame, _keyFrame);
+
+            _keyFramePredictedCameraToWorld = predictedCameraToWorld;
+            _keyFrameRefinedCameraToWorld = refinedCameraToWorld;
+
+            _statistics.KeyFrameUpdated = true;
+        }
+
+        _statistics.ElapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+#if DBG_ENABLE_VERBOSE_LOGGING
+        dbg::trace(
+            L"DepthIcp::Refine: %s in %.02fms, %i -> %i inliers, rms residual %.04fm -> %.04fm, truncated %.04fm -> %.04fm, correction %.04fm / %.02fdeg",
+            converged ? L"converged" : L"failed",
+            _statistics.ElapsedTimeInMilliseconds,
+            _statistics.InitialNumberOfInliers,
+            _statistics.FinalNumberOfInliers,
+            _statistics.InitialRmsResidualInMeters,
+            _statistics.FinalRmsResidualInMeters,
+            _statistics.InitialTruncatedRmsResidualInMeters,
+            _statistics.FinalTruncatedRmsResidualInMeters,
+            _statistics.CorrectionTranslationInMeters,
+            _statistics.CorrectionRotationInDegrees);
+#endif /* DBG_ENABLE_VERBOSE_LOGGING */
+
+        return converged;
+    }
+
+    void DepthIcp::BuildPixelLookup(
+        _Inout_ UnitPlaneLevel& level)
+    {
+        const cv::Mat& unitPlane =
+            level.CameraUnitPlane;
+
+        cv::Point2f minimum(
+            std::numeric_limits<float>::max(),
+            std::numeric_limits<float>::max());
+
+        cv::Point2f maximum(
+            -std::numeric_limits<float>::max(),
+            -std::numeric_limits<float>::max());
+
+        for (int32_t y = 0; y < unitPlane.rows; ++y)
+        {
+            const cv::Vec2f* unitPlaneRow =
+                unitPlane.ptr<cv::Vec2f>(y);
+
+            for (int32_t x = 0; x < unitPlane.cols; ++x)
+            {
+                const cv::Vec2f& xy = unitPlaneRow[x];
+
+                if (std::isfinite(xy[0]) && std::isfinite(xy[1]))
+                {
+                    minimum.x = std::min(minimum.x, xy[0]);
+                    minimum.y = std::min(minimum.y, xy[1]);
+                    maximum.x = std::max(maximum.x, xy[0]);
+                    maximum.y = std::max(maximum.y, xy[1]);
+                }
+            }
+        }
+
+        REQUIRES(minimum.x < maximum.x && minimum.y < maximum.y);
+
+        //
+        // Size the grid so that it roughly matches the pixel density of the image.
+        //
+        level.LookupOrigin = minimum;
+        level.LookupCellsPerUnit =
+            std::max(
+                unitPlane.cols / (maximum.x - minimum.x),
+                unitPlane.rows / (maximum.y - minimum.y));
+
+        level.PixelLookup.create(
+            cvCeil((maximum.y - minimum.y) * level.LookupCellsPerUnit) + 1,
+            cvCeil((maximum.x - minimum.x) * level.LookupCellsPerUnit) + 1,
+            CV_32SC1);
+
+        level.PixelLookup.setTo(
+            cv::Scalar::all(-1));
+
+        for (int32_t y = 0; y < unitPlane.rows; ++y)
+        {
+            const cv::Vec2f* unitPlaneRow =
+                unitPlane.ptr<cv::Vec2f>(y);
+
+            for (int32_t x = 0; x < unitPlane.cols; ++x)
+            {
+                const cv::Vec2f& xy = unitPlaneRow[x];
+
+                if (!std::isfinite(xy[0]) || !std::isfinite(xy[1]))
+                {
+                    continue;
+                }
+
+                level.PixelLookup.at<int32_t>(
+                    cvRound((xy[1] - minimum.y) * level.LookupCellsPerUnit),
+                    cvRound((xy[0] - minimum.x) * level.LookupCellsPerUnit)) =
+                        y * unitPlane.cols + x;
+            }
+        }
+
+        //
+        // Lens distortion makes the pixels sparser than the grid towards the image
+        // corners; close the resulting gaps by copying from neighbouring cells.
+        //
+        for (int32_t pass = 0; pass < 3; ++pass)
+        {
+            const cv::Mat previousLookup =
+                level.PixelLookup.clone();
+
+            for (int32_t y = 0; y < previousLookup.rows; ++y)
+            {
+                int32_t* lookupRow =
+                    level.PixelLookup.ptr<int32_t>(y);
+
+                for (int32_t x = 0; x < previousLookup.cols; ++x)
+                {
+                    if (lookupRow[x] >= 0)
+                    {
+                        continue;
+                    }
+
+                    if (x > 0 && previousLookup.at<int32_t>(y, x - 1) >= 0)
+                    {
+                        lookupRow[x] = previousLookup.at<int32_t>(y, x - 1);
+                    }
+                    else if (x + 1 < previousLookup.cols && previousLookup.at<int32_t>(y, x + 1) >= 0)
+                    {
+                        lookupRow[x] = previousLookup.at<int32_t>(y, x + 1);
+                    }
+                    else if (y > 0 && previousLookup.at<int32_t>(y - 1, x) >= 0)
+                    {
+                        lookupRow[x] = previousLookup.at<int32_t>(y - 1, x);
+                    }
+                    else if (y + 1 < previousLookup.rows && previousLookup.at<int32_t>(y + 1, x) >= 0)
+                    {
+                        lookupRow[x] = previousLookup.at<int32_t>(y + 1, x);
+                    }
+                }
+            }
+        }
+    }
+
+    void DepthIcp::BuildFramePyramid(
+        _In_ const cv::Mat& depthImage,
+        _Inout_ FramePyramid& pyramid) const
+    {
+        pyramid.resize(
+            _unitPlanePyramid.size());
+
+        BackprojectDepthImage(
+            depthImage,
+            _unitPlanePyramid[0].CameraUnitPlane,
+            _settings.MinimumDepthInMeters,
+            _settings.MaximumDepthInMeters,
+            pyramid[0].Vertices);
+
+        for (size_t levelIndex = 1; levelIndex < pyramid.size(); ++levelIndex)
+        {
+            SubsampleMap(
+                pyramid[levelIndex - 1].Vertices,
+                pyramid[levelIndex].Vertices);
+        }
+
+        for (size_t levelIndex = 0; levelIndex < pyramid.size(); ++levelIndex)
+        {
+            ComputeVertexNormals(
+                pyramid[levelIndex].Vertices,
+                _settings.MaximumRelativeDepthJump * static_cast<float>(1 << levelIndex),
+                pyramid[levelIndex].Normals);
+        }
+    }
+
+    bool DepthIcp::ProjectToPixel(
+        _In_ const UnitPlaneLevel& level,
+        _In_ const cv::Vec3f& point,
+        _Out_ int32_t& pixelIndex)
+    {
+        pixelIndex = -1;
+
+        if (point[2] >= 0.0f)
+        {
+            return false;
+        }
+
+        const int32_t cellX =
+            cvRound((point[0] / point[2] - level.LookupOrigin.x) * level.LookupCellsPerUnit);
+
+        const int32_t cellY =
+            cvRound((point[1] / point[2] - level.LookupOrigin.y) * level.LookupCellsPerUnit);
+
+        if (cellX < 0 || cellX >= level.PixelLookup.cols ||
+            cellY < 0 || cellY >= level.PixelLookup.rows)
+        {
+            return false;
+        }
+
+        pixelIndex =
+            level.PixelLookup.at<int32_t>(cellY, cellX);
+
+        return pixelIndex >= 0;
+    }
+
+    void DepthIcp::AccumulateRows(
+        _In_ const size_t levelIndex,
+        _In_ const cv::Matx44f& currentToKeyFrame,
+        _In_ const cv::Range& rows,
+        _Inout_ NormalEquations& equations) const
+    {
+        const UnitPlaneLevel& unitPlaneLevel = _unitPlanePyramid[levelIndex];
+        const FrameLevel& currentFrame = _currentFrame[levelIndex];
+        const FrameLevel& keyFrame = _keyFrame[levelIndex];
+
+        const cv::Vec3f* keyFrameVertices = keyFrame.Vertices.ptr<cv::Vec3f>();
+        const cv::Vec3f* keyFrameNormals = keyFrame.Normals.ptr<cv::Vec3f>();
+
+        const cv::Matx33f rotation =
+            currentToKeyFrame.get_minor<3, 3>(0, 0);
+
+        const cv::Vec3f translation(
+            currentToKeyFrame(0, 3),
+            currentToKeyFrame(1, 3),
+            currentToKeyFrame(2, 3));
+
+        const float maximumSquaredDistance =
+            _settings.MaximumCorrespondenceDistanceInMeters *
+            _settings.MaximumCorrespondenceDistanceInMeters;
+
+        //
+        // Correspondences of a row are gathered as a structure of arrays (six Jacobian
+        // rows, residuals and weights) and then reduced with WeightedDotProduct.
+        //
+        const int32_t columns = currentFrame.Vertices.cols;
+
+        std::vector<float> buffer(
+            8 * columns);
+
+        float* jacobian[6];
+
+        for (int32_t i = 0; i < 6; ++i)
+        {
+            jacobian[i] = buffer.data() + i * columns;
+        }
+
+        float* residuals = buffer.data() + 6 * columns;
+        float* weights = buffer.data() + 7 * columns;
+
+        for (int32_t y = rows.start; y < rows.end; ++y)
+        {
+            const cv::Vec3f* vertexRow = currentFrame.Vertices.ptr<cv::Vec3f>(y);
+            const cv::Vec3f* normalRow = currentFrame.Normals.ptr<cv::Vec3f>(y);
+
+            int32_t count = 0;
+
+            for (int32_t x = 0; x < columns; ++x)
+            {
+                if (!IsValidNormal(normalRow[x]))
+                {
+                    continue;
+                }
+
+                ++equations.NumberOfSamples;
+
+                const cv::Vec3f point =
+                    rotation * vertexRow[x] + translation;
+
+                int32_t pixelIndex;
+
+                if (!ProjectToPixel(unitPlaneLevel, point, pixelIndex))
+                {
+                    continue;
+                }
+
+                const cv::Vec3f& keyFrameNormal =
+                    keyFrameNormals[pixelIndex];
+
+                if (!IsValidNormal(keyFrameNormal))
+                {
+                    continue;
+                }
+
+                const cv::Vec3f difference =
+                    point - keyFrameVertices[pixelIndex];
+
+                if (difference.dot(difference) > maximumSquaredDistance ||
+                    (rotation * normalRow[x]).dot(keyFrameNormal) < _settings.MinimumNormalDotProduct)
+                {
+                    continue;
+                }
+
+                const float residual =
+                    keyFrameNormal.dot(difference);
+
+                const cv::Vec3f pointCrossNormal =
+                    point.cross(keyFrameNormal);
+
+                jacobian[0][count] = pointCrossNormal[0];
+                jacobian[1][count] = pointCrossNormal[1];
+                jacobian[2][count] = pointCrossNormal[2];
+                jacobian[3][count] = keyFrameNormal[0];
+                jacobian[4][count] = keyFrameNormal[1];
+                jacobian[5][count] = keyFrameNormal[2];
+
+                residuals[count] = residual;
+
+                weights[count] =
+                    std::abs(residual) <= _settings.HuberThresholdInMeters
+                        ? 1.0f
+                        : _settings.HuberThresholdInMeters / std::abs(residual);
+
+                equations.SquaredResidualSum += residual * residual;
+
+                ++count;
+            }
+
+            for (int32_t i = 0, k = 0; i < 6; ++i)
+            {
+                for (int32_t j = i; j < 6; ++j, ++k)
+                {
+                    equations.Hessian[k] +=
+                        WeightedDotProduct(jacobian[i], jacobian[j], weights, count);
+                }
+
+                equations.Gradient[i] +=
+                    WeightedDotProduct(jacobian[i], residuals, weights, count);
+            }
+
+            equations.NumberOfCorrespondences += count;
+        }
+    }
+
+    void DepthIcp::AccumulateNormalEquations(
+        _In_ const size_t levelIndex,
+        _In_ const cv::Matx44f& currentToKeyFrame,
+        _Out_ NormalEquations& equations) const
+    {
+        equations = NormalEquations();
+
+        NormalEquationsBody body(
+            *this,
+            levelIndex,
+            currentToKeyFrame,
+            equations);
+
+        cv::parallel_for_(
+            cv::Range(0, _currentFrame[levelIndex].Vertices.rows),
+            body);
+    }
+
+    void DepthIcp::EvaluateFit(
+        _In_ const cv::Matx44f& currentToKeyFrame,
+        _Out_ float& rmsResidualInMeters,
+        _Out_ float& truncatedRmsResidualInMeters,
+        _Out_ int32_t& numberOfInliers) const
+    {
+        NormalEquations equations;
+
+        AccumulateNormalEquations(
+            0 /* levelIndex */,
+            currentToKeyFrame,
+            equations);
+
+        numberOfInliers =
+            equations.NumberOfCorrespondences;
+
+        rmsResidualInMeters =
+            0 == equations.NumberOfCorrespondences
+                ? std::numeric_limits<float>::max()
+                : static_cast<float>(std::sqrt(equations.SquaredResidualSum / equations.NumberOfCorrespondences));
+
+        //
+        // An inlier's point-to-plane residual never exceeds its distance to the key
+        // frame vertex, which the gate bounds, so every sample contributes at most the
+        // squared gate.
+        //
+        const double maximumSquaredResidual =
+            _settings.MaximumCorrespondenceDistanceInMeters *
+            _settings.MaximumCorrespondenceDistanceInMeters;
+
+        truncatedRmsResidualInMeters =
+            0 == equations.NumberOfSamples
+                ? std::numeric_limits<float>::max()
+                : static_cast<float>(std::sqrt(
+                    (equations.SquaredResidualSum +
+                        (equations.NumberOfSamples - equations.NumberOfCorrespondences) * maximumSquaredResidual) /
+                    equations.NumberOfSamples));
+    }
+}
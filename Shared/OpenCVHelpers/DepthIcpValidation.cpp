@@ -0,0 +1,419 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const float c_radiansToDegrees = 57.2957795f;
+        const float c_degreesToRadians = 0.0174532925f;
+
+        const uint32_t c_randomSeed = 42;
+
+        //
+        // Per frame, the headset's pose drifts by a random walk with these standard
+        // deviations, plus a constant bias along the X axis and around the Y axis.
+        //
+        const float c_driftTranslationInMeters = 0.001f;
+        const float c_driftRotationInDegrees = 0.05f;
+        const float c_driftTranslationBiasInMeters = 0.0005f;
+        const float c_driftRotationBiasInDegrees = 0.02f;
+
+        struct SceneBox
+        {
+            cv::Vec3f Minimum;
+            cv::Vec3f Maximum;
+        };
+
+        //
+        // World coordinates with the Y axis up. The camera starts at 1.5m above the
+        // floor, looking at the back wall; the boxes stand in front of it and hang
+        // from it, so that the frames have depth discontinuities all around them.
+        //
+        const SceneBox c_room =
+            { cv::Vec3f(-2.0f, 0.0f, -3.5f), cv::Vec3f(2.0f, 2.5f, 1.0f) };
+
+        const SceneBox c_boxes[] =
+        {
+            { cv::Vec3f(-0.9f, 0.0f, -2.2f), cv::Vec3f(-0.3f, 0.8f, -1.6f) },
+            { cv::Vec3f(0.4f, 0.0f, -2.8f), cv::Vec3f(1.0f, 1.2f, -2.3f) },
+            { cv::Vec3f(-0.3f, 1.6f, -3.5f), cv::Vec3f(0.5f, 1.8f, -3.1f) },
+        };
+
+        cv::Matx44f CreateRigidTransform(
+            _In_ const cv::Vec3f& rotationVector,
+            _In_ const cv::Vec3f& translation)
+        {
+            cv::Matx33d rotation;
+
+            cv::Rodrigues(
+                cv::Vec3d(rotationVector[0], rotationVector[1], rotationVector[2]),
+                rotation);
+
+            return cv::Matx44f(
+                static_cast<float>(rotation(0, 0)), static_cast<float>(rotation(0, 1)), static_cast<float>(rotation(0, 2)), translation[0],
+                static_cast<float>(rotation(1, 0)), static_cast<float>(rotation(1, 1)), static_cast<float>(rotation(1, 2)), translation[1],
+                static_cast<float>(rotation(2, 0)), static_cast<float>(rotation(2, 1)), static_cast<float>(rotation(2, 2)), translation[2],
+                0.0f, 0.0f, 0.0f, 1.0f);
+        }
+
+        //
+        // One loop around the room: the camera sways sideways and back while it pans
+        // by up to 20 degrees and tilts between 5 and 15 degrees down.
+        //
+        cv::Matx44f GetGroundTruthCameraToWorld(
+            _In_ const int32_t frameIndex,
+            _In_ const int32_t numberOfFrames)
+        {
+            const float phase =
+                2.0f * static_cast<float>(CV_PI) * frameIndex / numberOfFrames;
+
+            const float panInDegrees = 20.0f * std::sin(phase);
+            const float tiltInDegrees = -10.0f + 5.0f * std::sin(2.0f * phase);
+
+            cv::Matx44f cameraToWorld =
+                CreateRigidTransform(cv::Vec3f(0.0f, panInDegrees * c_degreesToRadians, 0.0f), cv::Vec3f()) *
+                CreateRigidTransform(cv::Vec3f(tiltInDegrees * c_degreesToRadians, 0.0f, 0.0f), cv::Vec3f());
+
+            cameraToWorld(0, 3) = 0.4f * std::sin(phase);
+            cameraToWorld(1, 3) = 1.5f + 0.1f * std::sin(2.0f * phase);
+            cameraToWorld(2, 3) = 0.3f * (1.0f - std::cos(phase));
+
+            return cameraToWorld;
+        }
+
+        //
+        // Distances along the ray at which it enters and leaves the box.
+        //
+        bool IntersectBox(
+            _In_ const SceneBox& box,
+            _In_ const cv::Vec3f& origin,
+            _In_ const cv::Vec3f& direction,
+            _Out_ float& entryDistance,
+            _Out_ float& exitDistance)
+        {
+            entryDistance = -std::numeric_limits<float>::max();
+            exitDistance = std::numeric_limits<float>::max();
+
+            for (int32_t axis = 0; axis < 3; ++axis)
+            {
+                if (std::abs(direction[axis]) <= std::numeric_limits<float>::epsilon())
+                {
+                    if (origin[axis] < box.Minimum[axis] || origin[axis] > box.Maximum[axis])
+                    {
+                        return false;
+                    }
+
+                    continue;
+                }
+
+                const float first =
+                    (box.Minimum[axis] - origin[axis]) / direction[axis];
+
+                const float second =
+                    (box.Maximum[axis] - origin[axis]) / direction[axis];
+
+                entryDistance = std::max(entryDistance, std::min(first, second));
+                exitDistance = std::min(exitDistance, std::max(first, second));
+            }
+
+            return entryDistance <= exitDistance;
+        }
+
+        //
+        // Renders the distance along each pixel ray to the closest surface, in
+        // millimeters, or 0 if it is out of range.
+        //
+        void RenderScene(
+            _In_ const cv::Mat& cameraUnitPlane,
+            _In_ const cv::Matx44f& cameraToWorld,
+            _In_ const DepthIcpSettings& settings,
+            _Out_ cv::Mat& depthImage)
+        {
+            depthImage.create(
+                cameraUnitPlane.size(),
+                CV_16UC1);
+
+            const cv::Matx33f rotation =
+                cameraToWorld.get_minor<3, 3>(0, 0);
+
+            const cv::Vec3f origin(
+                cameraToWorld(0, 3),
+                cameraToWorld(1, 3),
+                cameraToWorld(2, 3));
+
+            for (int32_t y = 0; y < cameraUnitPlane.rows; ++y)
+            {
+                const cv::Vec2f* unitPlaneRow =
+                    cameraUnitPlane.ptr<cv::Vec2f>(y);
+
+                uint16_t* depthRow =
+                    depthImage.ptr<uint16_t>(y);
+
+                for (int32_t x = 0; x < cameraUnitPlane.cols; ++x)
+                {
+                    depthRow[x] = 0;
+
+                    const cv::Vec2f& xy = unitPlaneRow[x];
+
+                    if (!std::isfinite(xy[0]) || !std::isfinite(xy[1]))
+                    {
+                        continue;
+                    }
+
+                    const cv::Vec3f direction =
+                        rotation * cv::normalize(cv::Vec3f(-xy[0], -xy[1], -1.0f));
+
+                    float entryDistance, closestDistance;
+
+                    if (!IntersectBox(c_room, origin, direction, entryDistance, closestDistance))
+                    {
+                        continue;
+                    }
+
+                    for (const SceneBox& box : c_boxes)
+                    {
+                        float exitDistance;
+
+                        if (IntersectBox(box, origin, direction, entryDistance, exitDistance) &&
+                            entryDistance > 0.0f &&
+                            entryDistance < closestDistance)
+                        {
+                            closestDistance = entryDistance;
+                        }
+                    }
+
+                    if (closestDistance < settings.MinimumDepthInMeters ||
+                        closestDistance > settings.MaximumDepthInMeters)
+                    {
+                        continue;
+                    }
+
+                    depthRow[x] =
+                        static_cast<uint16_t>(closestDistance * 1000.0f + 0.5f);
+                }
+            }
+        }
+
+        void GetPoseDifference(
+            _In_ const cv::Matx44f& groundTruthCameraToWorld,
+            _In_ const cv::Matx44f& cameraToWorld,
+            _Out_ float& translationInMeters,
+            _Out_ float& rotationInDegrees)
+        {
+            const cv::Matx44f difference =
+                groundTruthCameraToWorld.inv() * cameraToWorld;
+
+            translationInMeters =
+                std::sqrt(
+                    difference(0, 3) * difference(0, 3) +
+                    difference(1, 3) * difference(1, 3) +
+                    difference(2, 3) * difference(2, 3));
+
+            const float cosine =
+                0.5f * (difference(0, 0) + difference(1, 1) + difference(2, 2) - 1.0f);
+
+            rotationInDegrees =
+                std::acos(std::min(1.0f, std::max(-1.0f, cosine))) * c_radiansToDegrees;
+        }
+
+        //
+        // Refines the headset's poses of the frames one after another and returns the
+        // refined pose of the last one.
+        //
+        cv::Matx44f RefineTrajectory(
+            _In_ const cv::Mat& cameraUnitPlane,
+            _In_ const DepthIcpSettings& settings,
+            _In_ const std::vector<cv::Mat>& depthImages,
+            _In_ const std::vector<cv::Matx44f>& headsetCameraToWorld,
+            _Out_ int32_t& numberOfFramesRefined,
+            _Out_ int32_t& numberOfKeyFrames,
+            _Out_ double& totalMilliseconds,
+            _Out_ double& maximumMilliseconds)
+        {
+            DepthIcp depthIcp(
+                cameraUnitPlane,
+                settings);
+
+            numberOfFramesRefined = 0;
+            numberOfKeyFrames = 0;
+            totalMilliseconds = 0.0;
+            maximumMilliseconds = 0.0;
+
+            cv::Matx44f refinedCameraToWorld;
+
+            for (size_t i = 0; i < depthImages.size(); ++i)
+            {
+                const bool refined =
+                    depthIcp.Refine(
+                        depthImages[i],
+                        headsetCameraToWorld[i],
+                        refinedCameraToWorld);
+
+                const DepthIcpStatistics& statistics =
+                    depthIcp.GetStatistics();
+
+                numberOfFramesRefined += refined ? 1 : 0;
+                numberOfKeyFrames += statistics.KeyFrameUpdated ? 1 : 0;
+                totalMilliseconds += statistics.ElapsedTimeInMilliseconds;
+                maximumMilliseconds = std::max(maximumMilliseconds, statistics.ElapsedTimeInMilliseconds);
+            }
+
+            return refinedCameraToWorld;
+        }
+    }
+
+    DepthIcpDriftBenchmarkResult BenchmarkDepthIcpDrift(
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const int32_t numberOfFrames)
+    {
+        REQUIRES(CV_32FC2 == cameraUnitPlane.type());
+        REQUIRES(numberOfFrames > 1);
+
+        const DepthIcpSettings settings;
+
+        std::mt19937 randomEngine(
+            c_randomSeed);
+
+        std::normal_distribution<float> normalDistribution(
+            0.0f,
+            1.0f);
+
+        const cv::Matx44f driftBias =
+            CreateRigidTransform(
+                cv::Vec3f(0.0f, c_driftRotationBiasInDegrees * c_degreesToRadians, 0.0f),
+                cv::Vec3f(c_driftTranslationBiasInMeters, 0.0f, 0.0f));
+
+        std::vector<cv::Mat> depthImages(numberOfFrames);
+        std::vector<cv::Matx44f> groundTruthCameraToWorld(numberOfFrames);
+        std::vector<cv::Matx44f> headsetCameraToWorld(numberOfFrames);
+
+        //
+        // The headset's trajectory starts out at the ground truth, which is where the
+        // refined trajectory is anchored too.
+        //
+        cv::Matx44f drift =
+            cv::Matx44f::eye();
+
+        for (int32_t i = 0; i < numberOfFrames; ++i)
+        {
+            if (i > 0)
+            {
+                cv::Vec3f rotationVector, translation;
+
+                for (int32_t axis = 0; axis < 3; ++axis)
+                {
+                    rotationVector[axis] =
+                        normalDistribution(randomEngine) * c_driftRotationInDegrees * c_degreesToRadians;
+                }
+
+                for (int32_t axis = 0; axis < 3; ++axis)
+                {
+                    translation[axis] =
+                        normalDistribution(randomEngine) * c_driftTranslationInMeters;
+                }
+
+                drift =
+                    CreateRigidTransform(rotationVector, translation) * driftBias * drift;
+            }
+
+            groundTruthCameraToWorld[i] =
+                GetGroundTruthCameraToWorld(
+                    i,
+                    numberOfFrames);
+
+            headsetCameraToWorld[i] =
+                drift * groundTruthCameraToWorld[i];
+
+            RenderScene(
+                cameraUnitPlane,
+                groundTruthCameraToWorld[i],
+                settings,
+                depthImages[i]);
+        }
+
+        DepthIcpDriftBenchmarkResult result = {};
+
+        result.NumberOfFrames = numberOfFrames;
+
+        GetPoseDifference(
+            groundTruthCameraToWorld.back(),
+            headsetCameraToWorld.back(),
+            result.HeadsetDriftInMeters,
+            result.HeadsetDriftInDegrees);
+
+        double totalMilliseconds;
+
+        GetPoseDifference(
+            groundTruthCameraToWorld.back(),
+            RefineTrajectory(
+                cameraUnitPlane,
+                settings,
+                depthImages,
+                headsetCameraToWorld,
+                result.NumberOfFramesRefined,
+                result.NumberOfKeyFrames,
+                totalMilliseconds,
+                result.MaximumMilliseconds),
+            result.RefinedDriftInMeters,
+            result.RefinedDriftInDegrees);
+
+        result.MeanMilliseconds =
+            totalMilliseconds / numberOfFrames;
+
+        DepthIcpSettings settingsWithoutDepthJumpRejection;
+
+        settingsWithoutDepthJumpRejection.MaximumRelativeDepthJump =
+            std::numeric_limits<float>::infinity();
+
+        int32_t numberOfFramesRefined, numberOfKeyFrames;
+        double maximumMilliseconds;
+
+        GetPoseDifference(
+            groundTruthCameraToWorld.back(),
+            RefineTrajectory(
+                cameraUnitPlane,
+                settingsWithoutDepthJumpRejection,
+                depthImages,
+                headsetCameraToWorld,
+                numberOfFramesRefined,
+                numberOfKeyFrames,
+                totalMilliseconds,
+                maximumMilliseconds),
+            result.RefinedWithoutDepthJumpRejectionDriftInMeters,
+            result.RefinedWithoutDepthJumpRejectionDriftInDegrees);
+
+        result.Passed =
+            result.RefinedDriftInMeters < result.HeadsetDriftInMeters &&
+            result.RefinedDriftInDegrees < result.HeadsetDriftInDegrees;
+
+        dbg::trace(
+            L"BenchmarkDepthIcpDrift: %s on %ix%i pixels, %i frames, %i refined, %i key frames, %.02f ms per frame (at most %.02f ms), drift %.04fm / %.02fdeg headset, %.04fm / %.02fdeg refined, %.04fm / %.02fdeg refined without depth jump rejection",
+            result.Passed ? L"passed" : L"FAILED",
+            cameraUnitPlane.cols,
+            cameraUnitPlane.rows,
+            result.NumberOfFrames,
+            result.NumberOfFramesRefined,
+            result.NumberOfKeyFrames,
+            result.MeanMilliseconds,
+            result.MaximumMilliseconds,
+            result.HeadsetDriftInMeters,
+            result.HeadsetDriftInDegrees,
+            result.RefinedDriftInMeters,
+            result.RefinedDriftInDegrees,
+            result.RefinedWithoutDepthJumpRejectionDriftInMeters,
+            result.RefinedWithoutDepthJumpRejectionDriftInDegrees);
+
+        return result;
+    }
+}
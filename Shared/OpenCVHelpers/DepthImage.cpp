@@ -0,0 +1,202 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    void BackprojectDepthImage(
+        _In_ const cv::Mat& depthImage,
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const float minimumDepthInMeters,
+        _In_ const float maximumDepthInMeters,
+        _Inout_ cv::Mat& vertices)
+    {
+        REQUIRES(CV_16UC1 == depthImage.type());
+        REQUIRES(CV_32FC2 == cameraUnitPlane.type());
+        REQUIRES(depthImage.size() == cameraUnitPlane.size());
+
+        //
+        // Reuses the caller's buffer when the size matches, so that streaming callers
+        // do not reallocate the vertex map for every frame.
+        //
+        vertices.create(
+            depthImage.rows,
+            depthImage.cols,
+            CV_32FC3);
+
+        const uint16_t minimumDepth =
+            static_cast<uint16_t>(minimumDepthInMeters * 1000.0f);
+
+        const uint16_t maximumDepth =
+            static_cast<uint16_t>(maximumDepthInMeters * 1000.0f);
+
+        for (int32_t y = 0; y < depthImage.rows; ++y)
+        {
+            const uint16_t* depthRow =
+                depthImage.ptr<uint16_t>(y);
+
+            const cv::Vec2f* unitPlaneRow =
+                cameraUnitPlane.ptr<cv::Vec2f>(y);
+
+            cv::Vec3f* vertexRow =
+                vertices.ptr<cv::Vec3f>(y);
+
+            for (int32_t x = 0; x < depthImage.cols; ++x)
+            {
+                const uint16_t depth = depthRow[x];
+                const cv::Vec2f& xy = unitPlaneRow[x];
+
+                if (depth < minimumDepth || depth > maximumDepth ||
+                    !std::isfinite(xy[0]) || !std::isfinite(xy[1]))
+                {
+                    vertexRow[x] = cv::Vec3f(0.0f, 0.0f, 0.0f);
+
+                    continue;
+                }
+
+                //
+                // The depth cameras report the distance along the pixel ray, not the Z
+                // coordinate, see https://github.com/Microsoft/HoloLensForCV/issues/63.
+                //
+                const float z =
+                    -0.001f * depth / std::sqrt(xy[0] * xy[0] + xy[1] * xy[1] + 1.0f);
+
+                vertexRow[x] = cv::Vec3f(
+                    xy[0] * z,
+                    xy[1] * z,
+                    z);
+            }
+        }
+    }
+
+    void ComputeVertexNormals(
+        _In_ const cv::Mat& vertices,
+        _In_ const float maximumRelativeDepthJump,
+        _Inout_ cv::Mat& normals)
+    {
+        REQUIRES(CV_32FC3 == vertices.type());
+
+        normals.create(
+            vertices.rows,
+            vertices.cols,
+            CV_32FC3);
+
+        normals.setTo(
+            cv::Scalar::all(0.0));
+
+        for (int32_t y = 1; y < vertices.rows - 1; ++y)
+        {
+            const cv::Vec3f* previousRow = vertices.ptr<cv::Vec3f>(y - 1);
+            const cv::Vec3f* currentRow = vertices.ptr<cv::Vec3f>(y);
+            const cv::Vec3f* nextRow = vertices.ptr<cv::Vec3f>(y + 1);
+
+            cv::Vec3f* normalRow =
+                normals.ptr<cv::Vec3f>(y);
+
+            for (int32_t x = 1; x < vertices.cols - 1; ++x)
+            {
+                const cv::Vec3f& vertex =
+                    currentRow[x];
+
+                if (!IsValidVertex(vertex))
+                {
+                    continue;
+                }
+
+                //
+                // The camera looks down the negative Z axis, so the depth is -Z.
+                //
+                const float maximumDepthJump =
+                    -maximumRelativeDepthJump * vertex[2];
+
+                const auto isUsable = [&](const cv::Vec3f& neighbour)
+                {
+                    return
+                        IsValidVertex(neighbour) &&
+                        std::abs(neighbour[2] - vertex[2]) <= maximumDepthJump;
+                };
+
+                const bool isLeftUsable = isUsable(currentRow[x - 1]);
+                const bool isRightUsable = isUsable(currentRow[x + 1]);
+                const bool isAboveUsable = isUsable(previousRow[x]);
+                const bool isBelowUsable = isUsable(nextRow[x]);
+
+                if ((!isLeftUsable && !isRightUsable) ||
+                    (!isAboveUsable && !isBelowUsable))
+                {
+                    continue;
+                }
+
+                const cv::Vec3f horizontalDifference =
+                    (isRightUsable ? currentRow[x + 1] : vertex) -
+                    (isLeftUsable ? currentRow[x - 1] : vertex);
+
+                const cv::Vec3f verticalDifference =
+                    (isBelowUsable ? nextRow[x] : vertex) -
+                    (isAboveUsable ? previousRow[x] : vertex);
+
+                cv::Vec3f normal =
+                    horizontalDifference.cross(
+                        verticalDifference);
+
+                const float length =
+                    static_cast<float>(cv::norm(normal));
+
+                if (length <= std::numeric_limits<float>::epsilon())
+                {
+                    continue;
+                }
+
+                normal *= 1.0f / length;
+
+                if (normal.dot(vertex) > 0.0f)
+                {
+                    normal = -normal;
+                }
+
+                normalRow[x] = normal;
+            }
+        }
+    }
+
+    void SubsampleMap(
+        _In_ const cv::Mat& source,
+        _Inout_ cv::Mat& destination)
+    {
+        REQUIRES(CV_32FC3 == source.type() || CV_32FC2 == source.type());
+
+        destination.create(
+            source.rows / 2,
+            source.cols / 2,
+            source.type());
+
+        const size_t pixelSize =
+            source.elemSize();
+
+        for (int32_t y = 0; y < destination.rows; ++y)
+        {
+            const uint8_t* sourceRow =
+                source.ptr<uint8_t>(y * 2);
+
+            uint8_t* destinationRow =
+                destination.ptr<uint8_t>(y);
+
+            for (int32_t x = 0; x < destination.cols; ++x)
+            {
+                memcpy(
+                    destinationRow + x * pixelSize,
+                    sourceRow + x * 2 * pixelSize,
+                    pixelSize);
+            }
+        }
+    }
+}
@@ -0,0 +1,168 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    DepthNormalEstimator::DepthNormalEstimator(
+        _In_ const int32_t windowRadius,
+        _In_ const float maximumDepthChangeFactor)
+        : _windowRadius(windowRadius)
+        , _maximumDepthChangeFactor(maximumDepthChangeFactor)
+    {
+        REQUIRES(_windowRadius > 0);
+    }
+
+    void DepthNormalEstimator::Compute(
+        _In_ const cv::Mat& vertices,
+        _Inout_ cv::Mat& normals)
+    {
+        REQUIRES(CV_32FC3 == vertices.type());
+
+        _validVertices.create(
+            vertices.rows,
+            vertices.cols,
+            CV_8UC1);
+
+        for (int32_t y = 0; y < vertices.rows; ++y)
+        {
+            const cv::Vec3f* vertexRow =
+                vertices.ptr<cv::Vec3f>(y);
+
+            uint8_t* validVertexRow =
+                _validVertices.ptr<uint8_t>(y);
+
+            for (int32_t x = 0; x < vertices.cols; ++x)
+            {
+                validVertexRow[x] = IsValidVertex(vertexRow[x]) ? 1 : 0;
+            }
+        }
+
+        //
+        // Invalid vertices are all-zero, so they do not contribute to the sums; the
+        // counts tell how many valid vertices each window actually averages.
+        //
+        cv::integral(
+            vertices,
+            _vertexSums,
+            CV_64F);
+
+        cv::integral(
+            _validVertices,
+            _validVertexCounts,
+            CV_32S);
+
+        normals.create(
+            vertices.rows,
+            vertices.cols,
+            CV_32FC3);
+
+        normals.setTo(
+            cv::Scalar::all(0.0));
+
+        const int32_t r = _windowRadius;
+
+        for (int32_t y = r; y < vertices.rows - r; ++y)
+        {
+            const cv::Vec3f* vertexRow =
+                vertices.ptr<cv::Vec3f>(y);
+
+            cv::Vec3f* normalRow =
+                normals.ptr<cv::Vec3f>(y);
+
+            for (int32_t x = r; x < vertices.cols - r; ++x)
+            {
+                const cv::Vec3f& vertex = vertexRow[x];
+
+                if (!IsValidVertex(vertex))
+                {
+                    continue;
+                }
+
+                cv::Vec3f left, right, above, below;
+
+                if (!GetWindowAverage(x - r, y - r, x - 1, y + r, left) ||
+                    !GetWindowAverage(x + 1, y - r, x + r, y + r, right) ||
+                    !GetWindowAverage(x - r, y - r, x + r, y - 1, above) ||
+                    !GetWindowAverage(x - r, y + 1, x + r, y + r, below))
+                {
+                    continue;
+                }
+
+                //
+                // The half window averages are about r pixels apart; on a smooth surface
+                // their depths differ by a small fraction of the distance to the camera.
+                //
+                const float maximumDepthChange =
+                    _maximumDepthChangeFactor * r * -vertex[2];
+
+                if (std::abs(right[2] - left[2]) > maximumDepthChange ||
+                    std::abs(below[2] - above[2]) > maximumDepthChange)
+                {
+                    continue;
+                }
+
+                cv::Vec3f normal =
+                    (right - left).cross(below - above);
+
+                const float length =
+                    static_cast<float>(cv::norm(normal));
+
+                if (length <= std::numeric_limits<float>::epsilon())
+                {
+                    continue;
+                }
+
+                normal *= 1.0f / length;
+
+                if (normal.dot(vertex) > 0.0f)
+                {
+                    normal = -normal;
+                }
+
+                normalRow[x] = normal;
+            }
+        }
+    }
+
+    bool DepthNormalEstimator::GetWindowAverage(
+        _In_ const int32_t left,
+        _In_ const int32_t top,
+        _In_ const int32_t right,
+        _In_ const int32_t bottom,
+        _Out_ cv::Vec3f& average) const
+    {
+        const int32_t count =
+            _validVertexCounts.at<int32_t>(bottom + 1, right + 1) -
+            _validVertexCounts.at<int32_t>(top, right + 1) -
+            _validVertexCounts.at<int32_t>(bottom + 1, left) +
+            _validVertexCounts.at<int32_t>(top, left);
+
+        //
+        // Require at least half of the window to be valid.
+        //
+        if (2 * count < (right - left + 1) * (bottom - top + 1))
+        {
+            return false;
+        }
+
+        const cv::Vec3d sum =
+            _vertexSums.at<cv::Vec3d>(bottom + 1, right + 1) -
+            _vertexSums.at<cv::Vec3d>(top, right + 1) -
+            _vertexSums.at<cv::Vec3d>(bottom + 1, left) +
+            _vertexSums.at<cv::Vec3d>(top, left);
+
+        average = cv::Vec3f(sum * (1.0 / count));
+
+        return true;
+    }
+}
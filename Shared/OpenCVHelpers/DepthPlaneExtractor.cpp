@@ -0,0 +1,394 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const int16_t c_unassignedLabel = -1;
+
+        //
+        // Marks pixels of regions that were grown but turned out too small, so that they
+        // are not sampled again while extracting the remaining planes of the frame.
+        //
+        const int16_t c_rejectedLabel = -2;
+    }
+
+    DepthPlaneExtractorSettings::DepthPlaneExtractorSettings()
+        : MaximumNumberOfPlanes(8)
+        , MinimumNumberOfPixels(1500)
+        , NumberOfHypotheses(64)
+        , HypothesisSampleStep(4)
+        , InlierDistanceInMeters(0.02f)
+        , MinimumNormalDotProduct(0.9f)
+    {
+    }
+
+    class DepthPlaneExtractor::HypothesisScoringBody
+        : public cv::ParallelLoopBody
+    {
+    public:
+        HypothesisScoringBody(
+            _Inout_ DepthPlaneExtractor& extractor,
+            _In_ const cv::Vec3f* vertices,
+            _In_ const cv::Vec3f* normals)
+            : _extractor(extractor)
+            , _vertices(vertices)
+            , _normals(normals)
+        {
+        }
+
+        virtual void operator()(
+            const cv::Range& hypotheses) const override
+        {
+            for (int32_t i = hypotheses.start; i < hypotheses.end; ++i)
+            {
+                _extractor._hypothesisScores[i] =
+                    _extractor.ScoreHypothesis(
+                        _vertices,
+                        _normals,
+                        _extractor._hypothesisPixels[i]);
+            }
+        }
+
+    private:
+        DepthPlaneExtractor& _extractor;
+
+        const cv::Vec3f* _vertices;
+        const cv::Vec3f* _normals;
+    };
+
+    DepthPlaneExtractor::DepthPlaneExtractor(
+        _In_ const DepthPlaneExtractorSettings& settings)
+        : _settings(settings)
+        , _random(0x484c524d)
+    {
+        REQUIRES(_settings.NumberOfHypotheses > 0);
+        REQUIRES(_settings.HypothesisSampleStep > 0);
+    }
+
+    void DepthPlaneExtractor::Extract(
+        _In_ const cv::Mat& vertices,
+        _In_ const cv::Mat& normals,
+        _Inout_ std::vector<DepthPlane>& planes,
+        _Inout_ cv::Mat& labels)
+    {
+        REQUIRES(CV_32FC3 == vertices.type() && vertices.isContinuous());
+        REQUIRES(CV_32FC3 == normals.type() && normals.isContinuous());
+        REQUIRES(vertices.size() == normals.size());
+
+        labels.create(
+            vertices.rows,
+            vertices.cols,
+            CV_16SC1);
+
+        labels.setTo(
+            cv::Scalar::all(c_unassignedLabel));
+
+        planes.clear();
+
+        const cv::Vec3f* vertexData = vertices.ptr<cv::Vec3f>();
+        const cv::Vec3f* normalData = normals.ptr<cv::Vec3f>();
+
+        int16_t* labelData =
+            labels.ptr<int16_t>();
+
+        const int32_t step =
+            _settings.HypothesisSampleStep;
+
+        const int32_t minimumScore =
+            std::max(1, _settings.MinimumNumberOfPixels / (step * step));
+
+        for (int32_t attempt = 0;
+            attempt < 2 * _settings.MaximumNumberOfPlanes &&
+            static_cast<int32_t>(planes.size()) < _settings.MaximumNumberOfPlanes;
+            ++attempt)
+        {
+            _candidatePixels.clear();
+
+            for (int32_t y = 0; y < vertices.rows; y += step)
+            {
+                for (int32_t x = 0; x < vertices.cols; x += step)
+                {
+                    const int32_t pixel = y * vertices.cols + x;
+
+                    if (c_unassignedLabel == labelData[pixel] && IsValidNormal(normalData[pixel]))
+                    {
+                        _candidatePixels.push_back(pixel);
+                    }
+                }
+            }
+
+            if (static_cast<int32_t>(_candidatePixels.size()) < minimumScore)
+            {
+                break;
+            }
+
+            _hypothesisPixels.resize(
+                _settings.NumberOfHypotheses);
+
+            for (auto& hypothesisPixel : _hypothesisPixels)
+            {
+                hypothesisPixel =
+                    _candidatePixels[_random.uniform(0, static_cast<int32_t>(_candidatePixels.size()))];
+            }
+
+            _hypothesisScores.assign(
+                _settings.NumberOfHypotheses,
+                0);
+
+            cv::parallel_for_(
+                cv::Range(0, _settings.NumberOfHypotheses),
+                HypothesisScoringBody(*this, vertexData, normalData));
+
+            const size_t bestHypothesis =
+                std::max_element(_hypothesisScores.begin(), _hypothesisScores.end()) - _hypothesisScores.begin();
+
+            if (_hypothesisScores[bestHypothesis] < minimumScore)
+            {
+                break;
+            }
+
+            const int32_t seedPixel =
+                _hypothesisPixels[bestHypothesis];
+
+            const int16_t label =
+                static_cast<int16_t>(planes.size());
+
+            const cv::Vec3f& seedNormal =
+                normalData[seedPixel];
+
+            GrowRegion(
+                vertices,
+                normals,
+                seedPixel,
+                seedNormal,
+                -seedNormal.dot(vertexData[seedPixel]),
+                label,
+                labels);
+
+            DepthPlane plane;
+
+            const bool isPlaneFit =
+                FitPlane(vertices, _region, plane);
+
+            if (isPlaneFit)
+            {
+                for (const int32_t pixel : _region)
+                {
+                    labelData[pixel] = c_unassignedLabel;
+                }
+
+                GrowRegion(
+                    vertices,
+                    normals,
+                    seedPixel,
+                    plane.Normal,
+                    plane.Distance,
+                    label,
+                    labels);
+            }
+
+            //
+            // The plane is the least squares fit that the final region was grown with.
+            //
+            if (!isPlaneFit ||
+                static_cast<int32_t>(_region.size()) < _settings.MinimumNumberOfPixels)
+            {
+                for (const int32_t pixel : _region)
+                {
+                    labelData[pixel] = c_rejectedLabel;
+                }
+
+                labelData[seedPixel] = c_rejectedLabel;
+
+                continue;
+            }
+
+            plane.NumberOfPixels =
+                static_cast<int32_t>(_region.size());
+
+            planes.push_back(
+                plane);
+        }
+
+        labels.setTo(
+            cv::Scalar::all(c_unassignedLabel),
+            labels == c_rejectedLabel);
+
+#if DBG_ENABLE_VERBOSE_LOGGING
+        dbg::trace(
+            L"DepthPlaneExtractor::Extract: found %i planes",
+            static_cast<int32_t>(planes.size()));
+#endif /* DBG_ENABLE_VERBOSE_LOGGING */
+    }
+
+    bool DepthPlaneExtractor::IsInlier(
+        _In_ const cv::Vec3f& planeNormal,
+        _In_ const float planeDistance,
+        _In_ const cv::Vec3f& vertex,
+        _In_ const cv::Vec3f& normal) const
+    {
+        return
+            std::abs(planeNormal.dot(vertex) + planeDistance) <= _settings.InlierDistanceInMeters &&
+            planeNormal.dot(normal) >= _settings.MinimumNormalDotProduct;
+    }
+
+    int32_t DepthPlaneExtractor::ScoreHypothesis(
+        _In_ const cv::Vec3f* vertices,
+        _In_ const cv::Vec3f* normals,
+        _In_ const int32_t hypothesisPixel) const
+    {
+        const cv::Vec3f& planeNormal =
+            normals[hypothesisPixel];
+
+        const float planeDistance =
+            -planeNormal.dot(vertices[hypothesisPixel]);
+
+        int32_t score = 0;
+
+        for (const int32_t pixel : _candidatePixels)
+        {
+            if (IsInlier(planeNormal, planeDistance, vertices[pixel], normals[pixel]))
+            {
+                ++score;
+            }
+        }
+
+        return score;
+    }
+
+    void DepthPlaneExtractor::GrowRegion(
+        _In_ const cv::Mat& vertices,
+        _In_ const cv::Mat& normals,
+        _In_ const int32_t seedPixel,
+        _In_ const cv::Vec3f& planeNormal,
+        _In_ const float planeDistance,
+        _In_ const int16_t label,
+        _Inout_ cv::Mat& labels)
+    {
+        const cv::Vec3f* vertexData = vertices.ptr<cv::Vec3f>();
+        const cv::Vec3f* normalData = normals.ptr<cv::Vec3f>();
+
+        int16_t* labelData =
+            labels.ptr<int16_t>();
+
+        _region.clear();
+        _pixelsToVisit.clear();
+
+        if (c_unassignedLabel != labelData[seedPixel] ||
+            !IsInlier(planeNormal, planeDistance, vertexData[seedPixel], normalData[seedPixel]))
+        {
+            return;
+        }
+
+        labelData[seedPixel] = label;
+        _pixelsToVisit.push_back(seedPixel);
+
+        while (!_pixelsToVisit.empty())
+        {
+            const int32_t pixel = _pixelsToVisit.back();
+            _pixelsToVisit.pop_back();
+
+            _region.push_back(pixel);
+
+            const int32_t x = pixel % vertices.cols;
+            const int32_t y = pixel / vertices.cols;
+
+            const int32_t neighbours[4] =
+            {
+                x > 0 ? pixel - 1 : -1,
+                x + 1 < vertices.cols ? pixel + 1 : -1,
+                y > 0 ? pixel - vertices.cols : -1,
+                y + 1 < vertices.rows ? pixel + vertices.cols : -1
+            };
+
+            for (const int32_t neighbour : neighbours)
+            {
+                if (neighbour < 0 ||
+                    c_unassignedLabel != labelData[neighbour] ||
+                    !IsValidNormal(normalData[neighbour]) ||
+                    !IsInlier(planeNormal, planeDistance, vertexData[neighbour], normalData[neighbour]))
+                {
+                    continue;
+                }
+
+                labelData[neighbour] = label;
+                _pixelsToVisit.push_back(neighbour);
+            }
+        }
+    }
+
+    bool DepthPlaneExtractor::FitPlane(
+        _In_ const cv::Mat& vertices,
+        _In_ const std::vector<int32_t>& pixels,
+        _Out_ DepthPlane& plane)
+    {
+        plane = DepthPlane();
+
+        if (pixels.size() < 3)
+        {
+            return false;
+        }
+
+        const cv::Vec3f* vertexData =
+            vertices.ptr<cv::Vec3f>();
+
+        cv::Vec3d centroid(0.0, 0.0, 0.0);
+
+        for (const int32_t pixel : pixels)
+        {
+            centroid += cv::Vec3d(vertexData[pixel]);
+        }
+
+        centroid *= 1.0 / pixels.size();
+
+        cv::Matx33d covariance = cv::Matx33d::zeros();
+
+        for (const int32_t pixel : pixels)
+        {
+            const cv::Vec3d d = cv::Vec3d(vertexData[pixel]) - centroid;
+
+            covariance += d * d.t();
+        }
+
+        cv::Vec3d eigenvalues;
+        cv::Matx33d eigenvectors;
+
+        if (!cv::eigen(covariance, eigenvalues, eigenvectors))
+        {
+            return false;
+        }
+
+        //
+        // The eigenvalues are sorted in descending order; the plane normal is the
+        // direction of least variance.
+        //
+        cv::Vec3d normal(
+            eigenvectors(2, 0),
+            eigenvectors(2, 1),
+            eigenvectors(2, 2));
+
+        if (normal.dot(centroid) > 0.0)
+        {
+            normal = -normal;
+        }
+
+        plane.Normal = cv::Vec3f(normal);
+        plane.Distance = static_cast<float>(-normal.dot(centroid));
+        plane.Centroid = cv::Vec3f(centroid);
+        plane.NumberOfPixels = static_cast<int32_t>(pixels.size());
+
+        return true;
+    }
+}
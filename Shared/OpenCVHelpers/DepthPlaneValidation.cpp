@@ -0,0 +1,319 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const float c_radiansToDegrees = 57.2957795f;
+
+        const float c_minimumDepthInMeters = 0.2f;
+        const float c_maximumDepthInMeters = 4.0f;
+
+        //
+        // An extracted plane matches a scene plane within these tolerances.
+        //
+        const float c_maximumPlaneNormalErrorInDegrees = 2.0f;
+        const float c_maximumPlaneDistanceErrorInMeters = 0.01f;
+
+        //
+        // Scene planes covering fewer pixels than this many times the extractor's minimum
+        // may lose too many pixels at their borders to be found, and are not required.
+        //
+        const int32_t c_requiredPlaneSizeFactor = 4;
+
+        //
+        // The camera looks down the negative Z axis. The normals point towards it.
+        //
+        std::vector<DepthPlane> CreateScenePlanes()
+        {
+            std::vector<DepthPlane> planes(3);
+
+            planes[0].Normal = cv::Vec3f(0.0f, 0.0f, 1.0f);
+            planes[0].Distance = 2.5f;
+
+            planes[1].Normal = cv::Vec3f(0.0f, 1.0f, 0.0f);
+            planes[1].Distance = 1.2f;
+
+            planes[2].Normal = cv::Vec3f(-1.0f, 0.0f, 0.0f);
+            planes[2].Distance = 1.5f;
+
+            return planes;
+        }
+
+        //
+        // Renders the distance along each pixel ray to the closest scene plane, in
+        // millimeters, and the index of that plane (-1 if none is in range).
+        //
+        void RenderScene(
+            _In_ const cv::Mat& cameraUnitPlane,
+            _Inout_ std::vector<DepthPlane>& planes,
+            _Out_ cv::Mat& depthImage,
+            _Out_ cv::Mat& planeIndices)
+        {
+            depthImage.create(
+                cameraUnitPlane.size(),
+                CV_16UC1);
+
+            planeIndices.create(
+                cameraUnitPlane.size(),
+                CV_32SC1);
+
+            for (auto& plane : planes)
+            {
+                plane.NumberOfPixels = 0;
+            }
+
+            for (int32_t y = 0; y < cameraUnitPlane.rows; ++y)
+            {
+                const cv::Vec2f* unitPlaneRow =
+                    cameraUnitPlane.ptr<cv::Vec2f>(y);
+
+                uint16_t* depthRow =
+                    depthImage.ptr<uint16_t>(y);
+
+                int32_t* planeIndexRow =
+                    planeIndices.ptr<int32_t>(y);
+
+                for (int32_t x = 0; x < cameraUnitPlane.cols; ++x)
+                {
+                    depthRow[x] = 0;
+                    planeIndexRow[x] = -1;
+
+                    const cv::Vec2f& xy = unitPlaneRow[x];
+
+                    if (!std::isfinite(xy[0]) || !std::isfinite(xy[1]))
+                    {
+                        continue;
+                    }
+
+                    const cv::Vec3f ray =
+                        cv::normalize(
+                            cv::Vec3f(-xy[0], -xy[1], -1.0f));
+
+                    float closestDistance = std::numeric_limits<float>::max();
+                    int32_t closestPlane = -1;
+
+                    for (int32_t i = 0; i < static_cast<int32_t>(planes.size()); ++i)
+                    {
+                        const float cosine =
+                            planes[i].Normal.dot(ray);
+
+                        if (cosine >= 0.0f)
+                        {
+                            continue;
+                        }
+
+                        const float distance =
+                            -planes[i].Distance / cosine;
+
+                        if (distance < closestDistance)
+                        {
+                            closestDistance = distance;
+                            closestPlane = i;
+                        }
+                    }
+
+                    if (closestPlane < 0 ||
+                        closestDistance < c_minimumDepthInMeters ||
+                        closestDistance > c_maximumDepthInMeters)
+                    {
+                        continue;
+                    }
+
+                    depthRow[x] =
+                        static_cast<uint16_t>(closestDistance * 1000.0f + 0.5f);
+
+                    planeIndexRow[x] = closestPlane;
+
+                    ++planes[closestPlane].NumberOfPixels;
+                }
+            }
+        }
+
+        float GetAngleInDegrees(
+            _In_ const cv::Vec3f& a,
+            _In_ const cv::Vec3f& b)
+        {
+            return std::acos(std::min(1.0f, std::max(-1.0f, a.dot(b)))) * c_radiansToDegrees;
+        }
+    }
+
+    DepthPlaneValidationResult ValidateDepthPlaneExtraction(
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const int32_t numberOfRepetitions)
+    {
+        REQUIRES(CV_32FC2 == cameraUnitPlane.type());
+        REQUIRES(numberOfRepetitions > 0);
+
+        std::vector<DepthPlane> scenePlanes =
+            CreateScenePlanes();
+
+        cv::Mat depthImage, planeIndices;
+
+        RenderScene(
+            cameraUnitPlane,
+            scenePlanes,
+            depthImage,
+            planeIndices);
+
+        const DepthPlaneExtractorSettings settings;
+
+        DepthNormalEstimator normalEstimator;
+        DepthPlaneExtractor planeExtractor(settings);
+
+        cv::Mat vertices, normals, labels;
+        std::vector<DepthPlane> planes;
+
+        DepthPlaneValidationResult result = {};
+
+        for (int32_t repetition = 0; repetition < numberOfRepetitions; ++repetition)
+        {
+            dbg::Timer timer;
+
+            BackprojectDepthImage(
+                depthImage,
+                cameraUnitPlane,
+                c_minimumDepthInMeters,
+                c_maximumDepthInMeters,
+                vertices);
+
+            result.BackprojectionMilliseconds += timer.GetMillisecondsFromLastEvent();
+            timer.MarkEvent();
+
+            normalEstimator.Compute(
+                vertices,
+                normals);
+
+            result.NormalEstimationMilliseconds += timer.GetMillisecondsFromLastEvent();
+            timer.MarkEvent();
+
+            planeExtractor.Extract(
+                vertices,
+                normals,
+                planes,
+                labels);
+
+            result.PlaneExtractionMilliseconds += timer.GetMillisecondsFromLastEvent();
+        }
+
+        result.BackprojectionMilliseconds /= numberOfRepetitions;
+        result.NormalEstimationMilliseconds /= numberOfRepetitions;
+        result.PlaneExtractionMilliseconds /= numberOfRepetitions;
+
+        //
+        // Normal accuracy over the pixels that the estimator returned a normal for.
+        //
+        double normalErrorSum = 0.0;
+        int32_t numberOfNormals = 0;
+
+        for (int32_t y = 0; y < normals.rows; ++y)
+        {
+            const cv::Vec3f* normalRow = normals.ptr<cv::Vec3f>(y);
+            const int32_t* planeIndexRow = planeIndices.ptr<int32_t>(y);
+
+            for (int32_t x = 0; x < normals.cols; ++x)
+            {
+                if (planeIndexRow[x] < 0 || !IsValidNormal(normalRow[x]))
+                {
+                    continue;
+                }
+
+                normalErrorSum +=
+                    GetAngleInDegrees(
+                        normalRow[x],
+                        scenePlanes[planeIndexRow[x]].Normal);
+
+                ++numberOfNormals;
+            }
+        }
+
+        result.MeanNormalErrorInDegrees =
+            numberOfNormals > 0
+                ? static_cast<float>(normalErrorSum / numberOfNormals)
+                : std::numeric_limits<float>::max();
+
+        //
+        // Every extracted plane must match a scene plane, and every scene plane large
+        // enough must have been extracted.
+        //
+        std::vector<bool> isScenePlaneFound(
+            scenePlanes.size(),
+            false);
+
+        for (const DepthPlane& plane : planes)
+        {
+            bool isMatched = false;
+
+            for (size_t i = 0; i < scenePlanes.size(); ++i)
+            {
+                const float normalError =
+                    GetAngleInDegrees(
+                        plane.Normal,
+                        scenePlanes[i].Normal);
+
+                const float distanceError =
+                    std::abs(plane.Distance - scenePlanes[i].Distance);
+
+                if (normalError <= c_maximumPlaneNormalErrorInDegrees &&
+                    distanceError <= c_maximumPlaneDistanceErrorInMeters)
+                {
+                    result.MaximumPlaneNormalErrorInDegrees =
+                        std::max(result.MaximumPlaneNormalErrorInDegrees, normalError);
+
+                    result.MaximumPlaneDistanceErrorInMeters =
+                        std::max(result.MaximumPlaneDistanceErrorInMeters, distanceError);
+
+                    isScenePlaneFound[i] = true;
+                    isMatched = true;
+
+                    break;
+                }
+            }
+
+            result.NumberOfSpuriousPlanes += isMatched ? 0 : 1;
+        }
+
+        for (size_t i = 0; i < scenePlanes.size(); ++i)
+        {
+            if (scenePlanes[i].NumberOfPixels < c_requiredPlaneSizeFactor * settings.MinimumNumberOfPixels)
+            {
+                continue;
+            }
+
+            ++result.NumberOfScenePlanes;
+            result.NumberOfScenePlanesFound += isScenePlaneFound[i] ? 1 : 0;
+        }
+
+        result.Passed =
+            result.NumberOfScenePlanesFound == result.NumberOfScenePlanes &&
+            0 == result.NumberOfSpuriousPlanes;
+
+        dbg::trace(
+            L"ValidateDepthPlaneExtraction: %s on %ix%i pixels, %i of %i planes found, %i spurious, plane errors up to %.02fdeg / %.04fm, mean normal error %.02fdeg, %.02f ms back-projection, %.02f ms normals, %.02f ms planes",
+            result.Passed ? L"passed" : L"FAILED",
+            cameraUnitPlane.cols,
+            cameraUnitPlane.rows,
+            result.NumberOfScenePlanesFound,
+            result.NumberOfScenePlanes,
+            result.NumberOfSpuriousPlanes,
+            result.MaximumPlaneNormalErrorInDegrees,
+            result.MaximumPlaneDistanceErrorInMeters,
+            result.MeanNormalErrorInDegrees,
+            result.BackprojectionMilliseconds,
+            result.NormalEstimationMilliseconds,
+            result.PlaneExtractionMilliseconds);
+
+        return result;
+    }
+}
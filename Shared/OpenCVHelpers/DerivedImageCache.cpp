@@ -0,0 +1,355 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const int32_t c_benchmarkSensorType = 0;
+
+        const double c_benchmarkMarkerThreshold = 128.0;
+
+        const double c_cannyThreshold1 = 50.0;
+        const double c_cannyThreshold2 = 200.0;
+    }
+
+    DerivedImageCache::DerivedImageCache(
+        _In_ const size_t memoryBudgetInBytes)
+        : _memoryBudgetInBytes(memoryBudgetInBytes)
+        , _statistics()
+    {
+    }
+
+    cv::Mat DerivedImageCache::GetOrCompute(
+        _In_ const DerivedImageKey& key,
+        _In_ const std::function<void(cv::Mat&)>& compute)
+    {
+        std::shared_ptr<std::promise<cv::Mat>> promise;
+        std::shared_future<cv::Mat> cachedImage;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto entryIterator =
+                _entries.find(key);
+
+            if (entryIterator != _entries.end())
+            {
+                Entry& entry =
+                    entryIterator->second;
+
+                if (entry.ready)
+                {
+                    _recentlyUsed.splice(
+                        _recentlyUsed.begin(),
+                        _recentlyUsed,
+                        entry.recentlyUsed);
+
+                    ++_statistics.numberOfHits;
+                }
+                else
+                {
+                    ++_statistics.numberOfSharedComputations;
+                }
+
+                cachedImage = entry.image;
+            }
+            else
+            {
+                promise =
+                    std::make_shared<std::promise<cv::Mat>>();
+
+                Entry entry;
+
+                entry.image = promise->get_future().share();
+                entry.ready = false;
+                entry.numberOfBytes = 0;
+                entry.recentlyUsed = _recentlyUsed.end();
+
+                _entries.emplace(
+                    key,
+                    entry);
+
+                ++_statistics.numberOfMisses;
+            }
+        }
+
+        //
+        // Waits outside of the lock if another thread is still computing the image.
+        //
+        if (cachedImage.valid())
+        {
+            return cachedImage.get();
+        }
+
+        cv::Mat image;
+
+        try
+        {
+            compute(
+                image);
+        }
+        catch (...)
+        {
+            promise->set_exception(
+                std::current_exception());
+
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _entries.erase(
+                key);
+
+            throw;
+        }
+
+        promise->set_value(
+            image);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            Entry& entry =
+                _entries.at(key);
+
+            entry.ready = true;
+            entry.numberOfBytes = image.total() * image.elemSize();
+
+            _recentlyUsed.push_front(
+                key);
+
+            entry.recentlyUsed = _recentlyUsed.begin();
+
+            _statistics.numberOfBytesCached += entry.numberOfBytes;
+
+            EvictLeastRecentlyUsed();
+        }
+
+        return image;
+    }
+
+    cv::Mat DerivedImageCache::GetGray(
+        _In_ const int64_t timestamp,
+        _In_ const int32_t sensorType,
+        _In_ const cv::Mat& image)
+    {
+        if (CV_8UC1 == image.type() || CV_16UC1 == image.type())
+        {
+            return image;
+        }
+
+        REQUIRES(CV_8UC4 == image.type());
+
+        const DerivedImageKey key = { timestamp, sensorType, DerivedImageType::Gray, 0 };
+
+        return GetOrCompute(
+            key,
+            [&image](cv::Mat& gray)
+        {
+            cv::cvtColor(
+                image,
+                gray,
+                cv::COLOR_BGRA2GRAY);
+        });
+    }
+
+    cv::Mat DerivedImageCache::GetPyramidLevel(
+        _In_ const int64_t timestamp,
+        _In_ const int32_t sensorType,
+        _In_ const cv::Mat& image,
+        _In_ const int32_t level)
+    {
+        REQUIRES(level >= 0);
+
+        if (0 == level)
+        {
+            return GetGray(
+                timestamp,
+                sensorType,
+                image);
+        }
+
+        const DerivedImageKey key = { timestamp, sensorType, DerivedImageType::PyramidLevel, level };
+
+        return GetOrCompute(
+            key,
+            [&](cv::Mat& pyramidLevel)
+        {
+            cv::pyrDown(
+                GetPyramidLevel(timestamp, sensorType, image, level - 1),
+                pyramidLevel);
+        });
+    }
+
+    cv::Mat DerivedImageCache::GetUndistorted(
+        _In_ const int64_t timestamp,
+        _In_ const int32_t sensorType,
+        _In_ const cv::Mat& image,
+        _In_ const int32_t mapsIdentifier,
+        _In_ const cv::Mat& map1,
+        _In_ const cv::Mat& map2)
+    {
+        const DerivedImageKey key = { timestamp, sensorType, DerivedImageType::Undistorted, mapsIdentifier };
+
+        return GetOrCompute(
+            key,
+            [&](cv::Mat& undistorted)
+        {
+            cv::remap(
+                image,
+                undistorted,
+                map1,
+                map2,
+                cv::INTER_LINEAR);
+        });
+    }
+
+    DerivedImageCacheStatistics DerivedImageCache::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        return _statistics;
+    }
+
+    void DerivedImageCache::EvictLeastRecentlyUsed()
+    {
+        //
+        // Images being computed are not in the list, and are never evicted.
+        //
+        while (_statistics.numberOfBytesCached > _memoryBudgetInBytes && !_recentlyUsed.empty())
+        {
+            auto entryIterator =
+                _entries.find(_recentlyUsed.back());
+
+            _statistics.numberOfBytesCached -= entryIterator->second.numberOfBytes;
+            ++_statistics.numberOfEvictions;
+
+            _entries.erase(
+                entryIterator);
+
+            _recentlyUsed.pop_back();
+        }
+    }
+
+    DerivedImageCacheBenchmarkResult BenchmarkDerivedImageCache(
+        _In_ const cv::Mat& image,
+        _In_ const int32_t numberOfFrames)
+    {
+        REQUIRES(CV_8UC4 == image.type());
+        REQUIRES(numberOfFrames > 0);
+
+        DerivedImageCacheBenchmarkResult result = {};
+
+        Io::TaskExecutor taskExecutor(3);
+
+        //
+        // Without the cache, every consumer derives its input from the frame itself.
+        //
+        {
+            dbg::Timer timer;
+
+            for (int32_t i = 0; i < numberOfFrames; ++i)
+            {
+                taskExecutor.Submit(Io::TaskLane::Compute, [&image]()
+                {
+                    cv::Mat gray, markerMask;
+
+                    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+                    cv::threshold(gray, markerMask, c_benchmarkMarkerThreshold, 255.0, cv::THRESH_BINARY);
+                });
+
+                taskExecutor.Submit(Io::TaskLane::Compute, [&image]()
+                {
+                    cv::Mat gray, level1, edges;
+
+                    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+                    cv::pyrDown(gray, level1);
+                    cv::Canny(level1, edges, c_cannyThreshold1, c_cannyThreshold2);
+                });
+
+                taskExecutor.Submit(Io::TaskLane::Compute, [&image]()
+                {
+                    cv::Mat gray, level1, level2;
+
+                    cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+                    cv::pyrDown(gray, level1);
+                    cv::pyrDown(level1, level2);
+                });
+
+                taskExecutor.WaitForIdle();
+            }
+
+            result.uncachedTimeInMilliseconds =
+                timer.GetMillisecondsFromStart();
+        }
+
+        {
+            DerivedImageCache cache;
+
+            dbg::Timer timer;
+
+            for (int32_t i = 0; i < numberOfFrames; ++i)
+            {
+                const int64_t timestamp = i;
+
+                taskExecutor.Submit(Io::TaskLane::Compute, [&, timestamp]()
+                {
+                    cv::Mat markerMask;
+
+                    cv::threshold(
+                        cache.GetGray(timestamp, c_benchmarkSensorType, image),
+                        markerMask,
+                        c_benchmarkMarkerThreshold,
+                        255.0,
+                        cv::THRESH_BINARY);
+                });
+
+                taskExecutor.Submit(Io::TaskLane::Compute, [&, timestamp]()
+                {
+                    cv::Mat edges;
+
+                    cv::Canny(
+                        cache.GetPyramidLevel(timestamp, c_benchmarkSensorType, image, 1),
+                        edges,
+                        c_cannyThreshold1,
+                        c_cannyThreshold2);
+                });
+
+                taskExecutor.Submit(Io::TaskLane::Compute, [&, timestamp]()
+                {
+                    cache.GetPyramidLevel(timestamp, c_benchmarkSensorType, image, 2);
+                });
+
+                taskExecutor.WaitForIdle();
+            }
+
+            result.cachedTimeInMilliseconds =
+                timer.GetMillisecondsFromStart();
+
+            result.statistics =
+                cache.GetStatistics();
+        }
+
+#if DBG_ENABLE_INFORMATIONAL_LOGGING
+        dbg::trace(
+            L"BenchmarkDerivedImageCache: %i frames, %.02fms per frame uncached, %.02fms per frame cached (%llu hits, %llu misses, %llu shared)",
+            numberOfFrames,
+            result.uncachedTimeInMilliseconds / numberOfFrames,
+            result.cachedTimeInMilliseconds / numberOfFrames,
+            result.statistics.numberOfHits,
+            result.statistics.numberOfMisses,
+            result.statistics.numberOfSharedComputations);
+#endif /* DBG_ENABLE_INFORMATIONAL_LOGGING */
+
+        return result;
+    }
+}
@@ -0,0 +1,643 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+namespace rmcv
+{
+    namespace
+    {
+        const int32_t c_medianBlurKernelSize = 3;
+
+        const double c_cannyThreshold1 = 50.0;
+        const double c_cannyThreshold2 = 200.0;
+
+        const uint8_t c_edgeThreshold = 64;
+
+        // Magenta, stored as B, G, R, A bytes
+        const uint32_t c_edgeColor = 0xFFFF00FF;
+
+        //
+        // Unique across pipelines, which may share a DerivedImageCache.
+        //
+        std::atomic<int32_t> s_nextMapsIdentifier(1);
+
+        const int32_t c_validationImageWidth = 1280;
+        const int32_t c_validationImageHeight = 720;
+        const double c_validationScale = 0.5;
+
+        //
+        // Per channel, in 8-bit levels. Real PV frames differ by about 0.4; scaling the
+        // principal point about the image origin instead of the pixel centers, or not
+        // undistorting, exceeds 2 on the synthetic frame.
+        //
+        const double c_maximumMeanAbsoluteDifference = 1.0;
+
+        const double c_minimumEdgePixelFraction = 0.01;
+
+        //
+        // A gradient background with a checkerboard and two discs, blurred by about a
+        // pixel, so that the edges are as sharp as the camera's.
+        //
+        cv::Mat CreateValidationImage()
+        {
+            cv::Mat image(
+                c_validationImageHeight,
+                c_validationImageWidth,
+                CV_8UC4);
+
+            for (int32_t y = 0; y < image.rows; ++y)
+            {
+                uint8_t* row = image.ptr<uint8_t>(y);
+
+                for (int32_t x = 0; x < image.cols; ++x)
+                {
+                    row[4 * x + 0] = static_cast<uint8_t>(x * 255 / image.cols);
+                    row[4 * x + 1] = static_cast<uint8_t>(y * 255 / image.rows);
+                    row[4 * x + 2] = 128;
+                    row[4 * x + 3] = 255;
+                }
+            }
+
+            for (int32_t i = 0; i < 6; ++i)
+            {
+                for (int32_t j = 0; j < 10; ++j)
+                {
+                    if (0 == (i + j) % 2)
+                    {
+                        cv::rectangle(
+                            image,
+                            cv::Rect(240 + j * 80, 120 + i * 80, 80, 80),
+                            cv::Scalar(30, 30, 30, 255),
+                            cv::FILLED);
+                    }
+                }
+            }
+
+            cv::circle(
+                image,
+                cv::Point(200, 600),
+                90 /* radius */,
+                cv::Scalar(250, 250, 250, 255),
+                cv::FILLED);
+
+            cv::circle(
+                image,
+                cv::Point(1100, 150),
+                70 /* radius */,
+                cv::Scalar(0, 0, 255, 255),
+                cv::FILLED);
+
+            cv::GaussianBlur(
+                image,
+                image,
+                cv::Size(),
+                1.0 /* sigmaX */);
+
+            return image;
+        }
+    }
+
+    void CreateUndistortAndScaleMaps(
+        _In_ const cv::Mat& cameraMatrix,
+        _In_ const cv::Mat& distCoeffs,
+        _In_ const cv::Size& imageSize,
+        _In_ const double scale,
+        _Out_ cv::Mat& map1,
+        _Out_ cv::Mat& map2)
+    {
+        REQUIRES(3 == cameraMatrix.rows && 3 == cameraMatrix.cols);
+        REQUIRES(scale > 0.0);
+
+        cv::Mat scaledCameraMatrix;
+
+        cameraMatrix.convertTo(
+            scaledCameraMatrix,
+            CV_64FC1);
+
+        //
+        // Pixel (0, 0) covers [0, 1) x [0, 1) on both images, so the principal point
+        // is scaled about the pixel centers rather than about the image origin.
+        //
+        scaledCameraMatrix.at<double>(0, 0) *= scale;
+        scaledCameraMatrix.at<double>(1, 1) *= scale;
+        scaledCameraMatrix.at<double>(0, 2) = (scaledCameraMatrix.at<double>(0, 2) + 0.5) * scale - 0.5;
+        scaledCameraMatrix.at<double>(1, 2) = (scaledCameraMatrix.at<double>(1, 2) + 0.5) * scale - 0.5;
+
+        const cv::Size scaledImageSize(
+            cvRound(imageSize.width * scale),
+            cvRound(imageSize.height * scale));
+
+        cv::initUndistortRectifyMap(
+            cameraMatrix,
+            distCoeffs,
+            cv::Mat_<double>::eye(3, 3) /* R */,
+            scaledCameraMatrix,
+            scaledImageSize,
+            CV_16SC2 /* type */,
+            map1,
+            map2);
+    }
+
+    void OverlayEdges(
+        _In_ const cv::Mat& edges,
+        _In_ const uint8_t threshold,
+        _In_ const uint32_t color,
+        _Inout_ cv::Mat& image)
+    {
+        REQUIRES(CV_8UC1 == edges.type());
+        REQUIRES(CV_8UC4 == image.type());
+        REQUIRES(edges.size() == image.size());
+
+        for (int32_t y = 0; y < image.rows; ++y)
+        {
+            const uint8_t* edgeRow = edges.ptr<uint8_t>(y);
+            uint32_t* imageRow = image.ptr<uint32_t>(y);
+
+            int32_t x = 0;
+
+#if CV_SIMD128
+            const cv::v_uint8x16 threshold16 = cv::v_setall_u8(threshold);
+            const cv::v_uint32x4 color4 = cv::v_setall_u32(color);
+
+            for (; x + 16 <= image.cols; x += 16)
+            {
+                //
+                // Widen the 0x00/0xFF byte mask to one 32-bit lane per pixel and select
+                // between the edge color and the original pixel.
+                //
+                const cv::v_uint8x16 mask8 =
+                    cv::v_load(edgeRow + x) > threshold16;
+
+                cv::v_uint16x8 mask16[2];
+
+                cv::v_expand(
+                    mask8,
+                    mask16[0],
+                    mask16[1]);
+
+                for (int32_t half = 0; half < 2; ++half)
+                {
+                    cv::v_uint32x4 mask32[2];
+
+                    cv::v_expand(
+                        mask16[half],
+                        mask32[0],
+                        mask32[1]);
+
+                    for (int32_t quarter = 0; quarter < 2; ++quarter)
+                    {
+                        uint32_t* pixels =
+                            imageRow + x + 8 * half + 4 * quarter;
+
+                        const cv::v_uint32x4 mask =
+                            mask32[quarter] != cv::v_setzero_u32();
+
+                        cv::v_store(
+                            pixels,
+                            (color4 & mask) | (cv::v_load(pixels) & ~mask));
+                    }
+                }
+            }
+#endif /* CV_SIMD128 */
+
+            for (; x < image.cols; ++x)
+            {
+                if (edgeRow[x] > threshold)
+                {
+                    imageRow[x] = color;
+                }
+            }
+        }
+    }
+
+    bool ValidateEdgeOverlayPipeline()
+    {
+        const cv::Mat image =
+            CreateValidationImage();
+
+        //
+        // PV camera intrinsics with a mild radial and tangential distortion.
+        //
+        cv::Mat cameraMatrix = cv::Mat::eye(3, 3, CV_64FC1);
+
+        cameraMatrix.at<double>(0, 0) = 1000.0;
+        cameraMatrix.at<double>(1, 1) = 1000.0;
+        cameraMatrix.at<double>(0, 2) = 639.5;
+        cameraMatrix.at<double>(1, 2) = 359.5;
+
+        cv::Mat distCoeffs(5, 1, CV_64FC1);
+
+        distCoeffs.at<double>(0, 0) = -0.02;
+        distCoeffs.at<double>(1, 0) = 0.03;
+        distCoeffs.at<double>(2, 0) = 0.0005;
+        distCoeffs.at<double>(3, 0) = -0.0005;
+        distCoeffs.at<double>(4, 0) = 0.0;
+
+        EdgeOverlayPipeline edgeOverlayPipeline(
+            c_validationScale);
+
+        edgeOverlayPipeline.SetCameraIntrinsics(
+            cameraMatrix,
+            distCoeffs,
+            image.size());
+
+        cv::Mat result;
+
+        edgeOverlayPipeline.Process(
+            image,
+            result);
+
+        //
+        // The reference undistorts at full resolution through float maps, resizes, and
+        // overlays the edges one pixel at a time.
+        //
+        cv::Mat referenceMap1, referenceMap2;
+
+        cv::initUndistortRectifyMap(
+            cameraMatrix,
+            distCoeffs,
+            cv::Mat_<double>::eye(3, 3) /* R */,
+            cameraMatrix,
+            image.size(),
+            CV_32FC1 /* type */,
+            referenceMap1,
+            referenceMap2);
+
+        cv::Mat referenceUndistortedImage, referenceScaledImage, referenceResult, referenceEdges;
+
+        cv::remap(
+            image,
+            referenceUndistortedImage,
+            referenceMap1,
+            referenceMap2,
+            cv::INTER_LINEAR);
+
+        cv::resize(
+            referenceUndistortedImage,
+            referenceScaledImage,
+            cv::Size(),
+            c_validationScale /* fx */,
+            c_validationScale /* fy */,
+            cv::INTER_AREA);
+
+        cv::medianBlur(
+            referenceScaledImage,
+            referenceResult,
+            c_medianBlurKernelSize);
+
+        cv::Canny(
+            referenceResult,
+            referenceEdges,
+            c_cannyThreshold1,
+            c_cannyThreshold2);
+
+        int32_t numberOfEdgePixels = 0;
+
+        for (int32_t y = 0; y < referenceResult.rows; ++y)
+        {
+            for (int32_t x = 0; x < referenceResult.cols; ++x)
+            {
+                if (referenceEdges.at<uint8_t>(y, x) > c_edgeThreshold)
+                {
+                    *(referenceResult.ptr<uint32_t>(y, x)) = c_edgeColor;
+
+                    ++numberOfEdgePixels;
+                }
+            }
+        }
+
+        const double meanAbsoluteDifference =
+            result.size() == referenceResult.size()
+                ? cv::norm(result, referenceResult, cv::NORM_L1) / (result.total() * result.channels())
+                : std::numeric_limits<double>::infinity();
+
+        const double edgePixelFraction =
+            static_cast<double>(numberOfEdgePixels) / referenceResult.total();
+
+        const bool passed =
+            meanAbsoluteDifference <= c_maximumMeanAbsoluteDifference &&
+            edgePixelFraction >= c_minimumEdgePixelFraction;
+
+        dbg::trace(
+            L"ValidateEdgeOverlayPipeline: %s, mean absolute difference %.02f (at most %.02f), %.01f%% edge pixels",
+            passed ? L"passed" : L"FAILED",
+            meanAbsoluteDifference,
+            c_maximumMeanAbsoluteDifference,
+            edgePixelFraction * 100.0);
+
+        return passed;
+    }
+
+    EdgeOverlayPipeline::EdgeOverlayPipeline(
+        _In_ const double scale)
+        : _scale(scale)
+        , _mapsIdentifier(0)
+        , _statistics()
+    {
+        REQUIRES(_scale > 0.0);
+    }
+
+    void EdgeOverlayPipeline::SetCameraIntrinsics(
+        _In_ const cv::Mat& cameraMatrix,
+        _In_ const cv::Mat& distCoeffs,
+        _In_ const cv::Size& imageSize)
+    {
+        CreateUndistortAndScaleMaps(
+            cameraMatrix,
+            distCoeffs,
+            imageSize,
+            _scale,
+            _map1,
+            _map2);
+
+        _imageSize = imageSize;
+        _mapsIdentifier = s_nextMapsIdentifier++;
+
+#if EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE
+        cv::initUndistortRectifyMap(
+            cameraMatrix,
+            distCoeffs,
+            cv::Mat_<double>::eye(3, 3) /* R */,
+            cameraMatrix,
+            imageSize,
+            CV_32FC1 /* type */,
+            _referenceMap1,
+            _referenceMap2);
+#endif /* EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE */
+    }
+
+    bool EdgeOverlayPipeline::HasCameraIntrinsics() const
+    {
+        return !_map1.empty();
+    }
+
+    void EdgeOverlayPipeline::Process(
+        _In_ const cv::Mat& image,
+        _Out_ cv::Mat& result)
+    {
+        REQUIRES(CV_8UC4 == image.type());
+
+        dbg::Timer timer;
+
+        _statistics = EdgeOverlayPipelineStatistics();
+
+        if (HasCameraIntrinsics())
+        {
+            REQUIRES(image.size() == _imageSize);
+
+            cv::remap(
+                image,
+                _scaledImage,
+                _map1,
+                _map2,
+                cv::INTER_LINEAR);
+        }
+        else
+        {
+            cv::resize(
+                image,
+                _scaledImage,
+                cv::Size(),
+                _scale /* fx */,
+                _scale /* fy */,
+                cv::INTER_AREA);
+        }
+
+        _statistics.RemapTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        cv::medianBlur(
+            _scaledImage,
+            result,
+            c_medianBlurKernelSize);
+
+        _statistics.BlurTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        DetectAndOverlayEdges(
+            image,
+            timer,
+            result);
+    }
+
+    void EdgeOverlayPipeline::Process(
+        _In_ const cv::Mat& image,
+        _In_ const int64_t timestamp,
+        _In_ const int32_t sensorType,
+        _Inout_ DerivedImageCache& derivedImageCache,
+        _Out_ cv::Mat& result)
+    {
+        REQUIRES(CV_8UC4 == image.type());
+
+        if (!HasCameraIntrinsics())
+        {
+            Process(
+                image,
+                result);
+
+            return;
+        }
+
+        REQUIRES(image.size() == _imageSize);
+
+        dbg::Timer timer;
+
+        _statistics = EdgeOverlayPipelineStatistics();
+
+        const cv::Mat undistortedImage =
+            derivedImageCache.GetUndistorted(
+                timestamp,
+                sensorType,
+                image,
+                _mapsIdentifier,
+                _map1,
+                _map2);
+
+        _statistics.RemapTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        const DerivedImageKey blurredImageKey = { timestamp, sensorType, DerivedImageType::MedianBlurred, _mapsIdentifier };
+
+        //
+        // Cached images must not be modified, so the edges are drawn onto a copy.
+        //
+        derivedImageCache.GetOrCompute(
+            blurredImageKey,
+            [&undistortedImage](cv::Mat& blurredImage)
+        {
+            cv::medianBlur(
+                undistortedImage,
+                blurredImage,
+                c_medianBlurKernelSize);
+        }).copyTo(result);
+
+        _statistics.BlurTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        DetectAndOverlayEdges(
+            image,
+            timer,
+            result);
+    }
+
+    void EdgeOverlayPipeline::DetectAndOverlayEdges(
+        _In_ const cv::Mat& image,
+        _Inout_ dbg::Timer& timer,
+        _Inout_ cv::Mat& result)
+    {
+        cv::Canny(
+            result,
+            _edges,
+            c_cannyThreshold1,
+            c_cannyThreshold2);
+
+        _statistics.EdgeDetectionTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        OverlayEdges(
+            _edges,
+            c_edgeThreshold,
+            c_edgeColor,
+            result);
+
+        _statistics.OverlayTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        _statistics.ElapsedTimeInMilliseconds =
+            timer.GetMillisecondsFromStart();
+
+#if DBG_ENABLE_VERBOSE_LOGGING
+        dbg::trace(
+            L"EdgeOverlayPipeline::Process: %.02fms (remap %.02fms, blur %.02fms, edges %.02fms, overlay %.02fms)",
+            _statistics.ElapsedTimeInMilliseconds,
+            _statistics.RemapTimeInMilliseconds,
+            _statistics.BlurTimeInMilliseconds,
+            _statistics.EdgeDetectionTimeInMilliseconds,
+            _statistics.OverlayTimeInMilliseconds);
+#endif /* DBG_ENABLE_VERBOSE_LOGGING */
+
+#if EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE
+        ProcessReference(
+            image,
+            result);
+#else
+        (void)image;
+#endif /* EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE */
+    }
+
+    const EdgeOverlayPipelineStatistics& EdgeOverlayPipeline::GetStatistics() const
+    {
+        return _statistics;
+    }
+
+#if EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE
+    void EdgeOverlayPipeline::ProcessReference(
+        _In_ const cv::Mat& image,
+        _In_ const cv::Mat& result)
+    {
+        dbg::Timer timer;
+
+        if (HasCameraIntrinsics())
+        {
+            cv::remap(
+                image,
+                _referenceUndistortedImage,
+                _referenceMap1,
+                _referenceMap2,
+                cv::INTER_LINEAR);
+
+            cv::resize(
+                _referenceUndistortedImage,
+                _referenceScaledImage,
+                cv::Size(),
+                _scale /* fx */,
+                _scale /* fy */,
+                cv::INTER_AREA);
+        }
+        else
+        {
+            cv::resize(
+                image,
+                _referenceScaledImage,
+                cv::Size(),
+                _scale /* fx */,
+                _scale /* fy */,
+                cv::INTER_AREA);
+        }
+
+        const double remapTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        cv::medianBlur(
+            _referenceScaledImage,
+            _referenceResult,
+            c_medianBlurKernelSize);
+
+        const double blurTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        cv::Canny(
+            _referenceResult,
+            _referenceEdges,
+            c_cannyThreshold1,
+            c_cannyThreshold2);
+
+        const double edgeDetectionTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        timer.MarkEvent();
+
+        for (int32_t y = 0; y < _referenceResult.rows; ++y)
+        {
+            for (int32_t x = 0; x < _referenceResult.cols; ++x)
+            {
+                if (_referenceEdges.at<uint8_t>(y, x) > c_edgeThreshold)
+                {
+                    *(_referenceResult.ptr<uint32_t>(y, x)) = c_edgeColor;
+                }
+            }
+        }
+
+        const double overlayTimeInMilliseconds =
+            timer.GetMillisecondsFromLastEvent();
+
+        const double meanAbsoluteDifference =
+            result.size() == _referenceResult.size()
+                ? cv::norm(result, _referenceResult, cv::NORM_L1) / (result.total() * result.channels())
+                : -1.0;
+
+        dbg::trace(
+            L"EdgeOverlayPipeline::ProcessReference: %.02fms (remap %.02fms, blur %.02fms, edges %.02fms, overlay %.02fms) vs. %.02fms, mean absolute difference %.02f",
+            timer.GetMillisecondsFromStart(),
+            remapTimeInMilliseconds,
+            blurTimeInMilliseconds,
+            edgeDetectionTimeInMilliseconds,
+            overlayTimeInMilliseconds,
+            _statistics.ElapsedTimeInMilliseconds,
+            meanAbsoluteDifference);
+    }
+#endif /* EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE */
+}
@@ -1,4 +1,4 @@
-//*********************************************************
+﻿//*********************************************************
 //
 // Copyright (c) Microsoft. All rights reserved.
 // This code is licensed under the MIT License (MIT).
@@ -13,3 +13,11 @@
 
 #include <OpenCVHelpers/OpenCVHelpers.h>
 #include <OpenCVHelpers/OpenCVTexture2D.h>
+#include <OpenCVHelpers/DepthImage.h>
+#include <OpenCVHelpers/DepthIcp.h>
+#include <OpenCVHelpers/DepthIcpValidation.h>
+#include <OpenCVHelpers/DepthNormalEstimator.h>
+#include <OpenCVHelpers/DepthPlaneExtractor.h>
+#include <OpenCVHelpers/DepthPlaneValidation.h>
+#include <OpenCVHelpers/DerivedImageCache.h>
+#include <OpenCVHelpers/EdgeOverlayPipeline.h>
@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    struct DepthIcpSettings
+    {
+        DepthIcpSettings();
+
+        float MinimumDepthInMeters;
+        float MaximumDepthInMeters;
+
+        //
+        // Normals are not estimated across depth jumps larger than this fraction of the
+        // depth between adjacent pixels of the finest pyramid level (see
+        // ComputeVertexNormals), so that object boundaries do not contribute point-to-plane
+        // constraints along made-up surfaces. Pixels are twice as far apart on every
+        // coarser level, and so is the jump allowed there.
+        //
+        float MaximumRelativeDepthJump;
+
+        //
+        // Number of Gauss-Newton iterations to run on each pyramid level, finest level
+        // first. The size of the vector determines the number of pyramid levels.
+        //
+        std::vector<int32_t> IterationsPerPyramidLevel;
+
+        float MaximumCorrespondenceDistanceInMeters;
+        float MinimumNormalDotProduct;
+        float HuberThresholdInMeters;
+        int32_t MinimumNumberOfCorrespondences;
+
+        //
+        // The current frame replaces the key frame once it moved this far away from it.
+        //
+        float KeyFrameTranslationInMeters;
+        float KeyFrameRotationInDegrees;
+    };
+
+    struct DepthIcpStatistics
+    {
+        bool Converged;
+        bool KeyFrameUpdated;
+
+        int32_t NumberOfCorrespondences;
+
+        //
+        // Point-to-plane RMS residual on the finest pyramid level against the key frame
+        // before (using the headset pose) and after refinement.
+        //
+        float InitialRmsResidualInMeters;
+        float FinalRmsResidualInMeters;
+
+        int32_t InitialNumberOfInliers;
+        int32_t FinalNumberOfInliers;
+
+        //
+        // The same residuals over a set of samples that does not depend on the pose:
+        // every pixel of the current frame with a valid normal, where pixels without a
+        // correspondence count as the maximum correspondence distance. Unlike the RMS
+        // residual over the inliers, this cannot improve by losing correspondences, so
+        // it decides whether the refined pose is accepted.
+        //
+        float InitialTruncatedRmsResidualInMeters;
+        float FinalTruncatedRmsResidualInMeters;
+
+        //
+        // Difference between the predicted and the refined camera pose.
+        //
+        float CorrectionTranslationInMeters;
+        float CorrectionRotationInDegrees;
+
+        double ElapsedTimeInMilliseconds;
+    };
+
+    //
+    // Refines the poses of successive depth frames with coarse-to-fine, point-to-plane
+    // ICP against a key frame. The relative motion reported by the headset tracker is
+    // used as the initial guess; corrections are carried over from one key frame to the
+    // next, so the refined trajectory stays consistent with the observed geometry rather
+    // than slowly drifting away from it.
+    //
+    // Camera-to-world transforms use the column vector convention (p' = T * p), see
+    // GetCameraToWorldTransform and GetFrameToOriginTransform to convert to and from the
+    // sensor frame poses written to the recording CSV files.
+    //
+    class DepthIcp
+    {
+    public:
+        DepthIcp(
+            _In_ const cv::Mat& cameraUnitPlane,
+            _In_ const DepthIcpSettings& settings);
+
+        void Reset();
+
+        bool Refine(
+            _In_ const cv::Mat& depthImage,
+            _In_ const cv::Matx44f& predictedCameraToWorld,
+            _Out_ cv::Matx44f& refinedCameraToWorld);
+
+        const DepthIcpStatistics& GetStatistics() const;
+
+    private:
+        //
+        // Camera unit plane map of a pyramid level together with its inverse, a regular
+        // grid over the unit plane holding the index of the closest pixel. The inverse is
+        // used for projective data association without calling into the camera model.
+        //
+        struct UnitPlaneLevel
+        {
+            cv::Mat CameraUnitPlane;
+            cv::Mat PixelLookup;
+
+            cv::Point2f LookupOrigin;
+            float LookupCellsPerUnit;
+        };
+
+        struct FrameLevel
+        {
+            cv::Mat Vertices;
+            cv::Mat Normals;
+        };
+
+        typedef std::vector<FrameLevel> FramePyramid;
+
+        //
+        // Point-to-plane normal equations for the 6-DOF twist (rotation, translation).
+        // Only the upper triangle of the symmetric 6x6 matrix is accumulated.
+        //
+        struct NormalEquations
+        {
+            NormalEquations();
+
+            void Add(
+                _In_ const NormalEquations& other);
+
+            double Hessian[21];
+            double Gradient[6];
+            double SquaredResidualSum;
+
+            int32_t NumberOfCorrespondences;
+
+            // Pixels of the current frame with a valid normal, correspondence or not
+            int32_t NumberOfSamples;
+        };
+
+        class NormalEquationsBody;
+
+        static void BuildPixelLookup(
+            _Inout_ UnitPlaneLevel& level);
+
+        void BuildFramePyramid(
+            _In_ const cv::Mat& depthImage,
+            _Inout_ FramePyramid& pyramid) const;
+
+        static bool ProjectToPixel(
+            _In_ const UnitPlaneLevel& level,
+            _In_ const cv::Vec3f& point,
+            _Out_ int32_t& pixelIndex);
+
+        void AccumulateRows(
+            _In_ const size_t levelIndex,
+            _In_ const cv::Matx44f& currentToKeyFrame,
+            _In_ const cv::Range& rows,
+            _Inout_ NormalEquations& equations) const;
+
+        void AccumulateNormalEquations(
+            _In_ const size_t levelIndex,
+            _In_ const cv::Matx44f& currentToKeyFrame,
+            _Out_ NormalEquations& equations) const;
+
+        void EvaluateFit(
+            _In_ const cv::Matx44f& currentToKeyFrame,
+            _Out_ float& rmsResidualInMeters,
+            _Out_ float& truncatedRmsResidualInMeters,
+            _Out_ int32_t& numberOfInliers) const;
+
+        DepthIcpSettings _settings;
+        DepthIcpStatistics _statistics;
+
+        std::vector<UnitPlaneLevel> _unitPlanePyramid;
+
+        FramePyramid _currentFrame;
+        FramePyramid _keyFrame;
+
+        bool _hasKeyFrame;
+        cv::Matx44f _keyFramePredictedCameraToWorld;
+        cv::Matx44f _keyFrameRefinedCameraToWorld;
+    };
+}
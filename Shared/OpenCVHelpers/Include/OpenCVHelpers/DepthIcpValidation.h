@@ -0,0 +1,55 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    struct DepthIcpDriftBenchmarkResult
+    {
+        //
+        // Whether the refined trajectory ended up closer to the ground truth than the
+        // headset's, both in translation and in rotation.
+        //
+        bool Passed;
+
+        int32_t NumberOfFrames;
+        int32_t NumberOfFramesRefined;
+        int32_t NumberOfKeyFrames;
+
+        //
+        // Difference from the ground truth camera pose at the last frame: of the
+        // headset's pose, of the refined pose, and of the pose refined without the
+        // depth discontinuity rejection of the normal estimation.
+        //
+        float HeadsetDriftInMeters;
+        float HeadsetDriftInDegrees;
+        float RefinedDriftInMeters;
+        float RefinedDriftInDegrees;
+        float RefinedWithoutDepthJumpRejectionDriftInMeters;
+        float RefinedWithoutDepthJumpRejectionDriftInDegrees;
+
+        double MeanMilliseconds;
+        double MaximumMilliseconds;
+    };
+
+    //
+    // Measures how much DepthIcp reduces the drift of a headset trajectory. A room with
+    // a few boxes in it is rendered into depth images through the given camera unit
+    // plane along a known camera path, quantized to millimeters like the recorded ones.
+    // DepthIcp refines the path from poses that drift away from it by a seeded random
+    // walk with a constant bias, so that every run sees the same frames and poses and
+    // its results can be compared from one change to the next.
+    //
+    DepthIcpDriftBenchmarkResult BenchmarkDepthIcpDrift(
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const int32_t numberOfFrames);
+}
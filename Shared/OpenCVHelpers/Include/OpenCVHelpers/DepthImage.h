@@ -0,0 +1,68 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    //
+    // Vertex and normal maps produced by the helpers below are CV_32FC3 images laid
+    // out like the depth image they were computed from. The camera looks down the
+    // negative Z axis, so valid vertices always have a negative Z coordinate; invalid
+    // vertices and normals are stored as all-zero vectors.
+    //
+    inline bool IsValidVertex(
+        _In_ const cv::Vec3f& vertex)
+    {
+        return vertex[2] < 0.0f;
+    }
+
+    inline bool IsValidNormal(
+        _In_ const cv::Vec3f& normal)
+    {
+        return normal[2] != 0.0f || normal[0] != 0.0f || normal[1] != 0.0f;
+    }
+
+    /// <summary>
+    /// Back-projects a 16bpp depth image, holding the distance along each pixel ray in
+    /// millimeters, into a vertex map in the camera coordinate system. The unit plane
+    /// map is a CV_32FC2 image with the camera unit plane coordinates of every pixel,
+    /// i.e. the contents of the '*_camera_space_projection.bin' recording files.
+    /// </summary>
+    void BackprojectDepthImage(
+        _In_ const cv::Mat& depthImage,
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const float minimumDepthInMeters,
+        _In_ const float maximumDepthInMeters,
+        _Inout_ cv::Mat& vertices);
+
+    /// <summary>
+    /// Estimates per-pixel normals using central differences over the vertex map. The
+    /// normals are oriented towards the camera. A neighbour whose depth differs from the
+    /// pixel's by more than maximumRelativeDepthJump times the pixel's depth lies across
+    /// an object boundary and is skipped: the difference along that axis is taken from
+    /// the pixel to the other neighbour instead, and pixels without a neighbour to use
+    /// along either axis get no normal.
+    /// </summary>
+    void ComputeVertexNormals(
+        _In_ const cv::Mat& vertices,
+        _In_ const float maximumRelativeDepthJump,
+        _Inout_ cv::Mat& normals);
+
+    /// <summary>
+    /// Halves the resolution of a vertex, normal or unit plane map by keeping every
+    /// other pixel in both directions. Unlike cv::resize, this never blends valid and
+    /// invalid samples.
+    /// </summary>
+    void SubsampleMap(
+        _In_ const cv::Mat& source,
+        _Inout_ cv::Mat& destination);
+}
@@ -0,0 +1,52 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    //
+    // Estimates normals of an organized point cloud (a vertex map, see DepthImage.h)
+    // from smoothed 3D gradients. The averages of the half windows left and right of,
+    // and above and below each pixel are read from integral images in constant time,
+    // so the cost per pixel does not depend on the window size. Windows straddling a
+    // depth discontinuity are rejected instead of blending foreground and background.
+    //
+    // The integral images are kept between calls, so that a single instance can process
+    // a stream of frames without reallocating.
+    //
+    class DepthNormalEstimator
+    {
+    public:
+        DepthNormalEstimator(
+            _In_ const int32_t windowRadius = 4,
+            _In_ const float maximumDepthChangeFactor = 0.02f);
+
+        void Compute(
+            _In_ const cv::Mat& vertices,
+            _Inout_ cv::Mat& normals);
+
+    private:
+        bool GetWindowAverage(
+            _In_ const int32_t left,
+            _In_ const int32_t top,
+            _In_ const int32_t right,
+            _In_ const int32_t bottom,
+            _Out_ cv::Vec3f& average) const;
+
+        const int32_t _windowRadius;
+        const float _maximumDepthChangeFactor;
+
+        cv::Mat _validVertices;
+        cv::Mat _vertexSums;
+        cv::Mat _validVertexCounts;
+    };
+}
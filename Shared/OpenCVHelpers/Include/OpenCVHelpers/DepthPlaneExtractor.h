@@ -0,0 +1,108 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    //
+    // Plane in the camera coordinate system: Normal.dot(p) + Distance == 0. The normal
+    // points towards the camera.
+    //
+    struct DepthPlane
+    {
+        cv::Vec3f Normal;
+        float Distance;
+
+        cv::Vec3f Centroid;
+        int32_t NumberOfPixels;
+    };
+
+    struct DepthPlaneExtractorSettings
+    {
+        DepthPlaneExtractorSettings();
+
+        int32_t MaximumNumberOfPlanes;
+        int32_t MinimumNumberOfPixels;
+
+        //
+        // Plane hypotheses are scored on a subsampled pixel grid to keep RANSAC cheap;
+        // the winning hypothesis is then grown over the full resolution image.
+        //
+        int32_t NumberOfHypotheses;
+        int32_t HypothesisSampleStep;
+
+        float InlierDistanceInMeters;
+        float MinimumNormalDotProduct;
+    };
+
+    //
+    // Extracts the dominant planes of a depth frame directly on the image layout. Every
+    // plane is found by RANSAC over oriented points (a vertex and its normal define a
+    // plane hypothesis, so a single sample suffices), with the hypotheses scored in
+    // parallel. The best hypothesis is then grown into a connected region, refit by
+    // least squares, and grown again with the refined plane.
+    //
+    // The label image assigns each pixel the index of its plane, or -1. Internal buffers
+    // are kept between calls to process a stream of frames without reallocating.
+    //
+    class DepthPlaneExtractor
+    {
+    public:
+        explicit DepthPlaneExtractor(
+            _In_ const DepthPlaneExtractorSettings& settings);
+
+        void Extract(
+            _In_ const cv::Mat& vertices,
+            _In_ const cv::Mat& normals,
+            _Inout_ std::vector<DepthPlane>& planes,
+            _Inout_ cv::Mat& labels);
+
+    private:
+        class HypothesisScoringBody;
+
+        bool IsInlier(
+            _In_ const cv::Vec3f& planeNormal,
+            _In_ const float planeDistance,
+            _In_ const cv::Vec3f& vertex,
+            _In_ const cv::Vec3f& normal) const;
+
+        int32_t ScoreHypothesis(
+            _In_ const cv::Vec3f* vertices,
+            _In_ const cv::Vec3f* normals,
+            _In_ const int32_t hypothesisPixel) const;
+
+        void GrowRegion(
+            _In_ const cv::Mat& vertices,
+            _In_ const cv::Mat& normals,
+            _In_ const int32_t seedPixel,
+            _In_ const cv::Vec3f& planeNormal,
+            _In_ const float planeDistance,
+            _In_ const int16_t label,
+            _Inout_ cv::Mat& labels);
+
+        static bool FitPlane(
+            _In_ const cv::Mat& vertices,
+            _In_ const std::vector<int32_t>& pixels,
+            _Out_ DepthPlane& plane);
+
+        DepthPlaneExtractorSettings _settings;
+
+        cv::RNG _random;
+
+        std::vector<int32_t> _candidatePixels;
+        std::vector<int32_t> _hypothesisPixels;
+        std::vector<int32_t> _hypothesisScores;
+
+        std::vector<int32_t> _region;
+        std::vector<int32_t> _pixelsToVisit;
+    };
+}
@@ -0,0 +1,56 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+namespace rmcv
+{
+    struct DepthPlaneValidationResult
+    {
+        bool Passed;
+
+        //
+        // Planes of the synthetic scene that cover enough pixels to be extracted, and
+        // how many of them were, without any extracted plane that is not in the scene.
+        //
+        int32_t NumberOfScenePlanes;
+        int32_t NumberOfScenePlanesFound;
+        int32_t NumberOfSpuriousPlanes;
+
+        //
+        // Errors of the extracted planes against the scene planes they match, and of
+        // the estimated normals against those of the planes the pixels see.
+        //
+        float MaximumPlaneNormalErrorInDegrees;
+        float MaximumPlaneDistanceErrorInMeters;
+        float MeanNormalErrorInDegrees;
+
+        //
+        // Average time per frame of the back-projection, normal estimation and plane
+        // extraction.
+        //
+        double BackprojectionMilliseconds;
+        double NormalEstimationMilliseconds;
+        double PlaneExtractionMilliseconds;
+    };
+
+    //
+    // Checks DepthNormalEstimator and DepthPlaneExtractor against a synthetic scene of
+    // known planes (a floor, a back wall and a side wall) rendered into a depth image
+    // through the given camera unit plane, so that the check and its timings use the
+    // resolution and lens of a real depth camera, e.g. the long or short throw one.
+    // The depth image is quantized to millimeters like the recorded ones. The whole
+    // pipeline runs numberOfRepetitions times to measure its latency.
+    //
+    DepthPlaneValidationResult ValidateDepthPlaneExtraction(
+        _In_ const cv::Mat& cameraUnitPlane,
+        _In_ const int32_t numberOfRepetitions);
+}
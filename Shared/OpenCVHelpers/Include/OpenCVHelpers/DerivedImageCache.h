@@ -0,0 +1,164 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <list>
+#include <tuple>
+
+namespace rmcv
+{
+    enum class DerivedImageType : int32_t
+    {
+        // Single channel 8-bit version of the frame
+        Gray,
+
+        // Level n of the gaussian pyramid of the gray image, level 0 being the image
+        PyramidLevel,
+
+        // The frame remapped through a set of undistortion tables
+        Undistorted,
+
+        // The undistorted frame, median blurred
+        MedianBlurred
+    };
+
+    struct DerivedImageKey
+    {
+        // Frame timestamp, in the units of HoloLensForCV::SensorFrame::Timestamp
+        int64_t timestamp;
+
+        // HoloLensForCV::SensorType of the frame
+        int32_t sensorType;
+
+        DerivedImageType type;
+
+        // Pyramid level, or identifier of the undistortion tables of an undistorted or
+        // median blurred image
+        int32_t parameter;
+
+        bool operator<(
+            _In_ const DerivedImageKey& other) const
+        {
+            return
+                std::tie(timestamp, sensorType, type, parameter) <
+                std::tie(other.timestamp, other.sensorType, other.type, other.parameter);
+        }
+    };
+
+    struct DerivedImageCacheStatistics
+    {
+        uint64_t numberOfHits;
+        uint64_t numberOfMisses;
+
+        // Requests that waited for another thread computing the same image
+        uint64_t numberOfSharedComputations;
+
+        uint64_t numberOfEvictions;
+
+        uint64_t numberOfBytesCached;
+    };
+
+    //
+    // Images derived from sensor frames, shared by all consumers of the frames. Each
+    // image is computed on first request; concurrent requests for an image that is
+    // being computed wait for it instead of computing it again. Once the images exceed
+    // the memory budget, the least recently used ones are dropped.
+    //
+    // Images are returned as cv::Mat headers sharing the cached pixels, so they stay
+    // valid after being evicted, and must not be modified. Thread-safe.
+    //
+    class DerivedImageCache
+    {
+    public:
+        DerivedImageCache(
+            _In_ const size_t memoryBudgetInBytes = 64 * 1024 * 1024);
+
+        //
+        // Returns the cached image, or computes it by calling compute.
+        //
+        cv::Mat GetOrCompute(
+            _In_ const DerivedImageKey& key,
+            _In_ const std::function<void(cv::Mat&)>& compute);
+
+        //
+        // Gray8 and Gray16 images are returned as is, BGRA images are converted.
+        //
+        cv::Mat GetGray(
+            _In_ const int64_t timestamp,
+            _In_ const int32_t sensorType,
+            _In_ const cv::Mat& image);
+
+        //
+        // Builds the missing levels on top of the highest cached one.
+        //
+        cv::Mat GetPyramidLevel(
+            _In_ const int64_t timestamp,
+            _In_ const int32_t sensorType,
+            _In_ const cv::Mat& image,
+            _In_ const int32_t level);
+
+        //
+        // The maps identifier must change whenever map1 and map2 do, see
+        // CreateUndistortAndScaleMaps.
+        //
+        cv::Mat GetUndistorted(
+            _In_ const int64_t timestamp,
+            _In_ const int32_t sensorType,
+            _In_ const cv::Mat& image,
+            _In_ const int32_t mapsIdentifier,
+            _In_ const cv::Mat& map1,
+            _In_ const cv::Mat& map2);
+
+        DerivedImageCacheStatistics GetStatistics() const;
+
+    private:
+        struct Entry
+        {
+            std::shared_future<cv::Mat> image;
+            bool ready;
+            size_t numberOfBytes;
+            std::list<DerivedImageKey>::iterator recentlyUsed;
+        };
+
+        void EvictLeastRecentlyUsed();
+
+        const size_t _memoryBudgetInBytes;
+
+        mutable std::mutex _mutex;
+        std::map<DerivedImageKey, Entry> _entries;
+
+        // Ready entries, most recently used first
+        std::list<DerivedImageKey> _recentlyUsed;
+
+        DerivedImageCacheStatistics _statistics;
+    };
+
+    struct DerivedImageCacheBenchmarkResult
+    {
+        double uncachedTimeInMilliseconds;
+        double cachedTimeInMilliseconds;
+
+        DerivedImageCacheStatistics statistics;
+    };
+
+    //
+    // Runs three consumers on the same BGRA frames concurrently, first each computing
+    // its own images and then sharing them through a DerivedImageCache: a marker
+    // detector thresholding the gray image, an edge detector working on the second
+    // pyramid level and a preview downsampling to the third one.
+    //
+    DerivedImageCacheBenchmarkResult BenchmarkDerivedImageCache(
+        _In_ const cv::Mat& image,
+        _In_ const int32_t numberOfFrames);
+}
@@ -0,0 +1,143 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+//
+// When enabled, every frame is also run through the original full resolution sequence
+// (float map remap, area resize, blur, edge detection, per-pixel overlay) and both
+// timing breakdowns are traced together with the difference between the results.
+//
+#define EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE 0
+
+namespace rmcv
+{
+    //
+    // Creates fixed point (CV_16SC2 + CV_16UC1) remap tables that undistort an image of
+    // the given size and resample it by the given scale in a single pass. The camera
+    // matrix of the output is the input camera matrix scaled about the pixel centers,
+    // which matches undistorting at full resolution and resizing afterwards.
+    //
+    void CreateUndistortAndScaleMaps(
+        _In_ const cv::Mat& cameraMatrix,
+        _In_ const cv::Mat& distCoeffs,
+        _In_ const cv::Size& imageSize,
+        _In_ const double scale,
+        _Out_ cv::Mat& map1,
+        _Out_ cv::Mat& map2);
+
+    //
+    // Replaces the BGRA pixels of the image whose edge response exceeds the threshold
+    // with the given color, 16 pixels at a time.
+    //
+    void OverlayEdges(
+        _In_ const cv::Mat& edges,
+        _In_ const uint8_t threshold,
+        _In_ const uint32_t color,
+        _Inout_ cv::Mat& image);
+
+    //
+    // Checks EdgeOverlayPipeline against the original full resolution sequence on a
+    // synthetic 1280x720 frame, softened like a lens does, undistorted with synthetic
+    // PV camera intrinsics. Traces the mean absolute difference between the results and
+    // returns true if it is within the tolerance and edges were found.
+    //
+    bool ValidateEdgeOverlayPipeline();
+
+    struct EdgeOverlayPipelineStatistics
+    {
+        double RemapTimeInMilliseconds;
+        double BlurTimeInMilliseconds;
+        double EdgeDetectionTimeInMilliseconds;
+        double OverlayTimeInMilliseconds;
+
+        double ElapsedTimeInMilliseconds;
+    };
+
+    //
+    // Undistorts and downscales BGRA camera frames, then highlights their edges. The
+    // remap tables are created once per set of camera intrinsics; all intermediate
+    // images are kept between frames, so that steady state processing does not allocate.
+    //
+    class EdgeOverlayPipeline
+    {
+    public:
+        EdgeOverlayPipeline(
+            _In_ const double scale = 0.5);
+
+        void SetCameraIntrinsics(
+            _In_ const cv::Mat& cameraMatrix,
+            _In_ const cv::Mat& distCoeffs,
+            _In_ const cv::Size& imageSize);
+
+        bool HasCameraIntrinsics() const;
+
+        //
+        // Frames are only resized when no camera intrinsics have been set.
+        //
+        void Process(
+            _In_ const cv::Mat& image,
+            _Out_ cv::Mat& result);
+
+        //
+        // Takes the undistorted and the median blurred frame from the cache, where other
+        // consumers of the frame, identified by its timestamp and sensor type, share
+        // them. Falls back to the uncached Process until camera intrinsics are set.
+        //
+        void Process(
+            _In_ const cv::Mat& image,
+            _In_ const int64_t timestamp,
+            _In_ const int32_t sensorType,
+            _Inout_ DerivedImageCache& derivedImageCache,
+            _Out_ cv::Mat& result);
+
+        const EdgeOverlayPipelineStatistics& GetStatistics() const;
+
+    private:
+        //
+        // Detects the edges of the blurred frame in result and draws them onto it.
+        //
+        void DetectAndOverlayEdges(
+            _In_ const cv::Mat& image,
+            _Inout_ dbg::Timer& timer,
+            _Inout_ cv::Mat& result);
+
+#if EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE
+        void ProcessReference(
+            _In_ const cv::Mat& image,
+            _In_ const cv::Mat& result);
+#endif /* EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE */
+
+        const double _scale;
+
+        cv::Size _imageSize;
+        cv::Mat _map1;
+        cv::Mat _map2;
+
+        // Identifies the remap tables in a DerivedImageCache
+        int32_t _mapsIdentifier;
+
+        cv::Mat _scaledImage;
+        cv::Mat _edges;
+
+        EdgeOverlayPipelineStatistics _statistics;
+
+#if EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE
+        cv::Mat _referenceMap1;
+        cv::Mat _referenceMap2;
+
+        cv::Mat _referenceUndistortedImage;
+        cv::Mat _referenceScaledImage;
+        cv::Mat _referenceResult;
+        cv::Mat _referenceEdges;
+#endif /* EDGE_OVERLAY_PIPELINE_COMPARE_WITH_REFERENCE */
+    };
+}
@@ -13,10 +13,26 @@
 
 namespace rmcv
 {
+    /// <summary>
+    /// NV12 frames are wrapped as a single channel image of 3/2 the frame height, the
+    /// luma plane on top of the chroma plane, as cv::COLOR_YUV2BGR_NV12 expects. If the
+    /// chroma plane does not directly follow the luma plane, the planes are copied into
+    /// such an image instead.
+    /// </summary>
     void WrapHoloLensSensorFrameWithCvMat(
         _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
         _Out_ cv::Mat& openCVImage);
 
+    /// <summary>
+    /// Wraps the planes of an NV12 frame, as laid out by their plane descriptions: the
+    /// luma plane as a CV_8UC1 image, and the chroma plane as a CV_8UC2 image of half
+    /// the width and height with the interleaved U and V samples.
+    /// </summary>
+    void WrapHoloLensNv12SensorFrameWithCvMats(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
+        _Out_ cv::Mat& lumaImage,
+        _Out_ cv::Mat& chromaImage);
+
     /// <summary>
     /// Wraps a HoloLens Visible Light Camera frame with a cv::Mat. The VLC images
     /// are 8bpp grayscale, but we deliver them through Media APIs as 32bpp BGRA
@@ -26,4 +42,30 @@ namespace rmcv
     void WrapHoloLensVisibleLightCameraFrameWithCvMat(
         _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
         _Out_ cv::Mat& wrappedImage);
+
+    /// <summary>
+    /// Creates a CV_32FC2 map with the camera unit plane coordinates of every pixel of
+    /// the sensor frame, the same data the recorder saves to the
+    /// '*_camera_space_projection.bin' files. Pixels that cannot be mapped to the unit
+    /// plane are set to infinity.
+    /// </summary>
+    void CreateCameraUnitPlaneMap(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
+        _Out_ cv::Mat& cameraUnitPlane);
+
+    /// <summary>
+    /// Returns the camera-to-world transform of the sensor frame in the column vector
+    /// convention used by OpenCV, composed from the FrameToOrigin and CameraViewTransform
+    /// poses that are also written to the recording CSV files.
+    /// </summary>
+    cv::Matx44f GetCameraToWorldTransform(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame);
+
+    /// <summary>
+    /// Inverse of GetCameraToWorldTransform: computes the FrameToOrigin pose that, combined
+    /// with the given camera view transform, yields the camera-to-world transform.
+    /// </summary>
+    Windows::Foundation::Numerics::float4x4 GetFrameToOriginTransform(
+        _In_ const cv::Matx44f& cameraToWorld,
+        _In_ const Windows::Foundation::Numerics::float4x4& cameraViewTransform);
 }
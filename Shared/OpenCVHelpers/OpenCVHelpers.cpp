@@ -47,6 +47,53 @@ namespace rmcv
             wrappedImageType = CV_8UC1;
             break;
 
+        case Windows::Graphics::Imaging::BitmapPixelFormat::Nv12:
+        {
+            const Windows::Graphics::Imaging::BitmapPlaneDescription lumaPlane =
+                bitmapBuffer->GetPlaneDescription(0);
+
+            const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+                bitmapBuffer->GetPlaneDescription(1);
+
+            //
+            // Media Foundation usually lays out the chroma plane right below the luma
+            // plane, with the same stride, which can be wrapped as a single image.
+            //
+            if (chromaPlane.StartIndex == lumaPlane.StartIndex + lumaPlane.Stride * bitmap->PixelHeight &&
+                chromaPlane.Stride == lumaPlane.Stride)
+            {
+                wrappedImage = cv::Mat(
+                    bitmap->PixelHeight + bitmap->PixelHeight / 2,
+                    bitmap->PixelWidth,
+                    CV_8UC1,
+                    pixelBufferData + lumaPlane.StartIndex,
+                    lumaPlane.Stride);
+
+                return;
+            }
+
+            cv::Mat lumaImage;
+            cv::Mat chromaImage;
+
+            WrapHoloLensNv12SensorFrameWithCvMats(
+                holoLensSensorFrame,
+                lumaImage,
+                chromaImage);
+
+            wrappedImage.create(
+                bitmap->PixelHeight + bitmap->PixelHeight / 2,
+                bitmap->PixelWidth,
+                CV_8UC1);
+
+            lumaImage.copyTo(
+                wrappedImage.rowRange(0, bitmap->PixelHeight));
+
+            chromaImage.reshape(1 /* cn */).copyTo(
+                wrappedImage.rowRange(bitmap->PixelHeight, wrappedImage.rows));
+
+            return;
+        }
+
         default:
             dbg::trace(
                 L"WrapHoloLensSensorFrameWithCvMat: unrecognized bitmap pixel format, falling back to CV_8UC1");
@@ -62,6 +109,48 @@ namespace rmcv
             pixelBufferData);
     }
 
+    void WrapHoloLensNv12SensorFrameWithCvMats(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
+        _Out_ cv::Mat& lumaImage,
+        _Out_ cv::Mat& chromaImage)
+    {
+        Windows::Graphics::Imaging::SoftwareBitmap^ bitmap =
+            holoLensSensorFrame->SoftwareBitmap;
+
+        REQUIRES(Windows::Graphics::Imaging::BitmapPixelFormat::Nv12 == bitmap->BitmapPixelFormat);
+
+        Windows::Graphics::Imaging::BitmapBuffer^ bitmapBuffer =
+            bitmap->LockBuffer(
+                Windows::Graphics::Imaging::BitmapBufferAccessMode::Read);
+
+        uint32_t pixelBufferDataLength = 0;
+
+        uint8_t* pixelBufferData =
+            Io::GetTypedPointerToMemoryBuffer<uint8_t>(
+                bitmapBuffer->CreateReference(),
+                pixelBufferDataLength);
+
+        const Windows::Graphics::Imaging::BitmapPlaneDescription lumaPlane =
+            bitmapBuffer->GetPlaneDescription(0);
+
+        const Windows::Graphics::Imaging::BitmapPlaneDescription chromaPlane =
+            bitmapBuffer->GetPlaneDescription(1);
+
+        lumaImage = cv::Mat(
+            bitmap->PixelHeight,
+            bitmap->PixelWidth,
+            CV_8UC1,
+            pixelBufferData + lumaPlane.StartIndex,
+            lumaPlane.Stride);
+
+        chromaImage = cv::Mat(
+            bitmap->PixelHeight / 2,
+            bitmap->PixelWidth / 2,
+            CV_8UC2,
+            pixelBufferData + chromaPlane.StartIndex,
+            chromaPlane.Stride);
+    }
+
     void WrapHoloLensVisibleLightCameraFrameWithCvMat(
         _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
         _Out_ cv::Mat& wrappedImage)
@@ -86,4 +175,70 @@ namespace rmcv
             CV_8UC1,
             pixelBufferData);
     }
+
+    void CreateCameraUnitPlaneMap(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame,
+        _Out_ cv::Mat& cameraUnitPlane)
+    {
+        HoloLensForCV::CameraIntrinsics^ cameraIntrinsics =
+            holoLensSensorFrame->SensorStreamingCameraIntrinsics;
+
+        REQUIRES(nullptr != cameraIntrinsics);
+
+        cameraUnitPlane.create(
+            cameraIntrinsics->ImageHeight,
+            cameraIntrinsics->ImageWidth,
+            CV_32FC2);
+
+        for (int32_t y = 0; y < cameraUnitPlane.rows; ++y)
+        {
+            cv::Vec2f* cameraUnitPlaneRow =
+                cameraUnitPlane.ptr<cv::Vec2f>(y);
+
+            for (int32_t x = 0; x < cameraUnitPlane.cols; ++x)
+            {
+                Windows::Foundation::Point uv = { float(x), float(y) }, xy;
+
+                //
+                // On failure, the camera intrinsics report an infinite unit plane point.
+                //
+                cameraIntrinsics->MapImagePointToCameraUnitPlane(uv, &xy);
+
+                cameraUnitPlaneRow[x] = cv::Vec2f(xy.X, xy.Y);
+            }
+        }
+    }
+
+    cv::Matx44f GetCameraToWorldTransform(
+        _In_ HoloLensForCV::SensorFrame^ holoLensSensorFrame)
+    {
+        Windows::Foundation::Numerics::float4x4 cameraToFrame;
+
+        REQUIRES(Windows::Foundation::Numerics::invert(holoLensSensorFrame->CameraViewTransform, &cameraToFrame));
+
+        //
+        // The Windows numerics types use the row vector convention, hence the transpose.
+        //
+        const Windows::Foundation::Numerics::float4x4 cameraToOrigin =
+            cameraToFrame * holoLensSensorFrame->FrameToOrigin;
+
+        return cv::Matx44f(
+            cameraToOrigin.m11, cameraToOrigin.m21, cameraToOrigin.m31, cameraToOrigin.m41,
+            cameraToOrigin.m12, cameraToOrigin.m22, cameraToOrigin.m32, cameraToOrigin.m42,
+            cameraToOrigin.m13, cameraToOrigin.m23, cameraToOrigin.m33, cameraToOrigin.m43,
+            cameraToOrigin.m14, cameraToOrigin.m24, cameraToOrigin.m34, cameraToOrigin.m44);
+    }
+
+    Windows::Foundation::Numerics::float4x4 GetFrameToOriginTransform(
+        _In_ const cv::Matx44f& cameraToWorld,
+        _In_ const Windows::Foundation::Numerics::float4x4& cameraViewTransform)
+    {
+        const Windows::Foundation::Numerics::float4x4 cameraToOrigin(
+            cameraToWorld(0, 0), cameraToWorld(1, 0), cameraToWorld(2, 0), cameraToWorld(3, 0),
+            cameraToWorld(0, 1), cameraToWorld(1, 1), cameraToWorld(2, 1), cameraToWorld(3, 1),
+            cameraToWorld(0, 2), cameraToWorld(1, 2), cameraToWorld(2, 2), cameraToWorld(3, 2),
+            cameraToWorld(0, 3), cameraToWorld(1, 3), cameraToWorld(2, 3), cameraToWorld(3, 3));
+
+        return cameraViewTransform * cameraToOrigin;
+    }
 }
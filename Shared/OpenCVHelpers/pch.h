@@ -14,10 +14,16 @@
 #include "targetver.h"
 
 #include <map>
+#include <atomic>
 #include <array>
 #include <memory>
 #include <mutex>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <limits>
 #include <cstddef>
+#include <algorithm>
 #include <stdexcept>
 #include <shared_mutex>
 #include <unordered_set>
@@ -44,13 +50,28 @@
 #include <collection.h>
 #include <ppltasks.h>
 #include <memorybuffer.h>
+#include <WindowsNumerics.h>
 
 #include <windows.graphics.directx.direct3d11.interop.h>
 
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#define DBG_ENABLE_ERROR_LOGGING 1
+#define DBG_ENABLE_INFORMATIONAL_LOGGING 1
+#define DBG_ENABLE_VERBOSE_LOGGING 0
+
 #include <Debugging/All.h>
 #include <Io/All.h>
 #include <Graphics/All.h>
 #include <Rendering/All.h>
 #include <OpenCVHelpers/OpenCVHelpers.h>
+#include <OpenCVHelpers/DepthImage.h>
+#include <OpenCVHelpers/DepthIcp.h>
+#include <OpenCVHelpers/DepthIcpValidation.h>
+#include <OpenCVHelpers/DepthNormalEstimator.h>
+#include <OpenCVHelpers/DepthPlaneExtractor.h>
+#include <OpenCVHelpers/DepthPlaneValidation.h>
+#include <OpenCVHelpers/DerivedImageCache.h>
+#include <OpenCVHelpers/EdgeOverlayPipeline.h>
@@ -14,6 +14,15 @@
 
 //#define RECORDER_USE_SPEECH
 
+// Keeps the last minute of all sensors in memory once started, and saves it to a recording on air tap or 'save', see HoloLensForCV::SensorFrameRecorder.
+//#define RECORDER_USE_FLIGHT_RECORDER
+
+// Runs the synthetic sensor frame benchmark at startup instead of waiting for a recording, see HoloLensForCV::SensorFrameBenchmark.
+//#define RECORDER_RUN_SENSOR_FRAME_BENCHMARK
+
+// Runs the checks of the sensor frame buffering and recording against synthetic frames at startup, see HoloLensForCV::SensorFrameValidation.
+//#define RECORDER_RUN_SENSOR_FRAME_VALIDATION
+
 // By default all sensors are enabled. To only enable individual sensors, simply add types from HoloLensForCV::SensorType.
 std::vector<HoloLensForCV::SensorType> kEnabledSensorTypes = {};
 
@@ -36,6 +45,24 @@ namespace Recorder
     , _researchModeMediaFrameSourceGroupStarted(false)
     , _sensorFrameRecorderStarted(false)
   {
+#ifdef RECORDER_RUN_SENSOR_FRAME_BENCHMARK
+    // Results are written to sensor_frame_benchmark.csv in the app's local folder.
+    concurrency::create_task([]()
+    {
+      HoloLensForCV::SensorFrameBenchmark::Run(
+        Windows::Storage::ApplicationData::Current->LocalFolder,
+        300 /* numberOfFramesPerSensor */);
+    });
+#endif
+
+#ifdef RECORDER_RUN_SENSOR_FRAME_VALIDATION
+    // The recordings of the checks are written to the app's local folder.
+    concurrency::create_task([]()
+    {
+      HoloLensForCV::SensorFrameValidation::Run(
+        Windows::Storage::ApplicationData::Current->LocalFolder);
+    });
+#endif
   }
 
   void AppMain::OnHolographicSpaceChanged(
@@ -43,10 +70,17 @@ namespace Recorder
   {
     StartHoloLensMediaFrameSourceGroup();
 
-#ifdef RECORDER_USE_SPEECH
+#if defined(RECORDER_USE_SPEECH) && defined(RECORDER_USE_FLIGHT_RECORDER)
+    StartRecognizeSpeechCommands();
+    Platform::StringReference startSentence =
+      L"Say 'start' to begin, and 'save' to keep the last minute";
+#elif defined(RECORDER_USE_SPEECH)
     StartRecognizeSpeechCommands();
     Platform::StringReference startSentence =
       L"Say 'start' to begin, and 'stop' to end recording";
+#elif defined(RECORDER_USE_FLIGHT_RECORDER)
+    Platform::StringReference startSentence =
+      L"Air tap to begin, and air tap again to keep the last minute";
 #else
     Platform::StringReference startSentence =
       L"Air tap to begin and end recording";
@@ -58,9 +92,15 @@ namespace Recorder
     _In_ Windows::UI::Input::Spatial::SpatialInteractionSourceState^ pointerState)
   {
 #ifndef RECORDER_USE_SPEECH
+#ifdef RECORDER_USE_FLIGHT_RECORDER
+    if (_sensorFrameRecorderStarted) {
+      concurrency::create_async([&]() { SaveFlightRecording(); });
+    }
+#else
     if (_sensorFrameRecorderStarted) {
       concurrency::create_async([&]() { StopRecording(); });
     }
+#endif // RECORDER_USE_FLIGHT_RECORDER
     else
     {
       concurrency::create_async([&]() { StartRecording(); });
@@ -146,6 +186,24 @@ namespace Recorder
     SaySentence(Platform::StringReference(L"Finished recording"));
   }
 
+  void AppMain::SaveFlightRecording()
+  {
+    std::unique_lock<std::mutex> lock(_startStopRecordingMutex);
+
+    if (!_sensorFrameRecorderStarted || 0 == _sensorFrameRecorder->FlightRecorderDurationInSeconds)
+    {
+      return;
+    }
+
+    SaySentence(Platform::StringReference(L"Saving the last minute"));
+
+    concurrency::create_task(
+      _sensorFrameRecorder->PersistFlightRecordingAsync()).then([this]()
+    {
+      SaySentence(Platform::StringReference(L"Saved"));
+    });
+  }
+
   concurrency::task<void> AppMain::StopCurrentRecognizerIfExists()
   {
     if (_speechRecognizer != nullptr)
@@ -207,6 +265,7 @@ namespace Recorder
 
       speechCommandList->Append(L"start");
       speechCommandList->Append(L"stop");
+      speechCommandList->Append(L"save");
 
       Windows::Media::SpeechRecognition::SpeechRecognitionListConstraint^ spConstraint =
         ref new Windows::Media::SpeechRecognition::SpeechRecognitionListConstraint(
@@ -323,6 +382,10 @@ namespace Recorder
       {
         concurrency::create_async([&]() { StopRecording(); });
       }
+      else if (args->Result->Text == L"save")
+      {
+        concurrency::create_async([&]() { SaveFlightRecording(); });
+      }
 
       // When the debugger is attached, we can print information to the debug console.
       dbg::trace(
@@ -402,6 +465,40 @@ namespace Recorder
     _sensorFrameRecorder =
       ref new HoloLensForCV::SensorFrameRecorder();
 
+    //
+    // Record one-minute segments, so that stopping does not take longer for long
+    // recordings and the finished segments can be downloaded while recording.
+    //
+    _sensorFrameRecorder->SegmentDurationInSeconds = 60;
+
+    //
+    // Store the PV camera's frames as JPEG and the research mode sensors' frames as
+    // lossless PNG, which take a fraction of the space and time to download of the
+    // raw PGM/PPM files, encoded off the sensor threads.
+    //
+    for (int32_t sensorTypeAsIndex = 0; sensorTypeAsIndex < (int32_t)HoloLensForCV::SensorType::NumberOfSensorTypes; ++sensorTypeAsIndex)
+    {
+      const HoloLensForCV::SensorType sensorType =
+        (HoloLensForCV::SensorType)sensorTypeAsIndex;
+
+      _sensorFrameRecorder->SetImageCodec(
+        sensorType,
+        HoloLensForCV::SensorType::PhotoVideo == sensorType ?
+          HoloLensForCV::RecordingImageCodec::Jpeg :
+          HoloLensForCV::RecordingImageCodec::Png);
+    }
+
+    _sensorFrameRecorder->JpegQuality = 90;
+
+#ifdef RECORDER_USE_FLIGHT_RECORDER
+    //
+    // Keep the last minute of every sensor, but no more than 128MB of any one sensor:
+    // at 30 frames per second, about 15 seconds of a visible light camera.
+    //
+    _sensorFrameRecorder->FlightRecorderDurationInSeconds = 60;
+    _sensorFrameRecorder->FlightRecorderSizeInMegabytes = 128;
+#endif // RECORDER_USE_FLIGHT_RECORDER
+
     _photoVideoMediaFrameSourceGroup =
         ref new HoloLensForCV::MediaFrameSourceGroup(
             HoloLensForCV::MediaFrameSourceGroupType::PhotoVideoCamera,
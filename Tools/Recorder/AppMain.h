@@ -46,6 +46,9 @@ namespace Recorder
     void StartRecording();
     void StopRecording();
 
+    // Saves the frames kept by the flight recorder to a recording.
+    void SaveFlightRecording();
+
     // Initializes a speech recognizer.
     bool InitializeSpeechRecognizer();
 